@@ -20,6 +20,9 @@
 #include "../dbcore/sm-chkpt.h"
 #include "../dbcore/sm-cmd-log.h"
 #include "../dbcore/sm-config.h"
+#include "../dbcore/sm-delta.h"
+#include "../dbcore/sm-evict.h"
+#include "../dbcore/sm-gc.h"
 #include "../dbcore/sm-table.h"
 #include "../dbcore/sm-log.h"
 #include "../dbcore/sm-log-recover-impl.h"
@@ -31,6 +34,25 @@ std::vector<bench_worker *> bench_runner::cmdlog_redoers;
 
 thread_local ermia::epoch_num coroutine_batch_end_epoch = 0;
 
+// Which loop ran the transactions, to label latency numbers
+static const char *scheduler_name() {
+  if (!ermia::config::coro_tx) {
+    return "sequential";
+  }
+#ifdef ADV_COROUTINE
+  return "coro-nested";
+#else
+  if (ermia::config::coro_pipeline_schedule) {
+    return "coro-pipeline";
+  } else if (ermia::config::coro_batch_schedule) {
+    return "coro-batch";
+  } else if (ermia::config::coro_work_stealing) {
+    return "coro-work-stealing";
+  }
+  return "coro";
+#endif
+}
+
 void bench_worker::do_workload_function(uint32_t i) {
   ASSERT(workload.size() && cmdlog_redo_workload.size() == 0);
 retry:
@@ -72,10 +94,14 @@ bool bench_worker::finish_workload(rc_t ret, uint32_t workload_idx, util::timer
   if (!ret.IsAbort()) {
     ++ntxn_commits;
     std::get<0>(txn_counts[workload_idx])++;
-    if (!ermia::config::is_backup_srv() && ermia::config::group_commit) {
-      ermia::logmgr->enqueue_committed_xct(worker_id, t.get_start());
+    if (ermia::config::commit_queue_latency()) {
+      ermia::logmgr->enqueue_committed_xct(worker_id, t.get_start(), workload_idx);
+      // Durability latency is recorded by the log flusher on dequeue
+      txn_latency[workload_idx].Record(t.lap());
     } else {
-      latency_numer_us += t.lap();
+      uint64_t latency_us = t.lap();
+      latency_numer_us += latency_us;
+      txn_latency[workload_idx].Record(latency_us);
     }
     backoff_shifts >>= 1;
   } else {
@@ -127,7 +153,7 @@ bool bench_worker::finish_workload(rc_t ret, uint32_t workload_idx, util::timer
 void bench_worker::MyWork(char *) {
   if (is_worker) {
     workload = get_workload();
-    txn_counts.resize(workload.size());
+    prepare_txn_stats(workload.size());
     barrier_a->count_down();
     barrier_b->wait_for();
 
@@ -138,7 +164,7 @@ void bench_worker::MyWork(char *) {
 
   } else {
     cmdlog_redo_workload = get_cmdlog_redo_workload();
-    txn_counts.resize(cmdlog_redo_workload.size());
+    prepare_txn_stats(cmdlog_redo_workload.size());
     if (ermia::config::replay_policy == ermia::config::kReplayBackground) {
       ermia::CommandLog::cmd_log->BackgroundReplay(worker_id,
         std::bind(&bench_worker::do_cmdlog_redo_workload_function, this, std::placeholders::_1, std::placeholders::_2));
@@ -208,6 +234,7 @@ void bench_runner::run() {
           }
         }
       }
+      finish_load();
     }
     ermia::volatile_write(ermia::MM::safesnap_lsn, ermia::logmgr->cur_lsn().offset());
     ALWAYS_ASSERT(ermia::MM::safesnap_lsn);
@@ -263,6 +290,7 @@ void bench_runner::run() {
     if (ermia::config::enable_chkpt) {
       ermia::chkptmgr->start_chkpt_thread();
     }
+    ermia::evict::start_evict_thread();
     ermia::volatile_write(ermia::config::state, ermia::config::kStateForwardProcessing);
   }
 
@@ -271,6 +299,10 @@ void bench_runner::run() {
   if (ermia::config::read_view_stat_interval_ms) {
     read_view_observer = std::move(std::thread(measure_read_view_lsn));
   }
+  std::thread memory_observer;
+  if (ermia::config::mem_stat_interval_ms) {
+    memory_observer = std::move(std::thread(measure_memory));
+  }
 
   if (ermia::config::worker_threads) {
     start_measurement();
@@ -308,6 +340,9 @@ void bench_runner::run() {
   if (ermia::config::read_view_stat_interval_ms) {
     read_view_observer.join();
   }
+  if (ermia::config::mem_stat_interval_ms) {
+    memory_observer.join();
+  }
 }
 
 void bench_runner::measure_read_view_lsn() {
@@ -332,6 +367,68 @@ void bench_runner::measure_read_view_lsn() {
   }
 }
 
+void bench_runner::measure_memory() {
+  std::ofstream out_file(ermia::config::mem_stat_file, std::ios::out | std::ios::trunc);
+  LOG_IF(FATAL, !out_file.is_open()) << "Memory stat file not open";
+  DEFER(out_file.close());
+  // Walking the tables needs to enter MM epochs
+  ermia::MM::register_thread();
+  DEFER(ermia::MM::deregister_thread());
+
+  // One row per dump; histograms are cumulative, the rest is a snapshot
+  typedef ermia::chain_histogram hist;
+  out_file << "Time,EpochLag,GcLsnLag,FreeReadyBytes,FreePendingBytes,DepotBytes";
+  for (uint32_t i = 0; i < hist::kBuckets; ++i) {
+    out_file << ",ReadHops_" << hist::BucketLow(i);
+  }
+  for (uint32_t i = 0; i < hist::kBuckets; ++i) {
+    out_file << ",GcChain_" << hist::BucketLow(i);
+  }
+  for (auto &t : ermia::TableDescriptor::name_map) {
+    const std::string &n = t.first;
+    out_file << "," << n << ".Records," << n << ".Versions," << n << ".VersionBytes,"
+             << n << ".KeyBytes," << n << ".OidArrayBytes," << n << ".MaxChain";
+  }
+  for (auto &i : ermia::TableDescriptor::index_map) {
+    out_file << "," << i.first << ".IndexBytes";
+  }
+  out_file << std::endl;
+
+  while (!ermia::config::IsShutdown()) {
+    if (!ermia::config::IsForwardProcessing()) {
+      usleep(1000);
+      continue;
+    }
+    uint64_t t = std::chrono::system_clock::now().time_since_epoch() /
+                 std::chrono::milliseconds(1);
+    uint64_t lsn = ermia::logmgr->cur_lsn().offset();
+    uint64_t gc_lsn = ermia::volatile_read(ermia::MM::gc_lsn);
+    ermia::MM::free_pool_stats pools = ermia::MM::get_free_pool_stats();
+    out_file << t << ","
+             << ermia::MM::mm_epochs.get_cur_epoch() - ermia::volatile_read(ermia::MM::gc_epoch)
+             << "," << (lsn > gc_lsn ? lsn - gc_lsn : 0) << "," << pools.ready_bytes << ","
+             << pools.pending_bytes << "," << pools.depot_bytes;
+    ermia::version_chain_stats chains = ermia::get_version_chain_stats();
+    for (uint32_t i = 0; i < hist::kBuckets; ++i) {
+      out_file << "," << chains.read_hops.counts[i];
+    }
+    for (uint32_t i = 0; i < hist::kBuckets; ++i) {
+      out_file << "," << chains.gc_lengths.counts[i];
+    }
+    for (auto &td : ermia::TableDescriptor::name_map) {
+      ermia::table_mem_stats s;
+      td.second->CollectMemStats(s);
+      out_file << "," << s.records << "," << s.versions << "," << s.version_bytes << ","
+               << s.key_bytes << "," << s.oid_array_bytes << "," << s.max_chain;
+    }
+    for (auto &i : ermia::TableDescriptor::index_map) {
+      out_file << "," << i.second->MemoryBytes();
+    }
+    out_file << std::endl;
+    usleep(ermia::config::mem_stat_interval_ms * 1000);
+  }
+}
+
 void bench_runner::start_measurement() {
   workers = make_workers();
   ALWAYS_ASSERT(!workers.empty());
@@ -424,10 +521,15 @@ void bench_runner::start_measurement() {
   }
 
   if (ermia::config::print_cpu_util) {
-    printf("Sec,Commits,Aborts,CPU\n");
+    printf("Sec,Commits,Aborts,CPU");
   } else {
-    printf("Sec,Commits,Aborts\n");
+    printf("Sec,Commits,Aborts");
   }
+  printf(ermia::config::coro_adaptive_batch ? ",CoroDepth\n" : "\n");
+
+  // Loading walks version chains too, only count what the benchmark does
+  const ermia::version_chain_stats chains_before = ermia::get_version_chain_stats();
+  const ermia::delta_stats deltas_before = ermia::get_delta_stats();
 
   util::timer t, t_nosync;
   barrier_b.count_down();  // bombs away!
@@ -449,9 +551,19 @@ void bench_runner::start_measurement() {
     if (ermia::config::print_cpu_util) {
       sec_util = get_cpu_util();
       total_util += sec_util;
-      printf("%lu,%lu,%lu,%.2f%%\n", slept + 1, sec_commits, sec_aborts, sec_util);
+      printf("%lu,%lu,%lu,%.2f%%", slept + 1, sec_commits, sec_aborts, sec_util);
+    } else {
+      printf("%lu,%lu,%lu", slept + 1, sec_commits, sec_aborts);
+    }
+    if (ermia::config::coro_adaptive_batch) {
+      // Average number of in-flight coroutines across workers
+      double depth = 0;
+      for (size_t i = 0; i < ermia::config::worker_threads; i++) {
+        depth += workers[i]->get_coro_batch_depth();
+      }
+      printf(",%.2f\n", depth / ermia::config::worker_threads);
     } else {
-      printf("%lu,%lu,%lu\n", slept + 1, sec_commits, sec_aborts);
+      printf("\n");
     }
     slept++;
   };
@@ -472,6 +584,8 @@ void bench_runner::start_measurement() {
   for (size_t i = 0; i < ermia::config::worker_threads; i++) {
     workers[i]->Join();
   }
+  ermia::MM::stop_gc_threads();
+  ermia::evict::stop_evict_thread();
 
   if (ermia::config::num_backups) {
     delete ermia::logmgr;
@@ -501,6 +615,9 @@ void bench_runner::start_measurement() {
   size_t n_rw_aborts = 0;
   size_t n_phantom_aborts = 0;
   size_t n_query_commits = 0;
+  size_t n_steals = 0;
+  uint64_t coro_frame_chunk_bytes = 0;
+  uint64_t coro_frame_high_water = 0;
   uint64_t latency_numer_us = 0;
   for (size_t i = 0; i < ermia::config::worker_threads; i++) {
     n_commits += workers[i]->get_ntxn_commits();
@@ -512,12 +629,16 @@ void bench_runner::start_measurement() {
     n_rw_aborts += workers[i]->get_ntxn_rw_aborts();
     n_phantom_aborts += workers[i]->get_ntxn_phantom_aborts();
     n_query_commits += workers[i]->get_ntxn_query_commits();
-    if (ermia::config::is_backup_srv() || !ermia::config::group_commit) {
+    n_steals += workers[i]->get_ntxn_steals();
+    coro_frame_chunk_bytes += workers[i]->get_coro_frame_stats().chunk_bytes;
+    coro_frame_high_water =
+      std::max(coro_frame_high_water, workers[i]->get_coro_frame_stats().high_water);
+    if (!ermia::config::commit_queue_latency()) {
       latency_numer_us += workers[i]->get_latency_numer_us();
     }
   }
 
-  if (!ermia::config::is_backup_srv() && ermia::config::group_commit) {
+  if (ermia::config::commit_queue_latency()) {
     latency_numer_us = ermia::sm_log_alloc_mgr::commit_queue::total_latency_us;
   }
 
@@ -577,6 +698,28 @@ void bench_runner::start_measurement() {
     }
   }
 
+  tx_latency_map agg_txn_latency;
+  ermia::LatencyHistogram queue_delay;
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i]->merge_txn_latency(agg_txn_latency);
+    queue_delay.Merge(workers[i]->get_queue_delay());
+  }
+  // Under group commit the above is execution latency (unless coroutine
+  // transactions waited for durability themselves); durability latency
+  // (commit to log flush) comes from the commit queues
+  const bool has_durable_latency = ermia::config::commit_queue_latency();
+  tx_latency_map agg_durable_latency;
+  ermia::LatencyHistogram durable_latency;
+  if (has_durable_latency) {
+    // The queues record by workload index, the same for all workers
+    const bench_worker::workload_desc_vec types = workers[0]->get_workload();
+    for (size_t i = 0; i < types.size(); i++) {
+      const ermia::LatencyHistogram &h = ermia::sm_log_alloc_mgr::commit_queue::durable_latency[i];
+      agg_durable_latency[types[i].name].Merge(h);
+      durable_latency.Merge(h);
+    }
+  }
+
   if (ermia::config::enable_chkpt) delete ermia::chkptmgr;
 
   if (ermia::config::verbose) {
@@ -605,6 +748,47 @@ void bench_runner::start_measurement() {
     std::cerr << "agg_abort_rate: " << agg_abort_rate << " aborts/sec" << std::endl;
     std::cerr << "avg_per_core_abort_rate: " << avg_per_core_abort_rate
          << " aborts/sec/core" << std::endl;
+    if (ermia::config::coro_work_stealing) {
+      std::cerr << "stolen_txns: " << n_steals << std::endl;
+    }
+    if (ermia::config::coro_tx) {
+      std::cerr << "coro_frame_memory: " << coro_frame_chunk_bytes / ermia::config::MB
+                << " MB" << std::endl;
+      std::cerr << "max_coro_frame_bytes_in_use: " << coro_frame_high_water << std::endl;
+    }
+    if (ermia::config::enable_gc && ermia::config::gc_threads_per_node) {
+      ermia::MM::gc_stats gc = ermia::MM::get_gc_stats();
+      std::cerr << "gc_chains: " << gc.chains << std::endl;
+      std::cerr << "gc_recycled_versions: " << gc.versions << std::endl;
+      std::cerr << "gc_dropped_chains: " << gc.dropped << std::endl;
+      std::cerr << "gc_max_backlog: " << gc.max_backlog << std::endl;
+      std::cerr << "gc_busy_time: " << gc.busy_us / 1000 << " ms" << std::endl;
+    }
+    ermia::version_chain_stats chains = ermia::get_version_chain_stats();
+    const uint64_t chain_reads = chains.reads - chains_before.reads;
+    std::cerr << "version_chain_reads: " << chain_reads << std::endl;
+    std::cerr << "avg_version_hops: "
+              << (chain_reads ? double(chains.hops - chains_before.hops) / chain_reads : 0)
+              << std::endl;
+    std::cerr << "max_version_hops: " << chains.max_hops << std::endl;
+    ermia::delta_stats deltas = ermia::get_delta_stats();
+    const uint64_t new_versions = deltas.versions - deltas_before.versions;
+    std::cerr << "update_versions: " << new_versions << std::endl;
+    std::cerr << "delta_versions: " << deltas.deltas - deltas_before.deltas << std::endl;
+    std::cerr << "update_version_bytes: " << deltas.bytes - deltas_before.bytes << std::endl;
+    std::cerr << "avg_update_version_bytes: "
+              << (new_versions ? double(deltas.bytes - deltas_before.bytes) / new_versions : 0)
+              << std::endl;
+    std::cerr << "delta_reconstructions: "
+              << deltas.materialized - deltas_before.materialized << std::endl;
+    if (ermia::config::evict_threshold_pct) {
+      ermia::evict::evict_stats evicts = ermia::evict::get_evict_stats();
+      std::cerr << "evicted_records: " << evicts.evicted << std::endl;
+      std::cerr << "evicted_bytes: " << evicts.bytes << std::endl;
+      std::cerr << "evict_faults: " << evicts.faults << std::endl;
+      std::cerr << "evict_reloads: " << evicts.reloads << std::endl;
+      std::cerr << "evict_sweeps: " << evicts.sweeps << std::endl;
+    }
 #ifndef __clang__
     std::cerr << "txn breakdown: " << util::format_list(agg_txn_counts.begin(),
                                                    agg_txn_counts.end()) << std::endl;
@@ -642,7 +826,62 @@ void bench_runner::start_measurement() {
          << " system aborts/s\t" << std::get<3>(c.second) / (double)elapsed_sec
          << " user aborts/s\n";
   }
+
+  std::cout << "---------------------------------------\n";
+  std::cout << "latency (us), " << scheduler_name() << " scheduler\n";
+  for (auto &h : agg_txn_latency) {
+    std::cout << h.first << "\t";
+    h.second.PrintSummary(std::cout);
+    std::cout << "\n";
+  }
+  if (has_durable_latency) {
+    std::cout << "(durable)\t";
+    durable_latency.PrintSummary(std::cout);
+    std::cout << "\n";
+    std::cout << "durable latency (us), commit to log flush\n";
+    for (auto &h : agg_durable_latency) {
+      std::cout << h.first << "\t";
+      h.second.PrintSummary(std::cout);
+      std::cout << "\n";
+    }
+  }
+  if (ermia::config::coro_work_stealing) {
+    // Time from arrival to start, not included above
+    std::cout << "(queued)\t";
+    queue_delay.PrintSummary(std::cout);
+    std::cout << "\n";
+  }
   std::cout.flush();
+
+  if (!ermia::config::latency_json.empty()) {
+    std::ofstream out_file(ermia::config::latency_json, std::ios::out | std::ios::trunc);
+    LOG_IF(FATAL, !out_file.is_open()) << "Latency JSON file not open";
+    out_file << "{\"scheduler\": \"" << scheduler_name() << "\", \"unit\": \"us\", \"txns\": {";
+    bool first = true;
+    for (auto &h : agg_txn_latency) {
+      out_file << (first ? "" : ", ") << "\"" << h.first << "\": ";
+      h.second.PrintJson(out_file);
+      first = false;
+    }
+    out_file << "}";
+    if (has_durable_latency) {
+      out_file << ", \"durable\": ";
+      durable_latency.PrintJson(out_file);
+      out_file << ", \"durable_txns\": {";
+      first = true;
+      for (auto &h : agg_durable_latency) {
+        out_file << (first ? "" : ", ") << "\"" << h.first << "\": ";
+        h.second.PrintJson(out_file);
+        first = false;
+      }
+      out_file << "}";
+    }
+    if (ermia::config::coro_work_stealing) {
+      out_file << ", \"queued\": ";
+      queue_delay.PrintJson(out_file);
+    }
+    out_file << "}" << std::endl;
+  }
 }
 
 template <typename K, typename V>
@@ -662,6 +901,12 @@ const tx_stat_map bench_worker::get_txn_counts() const {
   return m;
 }
 
+void bench_worker::merge_txn_latency(tx_latency_map &agg) const {
+  const workload_desc_vec workload = get_workload();
+  for (size_t i = 0; i < txn_latency.size(); i++)
+    agg[workload[i].name].Merge(txn_latency[i]);
+}
+
 const tx_stat_map bench_worker::get_cmdlog_txn_counts() const {
   tx_stat_map m;
   const cmdlog_redo_workload_desc_vec workload = get_cmdlog_redo_workload();
@@ -670,12 +915,24 @@ const tx_stat_map bench_worker::get_cmdlog_txn_counts() const {
   return m;
 }
 
+// Continuously refills a slot as soon as its transaction finishes, instead of
+// waiting for the whole batch to drain as Scheduler() does.
+//
+// The epoch manager only tracks one [begin, end] window per thread, so slots
+// can't enter and exit epochs independently. Instead each slot is started
+// under the worker's current epoch (which is also its xc->begin_epoch), and
+// the worker rotates to a new epoch whenever the global epoch has moved on or
+// it has allocated enough to end the current one: it stops refilling, lets
+// the in-flight slots finish, exits the epoch with the largest end LSN of
+// those transactions, and re-enters. This keeps the worker from pinning an
+// old epoch (and thus GC) while slots are busy only for the short drain
+// period, which is bounded by the longest transaction in flight.
+//
+// With --coro_adaptive_batch, only the first batch_ctrl->depth() slots are
+// used. Every [depth] finished transactions count as one batch for the
+// controller; when it goes shallower the slots beyond the new depth aren't
+// refilled, when it goes deeper the new slots start right away.
 void bench_worker::PipelineScheduler() {
-#ifdef BATCH_SAME_TRX
-  LOG(FATAL) << "Pipeline scheduler doesn't work with batching same-type transactions";
-#endif
-  LOG(INFO) << "Epoch management and latency recorder in Pipeline scheduler are not logically correct";
-
   CoroTxnHandle *handles = (CoroTxnHandle *)numa_alloc_onnode(
     sizeof(CoroTxnHandle) * ermia::config::coro_batch_size, numa_node_of_cpu(sched_getcpu()));
   memset(handles, 0, sizeof(CoroTxnHandle) * ermia::config::coro_batch_size);
@@ -689,47 +946,103 @@ void bench_worker::PipelineScheduler() {
   util::timer *ts = (util::timer *)numa_alloc_onnode(
     sizeof(util::timer) * ermia::config::coro_batch_size, numa_node_of_cpu(sched_getcpu()));
 
+  batch_ctrl = new coro_batch_controller(ermia::config::coro_batch_size,
+                                         ermia::config::coro_adaptive_batch,
+                                         ermia::config::coro_batch_pmu);
+
   barrier_a->count_down();
   barrier_b->wait_for();
 
-  for (uint32_t i = 0; i < ermia::config::coro_batch_size; i++) {
-    uint32_t workload_idx = fetch_workload();
-    workload_idxs[i] = workload_idx;
-    handles[i] = workload[workload_idx].coro_fn(this, i, 0).get_handle();
+#ifdef BATCH_SAME_TRX
+  // Same-type batching: every coro_batch_size consecutive refills run the
+  // same transaction type
+  uint32_t batch_workload_idx = fetch_workload();
+  uint32_t batch_refills = 0;
+#endif
+
+  auto start_slot = [&](uint32_t i, ermia::epoch_num e) {
+#ifdef BATCH_SAME_TRX
+    if (batch_refills++ == ermia::config::coro_batch_size) {
+      batch_workload_idx = fetch_workload();
+      batch_refills = 1;
+    }
+    workload_idxs[i] = batch_workload_idx;
+#else
+    workload_idxs[i] = fetch_workload();
+#endif
+    // Latency is per transaction, starting from when it gets its slot
     new (&ts[i]) util::timer();
-  }
+    handles[i] = workload[workload_idxs[i]].coro_fn(this, i, e).get_handle();
+  };
+
+  uint32_t depth = batch_ctrl->depth();
+  uint32_t batch_finished = 0;
+  batch_ctrl->batch_begin();
 
-  uint32_t i = 0;
-  coroutine_batch_end_epoch = 0;
-  ermia::epoch_num begin_epoch = ermia::MM::epoch_enter();
   while (running) {
-    if (handles[i].done()) {
-      rcs[i] = handles[i].promise().get_return_value();
+    coroutine_batch_end_epoch = 0;
+    ermia::epoch_num begin_epoch = ermia::MM::epoch_enter();
+    uint32_t active = depth;
+    bool draining = false;
+
+    for (uint32_t i = 0; i < depth; i++) {
+      start_slot(i, begin_epoch);
+    }
+
+    uint32_t i = 0;
+    while (active) {
+      if (handles[i]) {
+        if (handles[i].done()) {
+          rcs[i] = handles[i].promise().get_return_value();
 #ifdef CORO_BATCH_COMMIT
-      if (!rcs[i].IsAbort()) {
-        rcs[i] = db->Commit(&transactions[i]);
-      }
+          if (!rcs[i].IsAbort()) {
+            rcs[i] = db->Commit(&transactions[i]);
+          }
 #endif
-      finish_workload(rcs[i], workload_idxs[i], ts[i]);
-      handles[i].destroy();
+          finish_workload(rcs[i], workload_idxs[i], ts[i]);
+          handles[i].destroy();
+          handles[i] = nullptr;
+          --active;
+
+          uint32_t old_depth = depth;
+          if (++batch_finished == depth) {
+            batch_ctrl->batch_end(batch_finished);
+            batch_finished = 0;
+            depth = batch_ctrl->depth();
+            batch_ctrl->batch_begin();
+          }
 
-      ts[i].lap();
-      uint32_t workload_idx = fetch_workload();
-      workload_idxs[i] = workload_idx;
-      handles[i] = workload[workload_idx].coro_fn(this, i, 0).get_handle();
-    } else if (!handles[i].promise().callee_coro || handles[i].promise().callee_coro.done()) {
-      handles[i].resume();
-    } else {
-      handles[i].promise().callee_coro.resume();
+          if (!draining) {
+            draining = !running ||
+                       ermia::MM::mm_epochs.get_cur_epoch() != begin_epoch ||
+                       ermia::MM::epoch_end_due();
+          }
+          if (!draining) {
+            if (i < depth) {
+              start_slot(i, begin_epoch);
+              ++active;
+            }
+            for (uint32_t j = old_depth; j < depth; j++) {
+              if (!handles[j]) {
+                start_slot(j, begin_epoch);
+                ++active;
+              }
+            }
+          }
+        } else {
+          handles[i].promise().resume_leaf();
+        }
+      }
+
+      if (++i == ermia::config::coro_batch_size) {
+        i = 0;
+      }
     }
 
-    i = (i + 1) & (ermia::config::coro_batch_size - 1);
+    ermia::MM::epoch_exit(coroutine_batch_end_epoch, begin_epoch);
   }
-
-  ermia::MM::epoch_exit(coroutine_batch_end_epoch, begin_epoch);
 }
 
-
 void bench_worker::Scheduler() {
 #ifdef BATCH_SAME_TRX
   LOG(FATAL) << "General scheduler doesn't work with batching same-type transactions";
@@ -747,23 +1060,29 @@ void bench_worker::Scheduler() {
   rc_t *rcs = (rc_t *)numa_alloc_onnode(
     sizeof(rc_t) * ermia::config::coro_batch_size, numa_node_of_cpu(sched_getcpu()));
 
+  batch_ctrl = new coro_batch_controller(ermia::config::coro_batch_size,
+                                         ermia::config::coro_adaptive_batch,
+                                         ermia::config::coro_batch_pmu);
+
   barrier_a->count_down();
   barrier_b->wait_for();
 
   while (running) {
     coroutine_batch_end_epoch = 0;
     ermia::epoch_num begin_epoch = ermia::MM::epoch_enter();
-    uint32_t todo = ermia::config::coro_batch_size;
+    const uint32_t batch_size = batch_ctrl->depth();
+    uint32_t todo = batch_size;
+    batch_ctrl->batch_begin();
     util::timer t;
 
-    for (uint32_t i = 0; i < ermia::config::coro_batch_size; i++) {
+    for (uint32_t i = 0; i < batch_size; i++) {
       uint32_t workload_idx = fetch_workload();
       workload_idxs[i] = workload_idx;
       handles[i] = workload[workload_idx].coro_fn(this, i, 0).get_handle();
     }
 
     while (todo) {
-      for (uint32_t i = 0; i < ermia::config::coro_batch_size; i++) {
+      for (uint32_t i = 0; i < batch_size; i++) {
         if (!handles[i]) {
           continue;
         }
@@ -773,14 +1092,13 @@ void bench_worker::Scheduler() {
           handles[i].destroy();
           handles[i] = nullptr;
           --todo;
-        } else if (!handles[i].promise().callee_coro || handles[i].promise().callee_coro.done()) {
-          handles[i].resume();
         } else {
-          handles[i].promise().callee_coro.resume();
+          handles[i].promise().resume_leaf();
         }
       }
     }
 
+    batch_ctrl->batch_end(batch_size);
     ermia::MM::epoch_exit(coroutine_batch_end_epoch, begin_epoch);
   }
 }
@@ -797,23 +1115,29 @@ void bench_worker::BatchScheduler() {
   LOG(FATAL) << "Batch scheduler batches same-type transactions";
 #endif
 
+  batch_ctrl = new coro_batch_controller(ermia::config::coro_batch_size,
+                                         ermia::config::coro_adaptive_batch,
+                                         ermia::config::coro_batch_pmu);
+
   barrier_a->count_down();
   barrier_b->wait_for();
 
   while (running) {
     coroutine_batch_end_epoch = 0;
     ermia::epoch_num begin_epoch = ermia::MM::epoch_enter();
-    uint32_t todo = ermia::config::coro_batch_size;
+    const uint32_t batch_size = batch_ctrl->depth();
+    uint32_t todo = batch_size;
+    batch_ctrl->batch_begin();
     uint32_t workload_idx = -1;
     workload_idx = fetch_workload();
     util::timer t;
 
-    for (uint32_t i = 0; i < ermia::config::coro_batch_size; i++) {
+    for (uint32_t i = 0; i < batch_size; i++) {
       handles[i] = workload[workload_idx].coro_fn(this, i, 0).get_handle();
     }
 
     while (todo) {
-      for (uint32_t i = 0; i < ermia::config::coro_batch_size; i++) {
+      for (uint32_t i = 0; i < batch_size; i++) {
         if (!handles[i]) {
           continue;
         }
@@ -825,26 +1149,177 @@ void bench_worker::BatchScheduler() {
           handles[i].destroy();
           handles[i] = nullptr;
           --todo;
-        } else if (!handles[i].promise().callee_coro || handles[i].promise().callee_coro.done()) {
-          handles[i].resume();
         } else {
-          handles[i].promise().callee_coro.resume();
+          handles[i].promise().resume_leaf();
         }
       }
     }
 
 #ifdef CORO_BATCH_COMMIT
-    for (uint32_t i = 0; i < ermia::config::coro_batch_size; i++) {
-      if (!rcs[i].IsAbort()) {
-        rcs[i] = db->Commit(&transactions[i]);
-      }
-      // No need to abort - TryCatchCond family of macros should have already
+    // Aborts during execution were already handled by the TryCatchCond family
+    // of macros; CommitBatch aborts those failing to commit
+    db->CommitBatch(transactions, rcs, batch_size);
+    for (uint32_t i = 0; i < batch_size; i++) {
       finish_workload(rcs[i], workload_idx, t);
     }
 #endif
 
+    batch_ctrl->batch_end(batch_size);
     ermia::MM::epoch_exit(coroutine_batch_end_epoch, begin_epoch);
   }
 }
 
 
+
+bool bench_worker::steal_request(txn_request &req) {
+  // Two passes: peers on my own NUMA node first, then everyone else
+  const uint32_t nworkers = bench_runner::workers.size();
+  for (uint32_t pass = 0; pass < 2; ++pass) {
+    for (uint32_t k = 1; k < nworkers; ++k) {
+      bench_worker *victim = bench_runner::workers[(worker_id + k) % nworkers];
+      if (!victim->requests || ((victim->me->node == me->node) != (pass == 0))) {
+        continue;
+      }
+      // Don't bother with peers that have nothing queued behind their batch
+      if (victim->requests->size() && victim->requests->steal(req)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Requests arrive in bursts of coro_batch_size every coro_request_interval_us,
+// whether or not the worker keeps up; a burst that doesn't fit waits for room
+// but keeps its arrival time. Returns whether any request was added.
+bool bench_worker::generate_requests(uint64_t &next_arrival_usec, txn_inputs &own_inputs) {
+  const uint64_t now = util::timer::cur_usec();
+  const uint32_t burst = ermia::config::coro_batch_size;
+  if (next_arrival_usec > now || requests->size() + burst > kRequestDequeCapacity) {
+    return false;
+  }
+
+  // Slots leave their own inputs behind in the generators
+  load_txn_inputs(own_inputs);
+  do {
+    for (uint32_t i = 0; i < burst; ++i) {
+      txn_request req;
+      req.arrival_usec = next_arrival_usec;
+      req.seed = r.next();
+      req.workload_idx = fetch_workload();
+      req.home = home_partition();
+      bool pushed = requests->push(req);
+      ALWAYS_ASSERT(pushed);
+    }
+    next_arrival_usec += ermia::config::coro_request_interval_us;
+  } while (next_arrival_usec <= now && requests->size() + burst <= kRequestDequeCapacity);
+  save_txn_inputs(own_inputs);
+  return true;
+}
+
+// Same as Scheduler(), but batch slots are filled from a per-worker request
+// deque which idle workers can steal from. A worker steals only once its own
+// deque is empty and its next burst of requests isn't due yet, taking the
+// oldest requests of (preferably NUMA-local) peers that are stuck behind a
+// long batch. Only requests that have not started yet move: a suspended
+// transaction is tied to its worker's TLS state (epoch, allocator, XID and
+// serial slots) and per-slot transaction/arena, so it cannot migrate.
+void bench_worker::WorkStealingScheduler() {
+#ifdef BATCH_SAME_TRX
+  LOG(FATAL) << "Work-stealing scheduler doesn't work with batching same-type transactions";
+#endif
+#ifdef CORO_BATCH_COMMIT
+  LOG(FATAL) << "Work-stealing scheduler doesn't work with batching commits";
+#endif
+
+  CoroTxnHandle *handles = (CoroTxnHandle *)numa_alloc_onnode(
+    sizeof(CoroTxnHandle) * ermia::config::coro_batch_size, numa_node_of_cpu(sched_getcpu()));
+  memset(handles, 0, sizeof(CoroTxnHandle) * ermia::config::coro_batch_size);
+
+  txn_request *reqs = (txn_request *)numa_alloc_onnode(
+    sizeof(txn_request) * ermia::config::coro_batch_size, numa_node_of_cpu(sched_getcpu()));
+
+  txn_inputs *inputs = (txn_inputs *)numa_alloc_onnode(
+    sizeof(txn_inputs) * ermia::config::coro_batch_size, numa_node_of_cpu(sched_getcpu()));
+
+  rc_t *rcs = (rc_t *)numa_alloc_onnode(
+    sizeof(rc_t) * ermia::config::coro_batch_size, numa_node_of_cpu(sched_getcpu()));
+
+  util::timer *ts = (util::timer *)numa_alloc_onnode(
+    sizeof(util::timer) * ermia::config::coro_batch_size, numa_node_of_cpu(sched_getcpu()));
+
+  // Must be ready before the barriers; peers start stealing right after
+  requests = (request_deque *)numa_alloc_onnode(sizeof(request_deque),
+                                                numa_node_of_cpu(sched_getcpu()));
+  new (requests) request_deque();
+
+  batch_ctrl = new coro_batch_controller(ermia::config::coro_batch_size,
+                                         ermia::config::coro_adaptive_batch,
+                                         ermia::config::coro_batch_pmu);
+
+  barrier_a->count_down();
+  barrier_b->wait_for();
+
+  txn_inputs own_inputs;
+  save_txn_inputs(own_inputs);
+  uint64_t next_arrival_usec = util::timer::cur_usec();
+
+  while (running) {
+    generate_requests(next_arrival_usec, own_inputs);
+    const uint32_t batch_size = batch_ctrl->depth();
+    uint32_t n = 0;
+    while (n < batch_size) {
+      if (requests->pop(reqs[n])) {
+        ++n;
+      } else if (steal_request(reqs[n])) {
+        ++ntxn_steals;
+        ++n;
+      } else {
+        break;
+      }
+    }
+    if (!n) {
+      // Nothing to run or steal until my next burst
+      NOP_PAUSE;
+      continue;
+    }
+
+    coroutine_batch_end_epoch = 0;
+    ermia::epoch_num begin_epoch = ermia::MM::epoch_enter();
+    uint32_t todo = n;
+    batch_ctrl->batch_begin();
+
+    for (uint32_t i = 0; i < n; i++) {
+      new (&ts[i]) util::timer();
+      queue_delay.Record(ts[i].get_start() - std::min(ts[i].get_start(), reqs[i].arrival_usec));
+      seed_txn_inputs(reqs[i].seed, reqs[i].home);
+      handles[i] = workload[reqs[i].workload_idx].coro_fn(this, i, 0).get_handle();
+      save_txn_inputs(inputs[i]);
+    }
+
+    while (todo) {
+      for (uint32_t i = 0; i < n; i++) {
+        if (!handles[i]) {
+          continue;
+        }
+        if (handles[i].done()) {
+          rcs[i] = handles[i].promise().get_return_value();
+          finish_workload(rcs[i], reqs[i].workload_idx, ts[i]);
+          handles[i].destroy();
+          handles[i] = nullptr;
+          --todo;
+        } else {
+          load_txn_inputs(inputs[i]);
+          handles[i].promise().resume_leaf();
+          save_txn_inputs(inputs[i]);
+        }
+      }
+      // Keep taking arrivals while stuck on a long batch, so that peers can
+      // pick them up
+      generate_requests(next_arrival_usec, own_inputs);
+    }
+
+    batch_ctrl->batch_end(n);
+    ermia::MM::epoch_exit(coroutine_batch_end_epoch, begin_epoch);
+  }
+}
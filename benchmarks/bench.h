@@ -9,6 +9,9 @@
 #include "../util.h"
 #include "../dbcore/sm-log-alloc.h"
 #include "../dbcore/sm-coroutine.h"
+#include "../dbcore/sm-histogram.h"
+#include "coro-batch-controller.h"
+#include "work-deque.h"
 
 extern void ycsb_do_test(ermia::Engine *db, int argc, char **argv);
 extern void ycsb_cs_do_test(ermia::Engine *db, int argc, char **argv);
@@ -65,6 +68,7 @@ class bench_loader : public ermia::thread::Runner {
 
 typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t> tx_stat;
 typedef std::map<std::string, tx_stat> tx_stat_map;
+typedef std::map<std::string, ermia::LatencyHistogram> tx_latency_map;
 
 class bench_worker : public ermia::thread::Runner {
   friend class ermia::sm_log_alloc_mgr;
@@ -93,7 +97,11 @@ class bench_worker : public ermia::thread::Runner {
         ntxn_serial_aborts(0),
         ntxn_rw_aborts(0),
         ntxn_phantom_aborts(0),
-        ntxn_query_commits(0) {
+        ntxn_query_commits(0),
+        ntxn_steals(0),
+        requests(nullptr),
+        batch_ctrl(nullptr),
+        coro_frame_stats() {
     txn_obj_buf = (ermia::transaction *)malloc(sizeof(ermia::transaction));
     arena = new ermia::str_arena(ermia::config::arena_size_mb);
     if (ermia::config::numa_spread) {
@@ -162,6 +170,13 @@ class bench_worker : public ermia::thread::Runner {
   inline size_t get_ntxn_int_aborts() const { return ntxn_int_aborts; }
   inline size_t get_ntxn_phantom_aborts() const { return ntxn_phantom_aborts; }
   inline size_t get_ntxn_query_commits() const { return ntxn_query_commits; }
+  inline size_t get_ntxn_steals() const { return ntxn_steals; }
+  inline const ermia::coro::tcalloc::stats &get_coro_frame_stats() const {
+    return coro_frame_stats;
+  }
+  inline uint32_t get_coro_batch_depth() const {
+    return batch_ctrl ? batch_ctrl->depth() : ermia::config::coro_batch_size;
+  }
   inline void inc_ntxn_user_aborts() { ++ntxn_user_aborts; }
   inline void inc_ntxn_si_aborts() { ++ntxn_si_aborts; }
   inline void inc_ntxn_serial_aborts() { ++ntxn_serial_aborts; }
@@ -181,6 +196,10 @@ class bench_worker : public ermia::thread::Runner {
   const tx_stat_map get_txn_counts() const;
   const tx_stat_map get_cmdlog_txn_counts() const;
 
+  // Add this worker's per-transaction-type commit latencies to [agg]
+  void merge_txn_latency(tx_latency_map &agg) const;
+  inline const ermia::LatencyHistogram &get_queue_delay() const { return queue_delay; }
+
   void do_workload_function(uint32_t i);
   void do_cmdlog_redo_workload_function(uint32_t i, void *param);
   uint32_t fetch_workload();
@@ -190,6 +209,22 @@ class bench_worker : public ermia::thread::Runner {
   virtual void MyWork(char *);
   inline ermia::transaction *txn_buf() { return txn_obj_buf; }
 
+  // Flags for the workloads' read-only transactions, see -fast_read_only
+  static inline uint64_t read_only_txn_flags() {
+    return ermia::config::fast_read_only ? ermia::transaction::TXN_FLAG_FAST_READ_ONLY
+                                         : ermia::transaction::TXN_FLAG_READ_ONLY;
+  }
+
+  // Size the per-transaction-type stats before running [ntypes] transaction
+  // types, so that finish_workload() never allocates
+  inline void prepare_txn_stats(size_t ntypes) {
+    LOG_IF(FATAL, ermia::config::commit_queue_latency() &&
+                  ntypes > ermia::sm_log_alloc_mgr::commit_queue::kMaxTypes)
+        << "Too many transaction types for the commit queue latency histograms";
+    txn_counts.resize(ntypes);
+    txn_latency.resize(ntypes);
+  }
+
   unsigned int worker_id;
   bool is_worker;
   util::fast_random r;
@@ -202,8 +237,47 @@ class bench_worker : public ermia::thread::Runner {
   void Scheduler();
   void PipelineScheduler();
   void BatchScheduler();
+  void WorkStealingScheduler();
+
+  // What a transaction draws its inputs (keys, warehouse, etc.) from: the
+  // state of the worker's random number generators and the home partition
+  // (e.g., warehouse) it runs for. The work-stealing scheduler keeps one per
+  // slot and swaps it in around every resume, so that a transaction runs with
+  // the inputs of its request no matter which worker generated the request.
+  struct txn_inputs {
+    static const uint32_t kMaxSeeds = 5;
+    uint64_t seeds[kMaxSeeds];
+    uint32_t home;
+  };
+
+  // Benchmarks with more generators or a home partition override all four
+  virtual uint32_t home_partition() const { return 0; }
+  virtual void seed_txn_inputs(uint64_t seed, uint32_t home) {
+    MARK_REFERENCED(home);
+    r.set_seed(seed);
+  }
+  virtual void save_txn_inputs(txn_inputs &in) { in.seeds[0] = r.get_seed(); }
+  virtual void load_txn_inputs(const txn_inputs &in) { r.set_seed(in.seeds[0]); }
 
  private:
+  // A pending transaction request for the work-stealing scheduler. It carries
+  // the inputs drawn by the worker it arrived at, so a thief runs exactly the
+  // transaction the victim would have. Latency is measured from the start of
+  // the transaction as in the other schedulers; the time spent waiting in a
+  // queue is recorded separately.
+  struct txn_request {
+    uint64_t arrival_usec;
+    uint64_t seed;  // for seed_txn_inputs()
+    uint32_t workload_idx;
+    uint32_t home;
+  };
+  static const uint32_t kRequestDequeCapacity = 256;
+  typedef work_deque<txn_request, kRequestDequeCapacity> request_deque;
+
+  bool generate_requests(uint64_t &next_arrival_usec, txn_inputs &own_inputs);
+  bool steal_request(txn_request &req);
+
+
   uint64_t latency_numer_us;
   unsigned backoff_shifts;
 
@@ -217,9 +291,20 @@ class bench_worker : public ermia::thread::Runner {
   size_t ntxn_rw_aborts;
   size_t ntxn_phantom_aborts;
   size_t ntxn_query_commits;
+  size_t ntxn_steals;
+
+  request_deque *requests;
+
+  // Picks the number of in-flight coroutines per batch
+  coro_batch_controller *batch_ctrl;
 
  protected:
   std::vector<tx_stat> txn_counts;  // commits and aborts breakdown
+  std::vector<ermia::LatencyHistogram> txn_latency;  // commit latency (usec) breakdown
+  ermia::LatencyHistogram queue_delay;  // usec work-stealing requests waited to start
+
+  // Snapshot of this worker's coroutine frame allocator at the end of the run
+  ermia::coro::tcalloc::stats coro_frame_stats;
 
   ermia::transaction *txn_obj_buf;
   ermia::str_arena *arena;
@@ -250,11 +335,17 @@ class bench_runner {
   static std::vector<bench_worker *> cmdlog_redoers;
 
   static void measure_read_view_lsn();
+  // Periodically dump per-table/index memory use, chain lengths and GC lag
+  static void measure_memory();
 
  protected:
   // only called once
   virtual std::vector<bench_loader *> make_loaders() = 0;
 
+  // Called once after all loaders are done, e.g., to bulk-load the indexes
+  // from what the loaders produced
+  virtual void finish_load() {}
+
   // only called once
   virtual std::vector<bench_worker *> make_workers() = 0;
   virtual std::vector<bench_worker *> make_cmdlog_redoers() = 0;
@@ -331,6 +422,14 @@ class limit_callback : public ermia::OrderedIndex::ScanCallback {
   if (r.IsAbort()) return r; \
 }
 
+// Coroutine version of TryReturn, for nested frames that already aborted
+// the transaction they share with the caller
+#define TryReturnCoro(rc)       \
+{                               \
+  rc_t r = rc;                  \
+  if (r.IsAbort()) co_return r; \
+}
+
 // if rc == RC_FALSE then do op
 #define TryCatchCond(rc, op)       \
 {                                  \
@@ -0,0 +1,88 @@
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "coro-batch-controller.h"
+
+coro_batch_controller::coro_batch_controller(uint32_t max_depth, bool adaptive, bool use_pmu)
+    : max_depth_(max_depth),
+      adaptive_(adaptive),
+      depth_(max_depth),
+      direction_(-1),
+      batch_start_cycles_(0),
+      window_cycles_(0),
+      window_txns_(0),
+      window_batches_(0),
+      last_cycles_per_txn_(0),
+      last_llc_misses_per_txn_(0),
+      pmu_fd_(-1),
+      window_start_llc_misses_(0) {
+  ALWAYS_ASSERT(max_depth_);
+  if (use_pmu) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Count for the calling thread only, on any CPU
+    pmu_fd_ = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    LOG_IF(WARNING, pmu_fd_ < 0) << "LLC miss counter unavailable, using cycles only";
+    if (pmu_fd_ >= 0) {
+      ioctl(pmu_fd_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(pmu_fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+}
+
+coro_batch_controller::~coro_batch_controller() {
+  if (pmu_fd_ >= 0) {
+    close(pmu_fd_);
+  }
+}
+
+uint64_t coro_batch_controller::read_llc_misses() {
+  uint64_t count = 0;
+  if (pmu_fd_ >= 0 && read(pmu_fd_, &count, sizeof(count)) != sizeof(count)) {
+    count = 0;
+  }
+  return count;
+}
+
+void coro_batch_controller::end_window() {
+  double cycles_per_txn = window_txns_ ? double(window_cycles_) / window_txns_ : 0;
+  if (pmu_fd_ >= 0) {
+    uint64_t misses = read_llc_misses();
+    last_llc_misses_per_txn_ =
+      window_txns_ ? double(misses - window_start_llc_misses_) / window_txns_ : 0;
+    window_start_llc_misses_ = misses;
+  }
+
+  if (adaptive_ && window_txns_ && last_cycles_per_txn_ > 0) {
+    if (cycles_per_txn > last_cycles_per_txn_ * (1 + kNoiseThreshold)) {
+      // Got worse: turn around
+      direction_ = -direction_;
+    }
+    int64_t d = int64_t(depth_) + direction_;
+    if (d < 1 || d > int64_t(max_depth_)) {
+      // Hit a bound: bounce back so we keep probing
+      direction_ = -direction_;
+      d = int64_t(depth_) + direction_;
+    }
+    if (d >= 1 && d <= int64_t(max_depth_)) {
+      ermia::volatile_write(depth_, uint32_t(d));
+    }
+  }
+
+  last_cycles_per_txn_ = cycles_per_txn;
+  window_cycles_ = 0;
+  window_txns_ = 0;
+  window_batches_ = 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <x86intrin.h>
+
+#include "../macros.h"
+#include "../dbcore/sm-defs.h"
+
+// Adjusts the number of in-flight coroutines per worker at runtime.
+//
+// The best interleaving depth depends on how often transactions miss the LLC,
+// which in turn depends on the working set and transaction mix. The controller
+// measures the cycles spent per finished transaction (rdtsc around each
+// batch) over a window of batches and hill-climbs the depth by one step per
+// window: keep going in the same direction while cycles/txn improve, turn
+// around otherwise. If requested and available, it also samples LLC misses
+// through perf_event_open so the depth can be correlated with stall rates.
+//
+// Depth is in [1, max_depth] and need not be a power of two; max_depth is
+// --coro_batch_size, which is what the per-worker transaction/arena slots are
+// sized for.
+class coro_batch_controller {
+ public:
+  // Batches per measurement window
+  static const uint32_t kWindowBatches = 256;
+
+  // Relative change in cycles/txn below which we treat two windows as equal
+  static constexpr double kNoiseThreshold = 0.01;
+
+  coro_batch_controller(uint32_t max_depth, bool adaptive, bool use_pmu);
+  ~coro_batch_controller();
+
+  inline uint32_t depth() const { return ermia::volatile_read(depth_); }
+
+  inline void batch_begin() {
+    unsigned int unused = 0;
+    batch_start_cycles_ = __rdtscp(&unused);
+  }
+
+  inline void batch_end(uint32_t ntxns) {
+    unsigned int unused = 0;
+    window_cycles_ += __rdtscp(&unused) - batch_start_cycles_;
+    window_txns_ += ntxns;
+    if (++window_batches_ == kWindowBatches) {
+      end_window();
+    }
+  }
+
+  // Stats of the last finished window, for reporting
+  inline double last_cycles_per_txn() const { return last_cycles_per_txn_; }
+  inline double last_llc_misses_per_txn() const { return last_llc_misses_per_txn_; }
+
+ private:
+  void end_window();
+  uint64_t read_llc_misses();
+
+  const uint32_t max_depth_;
+  const bool adaptive_;
+  uint32_t depth_;
+  int32_t direction_;
+
+  uint64_t batch_start_cycles_;
+  uint64_t window_cycles_;
+  uint64_t window_txns_;
+  uint32_t window_batches_;
+
+  double last_cycles_per_txn_;
+  double last_llc_misses_per_txn_;
+
+  // perf_event fd for LLC misses; -1 if not used/available
+  int pmu_fd_;
+  uint64_t window_start_llc_misses_;
+};
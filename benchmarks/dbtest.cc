@@ -24,8 +24,17 @@ DEFINE_bool(htt, true, "Whether the HW has hyper-threading enabled."
 DEFINE_bool(physical_workers_only, true, "Whether to only use one thread per physical core as transaction workers.");
 DEFINE_bool(amac_version_chain, false, "Whether to use AMAC for traversing version chain; applicable only for multi-get.");
 DEFINE_bool(coro_tx, false, "Whether to turn each transaction into a coroutine");
-DEFINE_uint64(coro_batch_size, 5, "Number of in-flight coroutines");
+DEFINE_uint64(coro_batch_size, 5, "Number of in-flight coroutines; the upper bound if coro_adaptive_batch is on");
+DEFINE_bool(coro_adaptive_batch, false, "Whether to adjust the number of in-flight coroutines at runtime");
+DEFINE_bool(coro_batch_pmu, false, "Whether to sample LLC misses with perf events for coro_adaptive_batch");
 DEFINE_bool(coro_batch_schedule, false, "Whether to run the same type of transactions per batch");
+DEFINE_bool(coro_pipeline_schedule, false, "Whether to refill a coroutine slot as soon as its transaction finishes");
+DEFINE_bool(coro_durable_commit, false, "Whether coroutine transactions suspend until their "
+  "commits are durable (needs group_commit); latency then includes the log flush.");
+DEFINE_bool(coro_work_stealing, false, "Whether idle workers steal pending transactions from "
+  "(preferably NUMA-local) peers; applicable only for coro_tx.");
+DEFINE_uint64(coro_request_interval_us, 0, "With coro_work_stealing, each worker receives "
+  "a burst of coro_batch_size requests every this many microseconds.");
 DEFINE_bool(scan_with_iterator, false, "Whether to run scan with iterator version or callback version");
 DEFINE_bool(verbose, true, "Verbose mode.");
 DEFINE_string(benchmark, "tpcc", "Benchmark name: tpcc, tpce, or ycsb");
@@ -39,6 +48,15 @@ DEFINE_string(tmpfs_dir, "/dev/shm",
 DEFINE_string(log_data_dir, "/tmpfs/ermia-log", "Log directory.");
 DEFINE_uint64(log_segment_mb, 8192, "Log segment size in MB.");
 DEFINE_uint64(log_buffer_mb, 16, "Log buffer size in MB.");
+DEFINE_bool(log_io_uring, false,
+            "Write the log through io_uring with several flushes in flight "
+            "(falls back to pwrite if unavailable).");
+DEFINE_uint64(log_io_depth, 4, "Maximum number of log writes in flight with log_io_uring.");
+DEFINE_bool(log_direct_io, false,
+            "Preallocate log segments in the background and write them with O_DIRECT.");
+DEFINE_bool(log_lsn_consolidation, false,
+            "Combine the LSN allocations of threads on the same NUMA node into one "
+            "atomic add on the global LSN counter.");
 DEFINE_bool(log_ship_by_rdma, false, "Whether to use RDMA for log shipping.");
 DEFINE_bool(phantom_prot, false, "Whether to enable phantom protection.");
 DEFINE_uint64(read_view_stat_interval_ms, 0,
@@ -46,9 +64,17 @@ DEFINE_uint64(read_view_stat_interval_ms, 0,
   "0 means do not output");
 DEFINE_string(read_view_stat_file, "/dev/shm/ermia_read_view_stat",
   "Where to store all the read view LSN outputs. Recommend tmpfs.");
+DEFINE_uint64(mem_stat_interval_ms, 0,
+  "Time interval between two dumps of per-table memory use, version chain "
+  "lengths and GC lag in milliseconds. Each dump walks all tables and indexes. "
+  "0 means do not output");
+DEFINE_string(mem_stat_file, "/dev/shm/ermia_mem_stat",
+  "Where to store the memory stat dumps (CSV). Recommend tmpfs.");
 DEFINE_bool(print_cpu_util, false, "Whether to print CPU utilization.");
 DEFINE_bool(enable_perf, false, "Whether to run Linux perf along with benchmark.");
 DEFINE_string(perf_record_event, "", "Perf record event");
+DEFINE_string(latency_json, "", "If set, dump per-transaction-type latency histograms "
+  "to this file as JSON at the end of the run.");
 #if defined(SSN) || defined(SSI)
 DEFINE_bool(safesnap, false,
             "Whether to use the safe snapshot (for SSI and SSN only).");
@@ -97,6 +123,24 @@ DEFINE_uint64(group_commit_timeout, 5,
 DEFINE_uint64(group_commit_size_kb, 4,
               "Group commit flush size interval in KB.");
 DEFINE_bool(enable_gc, false, "Whether to enable garbage collection.");
+DEFINE_uint64(gc_threads_per_node, 0, "Number of background version chain GC threads per NUMA node; "
+  "0 means updaters trim version chains inline. Applicable only with enable_gc.");
+DEFINE_uint64(gc_cpu_budget, 100, "Percentage of a core each background GC thread may use.");
+DEFINE_string(version_cache_tables, "", "Comma-separated list of tables that cache the newest "
+  "committed version of each record next to the OID array.");
+DEFINE_uint64(version_cache_value_size, 64, "Largest record (in bytes) the version cache keeps.");
+DEFINE_bool(delta_versions, false, "Store updates that keep the record size as a delta against "
+  "the overwritten version. Not supported with backups or checkpointing.");
+DEFINE_uint64(delta_max_depth, 4, "Most deltas a read has to apply before the next update "
+  "stores a full version again.");
+DEFINE_uint64(evict_threshold_pct, 0, "Evict cold records to the log once a node has used this "
+  "percentage of node_memory_gb; 0 disables eviction.");
+DEFINE_uint64(evict_cold_ms, 1000, "Evict records not read for about this long.");
+DEFINE_bool(read_set_dedup, true, "Whether SSN/SSI/MVOCC read sets skip versions "
+  "read before in the same transaction.");
+DEFINE_bool(fast_read_only, false, "Run the benchmarks' read-only transactions without an XID, "
+  "context or log (TXN_FLAG_FAST_READ_ONLY); falls back to normal read-only transactions "
+  "under MVOCC, and under SSN/SSI without safesnap.");
 DEFINE_uint64(num_backups, 0, "Number of backup servers. For primary only.");
 DEFINE_bool(wait_for_backups, true,
             "Whether to wait for backups to become online before starting "
@@ -177,6 +221,7 @@ int main(int argc, char **argv) {
   ermia::config::htt_is_on = FLAGS_htt;
   ermia::config::enable_perf = FLAGS_enable_perf;
   ermia::config::perf_record_event = FLAGS_perf_record_event;
+  ermia::config::latency_json = FLAGS_latency_json;
   ermia::config::physical_workers_only = FLAGS_physical_workers_only;
   if (ermia::config::physical_workers_only)
     ermia::config::threads = FLAGS_threads;
@@ -190,6 +235,10 @@ int main(int argc, char **argv) {
   ermia::config::log_dir = FLAGS_log_data_dir;
   ermia::config::log_segment_mb = FLAGS_log_segment_mb;
   ermia::config::log_buffer_mb = FLAGS_log_buffer_mb;
+  ermia::config::log_io_uring = FLAGS_log_io_uring;
+  ermia::config::log_io_depth = FLAGS_log_io_depth;
+  ermia::config::log_direct_io = FLAGS_log_direct_io;
+  ermia::config::log_lsn_consolidation = FLAGS_log_lsn_consolidation;
   ermia::config::phantom_prot = FLAGS_phantom_prot;
   ermia::config::recover_functor = new ermia::parallel_oid_replay(FLAGS_threads);
   ermia::config::log_ship_by_rdma = FLAGS_log_ship_by_rdma;
@@ -213,6 +262,8 @@ int main(int argc, char **argv) {
   ermia::config::log_redo_partitions = ermia::rep::kMaxLogBufferPartitions;
   ermia::config::read_view_stat_interval_ms = FLAGS_read_view_stat_interval_ms;
   ermia::config::read_view_stat_file = FLAGS_read_view_stat_file;
+  ermia::config::mem_stat_interval_ms = FLAGS_mem_stat_interval_ms;
+  ermia::config::mem_stat_file = FLAGS_mem_stat_file;
 
   ermia::config::command_log = FLAGS_command_log;
   ermia::config::command_log_buffer_mb = FLAGS_command_log_buffer_mb;
@@ -222,6 +273,16 @@ int main(int argc, char **argv) {
   ermia::config::coro_tx = FLAGS_coro_tx;
   ermia::config::coro_batch_size = FLAGS_coro_batch_size;
   ermia::config::coro_batch_schedule = FLAGS_coro_batch_schedule;
+  ermia::config::coro_pipeline_schedule = FLAGS_coro_pipeline_schedule;
+  ermia::config::coro_work_stealing = FLAGS_coro_work_stealing;
+  ermia::config::coro_request_interval_us = FLAGS_coro_request_interval_us;
+  ermia::config::coro_adaptive_batch = FLAGS_coro_adaptive_batch;
+  ermia::config::coro_batch_pmu = FLAGS_coro_batch_pmu;
+  ermia::config::coro_durable_commit = FLAGS_coro_durable_commit;
+#ifdef CORO_BATCH_COMMIT
+  // Batched commits happen in the scheduler, outside the transactions
+  LOG_IF(FATAL, FLAGS_coro_durable_commit) << "coro_durable_commit doesn't work with batching commits";
+#endif
 
   ermia::config::scan_with_it = FLAGS_scan_with_iterator;
 
@@ -302,6 +363,16 @@ int main(int argc, char **argv) {
     ermia::config::chkpt_interval = FLAGS_chkpt_interval;
     ermia::config::parallel_loading = FLAGS_parallel_loading;
     ermia::config::enable_gc = FLAGS_enable_gc;
+    ermia::config::gc_threads_per_node = FLAGS_gc_threads_per_node;
+    ermia::config::gc_cpu_budget = FLAGS_gc_cpu_budget;
+    ermia::config::version_cache_tables = FLAGS_version_cache_tables;
+    ermia::config::version_cache_value_size = FLAGS_version_cache_value_size;
+    ermia::config::delta_versions = FLAGS_delta_versions;
+    ermia::config::delta_max_depth = FLAGS_delta_max_depth;
+    ermia::config::evict_threshold_pct = FLAGS_evict_threshold_pct;
+    ermia::config::evict_cold_ms = FLAGS_evict_cold_ms;
+    ermia::config::read_set_dedup = FLAGS_read_set_dedup;
+    ermia::config::fast_read_only = FLAGS_fast_read_only;
 
     if (FLAGS_recovery_warm_up == "none") {
       ermia::config::recovery_warm_up_policy = ermia::config::WARM_UP_NONE;
@@ -368,13 +439,24 @@ int main(int argc, char **argv) {
   std::cerr << "  command-log       : " << ermia::config::command_log << std::endl;
   std::cerr << "  command-logbuf    : " << ermia::config::command_log_buffer_mb << "MB" << std::endl;
   std::cerr << "  coro-tx           : " << FLAGS_coro_tx << std::endl;
+  std::cerr << "  coro-adaptive-batch: " << FLAGS_coro_adaptive_batch << std::endl;
+  std::cerr << "  coro-batch-pmu    : " << FLAGS_coro_batch_pmu << std::endl;
   std::cerr << "  coro-batch-schedule: " << FLAGS_coro_batch_schedule << std::endl;
+  std::cerr << "  coro-pipeline-schedule: " << FLAGS_coro_pipeline_schedule << std::endl;
   std::cerr << "  coro-batch-size   : " << FLAGS_coro_batch_size << std::endl;
+  std::cerr << "  coro-durable-commit: " << FLAGS_coro_durable_commit << std::endl;
+  std::cerr << "  coro-work-stealing: " << FLAGS_coro_work_stealing << std::endl;
+  std::cerr << "  coro-request-interval-us: " << FLAGS_coro_request_interval_us << std::endl;
   std::cerr << "  scan-use-iterator : " << FLAGS_scan_with_iterator << std::endl;
   std::cerr << "  enable-perf       : " << ermia::config::enable_perf << std::endl;
   std::cerr << "  index-probe-only  : " << FLAGS_index_probe_only << std::endl;
+  std::cerr << "  latency-json      : " << ermia::config::latency_json << std::endl;
   std::cerr << "  log-buffer-mb     : " << ermia::config::log_buffer_mb << std::endl;
   std::cerr << "  log-dir           : " << ermia::config::log_dir << std::endl;
+  std::cerr << "  log-io-uring      : " << ermia::config::log_io_uring << std::endl;
+  std::cerr << "  log-io-depth      : " << ermia::config::log_io_depth << std::endl;
+  std::cerr << "  log-direct-io     : " << ermia::config::log_direct_io << std::endl;
+  std::cerr << "  log-lsn-consolidation : " << ermia::config::log_lsn_consolidation << std::endl;
   std::cerr << "  log-ship-by-rdma  : " << ermia::config::log_ship_by_rdma << std::endl;
   std::cerr << "  log_ship_offset_replay  : " << ermia::config::log_ship_offset_replay << std::endl;
   std::cerr << "  logbuf-partitions : " << ermia::config::log_redo_partitions << std::endl;
@@ -390,6 +472,8 @@ int main(int argc, char **argv) {
   std::cerr << "  print-cpu-util    : " << ermia::config::print_cpu_util << std::endl;
   std::cerr << "  read_view_stat_interval : " << ermia::config::read_view_stat_interval_ms << "ms" << std::endl;
   std::cerr << "  read_view_stat_file     : " << ermia::config::read_view_stat_file << std::endl;
+  std::cerr << "  mem_stat_interval       : " << ermia::config::mem_stat_interval_ms << "ms" << std::endl;
+  std::cerr << "  mem_stat_file           : " << ermia::config::mem_stat_file << std::endl;
   std::cerr << "  threadpool        : " << ermia::config::threadpool << std::endl;
   std::cerr << "  tmpfs-dir         : " << ermia::config::tmpfs_dir << std::endl;
   std::cerr << "  tls-alloc         : " << FLAGS_tls_alloc << std::endl;
@@ -414,8 +498,16 @@ int main(int argc, char **argv) {
     std::cerr << "  backoff-txns      : " << FLAGS_backoff_aborted_transactions << std::endl;
     std::cerr << "  chkpt-interval    : " << ermia::config::chkpt_interval << std::endl;
     std::cerr << "  commit-queue      : " << ermia::config::group_commit_queue_length << std::endl;
+    std::cerr << "  delta-versions    : " << ermia::config::delta_versions << std::endl;
+    std::cerr << "  delta-max-depth   : " << ermia::config::delta_max_depth << std::endl;
     std::cerr << "  enable-chkpt      : " << ermia::config::enable_chkpt << std::endl;
     std::cerr << "  enable-gc         : " << ermia::config::enable_gc << std::endl;
+    std::cerr << "  evict-threshold   : " << ermia::config::evict_threshold_pct << "%" << std::endl;
+    std::cerr << "  evict-cold-ms     : " << ermia::config::evict_cold_ms << std::endl;
+    std::cerr << "  read-set-dedup    : " << ermia::config::read_set_dedup << std::endl;
+    std::cerr << "  fast-read-only    : " << ermia::config::fast_read_only << std::endl;
+    std::cerr << "  gc-threads-per-node: " << ermia::config::gc_threads_per_node << std::endl;
+    std::cerr << "  gc-cpu-budget     : " << ermia::config::gc_cpu_budget << "%" << std::endl;
     std::cerr << "  group-commit      : " << ermia::config::group_commit << std::endl;
     std::cerr << "  group-commit-size : " << ermia::config::group_commit_size_kb << "KB" << std::endl;
     std::cerr << "  log-key-for-update: " << ermia::config::log_key_for_update << std::endl;
@@ -426,6 +518,8 @@ int main(int argc, char **argv) {
     std::cerr << "  retry-txns        : " << FLAGS_retry_aborted_transactions << std::endl;
     std::cerr << "  scale-factor      : " << FLAGS_scale_factor << std::endl;
     std::cerr << "  truncate-at-bench-start : " << ermia::config::truncate_at_bench_start << std::endl;
+    std::cerr << "  version-cache-tables: " << ermia::config::version_cache_tables << std::endl;
+    std::cerr << "  version-cache-value-size: " << ermia::config::version_cache_value_size << std::endl;
     std::cerr << "  wait-for-backups  : " << ermia::config::wait_for_backups << std::endl;
   }
 
@@ -460,7 +554,11 @@ int main(int argc, char **argv) {
     LOG(FATAL) << "Not supported in this build";
 #endif
   } else if (FLAGS_benchmark == "tpce") {
+#ifndef ADV_COROUTINE
+    test_fn = tpce_do_test;
+#else
     LOG(FATAL) << "Not supported in this build";
+#endif
   } else {
     LOG(FATAL) << "Invalid benchmark: " << FLAGS_benchmark;
   }
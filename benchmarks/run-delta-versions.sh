@@ -0,0 +1,40 @@
+#!/bin/bash
+# Update memory and throughput of full versus delta-encoded versions on TPC-C
+# (stock and customer updates touch a few fields of wide rows).
+# $1 - executable
+# $2 - scale factor
+# $3 - num of threads
+# $4 - runtime
+# $5 - other parameters for the workload
+
+if [[ $# -lt 4 ]]; then
+    echo "Too few arguments. "
+    echo "Usage $0 <executable> <scalefactor> <threads> <runtime>"
+    exit
+fi
+
+exe=$1
+sf=$2
+threads=$3
+runtime=$4
+workload_opts=$5
+
+DIR=./delta-versions-results
+mkdir -p $DIR
+echo "delta_versions,max_depth,commits_per_sec,update_versions,delta_versions,update_version_bytes,avg_update_version_bytes,delta_reconstructions" > $DIR/summary.csv
+
+for mode in "0 4" "1 1" "1 4" "1 16"; do
+  delta=${mode% *}
+  depth=${mode#* }
+  out=$DIR/tpcc-delta-$delta-depth-$depth.txt
+  ./benchmarks/run.sh $exe tpcc $sf $threads $runtime \
+    "-delta_versions=$delta -delta_max_depth=$depth" \
+    "$workload_opts" &> $out
+  tput=`grep -o "^[0-9.e+]* commits/s" $out | awk '{print $1}'`
+  stats=""
+  for stat in update_versions delta_versions update_version_bytes avg_update_version_bytes delta_reconstructions; do
+    stats="$stats,`grep "^$stat: " $out | awk '{print $2}'`"
+  done
+  echo "$delta,$depth,$tput$stats" >> $DIR/summary.csv
+done
+cat $DIR/summary.csv
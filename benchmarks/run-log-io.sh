@@ -0,0 +1,42 @@
+#!/bin/bash
+# Commit throughput and durable latency of the log writer: sweeps the log
+# buffer size and group commit size, with pwrite and with io_uring.
+# $1 - executable
+# $2 - benchmark (e.g., tpcc, ycsb)
+# $3 - scale factor
+# $4 - num of threads
+# $5 - runtime
+# $6 - other parameters for the workload
+
+if [[ $# -lt 5 ]]; then
+    echo "Too few arguments. "
+    echo "Usage $0 <executable> <benchmark> <scalefactor> <threads> <runtime>"
+    exit
+fi
+
+exe=$1
+workload=$2
+sf=$3
+threads=$4
+runtime=$5
+workload_opts=$6
+
+DIR=./log-io-results
+mkdir -p $DIR
+echo "logbuf_mb,group_commit_kb,io_uring,depth,commits_per_sec" > $DIR/summary.csv
+
+for logbuf_mb in 16 64 256; do
+  for gc_kb in 4 64 1024; do
+    for mode in "0 1" "1 2" "1 4" "1 8"; do
+      uring=${mode% *}
+      depth=${mode#* }
+      out=$DIR/$workload-logbuf-$logbuf_mb-gc-$gc_kb-uring-$uring-depth-$depth.txt
+      logbuf_mb=$logbuf_mb ./benchmarks/run.sh $exe $workload $sf $threads $runtime \
+        "-group_commit -group_commit_size_kb=$gc_kb -log_io_uring=$uring -log_io_depth=$depth" \
+        "$workload_opts" &> $out
+      tput=`grep -o "^[0-9.e+]* commits/s" $out | awk '{print $1}'`
+      echo "$logbuf_mb,$gc_kb,$uring,$depth,$tput" >> $DIR/summary.csv
+    done
+  done
+done
+cat $DIR/summary.csv
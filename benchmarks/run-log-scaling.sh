@@ -0,0 +1,36 @@
+#!/bin/bash
+# TPC-C commit throughput as worker threads spread over more sockets, with and
+# without per-node LSN consolidation. One warehouse per thread.
+# $1 - executable
+# $2 - cores per socket
+# $3 - num of sockets
+# $4 - runtime
+# $5 - other parameters for the workload
+
+if [[ $# -lt 4 ]]; then
+    echo "Too few arguments. "
+    echo "Usage $0 <executable> <cores per socket> <sockets> <runtime>"
+    exit
+fi
+
+exe=$1
+cores=$2
+sockets=$3
+runtime=$4
+workload_opts=$5
+
+DIR=./log-scaling-results
+mkdir -p $DIR
+echo "sockets,threads,lsn_consolidation,commits_per_sec" > $DIR/summary.csv
+
+for s in `seq 1 $sockets`; do
+  threads=$((s * cores))
+  for consolidate in 0 1; do
+    out=$DIR/tpcc-sockets-$s-threads-$threads-consolidate-$consolidate.txt
+    ./benchmarks/run.sh $exe tpcc $threads $threads $runtime \
+      "-log_lsn_consolidation=$consolidate" "$workload_opts" &> $out
+    tput=`grep -o "^[0-9.e+]* commits/s" $out | awk '{print $1}'`
+    echo "$s,$threads,$consolidate,$tput" >> $DIR/summary.csv
+  done
+done
+cat $DIR/summary.csv
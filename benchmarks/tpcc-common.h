@@ -1332,11 +1332,28 @@ class tpcc_cs_worker : public bench_worker, public tpcc_worker_mixin {
   virtual workload_desc_vec get_workload() const override;
   virtual void MyWork(char *) override;
 
+  virtual uint32_t home_partition() const override { return home_warehouse_id; }
+  virtual void seed_txn_inputs(uint64_t seed, uint32_t home) override {
+    bench_worker::seed_txn_inputs(seed, home);
+    input_warehouse_id = home;
+  }
+  virtual void save_txn_inputs(txn_inputs &in) override {
+    bench_worker::save_txn_inputs(in);
+    in.home = input_warehouse_id;
+  }
+  virtual void load_txn_inputs(const txn_inputs &in) override {
+    bench_worker::load_txn_inputs(in);
+    input_warehouse_id = in.home;
+  }
+
  protected:
   ALWAYS_INLINE ermia::varstr &str(ermia::str_arena &a, uint64_t size) { return *a.next(size); }
 
  private:
   const uint home_warehouse_id;
+  // Home warehouse of the running transaction; differs from the above for
+  // requests stolen from other workers
+  uint input_warehouse_id;
   int32_t last_no_o_ids[10];  // XXX(stephentu): hack
 };
 
@@ -8,7 +8,7 @@
 #include "tpcc-common.h"
 
 ermia::coro::generator<rc_t> tpcc_cs_worker::txn_new_order(uint32_t idx, ermia::epoch_num begin_epoch) {
-  const uint warehouse_id = pick_wh(r, home_warehouse_id);
+  const uint warehouse_id = pick_wh(r, input_warehouse_id);
   const uint districtID = RandomNumber(r, 1, 10);
   const uint customerID = GetCustomerId(r);
   const uint numItems = RandomNumber(r, 5, 15);
@@ -265,13 +265,13 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_new_order(uint32_t idx, ermia::
     }
   }
 #ifndef CORO_BATCH_COMMIT
-  TryCatchCoro(db->Commit(txn));
+  TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
   co_return {RC_TRUE};
 }  // new-order
 
 ermia::coro::generator<rc_t> tpcc_cs_worker::txn_payment(uint32_t idx, ermia::epoch_num begin_epoch) {
-  const uint warehouse_id = pick_wh(r, home_warehouse_id);
+  const uint warehouse_id = pick_wh(r, input_warehouse_id);
   const uint districtID = RandomNumber(r, 1, NumDistrictsPerWarehouse());
   uint customerDistrictID, customerWarehouseID;
   if (likely(g_disable_xpartition_txn || NumWarehouses() == 1 ||
@@ -433,7 +433,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_payment(uint32_t idx, ermia::ep
   TryCatchCoro(rc);
 
 #ifndef CORO_BATCH_COMMIT
-  TryCatchCoro(db->Commit(txn));
+  TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
   co_return {RC_TRUE};
 }  // payment
@@ -447,7 +447,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_delivery(uint32_t idx, ermia::e
   xc->begin_epoch = begin_epoch;
   rc_t rc = rc_t{RC_INVALID};
 
-  const uint warehouse_id = pick_wh(r, home_warehouse_id);
+  const uint warehouse_id = pick_wh(r, input_warehouse_id);
   const uint o_carrier_id = RandomNumber(r, 1, NumDistrictsPerWarehouse());
   const uint32_t ts = GetCurrentTimeMillis();
 
@@ -469,8 +469,11 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_delivery(uint32_t idx, ermia::e
   //   max_read_set_size : 133
   //   max_write_set_size : 133
   //   num_txn_contexts : 4
+  // The last-seen hints are for my own home warehouse; a stolen request for
+  // another one scans from the beginning
+  const bool own_hints = input_warehouse_id == home_warehouse_id;
   for (uint d = 1; d <= NumDistrictsPerWarehouse(); d++) {
-    const new_order::key k_no_0(warehouse_id, d, last_no_o_ids[d - 1]);
+    const new_order::key k_no_0(warehouse_id, d, own_hints ? last_no_o_ids[d - 1] : 0);
     const new_order::key k_no_1(warehouse_id, d,
                                 std::numeric_limits<int32_t>::max());
     new_order_scan_callback new_order_c;
@@ -483,7 +486,9 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_delivery(uint32_t idx, ermia::e
 
     const new_order::key *k_no = new_order_c.get_key();
     if (unlikely(!k_no)) continue;
-    last_no_o_ids[d - 1] = k_no->no_o_id + 1;  // XXX: update last seen
+    if (own_hints) {
+      last_no_o_ids[d - 1] = k_no->no_o_id + 1;  // XXX: update last seen
+    }
 
     const oorder::key k_oo(warehouse_id, d, k_no->no_o_id);
     // even if we read the new order entry, there's no guarantee
@@ -568,7 +573,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_delivery(uint32_t idx, ermia::e
   }
 
 #ifndef CORO_BATCH_COMMIT
-  TryCatchCoro(db->Commit(txn));
+  TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
 
   co_return {RC_TRUE};
@@ -577,7 +582,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_delivery(uint32_t idx, ermia::e
 ermia::coro::generator<rc_t> tpcc_cs_worker::txn_order_status(uint32_t idx, ermia::epoch_num begin_epoch) {
   // NB: since txn_order_status() is a RO txn, we assume that
   // locking is un-necessary (since we can just read from some old snapshot)
-  ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | ermia::transaction::TXN_FLAG_READ_ONLY,
+  ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | read_only_txn_flags(),
                                                arenas[idx],
                                                &transactions[idx],
                                                idx);
@@ -585,7 +590,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_order_status(uint32_t idx, ermi
   xc->begin_epoch = begin_epoch;
   rc_t rc = rc_t{RC_INVALID};
 
-  const uint warehouse_id = pick_wh(r, home_warehouse_id);
+  const uint warehouse_id = pick_wh(r, input_warehouse_id);
   const uint districtID = RandomNumber(r, 1, NumDistrictsPerWarehouse());
 
   // output from txn counters:
@@ -705,7 +710,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_order_status(uint32_t idx, ermi
   ALWAYS_ASSERT(c_order_line.n >= 5 && c_order_line.n <= 15);
 
 #ifndef CORO_BATCH_COMMIT
-  TryCatchCoro(db->Commit(txn));
+  TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
 
   co_return {RC_TRUE};
@@ -714,7 +719,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_order_status(uint32_t idx, ermi
 ermia::coro::generator<rc_t> tpcc_cs_worker::txn_stock_level(uint32_t idx, ermia::epoch_num begin_epoch) {
   // NB: since txn_stock_level() is a RO txn, we assume that
   // locking is un-necessary (since we can just read from some old snapshot)
-  ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | ermia::transaction::TXN_FLAG_READ_ONLY,
+  ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | read_only_txn_flags(),
                                                arenas[idx],
                                                &transactions[idx],
                                                idx);
@@ -722,7 +727,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_stock_level(uint32_t idx, ermia
   xc->begin_epoch = begin_epoch;
   rc_t rc = rc_t{RC_INVALID};
 
-  const uint warehouse_id = pick_wh(r, home_warehouse_id);
+  const uint warehouse_id = pick_wh(r, input_warehouse_id);
   const uint threshold = RandomNumber(r, 10, 20);
   const uint districtID = RandomNumber(r, 1, NumDistrictsPerWarehouse());
 
@@ -823,7 +828,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_stock_level(uint32_t idx, ermia
   }
 
 #ifndef CORO_BATCH_COMMIT
-  TryCatchCoro(db->Commit(txn));
+  TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
 
   co_return {RC_TRUE};
@@ -862,7 +867,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_credit_check(uint32_t idx, ermi
   xc->begin_epoch = begin_epoch;
   rc_t rc = rc_t{RC_INVALID};
 
-  const uint warehouse_id = pick_wh(r, home_warehouse_id);
+  const uint warehouse_id = pick_wh(r, input_warehouse_id);
   const uint districtID = RandomNumber(r, 1, NumDistrictsPerWarehouse());
   uint customerDistrictID, customerWarehouseID;
   if (likely(g_disable_xpartition_txn || NumWarehouses() == 1 ||
@@ -952,7 +957,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_credit_check(uint32_t idx, ermi
   TryCatchCoro(rc);
 
 #ifndef CORO_BATCH_COMMIT
-  TryCatchCoro(db->Commit(txn));
+  TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
 
   co_return {RC_TRUE};
@@ -1158,7 +1163,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_query2(uint32_t idx, ermia::epo
   }
 
 #ifndef CORO_BATCH_COMMIT
-  TryCatchCoro(db->Commit(txn));
+  TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
   co_return {RC_TRUE};
 }
@@ -1239,7 +1244,7 @@ ermia::coro::generator<rc_t> tpcc_cs_worker::txn_microbench_random(uint32_t idx,
   abort();
 #endif
 
-  rc = db->Commit(txn);
+  rc = co_await db->coro_Commit(txn);
   TryCatchCoro(rc);
   co_return {RC_TRUE};
 }
@@ -1251,7 +1256,8 @@ tpcc_cs_worker::tpcc_cs_worker(unsigned int worker_id, unsigned long seed, ermia
                  uint home_warehouse_id)
       : bench_worker(worker_id, true, seed, db, open_tables, barrier_a, barrier_b),
         tpcc_worker_mixin(partitions),
-        home_warehouse_id(home_warehouse_id) {
+        home_warehouse_id(home_warehouse_id),
+        input_warehouse_id(home_warehouse_id) {
   ASSERT(home_warehouse_id >= 1 and home_warehouse_id <= NumWarehouses() + 1);
   memset(&last_no_o_ids[0], 0, sizeof(last_no_o_ids));
 }
@@ -1303,14 +1309,19 @@ void tpcc_cs_worker::MyWork(char *) {
   // No replication support
   ALWAYS_ASSERT(is_worker);
   workload = get_workload();
-  txn_counts.resize(workload.size());
+  prepare_txn_stats(workload.size());
 
-  if (ermia::config::coro_batch_schedule) {
-    //PipelineScheduler();
+  if (ermia::config::coro_pipeline_schedule) {
+    PipelineScheduler();
+  } else if (ermia::config::coro_batch_schedule) {
     BatchScheduler();
+  } else if (ermia::config::coro_work_stealing) {
+    WorkStealingScheduler();
   } else {
     Scheduler();
   }
+
+  coro_frame_stats = ermia::coro::coroutine_allocator.get_stats();
 }
 
 #endif // ADV_COROUTINE
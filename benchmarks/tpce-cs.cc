@@ -0,0 +1,1247 @@
+/**
+ * Coroutine version of the read-mostly TPC-E transactions, see
+ * tpce_cs_worker in tpce.h.
+ */
+
+#ifndef ADV_COROUTINE
+
+#include "bench.h"
+#include "tpce.h"
+
+using namespace TPCE;
+
+// The frames all finished but their output doesn't pass the TxnHarness
+// checks; TryTPCEOutput counts that as a user abort.
+#define TryValidateCoro(cond)     \
+{                                 \
+  if (!(cond)) {                  \
+    db->Abort(txn);               \
+    co_return {RC_ABORT_USER};    \
+  }                               \
+}
+
+tpce_cs_worker::tpce_cs_worker(unsigned int worker_id, unsigned long seed, ermia::Engine *db,
+                               const std::map<std::string, ermia::OrderedIndex *> &open_tables,
+                               const std::map<std::string, std::vector<ermia::OrderedIndex *>> &partitions,
+                               spin_barrier *barrier_a, spin_barrier *barrier_b,
+                               uint partition_id_start, uint partition_id_end)
+    : bench_worker(worker_id, true, seed, db, open_tables, barrier_a, barrier_b),
+      tpce_worker_mixin(partitions),
+      partition_id_start(partition_id_start),
+      partition_id_end(partition_id_end) {
+  ASSERT(partition_id_start >= 1);
+  ASSERT(partition_id_start <= NumPartitions());
+  ASSERT(partition_id_end > partition_id_start);
+  ASSERT(partition_id_end <= (NumPartitions() + 1));
+  if (ermia::config::verbose) {
+    std::cerr << "tpce: worker id " << worker_id << " => partitions ["
+              << partition_id_start << ", " << partition_id_end << ")" << std::endl;
+  }
+}
+
+ermia::transaction *tpce_cs_worker::begin_read_only(uint32_t idx, ermia::epoch_num begin_epoch) {
+  auto read_only_mask =
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | read_only_mask,
+                                               arenas[idx],
+                                               &transactions[idx],
+                                               idx);
+  txn->GetXIDContext()->begin_epoch = begin_epoch;
+  return txn;
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::txn_customer_position(uint32_t idx, ermia::epoch_num begin_epoch) {
+  TCustomerPositionTxnInput input;
+  m_TxnInputGenerator->GenerateCustomerPositionInput(input);
+
+  TCustomerPositionFrame1Input frame1_input;
+  TCustomerPositionFrame1Output frame1_output;
+  memset(&frame1_input, 0, sizeof(frame1_input));
+  memset(&frame1_output, 0, sizeof(frame1_output));
+  frame1_input.cust_id = input.cust_id;
+  strncpy(frame1_input.tax_id, input.tax_id, sizeof(frame1_input.tax_id));
+
+  ermia::transaction *txn = begin_read_only(idx, begin_epoch);
+
+  TryReturnCoro(co_await customer_position_frame1(txn, idx, &frame1_input, &frame1_output));
+  TryValidateCoro(frame1_output.acct_len >= 1 && frame1_output.acct_len <= max_acct_len);
+
+  if (input.get_history) {
+    TCustomerPositionFrame2Input frame2_input;
+    TCustomerPositionFrame2Output frame2_output;
+    memset(&frame2_input, 0, sizeof(frame2_input));
+    memset(&frame2_output, 0, sizeof(frame2_output));
+    frame2_input.acct_id = frame1_output.acct_id[input.acct_id_idx];
+
+    TryReturnCoro(co_await customer_position_frame2(txn, idx, &frame2_input, &frame2_output));
+    TryValidateCoro(frame2_output.hist_len >= min_hist_len &&
+                    frame2_output.hist_len <= max_hist_len);
+  }
+  // Otherwise it's frame 3, which only commits
+
+#ifndef CORO_BATCH_COMMIT
+  TryCatchCoro(co_await db->coro_Commit(txn));
+#endif
+
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::customer_position_frame1(
+    ermia::transaction *txn, uint32_t idx,
+    const TCustomerPositionFrame1Input *pIn,
+    TCustomerPositionFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
+  ermia::varstr valptr;
+
+  // Get c_id;
+  const c_tax_id_index::key k_c_0(pIn->tax_id, MIN_VAL(k_c_0.c_id));
+  const c_tax_id_index::key k_c_1(pIn->tax_id, MAX_VAL(k_c_1.c_id));
+  tpce_table_scanner c_scanner(&arenas[idx]);
+
+  if (pIn->cust_id)
+    pOut->cust_id = pIn->cust_id;
+  else {
+    rc = co_await tbl_c_tax_id_index(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_c_0)), k_c_0),
+        &Encode(str(arenas[idx], sizeof(k_c_1)), k_c_1), c_scanner);
+    TryCatchCoro(rc);
+    // XXX. input generator's tax_id doesn't exist.  ???
+    if (not c_scanner.output.size()) {
+      db->Abort(txn);
+      co_return {RC_ABORT_USER};
+    }
+    c_tax_id_index::key k_c_temp;
+    const c_tax_id_index::key *k_c =
+        Decode(*(c_scanner.output.front().first), k_c_temp);
+    pOut->cust_id = k_c->c_id;
+  }
+  ALWAYS_ASSERT(pOut->cust_id);
+
+  // probe Customers
+  const customers::key k_c(pOut->cust_id);
+  customers::value v_c_temp;
+  rc = co_await tbl_customers(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_c)), k_c), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const customers::value *v_c = Decode(valptr, v_c_temp);
+
+  memcpy(pOut->c_st_id, v_c->c_st_id.data(), v_c->c_st_id.size());
+  memcpy(pOut->c_l_name, v_c->c_l_name.data(), v_c->c_l_name.size());
+  memcpy(pOut->c_f_name, v_c->c_f_name.data(), v_c->c_f_name.size());
+  memcpy(pOut->c_m_name, v_c->c_m_name.data(), v_c->c_m_name.size());
+  pOut->c_gndr[0] = v_c->c_gndr;
+  pOut->c_gndr[1] = 0;
+  pOut->c_tier = v_c->c_tier;
+  CDateTime(v_c->c_dob).GetTimeStamp(&pOut->c_dob);
+  pOut->c_ad_id = v_c->c_ad_id;
+  memcpy(pOut->c_ctry_1, v_c->c_ctry_1.data(), v_c->c_ctry_1.size());
+  memcpy(pOut->c_area_1, v_c->c_area_1.data(), v_c->c_area_1.size());
+  memcpy(pOut->c_local_1, v_c->c_local_1.data(), v_c->c_local_1.size());
+  memcpy(pOut->c_ext_1, v_c->c_ext_1.data(), v_c->c_ext_1.size());
+  memcpy(pOut->c_ctry_2, v_c->c_ctry_2.data(), v_c->c_ctry_2.size());
+  memcpy(pOut->c_area_2, v_c->c_area_2.data(), v_c->c_area_2.size());
+  memcpy(pOut->c_local_2, v_c->c_local_2.data(), v_c->c_local_2.size());
+  memcpy(pOut->c_ext_2, v_c->c_ext_2.data(), v_c->c_ext_2.size());
+  memcpy(pOut->c_ctry_3, v_c->c_ctry_3.data(), v_c->c_ctry_3.size());
+  memcpy(pOut->c_area_3, v_c->c_area_3.data(), v_c->c_area_3.size());
+  memcpy(pOut->c_local_3, v_c->c_local_3.data(), v_c->c_local_3.size());
+  memcpy(pOut->c_ext_3, v_c->c_ext_3.data(), v_c->c_ext_3.size());
+  memcpy(pOut->c_email_1, v_c->c_email_1.data(), v_c->c_email_1.size());
+  memcpy(pOut->c_email_2, v_c->c_email_2.data(), v_c->c_email_2.size());
+
+  // CustomerAccount scan
+  const ca_id_index::key k_ca_0(pOut->cust_id, MIN_VAL(k_ca_0.ca_id));
+  const ca_id_index::key k_ca_1(pOut->cust_id, MAX_VAL(k_ca_1.ca_id));
+  tpce_table_scanner ca_scanner(&arenas[idx]);
+  rc = co_await tbl_ca_id_index(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_ca_0)), k_ca_0),
+      &Encode(str(arenas[idx], sizeof(k_ca_1)), k_ca_1), ca_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(ca_scanner.output.size());
+
+  for (auto &r_ca : ca_scanner.output) {
+    ca_id_index::key k_ca_temp;
+    customer_account::value v_ca_temp;
+    const ca_id_index::key *k_ca = Decode(*r_ca.first, k_ca_temp);
+    const customer_account::value *v_ca = Decode(*r_ca.second, v_ca_temp);
+
+    // HoldingSummary scan
+    const holding_summary::key k_hs_0(k_ca->ca_id,
+                                      std::string(cSYMBOL_len, (char)0));
+    const holding_summary::key k_hs_1(k_ca->ca_id,
+                                      std::string(cSYMBOL_len, (char)255));
+    tpce_table_scanner hs_scanner(&arenas[idx]);
+    rc = co_await tbl_holding_summary(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_hs_0)), k_hs_0),
+        &Encode(str(arenas[idx], sizeof(k_hs_1)), k_hs_1), hs_scanner);
+    TryCatchCoro(rc);
+    // left-outer join. S table could be empty.
+
+    auto asset = 0;
+    for (auto &r_hs : hs_scanner.output) {
+      holding_summary::key k_hs_temp;
+      holding_summary::value v_hs_temp;
+      const holding_summary::key *k_hs = Decode(*r_hs.first, k_hs_temp);
+      const holding_summary::value *v_hs = Decode(*r_hs.second, v_hs_temp);
+
+      // LastTrade probe & equi-join
+      const last_trade::key k_lt(k_hs->hs_s_symb);
+      last_trade::value v_lt_temp;
+      rc = co_await tbl_last_trade(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_lt)), k_lt), valptr);
+      TryVerifyRelaxedCoro(rc);
+      const last_trade::value *v_lt = Decode(valptr, v_lt_temp);
+
+      asset += v_hs->hs_qty * v_lt->lt_price;
+    }
+
+    // Since we are doing left outer join, non-join rows just emit 0 asset here.
+    pOut->acct_id[pOut->acct_len] = k_ca->ca_id;
+    pOut->cash_bal[pOut->acct_len] = v_ca->ca_bal;
+    pOut->asset_total[pOut->acct_len] = asset;
+    pOut->acct_len++;
+  }
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::customer_position_frame2(
+    ermia::transaction *txn, uint32_t idx,
+    const TCustomerPositionFrame2Input *pIn,
+    TCustomerPositionFrame2Output *pOut) {
+  // XXX. If, CP frame 1 doesn't give output, then, we don't have valid input at
+  // here. so just return
+  if (not pIn->acct_id) {
+    db->Abort(txn);
+    co_return {RC_ABORT_USER};
+  }
+
+  rc_t rc = rc_t{RC_INVALID};
+  ermia::varstr valptr;
+
+  // Trade scan and collect 10 TID
+  const t_ca_id_index::key k_t_0(pIn->acct_id, MIN_VAL(k_t_0.t_dts),
+                                 MIN_VAL(k_t_0.t_id));
+  const t_ca_id_index::key k_t_1(pIn->acct_id, MAX_VAL(k_t_0.t_dts),
+                                 MAX_VAL(k_t_0.t_id));
+  tpce_table_scanner t_scanner(&arenas[idx]);
+  rc = co_await tbl_t_ca_id_index(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_t_0)), k_t_0),
+      &Encode(str(arenas[idx], sizeof(k_t_1)), k_t_1), t_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(t_scanner.output.size());
+
+  std::vector<std::pair<ermia::varstr *, ermia::varstr *>> tids;
+  for (auto &r_t : t_scanner.output) {
+    t_ca_id_index::key k_t_temp;
+    trade::value v_t_temp;
+    const t_ca_id_index::key *k_t = Decode(*r_t.first, k_t_temp);
+    const trade::value *v_t = Decode(*r_t.second, v_t_temp);
+
+    // DTS could be changed, invalidating the key in 2nd index (t_s_symb_index),
+    // e.g., by MarketFeed. Skip if it doesn't match the one stored in the main
+    // record.
+    if (v_t->t_dts != k_t->t_dts) {
+      continue;
+    }
+
+    tids.push_back(r_t);
+    if (tids.size() >= 10) break;
+  }
+  reverse(tids.begin(), tids.end());
+
+  for (auto &r_t : tids) {
+    t_ca_id_index::key k_t_temp;
+    trade::value v_t_temp;
+    const t_ca_id_index::key *k_t = Decode(*r_t.first, k_t_temp);
+    const trade::value *v_t = Decode(*r_t.second, v_t_temp);
+
+    // Join
+    const trade_history::key k_th_0(k_t->t_id, std::string(cST_ID_len, (char)0),
+                                    MIN_VAL(k_th_0.th_dts));
+    const trade_history::key k_th_1(k_t->t_id, std::string(cST_ID_len, (char)255),
+                                    MAX_VAL(k_th_1.th_dts));
+    tpce_table_scanner th_scanner(&arenas[idx]);
+    rc = co_await tbl_trade_history(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_th_0)), k_th_0),
+        &Encode(str(arenas[idx], sizeof(k_th_1)), k_th_1), th_scanner);
+    TryCatchCoro(rc);
+    ALWAYS_ASSERT(th_scanner.output.size());
+
+    for (auto &r_th : th_scanner.output) {
+      trade_history::key k_th_temp;
+      const trade_history::key *k_th = Decode(*r_th.first, k_th_temp);
+
+      status_type::key k_st(k_th->th_st_id);
+      status_type::value v_st_temp;
+      rc = co_await tbl_status_type(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_st)), k_st), valptr);
+      TryVerifyRelaxedCoro(rc);
+      const status_type::value *v_st = Decode(valptr, v_st_temp);
+
+      // TODO. order by and grab 30 rows
+      pOut->trade_id[pOut->hist_len] = k_t->t_id;
+      pOut->qty[pOut->hist_len] = v_t->t_qty;
+      CDateTime(k_th->th_dts).GetTimeStamp(&pOut->hist_dts[pOut->hist_len]);
+      memcpy(pOut->symbol[pOut->hist_len], v_t->t_s_symb.data(),
+             v_t->t_s_symb.size());
+      memcpy(pOut->trade_status[pOut->hist_len], v_st->st_name.data(),
+             v_st->st_name.size());
+
+      pOut->hist_len++;
+      if (pOut->hist_len >= max_hist_len) {
+        co_return {RC_TRUE};
+      }
+    }
+  }
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::txn_market_watch(uint32_t idx, ermia::epoch_num begin_epoch) {
+  TMarketWatchTxnInput input;
+  m_TxnInputGenerator->GenerateMarketWatchInput(input);
+  if (input.acct_id == 0 && input.c_id == 0 && input.industry_name[0] == '\0') {
+    // MWF1_ERROR1, nothing to watch
+    co_return {RC_ABORT_USER};
+  }
+
+  TMarketWatchFrame1Output frame1_output;
+  memset(&frame1_output, 0, sizeof(frame1_output));
+
+  ermia::transaction *txn = begin_read_only(idx, begin_epoch);
+  TryReturnCoro(co_await market_watch_frame1(txn, idx, &input, &frame1_output));
+
+#ifndef CORO_BATCH_COMMIT
+  TryCatchCoro(co_await db->coro_Commit(txn));
+#endif
+
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::market_watch_frame1(
+    ermia::transaction *txn, uint32_t idx,
+    const TMarketWatchFrame1Input *pIn,
+    TMarketWatchFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
+  ermia::varstr valptr;
+
+  std::vector<inline_str_fixed<cSYMBOL_len>> stock_list_cursor;
+
+  if (pIn->c_id) {
+    const watch_list::key k_wl_0(pIn->c_id, MIN_VAL(k_wl_0.wl_id));
+    const watch_list::key k_wl_1(pIn->c_id, MAX_VAL(k_wl_1.wl_id));
+    tpce_table_scanner wl_scanner(&arenas[idx]);
+    rc = co_await tbl_watch_list(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_wl_0)), k_wl_0),
+        &Encode(str(arenas[idx], sizeof(k_wl_1)), k_wl_1), wl_scanner);
+    TryCatchCoro(rc);
+    ALWAYS_ASSERT(wl_scanner.output.size());
+
+    for (auto &r_wl : wl_scanner.output) {
+      watch_list::key k_wl_temp;
+      const watch_list::key *k_wl = Decode(*r_wl.first, k_wl_temp);
+
+      const watch_item::key k_wi_0(k_wl->wl_id, std::string(cSYMBOL_len, (char)0));
+      const watch_item::key k_wi_1(k_wl->wl_id, std::string(cSYMBOL_len, (char)255));
+      tpce_table_scanner wi_scanner(&arenas[idx]);
+      rc = co_await tbl_watch_item(1)->coro_Scan(
+          txn, Encode(str(arenas[idx], sizeof(k_wi_0)), k_wi_0),
+          &Encode(str(arenas[idx], sizeof(k_wi_1)), k_wi_1), wi_scanner);
+      TryCatchCoro(rc);
+      ALWAYS_ASSERT(wi_scanner.output.size());
+      for (auto &r_wi : wi_scanner.output) {
+        watch_item::key k_wi_temp;
+        const watch_item::key *k_wi = Decode(*r_wi.first, k_wi_temp);
+
+        stock_list_cursor.push_back(k_wi->wi_s_symb);
+      }
+    }
+  } else if (pIn->industry_name[0]) {
+    const in_name_index::key k_in_0(std::string(pIn->industry_name),
+                                    std::string(cIN_ID_len, (char)0));
+    const in_name_index::key k_in_1(std::string(pIn->industry_name),
+                                    std::string(cIN_ID_len, (char)255));
+    tpce_table_scanner in_scanner(&arenas[idx]);
+    rc = co_await tbl_in_name_index(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_in_0)), k_in_0),
+        &Encode(str(arenas[idx], sizeof(k_in_1)), k_in_1), in_scanner);
+    TryCatchCoro(rc);
+    ALWAYS_ASSERT(in_scanner.output.size());
+
+    const company::key k_co_0(pIn->starting_co_id);
+    const company::key k_co_1(pIn->ending_co_id);
+    tpce_table_scanner co_scanner(&arenas[idx]);
+    rc = co_await tbl_company(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_co_0)), k_co_0),
+        &Encode(str(arenas[idx], sizeof(k_co_1)), k_co_1), co_scanner);
+    TryCatchCoro(rc);
+    ALWAYS_ASSERT(co_scanner.output.size());
+
+    const security::key k_s_0(std::string(cSYMBOL_len, (char)0));
+    const security::key k_s_1(std::string(cSYMBOL_len, (char)255));
+    tpce_table_scanner s_scanner(&arenas[idx]);
+    rc = co_await tbl_security(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_s_0)), k_s_0),
+        &Encode(str(arenas[idx], sizeof(k_s_1)), k_s_1), s_scanner);
+    TryCatchCoro(rc);
+    ALWAYS_ASSERT(s_scanner.output.size());
+
+    for (auto &r_in : in_scanner.output) {
+      in_name_index::key k_in_temp;
+      const in_name_index::key *k_in = Decode(*r_in.first, k_in_temp);
+
+      for (auto &r_co : co_scanner.output) {
+        company::key k_co_temp;
+        company::value v_co_temp;
+        const company::key *k_co = Decode(*r_co.first, k_co_temp);
+        const company::value *v_co = Decode(*r_co.second, v_co_temp);
+
+        if (v_co->co_in_id != k_in->in_id) continue;
+
+        for (auto &r_s : s_scanner.output) {
+          security::key k_s_temp;
+          security::value v_s_temp;
+          const security::key *k_s = Decode(*r_s.first, k_s_temp);
+          const security::value *v_s = Decode(*r_s.second, v_s_temp);
+
+          if (v_s->s_co_id == k_co->co_id) {
+            stock_list_cursor.push_back(k_s->s_symb);
+          }
+        }
+      }
+    }
+  } else if (pIn->acct_id) {
+    const holding_summary::key k_hs_0(pIn->acct_id,
+                                      std::string(cSYMBOL_len, (char)0));
+    const holding_summary::key k_hs_1(pIn->acct_id,
+                                      std::string(cSYMBOL_len, (char)255));
+    tpce_table_scanner hs_scanner(&arenas[idx]);
+    rc = co_await tbl_holding_summary(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_hs_0)), k_hs_0),
+        &Encode(str(arenas[idx], sizeof(k_hs_1)), k_hs_1), hs_scanner);
+    TryCatchCoro(rc);
+
+    for (auto &r_hs : hs_scanner.output) {
+      holding_summary::key k_hs_temp;
+      const holding_summary::key *k_hs = Decode(*r_hs.first, k_hs_temp);
+
+      stock_list_cursor.push_back(k_hs->hs_s_symb);
+    }
+  } else
+    ALWAYS_ASSERT(false);
+
+  double old_mkt_cap = 0;
+  double new_mkt_cap = 0;
+
+  for (auto &s : stock_list_cursor) {
+    const last_trade::key k_lt(s);
+    last_trade::value v_lt_temp;
+    rc = co_await tbl_last_trade(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_lt)), k_lt), valptr);
+    TryCatchCoro(rc);
+    const last_trade::value *v_lt = Decode(valptr, v_lt_temp);
+
+    const security::key k_s(s);
+    security::value v_s_temp;
+    rc = co_await tbl_security(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_s)), k_s), valptr);
+    TryCatchCoro(rc);
+    const security::value *v_s = Decode(valptr, v_s_temp);
+
+    const daily_market::key k_dm(
+        s, CDateTime((TIMESTAMP_STRUCT *)&pIn->start_day).GetDate());
+    daily_market::value v_dm_temp;
+    rc = co_await tbl_daily_market(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_dm)), k_dm), valptr);
+    TryCatchCoro(rc);
+    const daily_market::value *v_dm = Decode(valptr, v_dm_temp);
+
+    auto s_num_out = v_s->s_num_out;
+    auto old_price = v_dm->dm_close;
+    auto new_price = v_lt->lt_price;
+
+    old_mkt_cap += s_num_out * old_price;
+    new_mkt_cap += s_num_out * new_price;
+  }
+
+  if (old_mkt_cap != 0)
+    pOut->pct_change = 100 * (new_mkt_cap / old_mkt_cap - 1);
+  else
+    pOut->pct_change = 0;
+
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::txn_security_detail(uint32_t idx, ermia::epoch_num begin_epoch) {
+  TSecurityDetailTxnInput input;
+  m_TxnInputGenerator->GenerateSecurityDetailInput(input);
+
+  // Not memset because of the large LOB members, same as the harness
+  TSecurityDetailFrame1Output frame1_output;
+
+  ermia::transaction *txn = begin_read_only(idx, begin_epoch);
+  TryReturnCoro(co_await security_detail_frame1(txn, idx, &input, &frame1_output));
+  TryValidateCoro(frame1_output.day_len >= min_day_len &&
+                  frame1_output.day_len <= max_day_len);
+  TryValidateCoro(frame1_output.fin_len == max_fin_len);
+  TryValidateCoro(frame1_output.news_len == max_news_len);
+
+#ifndef CORO_BATCH_COMMIT
+  TryCatchCoro(co_await db->coro_Commit(txn));
+#endif
+
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::security_detail_frame1(
+    ermia::transaction *txn, uint32_t idx,
+    const TSecurityDetailFrame1Input *pIn,
+    TSecurityDetailFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
+  ermia::varstr valptr;
+
+  int64_t co_id;
+
+  const security::key k_s(std::string(pIn->symbol));
+  security::value v_s_temp;
+  rc = co_await tbl_security(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_s)), k_s), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const security::value *v_s = Decode(valptr, v_s_temp);
+  co_id = v_s->s_co_id;
+
+  const company::key k_co(co_id);
+  company::value v_co_temp;
+  rc = co_await tbl_company(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_co)), k_co), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const company::value *v_co = Decode(valptr, v_co_temp);
+
+  const address::key k_ca(v_co->co_ad_id);
+  address::value v_ca_temp;
+  rc = co_await tbl_address(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_ca)), k_ca), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const address::value *v_ca = Decode(valptr, v_ca_temp);
+
+  const zip_code::key k_zca(v_ca->ad_zc_code);
+  zip_code::value v_zca_temp;
+  rc = co_await tbl_zip_code(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_zca)), k_zca), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const zip_code::value *v_zca = Decode(valptr, v_zca_temp);
+
+  const exchange::key k_ex(v_s->s_ex_id);
+  exchange::value v_ex_temp;
+  rc = co_await tbl_exchange(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_ex)), k_ex), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const exchange::value *v_ex = Decode(valptr, v_ex_temp);
+
+  const address::key k_ea(v_ex->ex_ad_id);
+  address::value v_ea_temp;
+  rc = co_await tbl_address(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_ea)), k_ea), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const address::value *v_ea = Decode(valptr, v_ea_temp);
+
+  const zip_code::key k_zea(v_ea->ad_zc_code);
+  zip_code::value v_zea_temp;
+  rc = co_await tbl_zip_code(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_zea)), k_zea), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const zip_code::value *v_zea = Decode(valptr, v_zea_temp);
+
+  memcpy(pOut->s_name, v_s->s_name.data(), v_s->s_name.size());
+  pOut->num_out = v_s->s_num_out;
+  CDateTime(v_s->s_start_date).GetTimeStamp(&pOut->start_date);
+  CDateTime(v_s->s_exch_date).GetTimeStamp(&pOut->ex_date);
+  pOut->pe_ratio = v_s->s_pe;
+  pOut->s52_wk_high = v_s->s_52wk_high;
+  CDateTime(v_s->s_52wk_high_date).GetTimeStamp(&pOut->s52_wk_high_date);
+  pOut->s52_wk_low = v_s->s_52wk_low;
+  CDateTime(v_s->s_52wk_low_date).GetTimeStamp(&pOut->s52_wk_low_date);
+  pOut->divid = v_s->s_dividend;
+  pOut->yield = v_s->s_yield;
+  memcpy(pOut->co_name, v_co->co_name.data(), v_co->co_name.size());
+  memcpy(pOut->sp_rate, v_co->co_sp_rate.data(), v_co->co_sp_rate.size());
+  memcpy(pOut->ceo_name, v_co->co_ceo.data(), v_co->co_ceo.size());
+  memcpy(pOut->co_desc, v_co->co_desc.data(), v_co->co_desc.size());
+  CDateTime(v_co->co_open_date).GetTimeStamp(&pOut->open_date);
+  memcpy(pOut->co_st_id, v_co->co_st_id.data(), v_co->co_st_id.size());
+  memcpy(pOut->co_ad_line1, v_ca->ad_line1.data(), v_ca->ad_line1.size());
+  memcpy(pOut->co_ad_line2, v_ca->ad_line2.data(), v_ca->ad_line2.size());
+  memcpy(pOut->co_ad_zip, v_ca->ad_zc_code.data(), v_ca->ad_zc_code.size());
+  memcpy(pOut->co_ad_cty, v_ca->ad_ctry.data(), v_ca->ad_ctry.size());
+  memcpy(pOut->ex_ad_line1, v_ea->ad_line1.data(), v_ea->ad_line1.size());
+  memcpy(pOut->ex_ad_line2, v_ea->ad_line2.data(), v_ea->ad_line2.size());
+  memcpy(pOut->ex_ad_zip, v_ea->ad_zc_code.data(), v_ea->ad_zc_code.size());
+  memcpy(pOut->ex_ad_cty, v_ea->ad_ctry.data(), v_ea->ad_ctry.size());
+  pOut->ex_open = v_ex->ex_open;
+  pOut->ex_close = v_ex->ex_close;
+  pOut->ex_num_symb = v_ex->ex_num_symb;
+  memcpy(pOut->ex_name, v_ex->ex_name.data(), v_ex->ex_name.size());
+  memcpy(pOut->ex_desc, v_ex->ex_desc.data(), v_ex->ex_desc.size());
+  memcpy(pOut->co_ad_town, v_zca->zc_town.data(), v_zca->zc_town.size());
+  memcpy(pOut->co_ad_div, v_zca->zc_div.data(), v_zca->zc_div.size());
+  memcpy(pOut->ex_ad_town, v_zea->zc_town.data(), v_zea->zc_town.size());
+  memcpy(pOut->ex_ad_div, v_zea->zc_div.data(), v_zea->zc_div.size());
+
+  const company_competitor::key k_cp_0(co_id, MIN_VAL(k_cp_0.cp_comp_co_id),
+                                       std::string(cIN_ID_len, (char)0));
+  const company_competitor::key k_cp_1(co_id, MAX_VAL(k_cp_1.cp_comp_co_id),
+                                       std::string(cIN_ID_len, (char)255));
+  tpce_table_scanner cp_scanner(&arenas[idx]);
+  rc = co_await tbl_company_competitor(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_cp_0)), k_cp_0),
+      &Encode(str(arenas[idx], sizeof(k_cp_1)), k_cp_1), cp_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(cp_scanner.output.size());
+
+  for (auto i = 0; i < max_comp_len; i++) {
+    auto &r_cp = cp_scanner.output[i];
+    company_competitor::key k_cp_temp;
+    const company_competitor::key *k_cp = Decode(*r_cp.first, k_cp_temp);
+
+    const company::key k_co3(k_cp->cp_comp_co_id);
+    company::value v_co3_temp;
+    rc = co_await tbl_company(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_co3)), k_co3), valptr);
+    TryVerifyRelaxedCoro(rc);
+    const company::value *v_co3 = Decode(valptr, v_co3_temp);
+
+    const industry::key k_in(k_cp->cp_in_id);
+    industry::value v_in_temp;
+    rc = co_await tbl_industry(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_in)), k_in), valptr);
+    TryVerifyRelaxedCoro(rc);
+    const industry::value *v_in = Decode(valptr, v_in_temp);
+
+    memcpy(pOut->cp_co_name[i], v_co3->co_name.data(), v_co3->co_name.size());
+    memcpy(pOut->cp_in_name[i], v_in->in_name.data(), v_in->in_name.size());
+  }
+
+  const financial::key k_fi_0(co_id, MIN_VAL(k_fi_0.fi_year),
+                              MIN_VAL(k_fi_0.fi_qtr));
+  const financial::key k_fi_1(co_id, MAX_VAL(k_fi_1.fi_year),
+                              MAX_VAL(k_fi_1.fi_qtr));
+  tpce_table_scanner fi_scanner(&arenas[idx]);
+  rc = co_await tbl_financial(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_fi_0)), k_fi_0),
+      &Encode(str(arenas[idx], sizeof(k_fi_1)), k_fi_1), fi_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(fi_scanner.output.size());
+  for (uint64_t i = 0; i < max_fin_len; i++) {
+    auto &r_fi = fi_scanner.output[i];
+    financial::key k_fi_temp;
+    financial::value v_fi_temp;
+    const financial::key *k_fi = Decode(*r_fi.first, k_fi_temp);
+    const financial::value *v_fi = Decode(*r_fi.second, v_fi_temp);
+
+    // TODO. order by
+
+    pOut->fin[i].year = k_fi->fi_year;
+    pOut->fin[i].qtr = k_fi->fi_qtr;
+    CDateTime(v_fi->fi_qtr_start_date).GetTimeStamp(&pOut->fin[i].start_date);
+    pOut->fin[i].rev = v_fi->fi_revenue;
+    pOut->fin[i].net_earn = v_fi->fi_net_earn;
+    pOut->fin[i].basic_eps = v_fi->fi_basic_eps;
+    pOut->fin[i].dilut_eps = v_fi->fi_dilut_eps;
+    pOut->fin[i].margin = v_fi->fi_margin;
+    pOut->fin[i].invent = v_fi->fi_inventory;
+    pOut->fin[i].assets = v_fi->fi_assets;
+    pOut->fin[i].liab = v_fi->fi_liability;
+    pOut->fin[i].out_basic = v_fi->fi_out_basic;
+    pOut->fin[i].out_dilut = v_fi->fi_out_dilut;
+  }
+  pOut->fin_len = max_fin_len;
+
+  const daily_market::key k_dm_0(
+      std::string(pIn->symbol),
+      CDateTime((TIMESTAMP_STRUCT *)&pIn->start_day).GetDate());
+  const daily_market::key k_dm_1(std::string(pIn->symbol), MAX_VAL(k_dm_1.dm_date));
+  tpce_table_scanner dm_scanner(&arenas[idx]);
+  rc = co_await tbl_daily_market(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_dm_0)), k_dm_0),
+      &Encode(str(arenas[idx], sizeof(k_dm_1)), k_dm_1), dm_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(dm_scanner.output.size());
+  for (size_t i = 0;
+       i < (size_t)pIn->max_rows_to_return and i < dm_scanner.output.size();
+       i++) {
+    auto &r_dm = dm_scanner.output[i];
+
+    daily_market::key k_dm_temp;
+    daily_market::value v_dm_temp;
+    const daily_market::key *k_dm = Decode(*r_dm.first, k_dm_temp);
+    const daily_market::value *v_dm = Decode(*r_dm.second, v_dm_temp);
+
+    CDateTime(k_dm->dm_date).GetTimeStamp(&pOut->day[i].date);
+    pOut->day[i].close = v_dm->dm_close;
+    pOut->day[i].high = v_dm->dm_high;
+    pOut->day[i].low = v_dm->dm_low;
+    pOut->day[i].vol = v_dm->dm_vol;
+  }
+  // TODO. order by
+  pOut->day_len = ((size_t)pIn->max_rows_to_return < dm_scanner.output.size())
+                      ? pIn->max_rows_to_return
+                      : dm_scanner.output.size();
+
+  const last_trade::key k_lt(std::string(pIn->symbol));
+  last_trade::value v_lt_temp;
+  rc = co_await tbl_last_trade(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_lt)), k_lt), valptr);
+  TryVerifyRelaxedCoro(rc);
+  const last_trade::value *v_lt = Decode(valptr, v_lt_temp);
+
+  pOut->last_price = v_lt->lt_price;
+  pOut->last_open = v_lt->lt_open_price;
+  pOut->last_vol = v_lt->lt_vol;
+
+  const news_xref::key k_nx_0(co_id, MIN_VAL(k_nx_0.nx_ni_id));
+  const news_xref::key k_nx_1(co_id, MAX_VAL(k_nx_0.nx_ni_id));
+  tpce_table_scanner nx_scanner(&arenas[idx]);
+  rc = co_await tbl_news_xref(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_nx_0)), k_nx_0),
+      &Encode(str(arenas[idx], sizeof(k_nx_1)), k_nx_1), nx_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(nx_scanner.output.size());
+
+  for (int i = 0; i < max_news_len; i++) {
+    auto &r_nx = nx_scanner.output[i];
+    news_xref::key k_nx_temp;
+    const news_xref::key *k_nx = Decode(*r_nx.first, k_nx_temp);
+
+    const news_item::key k_ni(k_nx->nx_ni_id);
+    news_item::value v_ni_temp;
+    rc = co_await tbl_news_item(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_ni)), k_ni), valptr);
+    TryVerifyRelaxedCoro(rc);
+    const news_item::value *v_ni = Decode(valptr, v_ni_temp);
+
+    if (pIn->access_lob_flag) {
+      memcpy(pOut->news[i].item, v_ni->ni_item.data(), v_ni->ni_item.size());
+      CDateTime(v_ni->ni_dts).GetTimeStamp(&pOut->news[i].dts);
+      memcpy(pOut->news[i].src, v_ni->ni_source.data(), v_ni->ni_source.size());
+      memcpy(pOut->news[i].auth, v_ni->ni_author.data(),
+             v_ni->ni_author.size());
+      pOut->news[i].headline[0] = 0;
+      pOut->news[i].summary[0] = 0;
+    } else {
+      pOut->news[i].item[0] = 0;
+      CDateTime(v_ni->ni_dts).GetTimeStamp(&pOut->news[i].dts);
+      memcpy(pOut->news[i].src, v_ni->ni_source.data(), v_ni->ni_source.size());
+      memcpy(pOut->news[i].auth, v_ni->ni_author.data(),
+             v_ni->ni_author.size());
+      memcpy(pOut->news[i].headline, v_ni->ni_headline.data(),
+             v_ni->ni_headline.size());
+      memcpy(pOut->news[i].summary, v_ni->ni_summary.data(),
+             v_ni->ni_summary.size());
+    }
+  }
+  pOut->news_len = (max_news_len > nx_scanner.output.size())
+                       ? max_news_len
+                       : nx_scanner.output.size();
+
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::txn_trade_lookup(uint32_t idx, ermia::epoch_num begin_epoch) {
+  TTradeLookupTxnInput input;
+  m_TxnInputGenerator->GenerateTradeLookupInput(input);
+
+  ermia::transaction *txn = begin_read_only(idx, begin_epoch);
+
+  switch (input.frame_to_execute) {
+    case 1: {
+      TTradeLookupFrame1Input frame1_input;
+      TTradeLookupFrame1Output frame1_output;
+      memset(&frame1_input, 0, sizeof(frame1_input));
+      memset(&frame1_output, 0, sizeof(frame1_output));
+      frame1_input.max_trades = input.max_trades;
+      memcpy(frame1_input.trade_id, input.trade_id, sizeof(frame1_input.trade_id));
+
+      TryReturnCoro(co_await trade_lookup_frame1(txn, idx, &frame1_input, &frame1_output));
+      TryValidateCoro(frame1_output.num_found == input.max_trades);
+      break;
+    }
+    case 2: {
+      TTradeLookupFrame2Input frame2_input;
+      TTradeLookupFrame2Output frame2_output;
+      memset(&frame2_input, 0, sizeof(frame2_input));
+      memset(&frame2_output, 0, sizeof(frame2_output));
+      frame2_input.acct_id = input.acct_id;
+      frame2_input.max_trades = input.max_trades;
+      frame2_input.start_trade_dts = input.start_trade_dts;
+      frame2_input.end_trade_dts = input.end_trade_dts;
+
+      TryReturnCoro(co_await trade_lookup_frame2(txn, idx, &frame2_input, &frame2_output));
+      TryValidateCoro(frame2_output.num_found > 0 &&
+                      frame2_output.num_found <= frame2_input.max_trades);
+      break;
+    }
+    case 3: {
+      TTradeLookupFrame3Input frame3_input;
+      TTradeLookupFrame3Output frame3_output;
+      memset(&frame3_input, 0, sizeof(frame3_input));
+      memset(&frame3_output, 0, sizeof(frame3_output));
+      frame3_input.max_trades = input.max_trades;
+      strncpy(frame3_input.symbol, input.symbol, sizeof(frame3_input.symbol));
+      frame3_input.start_trade_dts = input.start_trade_dts;
+      frame3_input.end_trade_dts = input.end_trade_dts;
+      frame3_input.max_acct_id = input.max_acct_id;
+
+      TryReturnCoro(co_await trade_lookup_frame3(txn, idx, &frame3_input, &frame3_output));
+      TryValidateCoro(frame3_output.num_found > 0 &&
+                      frame3_output.num_found <= frame3_input.max_trades);
+      break;
+    }
+    case 4: {
+      TTradeLookupFrame4Input frame4_input;
+      TTradeLookupFrame4Output frame4_output;
+      memset(&frame4_input, 0, sizeof(frame4_input));
+      memset(&frame4_output, 0, sizeof(frame4_output));
+      frame4_input.acct_id = input.acct_id;
+      frame4_input.trade_dts = input.start_trade_dts;
+
+      TryReturnCoro(co_await trade_lookup_frame4(txn, idx, &frame4_input, &frame4_output));
+      TryValidateCoro(frame4_output.num_trades_found == 1);
+      TryValidateCoro(frame4_output.num_found >= 1 &&
+                      frame4_output.num_found <= TradeLookupFrame4MaxRows);
+      break;
+    }
+    default:
+      LOG(FATAL) << "Wrong TradeLookup frame " << input.frame_to_execute;
+  }
+
+#ifndef CORO_BATCH_COMMIT
+  TryCatchCoro(co_await db->coro_Commit(txn));
+#endif
+
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::trade_lookup_frame1(
+    ermia::transaction *txn, uint32_t idx,
+    const TTradeLookupFrame1Input *pIn,
+    TTradeLookupFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
+  ermia::varstr valptr;
+
+  pOut->num_found = 0;
+  for (int i = 0; i < pIn->max_trades; i++) {
+    const trade::key k_t(pIn->trade_id[i]);
+    trade::value v_t_temp;
+    rc = co_await tbl_trade(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_t)), k_t), valptr);
+    TryVerifyRelaxedCoro(rc);
+    const trade::value *v_t = Decode(valptr, v_t_temp);
+
+    const trade_type::key k_tt(v_t->t_tt_id);
+    trade_type::value v_tt_temp;
+    rc = co_await tbl_trade_type(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_tt)), k_tt), valptr);
+    TryVerifyRelaxedCoro(rc);
+    const trade_type::value *v_tt = Decode(valptr, v_tt_temp);
+
+    pOut->trade_info[i].bid_price = v_t->t_bid_price;
+    memcpy(pOut->trade_info[i].exec_name, v_t->t_exec_name.data(),
+           v_t->t_exec_name.size());
+    pOut->trade_info[i].is_cash = v_t->t_is_cash;
+    pOut->trade_info[i].is_market = v_tt->tt_is_mrkt;
+    pOut->trade_info[i].trade_price = v_t->t_trade_price;
+
+    pOut->num_found++;
+
+    const settlement::key k_se(pIn->trade_id[i]);
+    settlement::value v_se_temp;
+    rc = co_await tbl_settlement(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_se)), k_se), valptr);
+    TryVerifyRelaxedCoro(rc);
+    const settlement::value *v_se = Decode(valptr, v_se_temp);
+
+    pOut->trade_info[i].settlement_amount = v_se->se_amt;
+    CDateTime(v_se->se_cash_due_date)
+        .GetTimeStamp(&pOut->trade_info[i].settlement_cash_due_date);
+    memcpy(pOut->trade_info[i].settlement_cash_type, v_se->se_cash_type.data(),
+           v_se->se_cash_type.size());
+
+    if (pOut->trade_info[i].is_cash) {
+      const cash_transaction::key k_ct(pIn->trade_id[i]);
+      cash_transaction::value v_ct_temp;
+      rc = co_await tbl_cash_transaction(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_ct)), k_ct), valptr);
+      TryVerifyRelaxedCoro(rc);
+      const cash_transaction::value *v_ct = Decode(valptr, v_ct_temp);
+
+      pOut->trade_info[i].cash_transaction_amount = v_ct->ct_amt;
+      CDateTime(v_ct->ct_dts)
+          .GetTimeStamp(&pOut->trade_info[i].cash_transaction_dts);
+      memcpy(pOut->trade_info[i].cash_transaction_name, v_ct->ct_name.data(),
+             v_ct->ct_name.size());
+    }
+
+    // Scan
+    const trade_history::key k_th_0(
+        pIn->trade_id[i], std::string(cST_ID_len, (char)0), MIN_VAL(k_th_0.th_dts));
+    const trade_history::key k_th_1(pIn->trade_id[i],
+                                    std::string(cST_ID_len, (char)255),
+                                    MAX_VAL(k_th_1.th_dts));
+    tpce_table_scanner th_scanner(&arenas[idx]);
+    rc = co_await tbl_trade_history(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_th_0)), k_th_0),
+        &Encode(str(arenas[idx], sizeof(k_th_1)), k_th_1), th_scanner);
+    TryCatchCoro(rc);
+    ALWAYS_ASSERT(th_scanner.output.size());
+
+    int th_cursor = 0;
+    for (auto &r_th : th_scanner.output) {
+      trade_history::key k_th_temp;
+      const trade_history::key *k_th = Decode(*r_th.first, k_th_temp);
+
+      memcpy(pOut->trade_info[i].trade_history_status_id[th_cursor],
+             k_th->th_st_id.data(), k_th->th_st_id.size());
+      CDateTime(k_th->th_dts)
+          .GetTimeStamp(&pOut->trade_info[i].trade_history_dts[th_cursor]);
+      th_cursor++;
+
+      if (th_cursor >= TradeLookupMaxTradeHistoryRowsReturned) break;
+    }
+  }
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::trade_lookup_frame2(
+    ermia::transaction *txn, uint32_t idx,
+    const TTradeLookupFrame2Input *pIn,
+    TTradeLookupFrame2Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
+  ermia::varstr valptr;
+
+  const t_ca_id_index::key k_t_0(
+      pIn->acct_id,
+      CDateTime((TIMESTAMP_STRUCT *)&pIn->start_trade_dts).GetDate(),
+      MIN_VAL(k_t_0.t_id));
+  const t_ca_id_index::key k_t_1(
+      pIn->acct_id,
+      CDateTime((TIMESTAMP_STRUCT *)&pIn->end_trade_dts).GetDate(),
+      MAX_VAL(k_t_1.t_id));
+  tpce_table_scanner t_scanner(&arenas[idx]);
+  rc = co_await tbl_t_ca_id_index(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_t_0)), k_t_0),
+      &Encode(str(arenas[idx], sizeof(k_t_1)), k_t_1), t_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(t_scanner.output.size());
+
+  auto num_found = 0;
+  for (auto &r_t : t_scanner.output) {
+    if (num_found >= pIn->max_trades) break;
+
+    t_ca_id_index::key k_t_temp;
+    trade::value v_t_temp;
+    const t_ca_id_index::key *k_t = Decode(*r_t.first, k_t_temp);
+    const trade::value *v_t = Decode(*r_t.second, v_t_temp);
+
+    // DTS could be changed, invalidating the key in 2nd index (t_s_symb_index),
+    // e.g., by MarketFeed. Skip if it doesn't match the one stored in the main
+    // record.
+    if (v_t->t_dts != k_t->t_dts) {
+      continue;
+    }
+
+    pOut->trade_info[num_found].bid_price = v_t->t_bid_price;
+    memcpy(pOut->trade_info[num_found].exec_name, v_t->t_exec_name.data(),
+           v_t->t_exec_name.size());
+    pOut->trade_info[num_found].is_cash = v_t->t_is_cash;
+    pOut->trade_info[num_found].trade_id = k_t->t_id;
+    pOut->trade_info[num_found].trade_price = v_t->t_trade_price;
+    num_found++;
+  }
+
+  pOut->num_found = num_found;
+
+  for (auto i = 0; i < num_found; i++) {
+    const settlement::key k_se(pOut->trade_info[i].trade_id);
+    settlement::value v_se_temp;
+    rc = co_await tbl_settlement(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_se)), k_se), valptr);
+    TryVerifyRelaxedCoro(rc);
+    const settlement::value *v_se = Decode(valptr, v_se_temp);
+
+    pOut->trade_info[i].settlement_amount = v_se->se_amt;
+    CDateTime(v_se->se_cash_due_date)
+        .GetTimeStamp(&pOut->trade_info[i].settlement_cash_due_date);
+    memcpy(pOut->trade_info[i].settlement_cash_type, v_se->se_cash_type.data(),
+           v_se->se_cash_type.size());
+
+    if (pOut->trade_info[i].is_cash) {
+      const cash_transaction::key k_ct(pOut->trade_info[i].trade_id);
+      cash_transaction::value v_ct_temp;
+      rc = co_await tbl_cash_transaction(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_ct)), k_ct), valptr);
+      TryVerifyRelaxedCoro(rc);
+      const cash_transaction::value *v_ct = Decode(valptr, v_ct_temp);
+
+      pOut->trade_info[i].cash_transaction_amount = v_ct->ct_amt;
+      CDateTime(v_ct->ct_dts)
+          .GetTimeStamp(&pOut->trade_info[i].cash_transaction_dts);
+      memcpy(pOut->trade_info[i].cash_transaction_name, v_ct->ct_name.data(),
+             v_ct->ct_name.size());
+    }
+
+    const trade_history::key k_th_0(pOut->trade_info[i].trade_id,
+                                    std::string(cST_ID_len, (char)0),
+                                    MIN_VAL(k_th_0.th_dts));
+    const trade_history::key k_th_1(pOut->trade_info[i].trade_id,
+                                    std::string(cST_ID_len, (char)255),
+                                    MAX_VAL(k_th_1.th_dts));
+    tpce_table_scanner th_scanner(&arenas[idx]);
+    rc = co_await tbl_trade_history(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_th_0)), k_th_0),
+        &Encode(str(arenas[idx], sizeof(k_th_1)), k_th_1), th_scanner);
+    TryCatchCoro(rc);
+    ALWAYS_ASSERT(th_scanner.output.size());
+
+    int th_cursor = 0;
+    for (auto &r_th : th_scanner.output) {
+      trade_history::key k_th_temp;
+      const trade_history::key *k_th = Decode(*r_th.first, k_th_temp);
+
+      memcpy(pOut->trade_info[i].trade_history_status_id[th_cursor],
+             k_th->th_st_id.data(), k_th->th_st_id.size());
+      CDateTime(k_th->th_dts)
+          .GetTimeStamp(&pOut->trade_info[i].trade_history_dts[th_cursor]);
+      th_cursor++;
+
+      if (th_cursor >= TradeLookupMaxTradeHistoryRowsReturned) break;
+    }
+  }
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::trade_lookup_frame3(
+    ermia::transaction *txn, uint32_t idx,
+    const TTradeLookupFrame3Input *pIn,
+    TTradeLookupFrame3Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
+  ermia::varstr valptr;
+
+  const t_s_symb_index::key k_t_0(
+      std::string(pIn->symbol),
+      CDateTime((TIMESTAMP_STRUCT *)&pIn->start_trade_dts).GetDate(),
+      MIN_VAL(k_t_0.t_id));
+  const t_s_symb_index::key k_t_1(
+      std::string(pIn->symbol),
+      CDateTime((TIMESTAMP_STRUCT *)&pIn->end_trade_dts).GetDate(),
+      MAX_VAL(k_t_1.t_id));
+  tpce_table_scanner t_scanner(&arenas[idx]);
+  rc = co_await tbl_t_s_symb_index(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_t_0)), k_t_0),
+      &Encode(str(arenas[idx], sizeof(k_t_1)), k_t_1), t_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(t_scanner.output.size());
+
+  auto num_found = 0;
+  for (auto &r_t : t_scanner.output) {
+    if (num_found >= pIn->max_trades) break;
+    t_s_symb_index::key k_t_temp;
+    trade::value v_t_temp;
+    const t_s_symb_index::key *k_t = Decode(*r_t.first, k_t_temp);
+    const trade::value *v_t = Decode(*r_t.second, v_t_temp);
+
+    // DTS could be changed, invalidating the key in 2nd index (t_s_symb_index),
+    // e.g., by MarketFeed. Skip if it doesn't match the one stored in the main
+    // record.
+    if (v_t->t_dts != k_t->t_dts) {
+      continue;
+    }
+
+    pOut->trade_info[num_found].acct_id = v_t->t_ca_id;
+    memcpy(pOut->trade_info[num_found].exec_name, v_t->t_exec_name.data(),
+           v_t->t_exec_name.size());
+    pOut->trade_info[num_found].is_cash = v_t->t_is_cash;
+    pOut->trade_info[num_found].price = v_t->t_trade_price;
+    pOut->trade_info[num_found].quantity = v_t->t_qty;
+    CDateTime(k_t->t_dts).GetTimeStamp(&pOut->trade_info[num_found].trade_dts);
+    pOut->trade_info[num_found].trade_id = k_t->t_id;
+    memcpy(pOut->trade_info[num_found].trade_type, v_t->t_tt_id.data(),
+           v_t->t_tt_id.size());
+
+    num_found++;
+  }
+
+  pOut->num_found = num_found;
+
+  for (int i = 0; i < num_found; i++) {
+    const settlement::key k_se(pOut->trade_info[i].trade_id);
+    settlement::value v_se_temp;
+    rc = co_await tbl_settlement(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_se)), k_se), valptr);
+    TryVerifyRelaxedCoro(rc);
+    const settlement::value *v_se = Decode(valptr, v_se_temp);
+
+    pOut->trade_info[i].settlement_amount = v_se->se_amt;
+    CDateTime(v_se->se_cash_due_date)
+        .GetTimeStamp(&pOut->trade_info[i].settlement_cash_due_date);
+    memcpy(pOut->trade_info[i].settlement_cash_type, v_se->se_cash_type.data(),
+           v_se->se_cash_type.size());
+
+    if (pOut->trade_info[i].is_cash) {
+      const cash_transaction::key k_ct(pOut->trade_info[i].trade_id);
+      cash_transaction::value v_ct_temp;
+      rc = co_await tbl_cash_transaction(1)->coro_GetRecord(txn, Encode(str(arenas[idx], sizeof(k_ct)), k_ct), valptr);
+      TryVerifyRelaxedCoro(rc);
+      const cash_transaction::value *v_ct = Decode(valptr, v_ct_temp);
+
+      pOut->trade_info[i].cash_transaction_amount = v_ct->ct_amt;
+      CDateTime(v_ct->ct_dts)
+          .GetTimeStamp(&pOut->trade_info[i].cash_transaction_dts);
+      memcpy(pOut->trade_info[i].cash_transaction_name, v_ct->ct_name.data(),
+             v_ct->ct_name.size());
+    }
+
+    const trade_history::key k_th_0(pOut->trade_info[i].trade_id,
+                                    std::string(cST_ID_len, (char)0),
+                                    MIN_VAL(k_th_0.th_dts));
+    const trade_history::key k_th_1(pOut->trade_info[i].trade_id,
+                                    std::string(cST_ID_len, (char)255),
+                                    MAX_VAL(k_th_1.th_dts));
+    tpce_table_scanner th_scanner(&arenas[idx]);
+    rc = co_await tbl_trade_history(1)->coro_Scan(
+        txn, Encode(str(arenas[idx], sizeof(k_th_0)), k_th_0),
+        &Encode(str(arenas[idx], sizeof(k_th_1)), k_th_1), th_scanner);
+    TryCatchCoro(rc);
+    ALWAYS_ASSERT(th_scanner.output.size());
+
+    // TODO. order by
+    int th_cursor = 0;
+    for (auto &r_th : th_scanner.output) {
+      trade_history::key k_th_temp;
+      const trade_history::key *k_th = Decode(*r_th.first, k_th_temp);
+
+      memcpy(pOut->trade_info[i].trade_history_status_id[th_cursor],
+             k_th->th_st_id.data(), k_th->th_st_id.size());
+      CDateTime(k_th->th_dts)
+          .GetTimeStamp(&pOut->trade_info[i].trade_history_dts[th_cursor]);
+      th_cursor++;
+      if (th_cursor >= TradeLookupMaxTradeHistoryRowsReturned) break;
+    }
+  }
+  co_return {RC_TRUE};
+}
+
+ermia::coro::generator<rc_t> tpce_cs_worker::trade_lookup_frame4(
+    ermia::transaction *txn, uint32_t idx,
+    const TTradeLookupFrame4Input *pIn,
+    TTradeLookupFrame4Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
+
+  const t_ca_id_index::key k_t_0(
+      pIn->acct_id, CDateTime((TIMESTAMP_STRUCT *)&pIn->trade_dts).GetDate(),
+      MIN_VAL(k_t_0.t_id));
+  const t_ca_id_index::key k_t_1(pIn->acct_id, MAX_VAL(k_t_1.t_dts),
+                                 MAX_VAL(k_t_1.t_id));
+  tpce_table_scanner t_scanner(&arenas[idx]);
+  rc = co_await tbl_t_ca_id_index(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_t_0)), k_t_0),
+      &Encode(str(arenas[idx], sizeof(k_t_1)), k_t_1), t_scanner);
+  TryCatchCoro(rc);
+  if (not t_scanner.output.size()) {  // XXX. can happen? or something is wrong?
+    pOut->num_trades_found = 0;
+    db->Abort(txn);
+    co_return {RC_ABORT_USER};
+  }
+
+  bool found = false;
+  for (auto &r_t : t_scanner.output) {
+    t_ca_id_index::key k_t_temp;
+    const t_ca_id_index::key *k_t = Decode(*r_t.first, k_t_temp);
+    trade::value v_t_temp;
+    const trade::value *v_t = Decode(*r_t.second, v_t_temp);
+
+    // DTS could be changed, invalidating the key in 2nd index (t_s_symb_index),
+    // e.g., by MarketFeed. Skip if it doesn't match the one stored in the main
+    // record.
+    if (v_t->t_dts != k_t->t_dts) {
+      continue;
+    }
+
+    pOut->trade_id = k_t->t_id;
+    found = true;
+    break;
+  }
+  if (!found) {
+    pOut->num_trades_found = 0;
+    db->Abort(txn);
+    co_return {RC_ABORT_USER};
+  }
+
+  pOut->num_trades_found = 1;
+
+  // XXX. holding_history PK isn't unique. combine T_ID and row ID.
+  const holding_history::key k_hh_0(pOut->trade_id, MIN_VAL(k_hh_0.hh_h_t_id));
+  const holding_history::key k_hh_1(pOut->trade_id, MAX_VAL(k_hh_1.hh_h_t_id));
+  tpce_table_scanner hh_scanner(&arenas[idx]);
+  rc = co_await tbl_holding_history(1)->coro_Scan(
+      txn, Encode(str(arenas[idx], sizeof(k_hh_0)), k_hh_0),
+      &Encode(str(arenas[idx], sizeof(k_hh_1)), k_hh_1), hh_scanner);
+  TryCatchCoro(rc);
+  ALWAYS_ASSERT(
+      hh_scanner.output.size());  // possible case. no holding for the customer
+
+  auto hh_cursor = 0;
+  for (auto &r_hh : hh_scanner.output) {
+    holding_history::key k_hh_temp;
+    holding_history::value v_hh_temp;
+    const holding_history::key *k_hh = Decode(*r_hh.first, k_hh_temp);
+    const holding_history::value *v_hh = Decode(*r_hh.second, v_hh_temp);
+
+    pOut->trade_info[hh_cursor].holding_history_id = k_hh->hh_h_t_id;
+    pOut->trade_info[hh_cursor].holding_history_trade_id = k_hh->hh_t_id;
+    pOut->trade_info[hh_cursor].quantity_after = v_hh->hh_after_qty;
+    pOut->trade_info[hh_cursor].quantity_before = v_hh->hh_before_qty;
+
+    hh_cursor++;
+    if (hh_cursor >= TradeLookupFrame4MaxRows) break;
+  }
+
+  pOut->num_found = hh_cursor;
+
+  co_return {RC_TRUE};
+}
+
+// Same order as g_txn_workload_mix
+static const char *const kTxnNames[] = {
+    "BrokerVolume", "CustomerPosition", "MarketFeed", "MarketWatch",
+    "SecurityDetail", "TradeLookup", "TradeOrder", "TradeResult",
+    "TradeStatus", "TradeUpdate", "LongQuery"};
+static const bench_worker::coro_txn_fn_t kCoroTxns[] = {
+    nullptr, tpce_cs_worker::TxnCustomerPosition, nullptr,
+    tpce_cs_worker::TxnMarketWatch, tpce_cs_worker::TxnSecurityDetail,
+    tpce_cs_worker::TxnTradeLookup, nullptr, nullptr, nullptr, nullptr, nullptr};
+static_assert(ARRAY_NELEMS(kTxnNames) == ARRAY_NELEMS(g_txn_workload_mix),
+              "TPC-E transaction names don't match the workload mix");
+static_assert(ARRAY_NELEMS(kCoroTxns) == ARRAY_NELEMS(g_txn_workload_mix),
+              "TPC-E coroutine transactions don't match the workload mix");
+
+void tpce_cs_worker::CheckWorkloadMix() {
+  for (size_t i = 0; i < ARRAY_NELEMS(g_txn_workload_mix); i++) {
+    LOG_IF(FATAL, g_txn_workload_mix[i] && !kCoroTxns[i])
+        << "TPC-E " << kTxnNames[i] << " has no coroutine version; --coro_tx "
+        << "only runs the read-only CustomerPosition, MarketWatch, "
+        << "SecurityDetail and TradeLookup, e.g. "
+        << "--workload-mix 0,25,0,25,25,25,0,0,0,0,0";
+  }
+}
+
+bench_worker::workload_desc_vec tpce_cs_worker::get_workload() const {
+  workload_desc_vec w;
+  double m = 0;
+  for (size_t i = 0; i < ARRAY_NELEMS(g_txn_workload_mix); i++)
+    m += g_txn_workload_mix[i];
+  ALWAYS_ASSERT(m == 100);
+
+  CheckWorkloadMix();
+  for (size_t i = 0; i < ARRAY_NELEMS(g_txn_workload_mix); i++) {
+    if (g_txn_workload_mix[i])
+      w.push_back(workload_desc(kTxnNames[i], g_txn_workload_mix[i] / 100.0,
+                                nullptr, kCoroTxns[i]));
+  }
+  return w;
+}
+
+void tpce_cs_worker::MyWork(char *) {
+  // No replication support
+  ALWAYS_ASSERT(is_worker);
+  workload = get_workload();
+  prepare_txn_stats(workload.size());
+
+  if (ermia::config::coro_pipeline_schedule) {
+    PipelineScheduler();
+  } else if (ermia::config::coro_batch_schedule) {
+    BatchScheduler();
+  } else if (ermia::config::coro_work_stealing) {
+    WorkStealingScheduler();
+  } else {
+    Scheduler();
+  }
+
+  coro_frame_stats = ermia::coro::coroutine_allocator.get_stats();
+}
+
+#endif // ADV_COROUTINE
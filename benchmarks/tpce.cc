@@ -19,7 +19,7 @@ using namespace TPCE;
 #define TryTPCEOutput(op)                   \
 {                                           \
   rc_t r = op;                              \
-  if (rc_is_abort(r)) return r;             \
+  if (r.IsAbort()) return r;                \
   if (output.status == 0) return {RC_TRUE}; \
   return {RC_ABORT_USER};                   \
 }
@@ -29,8 +29,8 @@ int64_t lastTradeId;
 int64_t last_list = 0;
 int64_t min_ca_id = numeric_limits<int64_t>::max();
 int64_t max_ca_id = 0;
-static double g_txn_workload_mix[] = {4.9,  13, 1,  18, 14, 8,
-                                      10.1, 10, 19, 2,  0};
+double g_txn_workload_mix[] = {4.9,  13, 1,  18, 14, 8,
+                               10.1, 10, 19, 2,  0};
 int64_t long_query_scan_range = 20;
 
 // Egen
@@ -82,25 +82,6 @@ StatusTypeBuffer statusTypeBuffer(10);
 TaxrateBuffer taxrateBuffer(325);
 ZipCodeBuffer zipCodeBuffer(14850);
 
-// Utils
-class tpce_table_scanner : public ermia::OrderedIndex::ScanCallback {
- public:
-  tpce_table_scanner(ermia::str_arena *arena) : _arena(arena) {}
-  virtual bool Invoke(const char *keyp, size_t keylen, const ermia::varstr &value) {
-    ermia::varstr *const k = _arena->next(keylen);
-    ASSERT(k);
-    k->copy_from(keyp, keylen);
-
-    ermia::varstr *v = _arena->next(0);
-    v->p = value.p;
-    v->l = value.l;
-    output.emplace_back(k, v);
-    return true;
-  }
-  std::vector<std::pair<ermia::varstr *, ermia::varstr *>> output;
-  ermia::str_arena *_arena;
-};
-
 int64_t GetLastListID() {
   // TODO. decentralize,  thread ID + local counter and TLS
   auto ret = __sync_add_and_fetch(&last_list, 1);
@@ -115,10 +96,6 @@ int64_t GetLastTradeID() {
   return ret;
 }
 
-static ALWAYS_INLINE size_t NumPartitions() {
-  return (size_t)ermia::config::benchmark_scale_factor;
-}
-
 void setRNGSeeds(CCETxnInputGenerator *gen, unsigned int UniqueId) {
   CDateTime Now;
   INT32 BaseYear;
@@ -174,101 +151,6 @@ unsigned int AutoRand() {
           tv.tv_usec / 1000);
 }
 
-struct _dummy {};  // exists so we can inherit from it, so we can use a macro in
-// an init list...
-
-class tpce_worker_mixin : private _dummy {
-#define DEFN_TBL_INIT_X(name) , tbl_##name##_vec(partitions.at(#name))
-
- public:
-  tpce_worker_mixin(const map<std::string, std::vector<ermia::OrderedIndex *>> &partitions)
-      : _dummy()  // so hacky...
-        TPCE_TABLE_LIST(DEFN_TBL_INIT_X) {}
-
-#undef DEFN_TBL_INIT_X
-
- protected:
-#define DEFN_TBL_ACCESSOR_X(name)                                   \
- private:                                                           \
-  std::vector<ermia::OrderedIndex *> tbl_##name##_vec;                          \
-                                                                    \
- protected:                                                         \
-  ALWAYS_INLINE ermia::OrderedIndex *tbl_##name(unsigned int pid) { \
-    return tbl_##name##_vec[pid - 1];                               \
-  }
-
-  TPCE_TABLE_LIST(DEFN_TBL_ACCESSOR_X)
-
-#undef DEFN_TBL_ACCESSOR_X
-
-  // only TPCE loaders need to call this- workers are automatically
-  // pinned by their worker id (which corresponds to partition id
-  // in TPCE)
-  //
-  // pins the *calling* thread
-  static void PinToPartition(unsigned int pid) {}
-
- public:
-  static inline uint32_t GetCurrentTimeMillis() {
-    // struct timeval tv;
-    // ALWAYS_ASSERT(gettimeofday(&tv, 0) == 0);
-    // return tv.tv_sec * 1000;
-
-    // XXX(stephentu): implement a scalable GetCurrentTimeMillis()
-    // for now, we just give each core an increasing number
-
-    static thread_local uint32_t tl_hack = 0;
-    return tl_hack++;
-  }
-
-  // utils for generating random #s and strings
-
-  static ALWAYS_INLINE int CheckBetweenInclusive(int v, int lower,
-                                                        int upper) {
-    ASSERT(v >= lower);
-    ASSERT(v <= upper);
-    return v;
-  }
-
-  static ALWAYS_INLINE int RandomNumber(util::fast_random &r, int min,
-                                               int max) {
-    return CheckBetweenInclusive(
-        (int)(r.next_uniform() * (max - min + 1) + min), min, max);
-  }
-
-  static ALWAYS_INLINE int NonUniformRandom(util::fast_random &r, int A, int C,
-                                                   int min, int max) {
-    return (((RandomNumber(r, 0, A) | RandomNumber(r, min, max)) + C) %
-            (max - min + 1)) +
-           min;
-  }
-
-  // following oltpbench, we really generate strings of len - 1...
-  static inline std::string RandomStr(util::fast_random &r, uint len) {
-    // this is a property of the oltpbench implementation...
-    if (!len) return "";
-
-    uint i = 0;
-    std::string buf(len - 1, 0);
-    while (i < (len - 1)) {
-      const char c = (char)r.next_char();
-      // XXX(stephentu): oltpbench uses java's Character.isLetter(), which
-      // is a less restrictive filter than isalnum()
-      if (!isalnum(c)) continue;
-      buf[i++] = c;
-    }
-    return buf;
-  }
-
-  // RandomNStr() actually produces a std::string of length len
-  static inline std::string RandomNStr(util::fast_random &r, uint len) {
-    const char base = '0';
-    std::string buf(len, 0);
-    for (uint i = 0; i < len; i++) buf[i] = (char)(base + (r.next() % 10));
-    return buf;
-  }
-};
-
 // TPCE workers implement TxnHarness interfaces
 class tpce_worker : public bench_worker,
                     public tpce_worker_mixin,
@@ -374,7 +256,7 @@ class tpce_worker : public bench_worker,
     auto ret = harness->DoTxn((PMarketFeedTxnInput)input,
                               (PMarketFeedTxnOutput)&output);
     delete input;
-    if (not rc_is_abort(ret)) {
+    if (not ret.IsAbort()) {
       if (output.status == 0)
         return {RC_TRUE};
       else {
@@ -491,7 +373,7 @@ class tpce_worker : public bench_worker,
     auto ret = harness->DoTxn((PTradeResultTxnInput)input,
                               (PTradeResultTxnOutput)&output);
     delete input;
-    if (not rc_is_abort(ret)) {
+    if (not ret.IsAbort()) {
       if (output.status == 0)
         return {RC_TRUE};
       else
@@ -647,7 +529,7 @@ class tpce_worker : public bench_worker,
   }
 
  protected:
-  ALWAYS_INLINE ermia::varstr &str(uint64_t size) { return *arena.next(size); }
+  ALWAYS_INLINE ermia::varstr &str(uint64_t size) { return *arena->next(size); }
 
  private:
   ermia::transaction *txn;
@@ -694,19 +576,19 @@ rc_t tpce_worker::DoBrokerVolumeFrame1(const TBrokerVolumeFrame1Input *pIn,
   */
 
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   std::vector<std::pair<ermia::varstr *, const ermia::varstr *>> brokers;
-  for (auto i = 0; i < max_broker_list_len and pIn->broker_list[i]; i++) {
+  for (auto i = 0; i < max_broker_list_len and pIn->broker_list[i][0]; i++) {
     const b_name_index::key k_b_0(std::string(pIn->broker_list[i]),
                                   MIN_VAL(k_b_0.b_id));
     const b_name_index::key k_b_1(std::string(pIn->broker_list[i]),
                                   MAX_VAL(k_b_1.b_id));
-    tpce_table_scanner b_scanner(&arena);
+    tpce_table_scanner b_scanner(arena);
     TryCatch(tbl_b_name_index(1)->Scan(txn, Encode(str(sizeof(k_b_0)), k_b_0),
                                         &Encode(str(sizeof(k_b_1)), k_b_1),
-                                        b_scanner, &arena));
+                                        b_scanner));
     if (not b_scanner.output.size()) continue;
 
     for (auto &r_b : b_scanner.output) brokers.push_back(r_b);
@@ -717,10 +599,10 @@ rc_t tpce_worker::DoBrokerVolumeFrame1(const TBrokerVolumeFrame1Input *pIn,
 
   const sector::key k_sc_0(pIn->sector_name, std::string(cSC_ID_len, (char)0));
   const sector::key k_sc_1(pIn->sector_name, std::string(cSC_ID_len, (char)255));
-  tpce_table_scanner sc_scanner(&arena);
+  tpce_table_scanner sc_scanner(arena);
   TryCatch(tbl_sector(1)->Scan(txn, Encode(str(sizeof(k_sc_0)), k_sc_0),
                                 &Encode(str(sizeof(k_sc_1)), k_sc_1),
-                                sc_scanner, &arena));
+                                sc_scanner));
   ALWAYS_ASSERT(sc_scanner.output.size() == 1);
   for (auto &r_sc : sc_scanner.output) {
     sector::key k_sc_temp;
@@ -730,10 +612,10 @@ rc_t tpce_worker::DoBrokerVolumeFrame1(const TBrokerVolumeFrame1Input *pIn,
     const in_sc_id_index::key k_in_0(k_sc->sc_id, std::string(cIN_ID_len, (char)0));
     const in_sc_id_index::key k_in_1(k_sc->sc_id,
                                      std::string(cIN_ID_len, (char)255));
-    tpce_table_scanner in_scanner(&arena);
+    tpce_table_scanner in_scanner(arena);
     TryCatch(tbl_in_sc_id_index(1)->Scan(
         txn, Encode(str(sizeof(k_in_0)), k_in_0),
-        &Encode(str(sizeof(k_in_1)), k_in_1), in_scanner, &arena));
+        &Encode(str(sizeof(k_in_1)), k_in_1), in_scanner));
     ALWAYS_ASSERT(in_scanner.output.size());
 
     for (auto &r_in : in_scanner.output) {
@@ -743,10 +625,10 @@ rc_t tpce_worker::DoBrokerVolumeFrame1(const TBrokerVolumeFrame1Input *pIn,
       // co_in_id_index scan
       const co_in_id_index::key k_in_0(k_in->in_id, MIN_VAL(k_in_0.co_id));
       const co_in_id_index::key k_in_1(k_in->in_id, MAX_VAL(k_in_1.co_id));
-      tpce_table_scanner co_scanner(&arena);
+      tpce_table_scanner co_scanner(arena);
       TryCatch(tbl_co_in_id_index(1)->Scan(
           txn, Encode(str(sizeof(k_in_0)), k_in_0),
-          &Encode(str(sizeof(k_in_1)), k_in_1), co_scanner, &arena));
+          &Encode(str(sizeof(k_in_1)), k_in_1), co_scanner));
       ALWAYS_ASSERT(co_scanner.output.size());
       for (auto &r_co : co_scanner.output) {
         co_in_id_index::key k_co_temp;
@@ -759,10 +641,10 @@ rc_t tpce_worker::DoBrokerVolumeFrame1(const TBrokerVolumeFrame1Input *pIn,
         const security_index::key k_s_1(k_co->co_id,
                                         std::string(cS_ISSUE_len, (char)255),
                                         std::string(cSYMBOL_len, (char)255));
-        tpce_table_scanner s_scanner(&arena);
+        tpce_table_scanner s_scanner(arena);
         TryCatch(tbl_security_index(1)->Scan(
             txn, Encode(str(sizeof(k_s_0)), k_s_0),
-            &Encode(str(sizeof(k_s_1)), k_s_1), s_scanner, &arena));
+            &Encode(str(sizeof(k_s_1)), k_s_1), s_scanner));
         ALWAYS_ASSERT(s_scanner.output.size());
         for (auto &r_s : s_scanner.output) {
           security_index::key k_s_temp;
@@ -778,10 +660,10 @@ rc_t tpce_worker::DoBrokerVolumeFrame1(const TBrokerVolumeFrame1Input *pIn,
                                             MIN_VAL(k_tr_0.tr_t_id));
             const trade_request::key k_tr_1(k_s->s_symb, k_b_idx->b_id,
                                             MAX_VAL(k_tr_1.tr_t_id));
-            tpce_table_scanner tr_scanner(&arena);
+            tpce_table_scanner tr_scanner(arena);
             TryCatch(tbl_trade_request(1)->Scan(
                 txn, Encode(str(sizeof(k_tr_0)), k_tr_0),
-                &Encode(str(sizeof(k_tr_1)), k_tr_1), tr_scanner, &arena));
+                &Encode(str(sizeof(k_tr_1)), k_tr_1), tr_scanner));
             // ALWAYS_ASSERT(tr_scanner.output.size()); // XXX. If there's no
             // previous trade, this can happen
 
@@ -809,21 +691,22 @@ rc_t tpce_worker::DoBrokerVolumeFrame1(const TBrokerVolumeFrame1Input *pIn,
 rc_t tpce_worker::DoCustomerPositionFrame1(
     const TCustomerPositionFrame1Input *pIn,
     TCustomerPositionFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   // Get c_id;
   const c_tax_id_index::key k_c_0(pIn->tax_id, MIN_VAL(k_c_0.c_id));
   const c_tax_id_index::key k_c_1(pIn->tax_id, MAX_VAL(k_c_1.c_id));
-  tpce_table_scanner c_scanner(&arena);
+  tpce_table_scanner c_scanner(arena);
 
   if (pIn->cust_id)
     pOut->cust_id = pIn->cust_id;
   else {
     TryCatch(tbl_c_tax_id_index(1)->Scan(
         txn, Encode(str(sizeof(k_c_0)), k_c_0),
-        &Encode(str(sizeof(k_c_1)), k_c_1), c_scanner, &arena));
+        &Encode(str(sizeof(k_c_1)), k_c_1), c_scanner));
     // XXX. input generator's tax_id doesn't exist.  ???
     if (not c_scanner.output.size()) {
       db->Abort(txn);
@@ -839,8 +722,8 @@ rc_t tpce_worker::DoCustomerPositionFrame1(
   // probe Customers
   const customers::key k_c(pOut->cust_id);
   customers::value v_c_temp;
-  TryVerifyStrict(tbl_customers(1)->Get(txn, Encode(str(sizeof(k_c)), k_c),
-                                          obj_v = str(sizeof(v_c_temp))));
+  tbl_customers(1)->GetRecord(txn, rc, Encode(str(sizeof(k_c)), k_c), obj_v);
+  TryVerifyStrict(rc);
   const customers::value *v_c = Decode(obj_v, v_c_temp);
 
   memcpy(pOut->c_st_id, v_c->c_st_id.data(), v_c->c_st_id.size());
@@ -870,10 +753,10 @@ rc_t tpce_worker::DoCustomerPositionFrame1(
   // CustomerAccount scan
   const ca_id_index::key k_ca_0(pOut->cust_id, MIN_VAL(k_ca_0.ca_id));
   const ca_id_index::key k_ca_1(pOut->cust_id, MAX_VAL(k_ca_1.ca_id));
-  tpce_table_scanner ca_scanner(&arena);
+  tpce_table_scanner ca_scanner(arena);
   TryCatch(tbl_ca_id_index(1)->Scan(txn, Encode(str(sizeof(k_ca_0)), k_ca_0),
                                      &Encode(str(sizeof(k_ca_1)), k_ca_1),
-                                     ca_scanner, &arena));
+                                     ca_scanner));
   ALWAYS_ASSERT(ca_scanner.output.size());
 
   for (auto &r_ca : ca_scanner.output) {
@@ -887,10 +770,10 @@ rc_t tpce_worker::DoCustomerPositionFrame1(
                                       std::string(cSYMBOL_len, (char)0));
     const holding_summary::key k_hs_1(k_ca->ca_id,
                                       std::string(cSYMBOL_len, (char)255));
-    tpce_table_scanner hs_scanner(&arena);
+    tpce_table_scanner hs_scanner(arena);
     TryCatch(tbl_holding_summary(1)->Scan(
         txn, Encode(str(sizeof(k_hs_0)), k_hs_0),
-        &Encode(str(sizeof(k_hs_1)), k_hs_1), hs_scanner, &arena));
+        &Encode(str(sizeof(k_hs_1)), k_hs_1), hs_scanner));
     // ALWAYS_ASSERT(hs_scanner.output.size());  // left-outer join. S table
     // could be empty.
 
@@ -904,9 +787,9 @@ rc_t tpce_worker::DoCustomerPositionFrame1(
       // LastTrade probe & equi-join
       const last_trade::key k_lt(k_hs->hs_s_symb);
       last_trade::value v_lt_temp;
-      TryVerifyRelaxed(tbl_last_trade(1)->Get(txn,
-                                              Encode(str(sizeof(k_lt)), k_lt),
-                                              obj_v = str(sizeof(v_lt_temp))));
+      tbl_last_trade(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_lt)), k_lt), obj_v);
+      TryVerifyRelaxed(rc);
       const last_trade::value *v_lt = Decode(obj_v, v_lt_temp);
 
       asset += v_hs->hs_qty * v_lt->lt_price;
@@ -926,6 +809,7 @@ rc_t tpce_worker::DoCustomerPositionFrame1(
 rc_t tpce_worker::DoCustomerPositionFrame2(
     const TCustomerPositionFrame2Input *pIn,
     TCustomerPositionFrame2Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   // XXX. If, CP frame 1 doesn't give output, then, we don't have valid input at
   // here. so just return
   if (not pIn->acct_id) {
@@ -938,10 +822,10 @@ rc_t tpce_worker::DoCustomerPositionFrame2(
                                  MIN_VAL(k_t_0.t_id));
   const t_ca_id_index::key k_t_1(pIn->acct_id, MAX_VAL(k_t_0.t_dts),
                                  MAX_VAL(k_t_0.t_id));
-  tpce_table_scanner t_scanner(&arena);
+  tpce_table_scanner t_scanner(arena);
   TryCatch(tbl_t_ca_id_index(1)->Scan(txn, Encode(str(sizeof(k_t_0)), k_t_0),
                                        &Encode(str(sizeof(k_t_1)), k_t_1),
-                                       t_scanner, &arena));
+                                       t_scanner));
   ALWAYS_ASSERT(t_scanner.output.size());
 
   std::vector<std::pair<ermia::varstr *, const ermia::varstr *>> tids;
@@ -974,10 +858,10 @@ rc_t tpce_worker::DoCustomerPositionFrame2(
                                     MIN_VAL(k_th_0.th_dts));
     const trade_history::key k_th_1(k_t->t_id, std::string(cST_ID_len, (char)255),
                                     MAX_VAL(k_th_1.th_dts));
-    tpce_table_scanner th_scanner(&arena);
+    tpce_table_scanner th_scanner(arena);
     TryCatch(tbl_trade_history(1)->Scan(
         txn, Encode(str(sizeof(k_th_0)), k_th_0),
-        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner, &arena));
+        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner));
     ALWAYS_ASSERT(th_scanner.output.size());
 
     for (auto &r_th : th_scanner.output) {
@@ -986,9 +870,9 @@ rc_t tpce_worker::DoCustomerPositionFrame2(
 
       status_type::key k_st(k_th->th_st_id);
       status_type::value v_st_temp;
-      TryVerifyRelaxed(tbl_status_type(1)->Get(txn,
-                                               Encode(str(sizeof(k_st)), k_st),
-                                               obj_v = str(sizeof(v_st_temp))));
+      tbl_status_type(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_st)), k_st), obj_v);
+      TryVerifyRelaxed(rc);
       const status_type::value *v_st = Decode(obj_v, v_st_temp);
 
       // TODO. order by and grab 30 rows
@@ -1019,6 +903,7 @@ rc_t tpce_worker::DoCustomerPositionFrame3(void) {
 rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn,
                                      TMarketFeedFrame1Output *pOut,
                                      CSendToMarketInterface *pSendToMarket) {
+  rc_t rc = rc_t{RC_INVALID};
   auto now_dts = CDateTime().GetDate();
   std::vector<TTradeRequest> TradeRequestBuffer;
   double req_price_quote = 0;
@@ -1037,14 +922,15 @@ rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn,
   //
   // Seems hstore (osdl dbt5) does this too:
   // https://github.com/apavlo/h-store/blob/master/src/benchmarks/edu/brown/benchmark/tpce/procedures/MarketFeed.java
-  txn = db->NewTransaction(0, arena, txn_buf());
+  txn = db->NewTransaction(0, *arena, txn_buf());
   for (int i = 0; i < max_feed_len; i++) {
     TTickerEntry ticker = pIn->Entries[i];
 
     last_trade::key k_lt(ticker.symbol);
     last_trade::value v_lt_temp;
-    TryVerifyRelaxed(tbl_last_trade(1)->Get(
-        txn, Encode(str(sizeof(k_lt)), k_lt), obj_v = str(sizeof(v_lt_temp))));
+    tbl_last_trade(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_lt)), k_lt), obj_v);
+    TryVerifyRelaxed(rc);
     const last_trade::value *v_lt = Decode(obj_v, v_lt_temp);
     last_trade::value v_lt_new(*v_lt);
     v_lt_new.lt_dts = now_dts;
@@ -1061,10 +947,10 @@ rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn,
     const trade_request::key k_tr_1(std::string(ticker.symbol),
                                     MAX_VAL(k_tr_1.tr_b_id),
                                     MAX_VAL(k_tr_1.tr_t_id));
-    tpce_table_scanner tr_scanner(&arena);
+    tpce_table_scanner tr_scanner(arena);
     TryCatch(tbl_trade_request(1)->Scan(
         txn, Encode(str(sizeof(k_tr_0)), k_tr_0),
-        &Encode(str(sizeof(k_tr_1)), k_tr_1), tr_scanner, &arena));
+        &Encode(str(sizeof(k_tr_1)), k_tr_1), tr_scanner));
     // ALWAYS_ASSERT(tr_scanner.output.size());  // XXX. If there's no previous
     // trade, this can happen. Higher initial trading days would enlarge this
     // scan set
@@ -1098,12 +984,11 @@ rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn,
       const trade::key k_t(req_trade_id);
       trade::value v_t_temp;
       ermia::OID t_oid = 0;
-      TryVerifyRelaxed(tbl_trade(1)->Get(txn, Encode(str(sizeof(k_t)), k_t),
-                                         obj_v = str(sizeof(v_t_temp)),
-                                         &t_oid));
+      tbl_trade(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_t)), k_t), obj_v, &t_oid);
+      TryVerifyRelaxed(rc);
       const trade::value *v_t = Decode(obj_v, v_t_temp);
-      trade::value v_t_new;
-      memcpy(&v_t_new, v_t, sizeof(trade::value));
+      trade::value v_t_new(*v_t);
       v_t_new.t_dts = now_dts;
       v_t_new.t_st_id = std::string(type.status_submitted);
       TryCatch(tbl_trade(1)->UpdateRecord(txn, Encode(str(sizeof(k_t)), k_t),
@@ -1117,18 +1002,18 @@ rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn,
       k_t_idx1.t_ca_id = v_t_new.t_ca_id;
       k_t_idx1.t_dts = v_t_new.t_dts;
       k_t_idx1.t_id = k_t.t_id;
-      TryCatch(tbl_t_ca_id_index(1)->Insert(
+      TryCatch(tbl_t_ca_id_index(1)->InsertOID(
           txn, Encode(str(sizeof(k_t_idx1)), k_t_idx1), t_oid));
 
       t_s_symb_index::key k_t_idx2;
       k_t_idx2.t_s_symb = v_t_new.t_s_symb;
       k_t_idx2.t_dts = v_t_new.t_dts;
       k_t_idx2.t_id = k_t.t_id;
-      TryCatch(tbl_t_s_symb_index(1)->Insert(
+      TryCatch(tbl_t_s_symb_index(1)->InsertOID(
           txn, Encode(str(sizeof(k_t_idx2)), k_t_idx2), t_oid));
 
       trade_request::key k_tr_new(*k_tr);
-      TryVerifyRelaxed(tbl_trade_request(1)->Remove(
+      TryVerifyRelaxed(tbl_trade_request(1)->RemoveRecord(
           txn, Encode(str(sizeof(k_tr_new)), k_tr_new)));
 
       trade_history::key k_th;
@@ -1136,7 +1021,7 @@ rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn,
       k_th.th_t_id = req_trade_id;
       k_th.th_dts = now_dts;
       k_th.th_st_id = std::string(type.status_submitted);
-      TryCatch(tbl_trade_history(1)->Insert(txn,
+      TryCatch(tbl_trade_history(1)->InsertRecord(txn,
                                              Encode(str(sizeof(k_th)), k_th),
                                              Encode(str(sizeof(v_th)), v_th)));
 
@@ -1164,19 +1049,20 @@ rc_t tpce_worker::DoMarketFeedFrame1(const TMarketFeedFrame1Input *pIn,
 
 rc_t tpce_worker::DoMarketWatchFrame1(const TMarketWatchFrame1Input *pIn,
                                       TMarketWatchFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   std::vector<inline_str_fixed<cSYMBOL_len>> stock_list_cursor;
 
   if (pIn->c_id) {
     const watch_list::key k_wl_0(pIn->c_id, MIN_VAL(k_wl_0.wl_id));
     const watch_list::key k_wl_1(pIn->c_id, MAX_VAL(k_wl_1.wl_id));
-    tpce_table_scanner wl_scanner(&arena);
+    tpce_table_scanner wl_scanner(arena);
     TryCatch(tbl_watch_list(1)->Scan(txn, Encode(str(sizeof(k_wl_0)), k_wl_0),
                                       &Encode(str(sizeof(k_wl_1)), k_wl_1),
-                                      wl_scanner, &arena));
+                                      wl_scanner));
     ALWAYS_ASSERT(wl_scanner.output.size());
 
     for (auto &r_wl : wl_scanner.output) {
@@ -1185,10 +1071,10 @@ rc_t tpce_worker::DoMarketWatchFrame1(const TMarketWatchFrame1Input *pIn,
 
       const watch_item::key k_wi_0(k_wl->wl_id, std::string(cSYMBOL_len, (char)0));
       const watch_item::key k_wi_1(k_wl->wl_id, std::string(cSYMBOL_len, (char)255));
-      tpce_table_scanner wi_scanner(&arena);
+      tpce_table_scanner wi_scanner(arena);
       TryCatch(tbl_watch_item(1)->Scan(
           txn, Encode(str(sizeof(k_wi_0)), k_wi_0),
-          &Encode(str(sizeof(k_wi_1)), k_wi_1), wi_scanner, &arena));
+          &Encode(str(sizeof(k_wi_1)), k_wi_1), wi_scanner));
       ALWAYS_ASSERT(wi_scanner.output.size());
       for (auto &r_wi : wi_scanner.output) {
         watch_item::key k_wi_temp;
@@ -1202,26 +1088,26 @@ rc_t tpce_worker::DoMarketWatchFrame1(const TMarketWatchFrame1Input *pIn,
                                     std::string(cIN_ID_len, (char)0));
     const in_name_index::key k_in_1(std::string(pIn->industry_name),
                                     std::string(cIN_ID_len, (char)255));
-    tpce_table_scanner in_scanner(&arena);
+    tpce_table_scanner in_scanner(arena);
     TryCatch(tbl_in_name_index(1)->Scan(
         txn, Encode(str(sizeof(k_in_0)), k_in_0),
-        &Encode(str(sizeof(k_in_1)), k_in_1), in_scanner, &arena));
+        &Encode(str(sizeof(k_in_1)), k_in_1), in_scanner));
     ALWAYS_ASSERT(in_scanner.output.size());
 
     const company::key k_co_0(pIn->starting_co_id);
     const company::key k_co_1(pIn->ending_co_id);
-    tpce_table_scanner co_scanner(&arena);
+    tpce_table_scanner co_scanner(arena);
     TryCatch(tbl_company(1)->Scan(txn, Encode(str(sizeof(k_co_0)), k_co_0),
                                    &Encode(str(sizeof(k_co_1)), k_co_1),
-                                   co_scanner, &arena));
+                                   co_scanner));
     ALWAYS_ASSERT(co_scanner.output.size());
 
     const security::key k_s_0(std::string(cSYMBOL_len, (char)0));
     const security::key k_s_1(std::string(cSYMBOL_len, (char)255));
-    tpce_table_scanner s_scanner(&arena);
+    tpce_table_scanner s_scanner(arena);
     TryCatch(tbl_security(1)->Scan(txn, Encode(str(sizeof(k_s_0)), k_s_0),
                                     &Encode(str(sizeof(k_s_1)), k_s_1),
-                                    s_scanner, &arena));
+                                    s_scanner));
     ALWAYS_ASSERT(s_scanner.output.size());
 
     for (auto &r_in : in_scanner.output) {
@@ -1253,10 +1139,10 @@ rc_t tpce_worker::DoMarketWatchFrame1(const TMarketWatchFrame1Input *pIn,
                                       std::string(cSYMBOL_len, (char)0));
     const holding_summary::key k_hs_1(pIn->acct_id,
                                       std::string(cSYMBOL_len, (char)255));
-    tpce_table_scanner hs_scanner(&arena);
+    tpce_table_scanner hs_scanner(arena);
     TryCatch(tbl_holding_summary(1)->Scan(
         txn, Encode(str(sizeof(k_hs_0)), k_hs_0),
-        &Encode(str(sizeof(k_hs_1)), k_hs_1), hs_scanner, &arena));
+        &Encode(str(sizeof(k_hs_1)), k_hs_1), hs_scanner));
 
     for (auto &r_hs : hs_scanner.output) {
       holding_summary::key k_hs_temp;
@@ -1273,21 +1159,23 @@ rc_t tpce_worker::DoMarketWatchFrame1(const TMarketWatchFrame1Input *pIn,
   for (auto &s : stock_list_cursor) {
     const last_trade::key k_lt(s);
     last_trade::value v_lt_temp;
-    TryCatch(tbl_last_trade(1)->Get(txn, Encode(str(sizeof(k_lt)), k_lt),
-                                     obj_v = str(sizeof(v_lt_temp))));
+    tbl_last_trade(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_lt)), k_lt), obj_v);
+    TryCatch(rc);
     const last_trade::value *v_lt = Decode(obj_v, v_lt_temp);
 
     const security::key k_s(s);
     security::value v_s_temp;
-    TryCatch(tbl_security(1)->Get(txn, Encode(str(sizeof(k_s)), k_s),
-                                   obj_v = str(sizeof(v_s_temp))));
+    tbl_security(1)->GetRecord(txn, rc, Encode(str(sizeof(k_s)), k_s), obj_v);
+    TryCatch(rc);
     const security::value *v_s = Decode(obj_v, v_s_temp);
 
     const daily_market::key k_dm(
         s, CDateTime((TIMESTAMP_STRUCT *)&pIn->start_day).GetDate());
     daily_market::value v_dm_temp;
-    TryCatch(tbl_daily_market(1)->Get(txn, Encode(str(sizeof(k_dm)), k_dm),
-                                       obj_v = str(sizeof(v_dm_temp))));
+    tbl_daily_market(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_dm)), k_dm), obj_v);
+    TryCatch(rc);
     const daily_market::value *v_dm = Decode(obj_v, v_dm_temp);
 
     auto s_num_out = v_s->s_num_out;
@@ -1309,53 +1197,54 @@ rc_t tpce_worker::DoMarketWatchFrame1(const TMarketWatchFrame1Input *pIn,
 
 rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
                                          TSecurityDetailFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   int64_t co_id;
 
   const security::key k_s(std::string(pIn->symbol));
   security::value v_s_temp;
-  TryVerifyRelaxed(tbl_security(1)->Get(txn, Encode(str(sizeof(k_s)), k_s),
-                                        obj_v = str(sizeof(v_s_temp))));
+  tbl_security(1)->GetRecord(txn, rc, Encode(str(sizeof(k_s)), k_s), obj_v);
+  TryVerifyRelaxed(rc);
   const security::value *v_s = Decode(obj_v, v_s_temp);
   co_id = v_s->s_co_id;
 
   const company::key k_co(co_id);
   company::value v_co_temp;
-  TryVerifyRelaxed(tbl_company(1)->Get(txn, Encode(str(sizeof(k_co)), k_co),
-                                       obj_v = str(sizeof(v_co_temp))));
+  tbl_company(1)->GetRecord(txn, rc, Encode(str(sizeof(k_co)), k_co), obj_v);
+  TryVerifyRelaxed(rc);
   const company::value *v_co = Decode(obj_v, v_co_temp);
 
   const address::key k_ca(v_co->co_ad_id);
   address::value v_ca_temp;
-  TryVerifyRelaxed(tbl_address(1)->Get(txn, Encode(str(sizeof(k_ca)), k_ca),
-                                       obj_v = str(sizeof(v_ca_temp))));
+  tbl_address(1)->GetRecord(txn, rc, Encode(str(sizeof(k_ca)), k_ca), obj_v);
+  TryVerifyRelaxed(rc);
   const address::value *v_ca = Decode(obj_v, v_ca_temp);
 
   const zip_code::key k_zca(v_ca->ad_zc_code);
   zip_code::value v_zca_temp;
-  TryVerifyRelaxed(tbl_zip_code(1)->Get(txn, Encode(str(sizeof(k_zca)), k_zca),
-                                        obj_v = str(sizeof(v_zca_temp))));
+  tbl_zip_code(1)->GetRecord(txn, rc, Encode(str(sizeof(k_zca)), k_zca), obj_v);
+  TryVerifyRelaxed(rc);
   const zip_code::value *v_zca = Decode(obj_v, v_zca_temp);
 
   const exchange::key k_ex(v_s->s_ex_id);
   exchange::value v_ex_temp;
-  TryVerifyRelaxed(tbl_exchange(1)->Get(txn, Encode(str(sizeof(k_ex)), k_ex),
-                                        obj_v = str(sizeof(v_ex_temp))));
+  tbl_exchange(1)->GetRecord(txn, rc, Encode(str(sizeof(k_ex)), k_ex), obj_v);
+  TryVerifyRelaxed(rc);
   const exchange::value *v_ex = Decode(obj_v, v_ex_temp);
 
   const address::key k_ea(v_ex->ex_ad_id);
   address::value v_ea_temp;
-  TryVerifyRelaxed(tbl_address(1)->Get(txn, Encode(str(sizeof(k_ea)), k_ea),
-                                       obj_v = str(sizeof(v_ea_temp))));
+  tbl_address(1)->GetRecord(txn, rc, Encode(str(sizeof(k_ea)), k_ea), obj_v);
+  TryVerifyRelaxed(rc);
   const address::value *v_ea = Decode(obj_v, v_ea_temp);
 
   const zip_code::key k_zea(v_ea->ad_zc_code);
   zip_code::value v_zea_temp;
-  TryVerifyRelaxed(tbl_zip_code(1)->Get(txn, Encode(str(sizeof(k_zea)), k_zea),
-                                        obj_v = str(sizeof(v_zea_temp))));
+  tbl_zip_code(1)->GetRecord(txn, rc, Encode(str(sizeof(k_zea)), k_zea), obj_v);
+  TryVerifyRelaxed(rc);
   const zip_code::value *v_zea = Decode(obj_v, v_zea_temp);
 
   memcpy(pOut->s_name, v_s->s_name.data(), v_s->s_name.size());
@@ -1397,10 +1286,10 @@ rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
                                        std::string(cIN_ID_len, (char)0));
   const company_competitor::key k_cp_1(co_id, MAX_VAL(k_cp_1.cp_comp_co_id),
                                        std::string(cIN_ID_len, (char)255));
-  tpce_table_scanner cp_scanner(&arena);
+  tpce_table_scanner cp_scanner(arena);
   TryCatch(tbl_company_competitor(1)->Scan(
       txn, Encode(str(sizeof(k_cp_0)), k_cp_0),
-      &Encode(str(sizeof(k_cp_1)), k_cp_1), cp_scanner, &arena));
+      &Encode(str(sizeof(k_cp_1)), k_cp_1), cp_scanner));
   ALWAYS_ASSERT(cp_scanner.output.size());
 
   for (auto i = 0; i < max_comp_len; i++) {
@@ -1410,14 +1299,15 @@ rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
 
     const company::key k_co3(k_cp->cp_comp_co_id);
     company::value v_co3_temp;
-    TryVerifyRelaxed(tbl_company(1)->Get(txn, Encode(str(sizeof(k_co3)), k_co3),
-                                         obj_v = str(sizeof(v_co3_temp))));
+    tbl_company(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_co3)), k_co3), obj_v);
+    TryVerifyRelaxed(rc);
     const company::value *v_co3 = Decode(obj_v, v_co3_temp);
 
     const industry::key k_in(k_cp->cp_in_id);
     industry::value v_in_temp;
-    TryVerifyRelaxed(tbl_industry(1)->Get(txn, Encode(str(sizeof(k_in)), k_in),
-                                          obj_v = str(sizeof(v_in_temp))));
+    tbl_industry(1)->GetRecord(txn, rc, Encode(str(sizeof(k_in)), k_in), obj_v);
+    TryVerifyRelaxed(rc);
     const industry::value *v_in = Decode(obj_v, v_in_temp);
 
     memcpy(pOut->cp_co_name[i], v_co3->co_name.data(), v_co3->co_name.size());
@@ -1428,10 +1318,10 @@ rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
                               MIN_VAL(k_fi_0.fi_qtr));
   const financial::key k_fi_1(co_id, MAX_VAL(k_fi_1.fi_year),
                               MAX_VAL(k_fi_1.fi_qtr));
-  tpce_table_scanner fi_scanner(&arena);
+  tpce_table_scanner fi_scanner(arena);
   TryCatch(tbl_financial(1)->Scan(txn, Encode(str(sizeof(k_fi_0)), k_fi_0),
                                    &Encode(str(sizeof(k_fi_1)), k_fi_1),
-                                   fi_scanner, &arena));
+                                   fi_scanner));
   ALWAYS_ASSERT(fi_scanner.output.size());
   for (uint64_t i = 0; i < max_fin_len; i++) {
     auto &r_fi = fi_scanner.output[i];
@@ -1462,10 +1352,10 @@ rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
       std::string(pIn->symbol),
       CDateTime((TIMESTAMP_STRUCT *)&pIn->start_day).GetDate());
   const daily_market::key k_dm_1(std::string(pIn->symbol), MAX_VAL(k_dm_1.dm_date));
-  tpce_table_scanner dm_scanner(&arena);
+  tpce_table_scanner dm_scanner(arena);
   TryCatch(tbl_daily_market(1)->Scan(txn, Encode(str(sizeof(k_dm_0)), k_dm_0),
                                       &Encode(str(sizeof(k_dm_1)), k_dm_1),
-                                      dm_scanner, &arena));
+                                      dm_scanner));
   ALWAYS_ASSERT(dm_scanner.output.size());
   for (size_t i = 0;
        i < (size_t)pIn->max_rows_to_return and i < dm_scanner.output.size();
@@ -1490,8 +1380,8 @@ rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
 
   const last_trade::key k_lt(std::string(pIn->symbol));
   last_trade::value v_lt_temp;
-  TryVerifyRelaxed(tbl_last_trade(1)->Get(txn, Encode(str(sizeof(k_lt)), k_lt),
-                                          obj_v = str(sizeof(v_lt_temp))));
+  tbl_last_trade(1)->GetRecord(txn, rc, Encode(str(sizeof(k_lt)), k_lt), obj_v);
+  TryVerifyRelaxed(rc);
   const last_trade::value *v_lt = Decode(obj_v, v_lt_temp);
 
   pOut->last_price = v_lt->lt_price;
@@ -1500,10 +1390,10 @@ rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
 
   const news_xref::key k_nx_0(co_id, MIN_VAL(k_nx_0.nx_ni_id));
   const news_xref::key k_nx_1(co_id, MAX_VAL(k_nx_0.nx_ni_id));
-  tpce_table_scanner nx_scanner(&arena);
+  tpce_table_scanner nx_scanner(arena);
   TryCatch(tbl_news_xref(1)->Scan(txn, Encode(str(sizeof(k_nx_0)), k_nx_0),
                                    &Encode(str(sizeof(k_nx_1)), k_nx_1),
-                                   nx_scanner, &arena));
+                                   nx_scanner));
   ALWAYS_ASSERT(nx_scanner.output.size());
 
   for (int i = 0; i < max_news_len; i++) {
@@ -1513,8 +1403,9 @@ rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
 
     const news_item::key k_ni(k_nx->nx_ni_id);
     news_item::value v_ni_temp;
-    TryVerifyRelaxed(tbl_news_item(1)->Get(txn, Encode(str(sizeof(k_ni)), k_ni),
-                                           obj_v = str(sizeof(v_ni_temp))));
+    tbl_news_item(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_ni)), k_ni), obj_v);
+    TryVerifyRelaxed(rc);
     const news_item::value *v_ni = Decode(obj_v, v_ni_temp);
 
     if (pIn->access_lob_flag) {
@@ -1547,24 +1438,26 @@ rc_t tpce_worker::DoSecurityDetailFrame1(const TSecurityDetailFrame1Input *pIn,
 
 rc_t tpce_worker::DoTradeLookupFrame1(const TTradeLookupFrame1Input *pIn,
                                       TTradeLookupFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   int i;
 
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   pOut->num_found = 0;
   for (i = 0; i < pIn->max_trades; i++) {
     const trade::key k_t(pIn->trade_id[i]);
     trade::value v_t_temp;
-    TryVerifyRelaxed(tbl_trade(1)->Get(txn, Encode(str(sizeof(k_t)), k_t),
-                                       obj_v = str(sizeof(v_t_temp))));
+    tbl_trade(1)->GetRecord(txn, rc, Encode(str(sizeof(k_t)), k_t), obj_v);
+    TryVerifyRelaxed(rc);
     const trade::value *v_t = Decode(obj_v, v_t_temp);
 
     const trade_type::key k_tt(v_t->t_tt_id);
     trade_type::value v_tt_temp;
-    TryVerifyRelaxed(tbl_trade_type(1)->Get(
-        txn, Encode(str(sizeof(k_tt)), k_tt), obj_v = str(sizeof(v_tt_temp))));
+    tbl_trade_type(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_tt)), k_tt), obj_v);
+    TryVerifyRelaxed(rc);
     const trade_type::value *v_tt = Decode(obj_v, v_tt_temp);
 
     pOut->trade_info[i].bid_price = v_t->t_bid_price;
@@ -1578,8 +1471,9 @@ rc_t tpce_worker::DoTradeLookupFrame1(const TTradeLookupFrame1Input *pIn,
 
     const settlement::key k_se(pIn->trade_id[i]);
     settlement::value v_se_temp;
-    TryVerifyRelaxed(tbl_settlement(1)->Get(
-        txn, Encode(str(sizeof(k_se)), k_se), obj_v = str(sizeof(v_se_temp))));
+    tbl_settlement(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_se)), k_se), obj_v);
+    TryVerifyRelaxed(rc);
     const settlement::value *v_se = Decode(obj_v, v_se_temp);
 
     pOut->trade_info[i].settlement_amount = v_se->se_amt;
@@ -1591,9 +1485,9 @@ rc_t tpce_worker::DoTradeLookupFrame1(const TTradeLookupFrame1Input *pIn,
     if (pOut->trade_info[i].is_cash) {
       const cash_transaction::key k_ct(pIn->trade_id[i]);
       cash_transaction::value v_ct_temp;
-      TryVerifyRelaxed(
-          tbl_cash_transaction(1)->Get(txn, Encode(str(sizeof(k_ct)), k_ct),
-                                       obj_v = str(sizeof(v_ct_temp))));
+      tbl_cash_transaction(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_ct)), k_ct), obj_v);
+      TryVerifyRelaxed(rc);
       const cash_transaction::value *v_ct = Decode(obj_v, v_ct_temp);
 
       pOut->trade_info[i].cash_transaction_amount = v_ct->ct_amt;
@@ -1609,10 +1503,10 @@ rc_t tpce_worker::DoTradeLookupFrame1(const TTradeLookupFrame1Input *pIn,
     const trade_history::key k_th_1(pIn->trade_id[i],
                                     std::string(cST_ID_len, (char)255),
                                     MAX_VAL(k_th_1.th_dts));
-    tpce_table_scanner th_scanner(&arena);
+    tpce_table_scanner th_scanner(arena);
     TryCatch(tbl_trade_history(1)->Scan(
         txn, Encode(str(sizeof(k_th_0)), k_th_0),
-        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner, &arena));
+        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner));
     ALWAYS_ASSERT(th_scanner.output.size());
 
     int th_cursor = 0;
@@ -1635,9 +1529,10 @@ rc_t tpce_worker::DoTradeLookupFrame1(const TTradeLookupFrame1Input *pIn,
 
 rc_t tpce_worker::DoTradeLookupFrame2(const TTradeLookupFrame2Input *pIn,
                                       TTradeLookupFrame2Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   const t_ca_id_index::key k_t_0(
       pIn->acct_id,
@@ -1647,10 +1542,10 @@ rc_t tpce_worker::DoTradeLookupFrame2(const TTradeLookupFrame2Input *pIn,
       pIn->acct_id,
       CDateTime((TIMESTAMP_STRUCT *)&pIn->end_trade_dts).GetDate(),
       MAX_VAL(k_t_1.t_id));
-  tpce_table_scanner t_scanner(&arena);
+  tpce_table_scanner t_scanner(arena);
   TryCatch(tbl_t_ca_id_index(1)->Scan(txn, Encode(str(sizeof(k_t_0)), k_t_0),
                                        &Encode(str(sizeof(k_t_1)), k_t_1),
-                                       t_scanner, &arena));
+                                       t_scanner));
   ALWAYS_ASSERT(t_scanner.output.size());
 
   auto num_found = 0;
@@ -1683,8 +1578,9 @@ rc_t tpce_worker::DoTradeLookupFrame2(const TTradeLookupFrame2Input *pIn,
   for (auto i = 0; i < num_found; i++) {
     const settlement::key k_se(pOut->trade_info[i].trade_id);
     settlement::value v_se_temp;
-    TryVerifyRelaxed(tbl_settlement(1)->Get(
-        txn, Encode(str(sizeof(k_se)), k_se), obj_v = str(sizeof(v_se_temp))));
+    tbl_settlement(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_se)), k_se), obj_v);
+    TryVerifyRelaxed(rc);
     const settlement::value *v_se = Decode(obj_v, v_se_temp);
 
     pOut->trade_info[i].settlement_amount = v_se->se_amt;
@@ -1696,9 +1592,9 @@ rc_t tpce_worker::DoTradeLookupFrame2(const TTradeLookupFrame2Input *pIn,
     if (pOut->trade_info[i].is_cash) {
       const cash_transaction::key k_ct(pOut->trade_info[i].trade_id);
       cash_transaction::value v_ct_temp;
-      TryVerifyRelaxed(
-          tbl_cash_transaction(1)->Get(txn, Encode(str(sizeof(k_ct)), k_ct),
-                                       obj_v = str(sizeof(v_ct_temp))));
+      tbl_cash_transaction(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_ct)), k_ct), obj_v);
+      TryVerifyRelaxed(rc);
       const cash_transaction::value *v_ct = Decode(obj_v, v_ct_temp);
 
       pOut->trade_info[i].cash_transaction_amount = v_ct->ct_amt;
@@ -1714,10 +1610,10 @@ rc_t tpce_worker::DoTradeLookupFrame2(const TTradeLookupFrame2Input *pIn,
     const trade_history::key k_th_1(pOut->trade_info[i].trade_id,
                                     std::string(cST_ID_len, (char)255),
                                     MAX_VAL(k_th_1.th_dts));
-    tpce_table_scanner th_scanner(&arena);
+    tpce_table_scanner th_scanner(arena);
     TryCatch(tbl_trade_history(1)->Scan(
         txn, Encode(str(sizeof(k_th_0)), k_th_0),
-        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner, &arena));
+        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner));
     ALWAYS_ASSERT(th_scanner.output.size());
 
     int th_cursor = 0;
@@ -1741,9 +1637,10 @@ rc_t tpce_worker::DoTradeLookupFrame2(const TTradeLookupFrame2Input *pIn,
 
 rc_t tpce_worker::DoTradeLookupFrame3(const TTradeLookupFrame3Input *pIn,
                                       TTradeLookupFrame3Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   const t_s_symb_index::key k_t_0(
       std::string(pIn->symbol),
@@ -1753,10 +1650,10 @@ rc_t tpce_worker::DoTradeLookupFrame3(const TTradeLookupFrame3Input *pIn,
       std::string(pIn->symbol),
       CDateTime((TIMESTAMP_STRUCT *)&pIn->end_trade_dts).GetDate(),
       MAX_VAL(k_t_1.t_id));
-  tpce_table_scanner t_scanner(&arena);
+  tpce_table_scanner t_scanner(arena);
   TryCatch(tbl_t_s_symb_index(1)->Scan(txn, Encode(str(sizeof(k_t_0)), k_t_0),
                                         &Encode(str(sizeof(k_t_1)), k_t_1),
-                                        t_scanner, &arena));
+                                        t_scanner));
   ALWAYS_ASSERT(t_scanner.output.size());
 
   auto num_found = 0;
@@ -1793,8 +1690,9 @@ rc_t tpce_worker::DoTradeLookupFrame3(const TTradeLookupFrame3Input *pIn,
   for (int i = 0; i < num_found; i++) {
     const settlement::key k_se(pOut->trade_info[i].trade_id);
     settlement::value v_se_temp;
-    TryVerifyRelaxed(tbl_settlement(1)->Get(
-        txn, Encode(str(sizeof(k_se)), k_se), obj_v = str(sizeof(v_se_temp))));
+    tbl_settlement(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_se)), k_se), obj_v);
+    TryVerifyRelaxed(rc);
     const settlement::value *v_se = Decode(obj_v, v_se_temp);
 
     pOut->trade_info[i].settlement_amount = v_se->se_amt;
@@ -1806,9 +1704,9 @@ rc_t tpce_worker::DoTradeLookupFrame3(const TTradeLookupFrame3Input *pIn,
     if (pOut->trade_info[i].is_cash) {
       const cash_transaction::key k_ct(pOut->trade_info[i].trade_id);
       cash_transaction::value v_ct_temp;
-      TryVerifyRelaxed(
-          tbl_cash_transaction(1)->Get(txn, Encode(str(sizeof(k_ct)), k_ct),
-                                       obj_v = str(sizeof(v_ct_temp))));
+      tbl_cash_transaction(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_ct)), k_ct), obj_v);
+      TryVerifyRelaxed(rc);
       const cash_transaction::value *v_ct = Decode(obj_v, v_ct_temp);
 
       pOut->trade_info[i].cash_transaction_amount = v_ct->ct_amt;
@@ -1824,10 +1722,10 @@ rc_t tpce_worker::DoTradeLookupFrame3(const TTradeLookupFrame3Input *pIn,
     const trade_history::key k_th_1(pOut->trade_info[i].trade_id,
                                     std::string(cST_ID_len, (char)255),
                                     MAX_VAL(k_th_1.th_dts));
-    tpce_table_scanner th_scanner(&arena);
+    tpce_table_scanner th_scanner(arena);
     TryCatch(tbl_trade_history(1)->Scan(
         txn, Encode(str(sizeof(k_th_0)), k_th_0),
-        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner, &arena));
+        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner));
     ALWAYS_ASSERT(th_scanner.output.size());
 
     // TODO. order by
@@ -1852,18 +1750,18 @@ rc_t tpce_worker::DoTradeLookupFrame3(const TTradeLookupFrame3Input *pIn,
 rc_t tpce_worker::DoTradeLookupFrame4(const TTradeLookupFrame4Input *pIn,
                                       TTradeLookupFrame4Output *pOut) {
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   const t_ca_id_index::key k_t_0(
       pIn->acct_id, CDateTime((TIMESTAMP_STRUCT *)&pIn->trade_dts).GetDate(),
       MIN_VAL(k_t_0.t_id));
   const t_ca_id_index::key k_t_1(pIn->acct_id, MAX_VAL(k_t_1.t_dts),
                                  MAX_VAL(k_t_1.t_id));
-  tpce_table_scanner t_scanner(&arena);
+  tpce_table_scanner t_scanner(arena);
   TryCatch(tbl_t_ca_id_index(1)->Scan(txn, Encode(str(sizeof(k_t_0)), k_t_0),
                                        &Encode(str(sizeof(k_t_1)), k_t_1),
-                                       t_scanner, &arena));
+                                       t_scanner));
   if (not t_scanner.output.size()) {  // XXX. can happen? or something is wrong?
     pOut->num_trades_found = 0;
     db->Abort(txn);
@@ -1899,10 +1797,10 @@ rc_t tpce_worker::DoTradeLookupFrame4(const TTradeLookupFrame4Input *pIn,
   // XXX. holding_history PK isn't unique. combine T_ID and row ID.
   const holding_history::key k_hh_0(pOut->trade_id, MIN_VAL(k_hh_0.hh_h_t_id));
   const holding_history::key k_hh_1(pOut->trade_id, MAX_VAL(k_hh_1.hh_h_t_id));
-  tpce_table_scanner hh_scanner(&arena);
+  tpce_table_scanner hh_scanner(arena);
   TryCatch(tbl_holding_history(1)->Scan(
       txn, Encode(str(sizeof(k_hh_0)), k_hh_0),
-      &Encode(str(sizeof(k_hh_1)), k_hh_1), hh_scanner, &arena));
+      &Encode(str(sizeof(k_hh_1)), k_hh_1), hh_scanner));
   ALWAYS_ASSERT(
       hh_scanner.output.size());  // possible case. no holding for the customer
 
@@ -1930,12 +1828,14 @@ rc_t tpce_worker::DoTradeLookupFrame4(const TTradeLookupFrame4Input *pIn,
 
 rc_t tpce_worker::DoTradeOrderFrame1(const TTradeOrderFrame1Input *pIn,
                                      TTradeOrderFrame1Output *pOut) {
-  txn = db->NewTransaction(0, arena, txn_buf());
+  rc_t rc = rc_t{RC_INVALID};
+  txn = db->NewTransaction(0, *arena, txn_buf());
 
   const customer_account::key k_ca(pIn->acct_id);
   customer_account::value v_ca_temp;
-  TryVerifyRelaxed(tbl_customer_account(1)->Get(
-      txn, Encode(str(sizeof(k_ca)), k_ca), obj_v = str(sizeof(v_ca_temp))));
+  tbl_customer_account(1)->GetRecord(
+      txn, rc, Encode(str(sizeof(k_ca)), k_ca), obj_v);
+  TryVerifyRelaxed(rc);
   const customer_account::value *v_ca = Decode(obj_v, v_ca_temp);
 
   memcpy(pOut->acct_name, v_ca->ca_name.data(), v_ca->ca_name.size());
@@ -1946,8 +1846,8 @@ rc_t tpce_worker::DoTradeOrderFrame1(const TTradeOrderFrame1Input *pIn,
 
   const customers::key k_c(pOut->cust_id);
   customers::value v_c_temp;
-  TryVerifyRelaxed(tbl_customers(1)->Get(txn, Encode(str(sizeof(k_c)), k_c),
-                                         obj_v = str(sizeof(v_c_temp))));
+  tbl_customers(1)->GetRecord(txn, rc, Encode(str(sizeof(k_c)), k_c), obj_v);
+  TryVerifyRelaxed(rc);
   const customers::value *v_c = Decode(obj_v, v_c_temp);
 
   memcpy(pOut->cust_f_name, v_c->c_f_name.data(), v_c->c_f_name.size());
@@ -1957,8 +1857,8 @@ rc_t tpce_worker::DoTradeOrderFrame1(const TTradeOrderFrame1Input *pIn,
 
   const broker::key k_b(pOut->broker_id);
   broker::value v_b_temp;
-  TryVerifyRelaxed(tbl_broker(1)->Get(txn, Encode(str(sizeof(k_b)), k_b),
-                                      obj_v = str(sizeof(v_b_temp))));
+  tbl_broker(1)->GetRecord(txn, rc, Encode(str(sizeof(k_b)), k_b), obj_v);
+  TryVerifyRelaxed(rc);
   const broker::value *v_b = Decode(obj_v, v_b_temp);
   memcpy(pOut->broker_name, v_b->b_name.data(), v_b->b_name.size());
 
@@ -1970,9 +1870,9 @@ rc_t tpce_worker::DoTradeOrderFrame2(const TTradeOrderFrame2Input *pIn,
   const account_permission::key k_ap(pIn->acct_id, std::string(pIn->exec_tax_id));
   account_permission::value v_ap_temp;
   rc_t ret;
-  TryCatch(
-      ret = tbl_account_permission(1)->Get(txn, Encode(str(sizeof(k_ap)), k_ap),
-                                           obj_v = str(sizeof(v_ap_temp))));
+  tbl_account_permission(1)->GetRecord(
+      txn, ret, Encode(str(sizeof(k_ap)), k_ap), obj_v);
+  TryCatch(ret);
   if (ret._val == RC_TRUE) {
     const account_permission::value *v_ap = Decode(obj_v, v_ap_temp);
     if (v_ap->ap_f_name == std::string(pIn->exec_f_name) and
@@ -1987,6 +1887,7 @@ rc_t tpce_worker::DoTradeOrderFrame2(const TTradeOrderFrame2Input *pIn,
 
 rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
                                      TTradeOrderFrame3Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   int64_t co_id = 0;
   char exch_id[cEX_ID_len + 1];  // XXX. without "+1", gdb can be killed!
   memset(exch_id, 0, cEX_ID_len + 1);
@@ -1996,10 +1897,10 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
                                     MIN_VAL(k_co_0.co_id));
     const co_name_index::key k_co_1(std::string(pIn->co_name),
                                     MAX_VAL(k_co_1.co_id));
-    tpce_table_scanner co_scanner(&arena);
+    tpce_table_scanner co_scanner(arena);
     TryCatch(tbl_co_name_index(1)->Scan(
         txn, Encode(str(sizeof(k_co_0)), k_co_0),
-        &Encode(str(sizeof(k_co_1)), k_co_1), co_scanner, &arena));
+        &Encode(str(sizeof(k_co_1)), k_co_1), co_scanner));
     ALWAYS_ASSERT(co_scanner.output.size());
 
     co_name_index::key k_co_temp;
@@ -2013,10 +1914,10 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
                                     std::string(cSYMBOL_len, (char)0));
     const security_index::key k_s_1(co_id, pIn->issue,
                                     std::string(cSYMBOL_len, (char)255));
-    tpce_table_scanner s_scanner(&arena);
+    tpce_table_scanner s_scanner(arena);
     TryCatch(tbl_security_index(1)->Scan(
         txn, Encode(str(sizeof(k_s_0)), k_s_0),
-        &Encode(str(sizeof(k_s_1)), k_s_1), s_scanner, &arena));
+        &Encode(str(sizeof(k_s_1)), k_s_1), s_scanner));
     ALWAYS_ASSERT(s_scanner.output.size());
     for (auto &r_s : s_scanner.output) {
       security_index::key k_s_temp;
@@ -2035,8 +1936,8 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
     memcpy(pOut->symbol, pIn->symbol, cSYMBOL_len);
     const security::key k_s(std::string(pIn->symbol));
     security::value v_s_temp;
-    TryVerifyRelaxed(tbl_security(1)->Get(txn, Encode(str(sizeof(k_s)), k_s),
-                                          obj_v = str(sizeof(v_s_temp))));
+    tbl_security(1)->GetRecord(txn, rc, Encode(str(sizeof(k_s)), k_s), obj_v);
+    TryVerifyRelaxed(rc);
     const security::value *v_s = Decode(obj_v, v_s_temp);
 
     co_id = v_s->s_co_id;
@@ -2045,23 +1946,23 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
 
     const company::key k_co(co_id);
     company::value v_co_temp;
-    TryVerifyRelaxed(tbl_company(1)->Get(txn, Encode(str(sizeof(k_co)), k_co),
-                                         obj_v = str(sizeof(v_co_temp))));
+    tbl_company(1)->GetRecord(txn, rc, Encode(str(sizeof(k_co)), k_co), obj_v);
+    TryVerifyRelaxed(rc);
     const company::value *v_co = Decode(obj_v, v_co_temp);
     memcpy(pOut->co_name, v_co->co_name.data(), v_co->co_name.size());
   }
   const last_trade::key k_lt(std::string(pOut->symbol));
   last_trade::value v_lt_temp;
-  TryVerifyRelaxed(tbl_last_trade(1)->Get(txn, Encode(str(sizeof(k_lt)), k_lt),
-                                          obj_v = str(sizeof(v_lt_temp))));
+  tbl_last_trade(1)->GetRecord(txn, rc, Encode(str(sizeof(k_lt)), k_lt), obj_v);
+  TryVerifyRelaxed(rc);
   const last_trade::value *v_lt = Decode(obj_v, v_lt_temp);
 
   pOut->market_price = v_lt->lt_price;
 
   const trade_type::key k_tt(pIn->trade_type_id);
   trade_type::value v_tt_temp;
-  TryVerifyRelaxed(tbl_trade_type(1)->Get(txn, Encode(str(sizeof(k_tt)), k_tt),
-                                          obj_v = str(sizeof(v_tt_temp))));
+  tbl_trade_type(1)->GetRecord(txn, rc, Encode(str(sizeof(k_tt)), k_tt), obj_v);
+  TryVerifyRelaxed(rc);
   const trade_type::value *v_tt = Decode(obj_v, v_tt_temp);
 
   pOut->type_is_market = v_tt->tt_is_mrkt;
@@ -2082,9 +1983,9 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
   const holding_summary::key k_hs(pIn->acct_id, std::string(pOut->symbol));
   holding_summary::value v_hs_temp;
   rc_t ret;
-  TryCatch(ret = tbl_holding_summary(1)->Get(txn,
-                                              Encode(str(sizeof(k_hs)), k_hs),
-                                              obj_v = str(sizeof(v_hs_temp))));
+  tbl_holding_summary(1)->GetRecord(
+      txn, ret, Encode(str(sizeof(k_hs)), k_hs), obj_v);
+  TryCatch(ret);
   if (ret._val == RC_TRUE) {
     const holding_summary::value *v_hs = Decode(obj_v, v_hs_temp);
     hs_qty = v_hs->hs_qty;
@@ -2097,10 +1998,10 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
                                MIN_VAL(k_h_0.h_dts), MIN_VAL(k_h_0.h_t_id));
       const holding::key k_h_1(pIn->acct_id, std::string(pOut->symbol),
                                MAX_VAL(k_h_0.h_dts), MAX_VAL(k_h_0.h_t_id));
-      tpce_table_scanner h_scanner(&arena);
+      tpce_table_scanner h_scanner(arena);
       TryCatch(tbl_holding(1)->Scan(txn, Encode(str(sizeof(k_h_0)), k_h_0),
                                      &Encode(str(sizeof(k_h_1)), k_h_1),
-                                     h_scanner, &arena));
+                                     h_scanner));
       // ALWAYS_ASSERT(h_scanner.output.size());  // this set could be empty
 
       for (auto &r_h : h_scanner.output) {
@@ -2138,10 +2039,10 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
                                MIN_VAL(k_h_0.h_dts), MIN_VAL(k_h_0.h_t_id));
       const holding::key k_h_1(pIn->acct_id, std::string(pOut->symbol),
                                MAX_VAL(k_h_0.h_dts), MAX_VAL(k_h_0.h_t_id));
-      tpce_table_scanner h_scanner(&arena);
+      tpce_table_scanner h_scanner(arena);
       TryCatch(tbl_holding(1)->Scan(txn, Encode(str(sizeof(k_h_0)), k_h_0),
                                      &Encode(str(sizeof(k_h_1)), k_h_1),
-                                     h_scanner, &arena));
+                                     h_scanner));
       // ALWAYS_ASSERT(h_scanner.output.size());  // this set could be empty
 
       for (auto &r_h : h_scanner.output) {
@@ -2182,10 +2083,10 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
     const customer_taxrate::key k_cx_1(pIn->cust_id,
                                        std::string(cTX_ID_len, (char)255));
 
-    tpce_table_scanner cx_scanner(&arena);
+    tpce_table_scanner cx_scanner(arena);
     TryCatch(tbl_customer_taxrate(1)->Scan(
         txn, Encode(str(sizeof(k_cx_0)), k_cx_0),
-        &Encode(str(sizeof(k_cx_1)), k_cx_1), cx_scanner, &arena));
+        &Encode(str(sizeof(k_cx_1)), k_cx_1), cx_scanner));
     ALWAYS_ASSERT(cx_scanner.output.size());
 
     auto tax_rates = 0.0;
@@ -2195,9 +2096,9 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
 
       const tax_rate::key k_tx(k_cx->cx_tx_id);
       tax_rate::value v_tx_temp;
-      TryVerifyRelaxed(tbl_tax_rate(1)->Get(txn,
-                                            Encode(str(sizeof(k_tx)), k_tx),
-                                            obj_v = str(sizeof(v_tx_temp))));
+      tbl_tax_rate(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_tx)), k_tx), obj_v);
+      TryVerifyRelaxed(rc);
       const tax_rate::value *v_tx = Decode(obj_v, v_tx_temp);
 
       tax_rates += v_tx->tx_rate;
@@ -2210,10 +2111,10 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
   const commission_rate::key k_cr_1(pIn->cust_tier, std::string(pIn->trade_type_id),
                                     std::string(exch_id), pIn->trade_qty);
 
-  tpce_table_scanner cr_scanner(&arena);
+  tpce_table_scanner cr_scanner(arena);
   TryCatch(tbl_commission_rate(1)->Scan(
       txn, Encode(str(sizeof(k_cr_0)), k_cr_0),
-      &Encode(str(sizeof(k_cr_1)), k_cr_1), cr_scanner, &arena));
+      &Encode(str(sizeof(k_cr_1)), k_cr_1), cr_scanner));
   ALWAYS_ASSERT(cr_scanner.output.size());
 
   for (auto &r_cr : cr_scanner.output) {
@@ -2228,8 +2129,8 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
 
   const charge::key k_ch(pIn->trade_type_id, pIn->cust_tier);
   charge::value v_ch_temp;
-  TryVerifyRelaxed(tbl_charge(1)->Get(txn, Encode(str(sizeof(k_ch)), k_ch),
-                                      obj_v = str(sizeof(v_ch_temp))));
+  tbl_charge(1)->GetRecord(txn, rc, Encode(str(sizeof(k_ch)), k_ch), obj_v);
+  TryVerifyRelaxed(rc);
   const charge::value *v_ch = Decode(obj_v, v_ch_temp);
   pOut->charge_amount = v_ch->ch_chrg;
 
@@ -2240,8 +2141,9 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
   if (pIn->type_is_margin) {
     const customer_account::key k_ca(pIn->acct_id);
     customer_account::value v_ca_temp;
-    TryVerifyRelaxed(tbl_customer_account(1)->Get(
-        txn, Encode(str(sizeof(k_ca)), k_ca), obj_v = str(sizeof(v_ca_temp))));
+    tbl_customer_account(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_ca)), k_ca), obj_v);
+    TryVerifyRelaxed(rc);
     const customer_account::value *v_ca = Decode(obj_v, v_ca_temp);
     acct_bal = v_ca->ca_bal;
 
@@ -2249,10 +2151,10 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
                                       std::string(cSYMBOL_len, (char)0));
     const holding_summary::key k_hs_1(pIn->acct_id,
                                       std::string(cSYMBOL_len, (char)255));
-    tpce_table_scanner hs_scanner(&arena);
+    tpce_table_scanner hs_scanner(arena);
     TryCatch(tbl_holding_summary(1)->Scan(
         txn, Encode(str(sizeof(k_hs_0)), k_hs_0),
-        &Encode(str(sizeof(k_hs_1)), k_hs_1), hs_scanner, &arena));
+        &Encode(str(sizeof(k_hs_1)), k_hs_1), hs_scanner));
     // ALWAYS_ASSERT(hs_scanner.output.size());  // XXX. allowed?
 
     for (auto &r_hs : hs_scanner.output) {
@@ -2263,9 +2165,9 @@ rc_t tpce_worker::DoTradeOrderFrame3(const TTradeOrderFrame3Input *pIn,
 
       const last_trade::key k_lt(k_hs->hs_s_symb);
       last_trade::value v_lt_temp;
-      TryVerifyRelaxed(tbl_last_trade(1)->Get(txn,
-                                              Encode(str(sizeof(k_lt)), k_lt),
-                                              obj_v = str(sizeof(v_lt_temp))));
+      tbl_last_trade(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_lt)), k_lt), obj_v);
+      TryVerifyRelaxed(rc);
       const last_trade::value *v_lt = Decode(obj_v, v_lt_temp);
 
       hold_assets += v_hs->hs_qty * v_lt->lt_price;
@@ -2305,7 +2207,7 @@ rc_t tpce_worker::DoTradeOrderFrame4(const TTradeOrderFrame4Input *pIn,
   v_t.t_tax = 0;
   v_t.t_lifo = pIn->is_lifo;
   ermia::OID t_oid = 0;
-  TryCatch(tbl_trade(1)->Insert(txn, Encode(str(sizeof(k_t)), k_t),
+  TryCatch(tbl_trade(1)->InsertRecord(txn, Encode(str(sizeof(k_t)), k_t),
                                  Encode(str(sizeof(v_t)), v_t), &t_oid));
 
   t_ca_id_index::key k_t_idx1;
@@ -2313,14 +2215,14 @@ rc_t tpce_worker::DoTradeOrderFrame4(const TTradeOrderFrame4Input *pIn,
   k_t_idx1.t_dts = v_t.t_dts;
   k_t_idx1.t_id = k_t.t_id;
   TryCatch(tbl_t_ca_id_index(1)
-                ->Insert(txn, Encode(str(sizeof(k_t_idx1)), k_t_idx1), t_oid));
+                ->InsertOID(txn, Encode(str(sizeof(k_t_idx1)), k_t_idx1), t_oid));
 
   t_s_symb_index::key k_t_idx2;
   k_t_idx2.t_s_symb = v_t.t_s_symb;
   k_t_idx2.t_dts = v_t.t_dts;
   k_t_idx2.t_id = k_t.t_id;
   TryCatch(tbl_t_s_symb_index(1)
-                ->Insert(txn, Encode(str(sizeof(k_t_idx2)), k_t_idx2), t_oid));
+                ->InsertOID(txn, Encode(str(sizeof(k_t_idx2)), k_t_idx2), t_oid));
 
   if (not pIn->type_is_market) {
     trade_request::key k_tr;
@@ -2332,7 +2234,7 @@ rc_t tpce_worker::DoTradeOrderFrame4(const TTradeOrderFrame4Input *pIn,
     v_tr.tr_tt_id = std::string(pIn->trade_type_id);
     v_tr.tr_qty = pIn->trade_qty;
     v_tr.tr_bid_price = pIn->requested_price;
-    TryCatch(tbl_trade_request(1)->Insert(txn, Encode(str(sizeof(k_tr)), k_tr),
+    TryCatch(tbl_trade_request(1)->InsertRecord(txn, Encode(str(sizeof(k_tr)), k_tr),
                                            Encode(str(sizeof(v_tr)), v_tr)));
   }
 
@@ -2343,7 +2245,7 @@ rc_t tpce_worker::DoTradeOrderFrame4(const TTradeOrderFrame4Input *pIn,
   k_th.th_dts = now_dts;
   k_th.th_st_id = std::string(pIn->status_id);
 
-  TryCatch(tbl_trade_history(1)->Insert(txn, Encode(str(sizeof(k_th)), k_th),
+  TryCatch(tbl_trade_history(1)->InsertRecord(txn, Encode(str(sizeof(k_th)), k_th),
                                          Encode(str(sizeof(v_th)), v_th)));
   return {RC_TRUE};
 }
@@ -2360,12 +2262,13 @@ rc_t tpce_worker::DoTradeOrderFrame6(void) {
 
 rc_t tpce_worker::DoTradeResultFrame1(const TTradeResultFrame1Input *pIn,
                                       TTradeResultFrame1Output *pOut) {
-  txn = db->NewTransaction(0, arena, txn_buf());
+  rc_t rc = rc_t{RC_INVALID};
+  txn = db->NewTransaction(0, *arena, txn_buf());
 
   const trade::key k_t(pIn->trade_id);
   trade::value v_t_temp;
-  TryVerifyRelaxed(tbl_trade(1)->Get(txn, Encode(str(sizeof(k_t)), k_t),
-                                     obj_v = str(sizeof(v_t_temp))));
+  tbl_trade(1)->GetRecord(txn, rc, Encode(str(sizeof(k_t)), k_t), obj_v);
+  TryVerifyRelaxed(rc);
   const trade::value *v_t = Decode(obj_v, v_t_temp);
   pOut->acct_id = v_t->t_ca_id;
   memcpy(pOut->type_id, v_t->t_tt_id.data(), v_t->t_tt_id.size());
@@ -2378,8 +2281,8 @@ rc_t tpce_worker::DoTradeResultFrame1(const TTradeResultFrame1Input *pIn,
 
   const trade_type::key k_tt(pOut->type_id);
   trade_type::value v_tt_temp;
-  TryVerifyRelaxed(tbl_trade_type(1)->Get(txn, Encode(str(sizeof(k_tt)), k_tt),
-                                          obj_v = str(sizeof(v_tt_temp))));
+  tbl_trade_type(1)->GetRecord(txn, rc, Encode(str(sizeof(k_tt)), k_tt), obj_v);
+  TryVerifyRelaxed(rc);
   const trade_type::value *v_tt = Decode(obj_v, v_tt_temp);
   memcpy(pOut->type_name, v_tt->tt_name.data(), v_tt->tt_name.size());
   pOut->type_is_sell = v_tt->tt_is_sell;
@@ -2389,9 +2292,9 @@ rc_t tpce_worker::DoTradeResultFrame1(const TTradeResultFrame1Input *pIn,
   const holding_summary::key k_hs(pOut->acct_id, std::string(pOut->symbol));
   holding_summary::value v_hs_temp;
   rc_t ret;
-  TryCatch(ret = tbl_holding_summary(1)->Get(txn,
-                                              Encode(str(sizeof(k_hs)), k_hs),
-                                              obj_v = str(sizeof(v_hs_temp))));
+  tbl_holding_summary(1)->GetRecord(
+      txn, ret, Encode(str(sizeof(k_hs)), k_hs), obj_v);
+  TryCatch(ret);
   if (ret._val == RC_TRUE) {
     const holding_summary::value *v_hs = Decode(obj_v, v_hs_temp);
     pOut->hs_qty = v_hs->hs_qty;
@@ -2401,6 +2304,7 @@ rc_t tpce_worker::DoTradeResultFrame1(const TTradeResultFrame1Input *pIn,
 
 rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
                                       TTradeResultFrame2Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   auto buy_value = 0.0;
   auto sell_value = 0.0;
   auto needed_qty = pIn->trade_qty;
@@ -2413,8 +2317,9 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
 
   const customer_account::key k_ca(pIn->acct_id);
   customer_account::value v_ca_temp;
-  TryVerifyRelaxed(tbl_customer_account(1)->Get(
-      txn, Encode(str(sizeof(k_ca)), k_ca), obj_v = str(sizeof(v_ca_temp))));
+  tbl_customer_account(1)->GetRecord(
+      txn, rc, Encode(str(sizeof(k_ca)), k_ca), obj_v);
+  TryVerifyRelaxed(rc);
   const customer_account::value *v_ca = Decode(obj_v, v_ca_temp);
   pOut->broker_id = v_ca->ca_b_id;
   pOut->cust_id = v_ca->ca_c_id;
@@ -2428,7 +2333,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
       k_hs.hs_s_symb = std::string(pIn->symbol);
       v_hs.hs_qty = -1 * pIn->trade_qty;
       TryCatch(
-          tbl_holding_summary(1)->Insert(txn, Encode(str(sizeof(k_hs)), k_hs),
+          tbl_holding_summary(1)->InsertRecord(txn, Encode(str(sizeof(k_hs)), k_hs),
                                          Encode(str(sizeof(v_hs)), v_hs)));
     }
 
@@ -2450,10 +2355,10 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
                                MIN_VAL(k_h_0.h_dts), MIN_VAL(k_h_0.h_t_id));
       const holding::key k_h_1(pIn->acct_id, std::string(pIn->symbol),
                                MAX_VAL(k_h_0.h_dts), MAX_VAL(k_h_0.h_t_id));
-      tpce_table_scanner h_scanner(&arena);
+      tpce_table_scanner h_scanner(arena);
       TryCatch(tbl_holding(1)->Scan(txn, Encode(str(sizeof(k_h_0)), k_h_0),
                                      &Encode(str(sizeof(k_h_1)), k_h_1),
-                                     h_scanner, &arena));
+                                     h_scanner));
 
       if (pIn->is_lifo) {
         reverse(h_scanner.output.begin(), h_scanner.output.end());
@@ -2478,7 +2383,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
           v_hh.hh_before_qty = hold_qty;
           v_hh.hh_after_qty = hold_qty - needed_qty;
           TryCatch(tbl_holding_history(1)
-                        ->Insert(txn, Encode(str(sizeof(k_hh)), k_hh),
+                        ->InsertRecord(txn, Encode(str(sizeof(k_hh)), k_hh),
                                  Encode(str(sizeof(v_hh)), v_hh)));
 
           // update with current holding cursor. use the same key
@@ -2500,12 +2405,12 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
           v_hh.hh_before_qty = hold_qty;
           v_hh.hh_after_qty = 0;
           TryCatch(tbl_holding_history(1)
-                        ->Insert(txn, Encode(str(sizeof(k_hh)), k_hh),
+                        ->InsertRecord(txn, Encode(str(sizeof(k_hh)), k_hh),
                                  Encode(str(sizeof(v_hh)), v_hh)));
 
           holding::key k_h_new(*k_h);
           TryCatch(tbl_holding(1)
-                        ->Remove(txn, Encode(str(sizeof(k_h_new)), k_h_new)));
+                        ->RemoveRecord(txn, Encode(str(sizeof(k_h_new)), k_h_new)));
 
           buy_value += hold_qty * hold_price;
           sell_value += hold_qty * pIn->trade_price;
@@ -2522,7 +2427,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
       v_hh.hh_before_qty = 0;
       v_hh.hh_after_qty = -1 * needed_qty;
       TryCatch(
-          tbl_holding_history(1)->Insert(txn, Encode(str(sizeof(k_hh)), k_hh),
+          tbl_holding_history(1)->InsertRecord(txn, Encode(str(sizeof(k_hh)), k_hh),
                                          Encode(str(sizeof(v_hh)), v_hh)));
 
       holding::key k_h;
@@ -2533,7 +2438,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
       k_h.h_t_id = pIn->trade_id;
       v_h.h_price = pIn->trade_price;
       v_h.h_qty = -1 * needed_qty;
-      TryCatch(tbl_holding(1)->Insert(txn, Encode(str(sizeof(k_h)), k_h),
+      TryCatch(tbl_holding(1)->InsertRecord(txn, Encode(str(sizeof(k_h)), k_h),
                                        Encode(str(sizeof(v_h)), v_h)));
 
     } else {
@@ -2542,17 +2447,17 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
         k_hs.hs_ca_id = pIn->acct_id;
         k_hs.hs_s_symb = std::string(pIn->symbol);
         TryCatch(tbl_holding_summary(1)
-                      ->Remove(txn, Encode(str(sizeof(k_hs)), k_hs)));
+                      ->RemoveRecord(txn, Encode(str(sizeof(k_hs)), k_hs)));
 
         // Cascade delete for FK integrity
         const holding::key k_h_0(pIn->acct_id, std::string(pIn->symbol),
                                  MIN_VAL(k_h_0.h_dts), MIN_VAL(k_h_0.h_t_id));
         const holding::key k_h_1(pIn->acct_id, std::string(pIn->symbol),
                                  MAX_VAL(k_h_0.h_dts), MAX_VAL(k_h_0.h_t_id));
-        tpce_table_scanner h_scanner(&arena);
+        tpce_table_scanner h_scanner(arena);
         TryCatch(tbl_holding(1)->Scan(txn, Encode(str(sizeof(k_h_0)), k_h_0),
                                        &Encode(str(sizeof(k_h_1)), k_h_1),
-                                       h_scanner, &arena));
+                                       h_scanner));
 
         for (auto &r_h : h_scanner.output) {
           holding::key k_h_temp;
@@ -2560,7 +2465,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
 
           holding::key k_h_new(*k_h);
           TryCatch(tbl_holding(1)
-                        ->Remove(txn, Encode(str(sizeof(k_h_new)), k_h_new)));
+                        ->RemoveRecord(txn, Encode(str(sizeof(k_h_new)), k_h_new)));
         }
       }
     }
@@ -2573,7 +2478,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
       k_hs.hs_s_symb = std::string(pIn->symbol);
       v_hs.hs_qty = pIn->trade_qty;
       TryCatch(
-          tbl_holding_summary(1)->Insert(txn, Encode(str(sizeof(k_hs)), k_hs),
+          tbl_holding_summary(1)->InsertRecord(txn, Encode(str(sizeof(k_hs)), k_hs),
                                          Encode(str(sizeof(v_hs)), v_hs)));
 
     } else if (-1 * pIn->hs_qty != pIn->trade_qty) {
@@ -2593,10 +2498,10 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
                                MIN_VAL(k_h_0.h_dts), MIN_VAL(k_h_0.h_t_id));
       const holding::key k_h_1(pIn->acct_id, std::string(pIn->symbol),
                                MAX_VAL(k_h_0.h_dts), MAX_VAL(k_h_0.h_t_id));
-      tpce_table_scanner h_scanner(&arena);
+      tpce_table_scanner h_scanner(arena);
       TryCatch(tbl_holding(1)->Scan(txn, Encode(str(sizeof(k_h_0)), k_h_0),
                                      &Encode(str(sizeof(k_h_1)), k_h_1),
-                                     h_scanner, &arena));
+                                     h_scanner));
       // ALWAYS_ASSERT(h_scanner.output.size());  // XXX. guessing could be
       // empty
 
@@ -2626,7 +2531,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
           v_hh.hh_before_qty = hold_qty;
           v_hh.hh_after_qty = hold_qty + needed_qty;
           TryCatch(tbl_holding_history(1)
-                        ->Insert(txn, Encode(str(sizeof(k_hh)), k_hh),
+                        ->InsertRecord(txn, Encode(str(sizeof(k_hh)), k_hh),
                                  Encode(str(sizeof(v_hh)), v_hh)));
 
           // update with current holding cursor. use the same key
@@ -2649,13 +2554,13 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
           v_hh.hh_before_qty = hold_qty;
           v_hh.hh_after_qty = 0;
           TryCatch(tbl_holding_history(1)
-                        ->Insert(txn, Encode(str(sizeof(k_hh)), k_hh),
+                        ->InsertRecord(txn, Encode(str(sizeof(k_hh)), k_hh),
                                  Encode(str(sizeof(v_hh)), v_hh)));
 
           // H delete
           holding::key k_h_new(*k_h);
           TryCatch(tbl_holding(1)
-                        ->Remove(txn, Encode(str(sizeof(k_h_new)), k_h_new)));
+                        ->RemoveRecord(txn, Encode(str(sizeof(k_h_new)), k_h_new)));
 
           hold_qty *= -1;
           sell_value += hold_qty * hold_price;
@@ -2672,7 +2577,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
       v_hh.hh_before_qty = 0;
       v_hh.hh_after_qty = needed_qty;
       TryCatch(
-          tbl_holding_history(1)->Insert(txn, Encode(str(sizeof(k_hh)), k_hh),
+          tbl_holding_history(1)->InsertRecord(txn, Encode(str(sizeof(k_hh)), k_hh),
                                          Encode(str(sizeof(v_hh)), v_hh)));
 
       holding::key k_h;
@@ -2683,24 +2588,24 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
       k_h.h_t_id = pIn->trade_id;
       v_h.h_price = pIn->trade_price;
       v_h.h_qty = needed_qty;
-      TryCatch(tbl_holding(1)->Insert(txn, Encode(str(sizeof(k_h)), k_h),
+      TryCatch(tbl_holding(1)->InsertRecord(txn, Encode(str(sizeof(k_h)), k_h),
                                        Encode(str(sizeof(v_h)), v_h)));
     } else if (-1 * pIn->hs_qty == pIn->trade_qty) {
       holding_summary::key k_hs;
       k_hs.hs_ca_id = pIn->acct_id;
       k_hs.hs_s_symb = std::string(pIn->symbol);
       TryCatch(
-          tbl_holding_summary(1)->Remove(txn, Encode(str(sizeof(k_hs)), k_hs)));
+          tbl_holding_summary(1)->RemoveRecord(txn, Encode(str(sizeof(k_hs)), k_hs)));
 
       // Cascade delete for FK integrity
       const holding::key k_h_0(pIn->acct_id, std::string(pIn->symbol),
                                MIN_VAL(k_h_0.h_dts), MIN_VAL(k_h_0.h_t_id));
       const holding::key k_h_1(pIn->acct_id, std::string(pIn->symbol),
                                MAX_VAL(k_h_0.h_dts), MAX_VAL(k_h_0.h_t_id));
-      tpce_table_scanner h_scanner(&arena);
+      tpce_table_scanner h_scanner(arena);
       TryCatch(tbl_holding(1)->Scan(txn, Encode(str(sizeof(k_h_0)), k_h_0),
                                      &Encode(str(sizeof(k_h_1)), k_h_1),
-                                     h_scanner, &arena));
+                                     h_scanner));
 
       for (auto &r_h : h_scanner.output) {
         holding::key k_h_temp;
@@ -2708,7 +2613,7 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
 
         holding::key k_h_new(*k_h);
         TryCatch(
-            tbl_holding(1)->Remove(txn, Encode(str(sizeof(k_h_new)), k_h_new)));
+            tbl_holding(1)->RemoveRecord(txn, Encode(str(sizeof(k_h_new)), k_h_new)));
       }
     }
   }
@@ -2717,13 +2622,14 @@ rc_t tpce_worker::DoTradeResultFrame2(const TTradeResultFrame2Input *pIn,
 
 rc_t tpce_worker::DoTradeResultFrame3(const TTradeResultFrame3Input *pIn,
                                       TTradeResultFrame3Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   const customer_taxrate::key k_cx_0(pIn->cust_id, std::string(cTX_ID_len, (char)0));
   const customer_taxrate::key k_cx_1(pIn->cust_id,
                                      std::string(cTX_ID_len, (char)255));
-  tpce_table_scanner cx_scanner(&arena);
+  tpce_table_scanner cx_scanner(arena);
   TryCatch(tbl_customer_taxrate(1)->Scan(
       txn, Encode(str(sizeof(k_cx_0)), k_cx_0),
-      &Encode(str(sizeof(k_cx_1)), k_cx_1), cx_scanner, &arena));
+      &Encode(str(sizeof(k_cx_1)), k_cx_1), cx_scanner));
   ALWAYS_ASSERT(cx_scanner.output.size());
 
   double tax_rates = 0.0;
@@ -2734,8 +2640,8 @@ rc_t tpce_worker::DoTradeResultFrame3(const TTradeResultFrame3Input *pIn,
 
     const tax_rate::key k_tx(k_cx->cx_tx_id);
     tax_rate::value v_tx_temp;
-    TryVerifyRelaxed(tbl_tax_rate(1)->Get(txn, Encode(str(sizeof(k_tx)), k_tx),
-                                          obj_v = str(sizeof(v_tx_temp))));
+    tbl_tax_rate(1)->GetRecord(txn, rc, Encode(str(sizeof(k_tx)), k_tx), obj_v);
+    TryVerifyRelaxed(rc);
     const tax_rate::value *v_tx = Decode(obj_v, v_tx_temp);
 
     tax_rates += v_tx->tx_rate;
@@ -2745,11 +2651,10 @@ rc_t tpce_worker::DoTradeResultFrame3(const TTradeResultFrame3Input *pIn,
 
   const trade::key k_t(pIn->trade_id);
   trade::value v_t_temp;
-  TryVerifyRelaxed(tbl_trade(1)->Get(txn, Encode(str(sizeof(k_t)), k_t),
-                                     obj_v = str(sizeof(v_t_temp))));
+  tbl_trade(1)->GetRecord(txn, rc, Encode(str(sizeof(k_t)), k_t), obj_v);
+  TryVerifyRelaxed(rc);
   const trade::value *v_t = Decode(obj_v, v_t_temp);
-  trade::value v_t_new;
-  memcpy(&v_t_new, v_t, sizeof(trade::value));
+  trade::value v_t_new(*v_t);
   v_t_new.t_tax = pOut->tax_amount;  // secondary indices don't have t_tax
                                      // field. no need for cascading update
 
@@ -2761,17 +2666,18 @@ rc_t tpce_worker::DoTradeResultFrame3(const TTradeResultFrame3Input *pIn,
 
 rc_t tpce_worker::DoTradeResultFrame4(const TTradeResultFrame4Input *pIn,
                                       TTradeResultFrame4Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   const security::key k_s(std::string(pIn->symbol));
   security::value v_s_temp;
-  TryVerifyRelaxed(tbl_security(1)->Get(txn, Encode(str(sizeof(k_s)), k_s),
-                                        obj_v = str(sizeof(v_s_temp))));
+  tbl_security(1)->GetRecord(txn, rc, Encode(str(sizeof(k_s)), k_s), obj_v);
+  TryVerifyRelaxed(rc);
   const security::value *v_s = Decode(obj_v, v_s_temp);
   memcpy(pOut->s_name, v_s->s_name.data(), v_s->s_name.size());
 
   const customers::key k_c(pIn->cust_id);
   customers::value v_c_temp;
-  TryVerifyRelaxed(tbl_customers(1)->Get(txn, Encode(str(sizeof(k_c)), k_c),
-                                         obj_v = str(sizeof(v_c_temp))));
+  tbl_customers(1)->GetRecord(txn, rc, Encode(str(sizeof(k_c)), k_c), obj_v);
+  TryVerifyRelaxed(rc);
   const customers::value *v_c = Decode(obj_v, v_c_temp);
 
   const commission_rate::key k_cr_0(v_c->c_tier, std::string(pIn->type_id),
@@ -2779,10 +2685,10 @@ rc_t tpce_worker::DoTradeResultFrame4(const TTradeResultFrame4Input *pIn,
   const commission_rate::key k_cr_1(v_c->c_tier, std::string(pIn->type_id),
                                     v_s->s_ex_id, pIn->trade_qty);
 
-  tpce_table_scanner cr_scanner(&arena);
+  tpce_table_scanner cr_scanner(arena);
   TryCatch(tbl_commission_rate(1)->Scan(
       txn, Encode(str(sizeof(k_cr_0)), k_cr_0),
-      &Encode(str(sizeof(k_cr_1)), k_cr_1), cr_scanner, &arena));
+      &Encode(str(sizeof(k_cr_1)), k_cr_1), cr_scanner));
   ALWAYS_ASSERT(cr_scanner.output.size());
 
   for (auto &r_cr : cr_scanner.output) {
@@ -2797,14 +2703,15 @@ rc_t tpce_worker::DoTradeResultFrame4(const TTradeResultFrame4Input *pIn,
 }
 
 rc_t tpce_worker::DoTradeResultFrame5(const TTradeResultFrame5Input *pIn) {
+  rc_t rc = rc_t{RC_INVALID};
   const trade::key k_t(pIn->trade_id);
   trade::value v_t_temp;
   ermia::OID t_oid = 0;
-  TryVerifyRelaxed(tbl_trade(1)->Get(txn, Encode(str(sizeof(k_t)), k_t),
-                                     obj_v = str(sizeof(v_t_temp)), &t_oid));
+  tbl_trade(1)->GetRecord(
+      txn, rc, Encode(str(sizeof(k_t)), k_t), obj_v, &t_oid);
+  TryVerifyRelaxed(rc);
   const trade::value *v_t = Decode(obj_v, v_t_temp);
-  trade::value v_t_new;
-  memcpy(&v_t_new, v_t, sizeof(trade::value));
+  trade::value v_t_new(*v_t);
   v_t_new.t_comm = pIn->comm_amount;
   v_t_new.t_dts = CDateTime((TIMESTAMP_STRUCT *)&pIn->trade_dts).GetDate();
   v_t_new.t_st_id = std::string(pIn->st_completed_id);
@@ -2821,27 +2728,27 @@ rc_t tpce_worker::DoTradeResultFrame5(const TTradeResultFrame5Input *pIn) {
   k_t_idx1.t_dts = v_t_new.t_dts;
   k_t_idx1.t_id = k_t.t_id;
   TryCatch(tbl_t_ca_id_index(1)
-                ->Insert(txn, Encode(str(sizeof(k_t_idx1)), k_t_idx1), t_oid));
+                ->InsertOID(txn, Encode(str(sizeof(k_t_idx1)), k_t_idx1), t_oid));
 
   t_s_symb_index::key k_t_idx2;
   k_t_idx2.t_s_symb = v_t_new.t_s_symb;
   k_t_idx2.t_dts = v_t_new.t_dts;
   k_t_idx2.t_id = k_t.t_id;
   TryCatch(tbl_t_s_symb_index(1)
-                ->Insert(txn, Encode(str(sizeof(k_t_idx2)), k_t_idx2), t_oid));
+                ->InsertOID(txn, Encode(str(sizeof(k_t_idx2)), k_t_idx2), t_oid));
 
   trade_history::key k_th;
   trade_history::value v_th;
   k_th.th_t_id = pIn->trade_id;
   k_th.th_dts = CDateTime((TIMESTAMP_STRUCT *)&pIn->trade_dts).GetDate();
   k_th.th_st_id = std::string(pIn->st_completed_id);
-  TryCatch(tbl_trade_history(1)->Insert(txn, Encode(str(sizeof(k_th)), k_th),
+  TryCatch(tbl_trade_history(1)->InsertRecord(txn, Encode(str(sizeof(k_th)), k_th),
                                          Encode(str(sizeof(v_th)), v_th)));
 
   const broker::key k_b(pIn->broker_id);
   broker::value v_b_temp;
-  TryVerifyRelaxed(tbl_broker(1)->Get(txn, Encode(str(sizeof(k_b)), k_b),
-                                      obj_v = str(sizeof(v_b_temp))));
+  tbl_broker(1)->GetRecord(txn, rc, Encode(str(sizeof(k_b)), k_b), obj_v);
+  TryVerifyRelaxed(rc);
   const broker::value *v_b = Decode(obj_v, v_b_temp);
   broker::value v_b_new(*v_b);
   v_b_new.b_comm_total += pIn->comm_amount;
@@ -2853,6 +2760,7 @@ rc_t tpce_worker::DoTradeResultFrame5(const TTradeResultFrame5Input *pIn) {
 
 rc_t tpce_worker::DoTradeResultFrame6(const TTradeResultFrame6Input *pIn,
                                       TTradeResultFrame6Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   std::string cash_type;
 
   if (pIn->trade_is_cash)
@@ -2867,14 +2775,15 @@ rc_t tpce_worker::DoTradeResultFrame6(const TTradeResultFrame6Input *pIn,
   v_se.se_cash_due_date =
       CDateTime((TIMESTAMP_STRUCT *)&pIn->due_date).GetDate();
   v_se.se_amt = pIn->se_amount;
-  TryCatch(tbl_settlement(1)->Insert(txn, Encode(str(sizeof(k_se)), k_se),
+  TryCatch(tbl_settlement(1)->InsertRecord(txn, Encode(str(sizeof(k_se)), k_se),
                                       Encode(str(sizeof(v_se)), v_se)));
 
   if (pIn->trade_is_cash) {
     const customer_account::key k_ca(pIn->acct_id);
     customer_account::value v_ca_temp;
-    TryVerifyRelaxed(tbl_customer_account(1)->Get(
-        txn, Encode(str(sizeof(k_ca)), k_ca), obj_v = str(sizeof(v_ca_temp))));
+    tbl_customer_account(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_ca)), k_ca), obj_v);
+    TryVerifyRelaxed(rc);
     const customer_account::value *v_ca = Decode(obj_v, v_ca_temp);
     customer_account::value v_ca_new(*v_ca);
     v_ca_new.ca_bal += pIn->se_amount;
@@ -2889,14 +2798,15 @@ rc_t tpce_worker::DoTradeResultFrame6(const TTradeResultFrame6Input *pIn,
     v_ct.ct_amt = pIn->se_amount;
     v_ct.ct_name = std::string(pIn->type_name) + " " + to_string(pIn->trade_qty) +
                    " shares of " + std::string(pIn->s_name);
-    TryCatch(tbl_cash_transaction(1)->Insert(
+    TryCatch(tbl_cash_transaction(1)->InsertRecord(
         txn, Encode(str(sizeof(k_ct)), k_ct), Encode(str(sizeof(v_ct)), v_ct)));
   }
 
   const customer_account::key k_ca(pIn->acct_id);
   customer_account::value v_ca_temp;
-  TryVerifyRelaxed(tbl_customer_account(1)->Get(
-      txn, Encode(str(sizeof(k_ca)), k_ca), obj_v = str(sizeof(v_ca_temp))));
+  tbl_customer_account(1)->GetRecord(
+      txn, rc, Encode(str(sizeof(k_ca)), k_ca), obj_v);
+  TryVerifyRelaxed(rc);
   const customer_account::value *v_ca = Decode(obj_v, v_ca_temp);
   pOut->acct_bal = v_ca->ca_bal;
 
@@ -2906,18 +2816,19 @@ rc_t tpce_worker::DoTradeResultFrame6(const TTradeResultFrame6Input *pIn,
 
 rc_t tpce_worker::DoTradeStatusFrame1(const TTradeStatusFrame1Input *pIn,
                                       TTradeStatusFrame1Output *pOut) {
+  rc_t rc = rc_t{RC_INVALID};
   auto read_only_mask =
-      ermia::config::enable_safesnap ? ermia::transaction::TXN_FLAG_READ_ONLY : 0;
-  txn = db->NewTransaction(read_only_mask, arena, txn_buf());
+      (ermia::config::enable_safesnap || ermia::config::fast_read_only) ? read_only_txn_flags() : 0;
+  txn = db->NewTransaction(read_only_mask, *arena, txn_buf());
 
   const t_ca_id_index::key k_t_0(pIn->acct_id, MIN_VAL(k_t_0.t_dts),
                                  MIN_VAL(k_t_0.t_id));
   const t_ca_id_index::key k_t_1(pIn->acct_id, MAX_VAL(k_t_1.t_dts),
                                  MAX_VAL(k_t_1.t_id));
-  tpce_table_scanner t_scanner(&arena);
+  tpce_table_scanner t_scanner(arena);
   TryCatch(tbl_t_ca_id_index(1)->Scan(txn, Encode(str(sizeof(k_t_0)), k_t_0),
                                        &Encode(str(sizeof(k_t_1)), k_t_1),
-                                       t_scanner, &arena));
+                                       t_scanner));
   ALWAYS_ASSERT(t_scanner.output.size());
 
   int t_cursor = 0;
@@ -2936,26 +2847,28 @@ rc_t tpce_worker::DoTradeStatusFrame1(const TTradeStatusFrame1Input *pIn,
 
     const status_type::key k_st(v_t->t_st_id);
     status_type::value v_st_temp;
-    TryVerifyRelaxed(tbl_status_type(1)->Get(
-        txn, Encode(str(sizeof(k_st)), k_st), obj_v = str(sizeof(v_st_temp))));
+    tbl_status_type(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_st)), k_st), obj_v);
+    TryVerifyRelaxed(rc);
     const status_type::value *v_st = Decode(obj_v, v_st_temp);
 
     const trade_type::key k_tt(v_t->t_tt_id);
     trade_type::value v_tt_temp;
-    TryVerifyRelaxed(tbl_trade_type(1)->Get(
-        txn, Encode(str(sizeof(k_tt)), k_tt), obj_v = str(sizeof(v_tt_temp))));
+    tbl_trade_type(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_tt)), k_tt), obj_v);
+    TryVerifyRelaxed(rc);
     const trade_type::value *v_tt = Decode(obj_v, v_tt_temp);
 
     const security::key k_s(v_t->t_s_symb);
     security::value v_s_temp;
-    TryVerifyRelaxed(tbl_security(1)->Get(txn, Encode(str(sizeof(k_s)), k_s),
-                                          obj_v = str(sizeof(v_s_temp))));
+    tbl_security(1)->GetRecord(txn, rc, Encode(str(sizeof(k_s)), k_s), obj_v);
+    TryVerifyRelaxed(rc);
     const security::value *v_s = Decode(obj_v, v_s_temp);
 
     const exchange::key k_ex(v_s->s_ex_id);
     exchange::value v_ex_temp;
-    TryVerifyRelaxed(tbl_exchange(1)->Get(txn, Encode(str(sizeof(k_ex)), k_ex),
-                                          obj_v = str(sizeof(v_ex_temp))));
+    tbl_exchange(1)->GetRecord(txn, rc, Encode(str(sizeof(k_ex)), k_ex), obj_v);
+    TryVerifyRelaxed(rc);
     const exchange::value *v_ex = Decode(obj_v, v_ex_temp);
 
     pOut->trade_id[t_cursor] = k_t->t_id;
@@ -2980,20 +2893,21 @@ rc_t tpce_worker::DoTradeStatusFrame1(const TTradeStatusFrame1Input *pIn,
 
   const customer_account::key k_ca(pIn->acct_id);
   customer_account::value v_ca_temp;
-  TryVerifyRelaxed(tbl_customer_account(1)->Get(
-      txn, Encode(str(sizeof(k_ca)), k_ca), obj_v = str(sizeof(v_ca_temp))));
+  tbl_customer_account(1)->GetRecord(
+      txn, rc, Encode(str(sizeof(k_ca)), k_ca), obj_v);
+  TryVerifyRelaxed(rc);
   const customer_account::value *v_ca = Decode(obj_v, v_ca_temp);
 
   const customers::key k_c(v_ca->ca_c_id);
   customers::value v_c_temp;
-  TryVerifyRelaxed(tbl_customers(1)->Get(txn, Encode(str(sizeof(k_c)), k_c),
-                                         obj_v = str(sizeof(v_c_temp))));
+  tbl_customers(1)->GetRecord(txn, rc, Encode(str(sizeof(k_c)), k_c), obj_v);
+  TryVerifyRelaxed(rc);
   const customers::value *v_c = Decode(obj_v, v_c_temp);
 
   const broker::key k_b(v_ca->ca_b_id);
   broker::value v_b_temp;
-  TryVerifyRelaxed(tbl_broker(1)->Get(txn, Encode(str(sizeof(k_b)), k_b),
-                                      obj_v = str(sizeof(v_b_temp))));
+  tbl_broker(1)->GetRecord(txn, rc, Encode(str(sizeof(k_b)), k_b), obj_v);
+  TryVerifyRelaxed(rc);
   const broker::value *v_b = Decode(obj_v, v_b_temp);
 
   memcpy(pOut->cust_f_name, v_c->c_f_name.data(), v_c->c_f_name.size());
@@ -3006,20 +2920,22 @@ rc_t tpce_worker::DoTradeStatusFrame1(const TTradeStatusFrame1Input *pIn,
 
 rc_t tpce_worker::DoTradeUpdateFrame1(const TTradeUpdateFrame1Input *pIn,
                                       TTradeUpdateFrame1Output *pOut) {
-  txn = db->NewTransaction(0, arena, txn_buf());
+  rc_t rc = rc_t{RC_INVALID};
+  txn = db->NewTransaction(0, *arena, txn_buf());
 
   for (auto i = 0; i < pIn->max_trades; i++) {
     const trade::key k_t(pIn->trade_id[i]);
     trade::value v_t_temp;
-    TryVerifyRelaxed(tbl_trade(1)->Get(txn, Encode(str(sizeof(k_t)), k_t),
-                                       obj_v = str(sizeof(v_t_temp))));
+    tbl_trade(1)->GetRecord(txn, rc, Encode(str(sizeof(k_t)), k_t), obj_v);
+    TryVerifyRelaxed(rc);
     const trade::value *v_t = Decode(obj_v, v_t_temp);
     pOut->num_found++;
 
     const trade_type::key k_tt(v_t->t_tt_id);
     trade_type::value v_tt_temp;
-    TryVerifyRelaxed(tbl_trade_type(1)->Get(
-        txn, Encode(str(sizeof(k_tt)), k_tt), obj_v = str(sizeof(v_tt_temp))));
+    tbl_trade_type(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_tt)), k_tt), obj_v);
+    TryVerifyRelaxed(rc);
     const trade_type::value *v_tt = Decode(obj_v, v_tt_temp);
 
     pOut->trade_info[i].bid_price = v_t->t_bid_price;
@@ -3037,8 +2953,7 @@ rc_t tpce_worker::DoTradeUpdateFrame1(const TTradeUpdateFrame1Input *pIn,
         temp_exec_name.replace(index, 3, " X ");
       }
 
-      trade::value v_t_new;
-      memcpy(&v_t_new, v_t, sizeof(trade::value));
+      trade::value v_t_new(*v_t);
       v_t_new.t_exec_name = temp_exec_name;
       TryCatch(tbl_trade(1)->UpdateRecord(txn, Encode(str(sizeof(k_t)), k_t),
                                   Encode(str(sizeof(v_t_new)), v_t_new)));
@@ -3054,8 +2969,9 @@ rc_t tpce_worker::DoTradeUpdateFrame1(const TTradeUpdateFrame1Input *pIn,
 
     const settlement::key k_se(pIn->trade_id[i]);
     settlement::value v_se_temp;
-    TryVerifyRelaxed(tbl_settlement(1)->Get(
-        txn, Encode(str(sizeof(k_se)), k_se), obj_v = str(sizeof(v_se_temp))));
+    tbl_settlement(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_se)), k_se), obj_v);
+    TryVerifyRelaxed(rc);
     const settlement::value *v_se = Decode(obj_v, v_se_temp);
     pOut->trade_info[i].settlement_amount = v_se->se_amt;
     CDateTime(v_se->se_cash_due_date)
@@ -3066,9 +2982,9 @@ rc_t tpce_worker::DoTradeUpdateFrame1(const TTradeUpdateFrame1Input *pIn,
     if (pOut->trade_info[i].is_cash) {
       const cash_transaction::key k_ct(pIn->trade_id[i]);
       cash_transaction::value v_ct_temp;
-      TryVerifyRelaxed(
-          tbl_cash_transaction(1)->Get(txn, Encode(str(sizeof(k_ct)), k_ct),
-                                       obj_v = str(sizeof(v_ct_temp))));
+      tbl_cash_transaction(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_ct)), k_ct), obj_v);
+      TryVerifyRelaxed(rc);
       const cash_transaction::value *v_ct = Decode(obj_v, v_ct_temp);
       pOut->trade_info[i].cash_transaction_amount = v_ct->ct_amt;
       CDateTime(v_ct->ct_dts)
@@ -3082,10 +2998,10 @@ rc_t tpce_worker::DoTradeUpdateFrame1(const TTradeUpdateFrame1Input *pIn,
     const trade_history::key k_th_1(pIn->trade_id[i],
                                     std::string(cST_ID_len, (char)255),
                                     MIN_VAL(k_th_0.th_dts));
-    tpce_table_scanner th_scanner(&arena);
+    tpce_table_scanner th_scanner(arena);
     TryCatch(tbl_trade_history(1)->Scan(
         txn, Encode(str(sizeof(k_th_0)), k_th_0),
-        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner, &arena));
+        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner));
     ALWAYS_ASSERT(th_scanner.output.size());
 
     for (size_t th_cursor = 0;
@@ -3107,7 +3023,8 @@ rc_t tpce_worker::DoTradeUpdateFrame1(const TTradeUpdateFrame1Input *pIn,
 
 rc_t tpce_worker::DoTradeUpdateFrame2(const TTradeUpdateFrame2Input *pIn,
                                       TTradeUpdateFrame2Output *pOut) {
-  txn = db->NewTransaction(0, arena, txn_buf());
+  rc_t rc = rc_t{RC_INVALID};
+  txn = db->NewTransaction(0, *arena, txn_buf());
 
   const t_ca_id_index::key k_t_0(
       pIn->acct_id,
@@ -3117,10 +3034,10 @@ rc_t tpce_worker::DoTradeUpdateFrame2(const TTradeUpdateFrame2Input *pIn,
       pIn->acct_id,
       CDateTime((TIMESTAMP_STRUCT *)&pIn->end_trade_dts).GetDate(),
       MAX_VAL(k_t_0.t_id));
-  tpce_table_scanner t_scanner(&arena);
+  tpce_table_scanner t_scanner(arena);
   TryCatch(tbl_t_ca_id_index(1)->Scan(txn, Encode(str(sizeof(k_t_0)), k_t_0),
                                        &Encode(str(sizeof(k_t_1)), k_t_1),
-                                       t_scanner, &arena));
+                                       t_scanner));
   ALWAYS_ASSERT(t_scanner.output.size());
 
   for (size_t i = 0;
@@ -3152,8 +3069,9 @@ rc_t tpce_worker::DoTradeUpdateFrame2(const TTradeUpdateFrame2Input *pIn,
   for (int i = 0; i < pOut->num_found; i++) {
     const settlement::key k_se(pOut->trade_info[i].trade_id);
     settlement::value v_se_temp;
-    TryVerifyRelaxed(tbl_settlement(1)->Get(
-        txn, Encode(str(sizeof(k_se)), k_se), obj_v = str(sizeof(v_se_temp))));
+    tbl_settlement(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_se)), k_se), obj_v);
+    TryVerifyRelaxed(rc);
     const settlement::value *v_se = Decode(obj_v, v_se_temp);
 
     if (pOut->num_updated < pIn->max_updates) {
@@ -3186,9 +3104,9 @@ rc_t tpce_worker::DoTradeUpdateFrame2(const TTradeUpdateFrame2Input *pIn,
     if (pOut->trade_info[i].is_cash) {
       const cash_transaction::key k_ct(pOut->trade_info[i].trade_id);
       cash_transaction::value v_ct_temp;
-      TryVerifyRelaxed(
-          tbl_cash_transaction(1)->Get(txn, Encode(str(sizeof(k_ct)), k_ct),
-                                       obj_v = str(sizeof(v_ct_temp))));
+      tbl_cash_transaction(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_ct)), k_ct), obj_v);
+      TryVerifyRelaxed(rc);
       const cash_transaction::value *v_ct = Decode(obj_v, v_ct_temp);
       pOut->trade_info[i].cash_transaction_amount = v_ct->ct_amt;
       CDateTime(v_ct->ct_dts)
@@ -3203,10 +3121,10 @@ rc_t tpce_worker::DoTradeUpdateFrame2(const TTradeUpdateFrame2Input *pIn,
     const trade_history::key k_th_1(pOut->trade_info[i].trade_id,
                                     std::string(cST_ID_len, (char)255),
                                     MAX_VAL(k_th_0.th_dts));
-    tpce_table_scanner th_scanner(&arena);
+    tpce_table_scanner th_scanner(arena);
     TryCatch(tbl_trade_history(1)->Scan(
         txn, Encode(str(sizeof(k_th_0)), k_th_0),
-        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner, &arena));
+        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner));
     ALWAYS_ASSERT(th_scanner.output.size());
 
     for (size_t th_cursor = 0;
@@ -3228,7 +3146,8 @@ rc_t tpce_worker::DoTradeUpdateFrame2(const TTradeUpdateFrame2Input *pIn,
 
 rc_t tpce_worker::DoTradeUpdateFrame3(const TTradeUpdateFrame3Input *pIn,
                                       TTradeUpdateFrame3Output *pOut) {
-  txn = db->NewTransaction(0, arena, txn_buf());
+  rc_t rc = rc_t{RC_INVALID};
+  txn = db->NewTransaction(0, *arena, txn_buf());
 
   const t_s_symb_index::key k_t_0(
       std::string(pIn->symbol),
@@ -3238,10 +3157,10 @@ rc_t tpce_worker::DoTradeUpdateFrame3(const TTradeUpdateFrame3Input *pIn,
       std::string(pIn->symbol),
       CDateTime((TIMESTAMP_STRUCT *)&pIn->end_trade_dts).GetDate(),
       MAX_VAL(k_t_0.t_id));
-  tpce_table_scanner t_scanner(&arena);
+  tpce_table_scanner t_scanner(arena);
   TryCatch(tbl_t_s_symb_index(1)->Scan(txn, Encode(str(sizeof(k_t_0)), k_t_0),
                                         &Encode(str(sizeof(k_t_1)), k_t_1),
-                                        t_scanner, &arena));
+                                        t_scanner));
   ALWAYS_ASSERT(t_scanner.output.size());  // XXX. short innitial trading day
                                            // can make this case happening?
 
@@ -3262,14 +3181,15 @@ rc_t tpce_worker::DoTradeUpdateFrame3(const TTradeUpdateFrame3Input *pIn,
 
     const trade_type::key k_tt(v_t->t_tt_id);
     trade_type::value v_tt_temp;
-    TryVerifyRelaxed(tbl_trade_type(1)->Get(
-        txn, Encode(str(sizeof(k_tt)), k_tt), obj_v = str(sizeof(v_tt_temp))));
+    tbl_trade_type(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_tt)), k_tt), obj_v);
+    TryVerifyRelaxed(rc);
     const trade_type::value *v_tt = Decode(obj_v, v_tt_temp);
 
     const security::key k_s(k_t->t_s_symb);
     security::value v_s_temp;
-    TryVerifyRelaxed(tbl_security(1)->Get(txn, Encode(str(sizeof(k_s)), k_s),
-                                          obj_v = str(sizeof(v_s_temp))));
+    tbl_security(1)->GetRecord(txn, rc, Encode(str(sizeof(k_s)), k_s), obj_v);
+    TryVerifyRelaxed(rc);
     const security::value *v_s = Decode(obj_v, v_s_temp);
 
     /*
@@ -3305,15 +3225,16 @@ rc_t tpce_worker::DoTradeUpdateFrame3(const TTradeUpdateFrame3Input *pIn,
   for (int i = 0; i < pOut->num_found; i++) {
     const settlement::key k_se(pOut->trade_info[i].trade_id);
     settlement::value v_se_temp;
-    TryVerifyRelaxed(tbl_settlement(1)->Get(
-        txn, Encode(str(sizeof(k_se)), k_se), obj_v = str(sizeof(v_se_temp))));
+    tbl_settlement(1)->GetRecord(
+        txn, rc, Encode(str(sizeof(k_se)), k_se), obj_v);
+    TryVerifyRelaxed(rc);
 
     if (pOut->trade_info[i].is_cash) {
       const cash_transaction::key k_ct(pOut->trade_info[i].trade_id);
       cash_transaction::value v_ct_temp;
-      TryVerifyRelaxed(
-          tbl_cash_transaction(1)->Get(txn, Encode(str(sizeof(k_ct)), k_ct),
-                                       obj_v = str(sizeof(v_ct_temp))));
+      tbl_cash_transaction(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_ct)), k_ct), obj_v);
+      TryVerifyRelaxed(rc);
       const cash_transaction::value *v_ct = Decode(obj_v, v_ct_temp);
 
       if (pOut->num_updated < pIn->max_updates) {
@@ -3359,10 +3280,10 @@ rc_t tpce_worker::DoTradeUpdateFrame3(const TTradeUpdateFrame3Input *pIn,
     const trade_history::key k_th_1(pOut->trade_info[i].trade_id,
                                     std::string(cST_ID_len, (char)255),
                                     MAX_VAL(k_th_0.th_dts));
-    tpce_table_scanner th_scanner(&arena);
+    tpce_table_scanner th_scanner(arena);
     TryCatch(tbl_trade_history(1)->Scan(
         txn, Encode(str(sizeof(k_th_0)), k_th_0),
-        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner, &arena));
+        &Encode(str(sizeof(k_th_1)), k_th_1), th_scanner));
     ALWAYS_ASSERT(th_scanner.output.size());
 
     for (size_t th_cursor = 0;
@@ -3383,8 +3304,9 @@ rc_t tpce_worker::DoTradeUpdateFrame3(const TTradeUpdateFrame3Input *pIn,
 }
 
 rc_t tpce_worker::DoLongQueryFrame1() {
+  rc_t rc = rc_t{RC_INVALID};
   // FIXME(yongjunh): use TXN_FLAG_READ_MOSTLY once SSN's and SSI's read optimization are available.
-  txn = db->NewTransaction(0, arena, txn_buf());
+  txn = db->NewTransaction(0, *arena, txn_buf());
 
   auto total_range = max_ca_id - min_ca_id;
   auto scan_range_size = (max_ca_id - min_ca_id) / 100 * long_query_scan_range;
@@ -3394,10 +3316,10 @@ rc_t tpce_worker::DoLongQueryFrame1() {
 
   const customer_account::key k_ca_0(start_pos);
   const customer_account::key k_ca_1(end_pos);
-  tpce_table_scanner ca_scanner(&arena);
+  tpce_table_scanner ca_scanner(arena);
   TryCatch(tbl_customer_account(1)->Scan(
       txn, Encode(str(sizeof(k_ca_0)), k_ca_0),
-      &Encode(str(sizeof(k_ca_1)), k_ca_1), ca_scanner, &arena));
+      &Encode(str(sizeof(k_ca_1)), k_ca_1), ca_scanner));
   ALWAYS_ASSERT(ca_scanner.output.size());
 
   auto asset = 0;
@@ -3409,11 +3331,11 @@ rc_t tpce_worker::DoLongQueryFrame1() {
                                       std::string(cSYMBOL_len, (char)0));
     const holding_summary::key k_hs_1(k_ca->ca_id,
                                       std::string(cSYMBOL_len, (char)255));
-    static thread_local tpce_table_scanner hs_scanner(&arena);
+    static thread_local tpce_table_scanner hs_scanner(arena);
     hs_scanner.output.clear();
     TryCatch(tbl_holding_summary(1)->Scan(
         txn, Encode(str(sizeof(k_hs_0)), k_hs_0),
-        &Encode(str(sizeof(k_hs_1)), k_hs_1), hs_scanner, &arena));
+        &Encode(str(sizeof(k_hs_1)), k_hs_1), hs_scanner));
 
     for (auto &r_hs : hs_scanner.output) {
       holding_summary::key k_hs_temp;
@@ -3424,8 +3346,9 @@ rc_t tpce_worker::DoLongQueryFrame1() {
       // LastTrade probe & equi-join
       const last_trade::key k_lt(k_hs->hs_s_symb);
       last_trade::value v_lt_temp;
-      TryCatch(tbl_last_trade(1)->Get(txn, Encode(str(sizeof(k_lt)), k_lt),
-                                       obj_v = str(sizeof(v_lt_temp))));
+      tbl_last_trade(1)->GetRecord(
+          txn, rc, Encode(str(sizeof(k_lt)), k_lt), obj_v);
+      TryCatch(rc);
       const last_trade::value *v_lt = Decode(obj_v, v_lt_temp);
 
       asset += v_hs->hs_qty * v_lt->lt_price;
@@ -3438,7 +3361,7 @@ rc_t tpce_worker::DoLongQueryFrame1() {
   v_ah.start_ca_id = start_pos;
   v_ah.end_ca_id = start_pos;
   v_ah.total_assets = asset;
-  TryCatch(tbl_assets_history(1)->Insert(txn, Encode(str(sizeof(k_ah)), k_ah),
+  TryCatch(tbl_assets_history(1)->InsertRecord(txn, Encode(str(sizeof(k_ah)), k_ah),
                                           Encode(str(sizeof(v_ah)), v_ah)));
 
   // nothing to do actually. just bothering writers.
@@ -3489,11 +3412,11 @@ class tpce_charge_loader : public bench_loader, public tpce_worker_mixin {
       k.ch_c_tier = record->CH_C_TIER;
       v.ch_chrg = record->CH_CHRG;
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-      TryVerifyStrict(tbl_charge(1)->Insert(txn, Encode(str(sizeof(k)), k),
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+      TryVerifyStrict(tbl_charge(1)->InsertRecord(txn, Encode(str(sizeof(k)), k),
                                               Encode(str(sizeof(v)), v)));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
       // TODO. sanity check
 
       // Partitioning by customer?
@@ -3545,11 +3468,11 @@ class tpce_commission_rate_loader : public bench_loader,
       v.cr_to_qty = record->CR_TO_QTY;
       v.cr_rate = record->CR_RATE;
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-      TryVerifyStrict(tbl_commission_rate(1)->Insert(
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+      TryVerifyStrict(tbl_commission_rate(1)->InsertRecord(
           txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
     }
     pGenerateAndLoad->ReleaseCommissionRate();
     commissionRateBuffer.release();
@@ -3591,11 +3514,11 @@ class tpce_exchange_loader : public bench_loader, public tpce_worker_mixin {
       v.ex_desc = std::string(record->EX_DESC);
       v.ex_ad_id = record->EX_AD_ID;
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-      TryVerifyStrict(tbl_exchange(1)->Insert(txn, Encode(str(sizeof(k)), k),
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+      TryVerifyStrict(tbl_exchange(1)->InsertRecord(txn, Encode(str(sizeof(k)), k),
                                                 Encode(str(sizeof(v)), v)));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
     }
     pGenerateAndLoad->ReleaseExchange();
     exchangeBuffer.release();
@@ -3644,17 +3567,17 @@ class tpce_industry_loader : public bench_loader, public tpce_worker_mixin {
       k_in_idx2.in_sc_id = std::string(record->IN_SC_ID);
       k_in_idx2.in_id = std::string(record->IN_ID);
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
       ermia::OID i_oid = 0;
       TryVerifyStrict(
-          tbl_industry(1)->Insert(txn, Encode(str(sizeof(k_in)), k_in),
+          tbl_industry(1)->InsertRecord(txn, Encode(str(sizeof(k_in)), k_in),
                                   Encode(str(sizeof(v_in)), v_in), &i_oid));
-      TryVerifyStrict(tbl_in_name_index(1)->Insert(
+      TryVerifyStrict(tbl_in_name_index(1)->InsertOID(
           txn, Encode(str(sizeof(k_in_idx1)), k_in_idx1), i_oid));
-      TryVerifyStrict(tbl_in_sc_id_index(1)->Insert(
+      TryVerifyStrict(tbl_in_sc_id_index(1)->InsertOID(
           txn, Encode(str(sizeof(k_in_idx2)), k_in_idx2), i_oid));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
     }
     pGenerateAndLoad->ReleaseIndustry();
     industryBuffer.release();
@@ -3700,11 +3623,11 @@ class tpce_sector_loader : public bench_loader, public tpce_worker_mixin {
       k.sc_id = std::string(record->SC_ID);
       v.dummy = true;
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-      TryVerifyStrict(tbl_sector(1)->Insert(txn, Encode(str(sizeof(k)), k),
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+      TryVerifyStrict(tbl_sector(1)->InsertRecord(txn, Encode(str(sizeof(k)), k),
                                               Encode(str(sizeof(v)), v)));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
     }
     pGenerateAndLoad->ReleaseSector();
     sectorBuffer.release();
@@ -3749,11 +3672,11 @@ class tpce_status_type_loader : public bench_loader, public tpce_worker_mixin {
       k.st_id = std::string(record->ST_ID);
       v.st_name = std::string(record->ST_NAME);
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-      TryVerifyStrict(tbl_status_type(1)->Insert(
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+      TryVerifyStrict(tbl_status_type(1)->InsertRecord(
           txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
     }
     pGenerateAndLoad->ReleaseStatusType();
     statusTypeBuffer.release();
@@ -3799,11 +3722,11 @@ class tpce_tax_rate_loader : public bench_loader, public tpce_worker_mixin {
       v.tx_name = std::string(record->TX_NAME);
       v.tx_rate = record->TX_RATE;
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-      TryVerifyStrict(tbl_tax_rate(1)->Insert(txn, Encode(str(sizeof(k)), k),
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+      TryVerifyStrict(tbl_tax_rate(1)->InsertRecord(txn, Encode(str(sizeof(k)), k),
                                                 Encode(str(sizeof(v)), v)));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
     }
     pGenerateAndLoad->ReleaseTaxrate();
     taxrateBuffer.release();
@@ -3850,11 +3773,11 @@ class tpce_trade_type_loader : public bench_loader, public tpce_worker_mixin {
       v.tt_is_sell = record->TT_IS_SELL;
       v.tt_is_mrkt = record->TT_IS_MRKT;
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-      TryVerifyStrict(tbl_trade_type(1)->Insert(
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+      TryVerifyStrict(tbl_trade_type(1)->InsertRecord(
           txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
     }
     pGenerateAndLoad->ReleaseTradeType();
     tradeTypeBuffer.release();
@@ -3898,11 +3821,11 @@ class tpce_zip_code_loader : public bench_loader, public tpce_worker_mixin {
       v.zc_town = std::string(record->ZC_TOWN);
       v.zc_div = std::string(record->ZC_DIV);
 
-      ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-      TryVerifyStrict(tbl_zip_code(1)->Insert(txn, Encode(str(sizeof(k)), k),
+      ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+      TryVerifyStrict(tbl_zip_code(1)->InsertRecord(txn, Encode(str(sizeof(k)), k),
                                                 Encode(str(sizeof(v)), v)));
       TryVerifyStrict(db->Commit(txn));
-      arena.reset();
+      arena->reset();
     }
     pGenerateAndLoad->ReleaseZipCode();
     zipCodeBuffer.release();
@@ -3951,11 +3874,11 @@ class tpce_address_loader : public bench_loader, public tpce_worker_mixin {
         v.ad_zc_code = std::string(record->AD_ZC_CODE);
         v.ad_ctry = std::string(record->AD_CTRY);
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_address(1)->Insert(txn, Encode(str(sizeof(k)), k),
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_address(1)->InsertRecord(txn, Encode(str(sizeof(k)), k),
                                                  Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseAddress();
@@ -4029,14 +3952,14 @@ class tpce_customer_loader : public bench_loader, public tpce_worker_mixin {
         k_idx_tax_id.c_id = record->C_ID;
         k_idx_tax_id.c_tax_id = std::string(record->C_TAX_ID);
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
         ermia::OID c_oid = 0;
-        TryVerifyStrict(tbl_customers(1)->Insert(
+        TryVerifyStrict(tbl_customers(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v), &c_oid));
-        TryVerifyStrict(tbl_c_tax_id_index(1)->Insert(
+        TryVerifyStrict(tbl_c_tax_id_index(1)->InsertOID(
             txn, Encode(str(sizeof(k_idx_tax_id)), k_idx_tax_id), c_oid));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseCustomer();
@@ -4102,15 +4025,15 @@ class tpce_ca_and_ap_loader : public bench_loader, public tpce_worker_mixin {
         k_idx1.ca_id = record->CA_ID;
         k_idx1.ca_c_id = record->CA_C_ID;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
         ermia::OID ca_oid = 0;
         TryVerifyStrict(tbl_customer_account(1)
-                              ->Insert(txn, Encode(str(sizeof(k)), k),
+                              ->InsertRecord(txn, Encode(str(sizeof(k)), k),
                                        Encode(str(sizeof(v)), v), &ca_oid));
-        TryVerifyStrict(tbl_ca_id_index(1)->Insert(
+        TryVerifyStrict(tbl_ca_id_index(1)->InsertOID(
             txn, Encode(str(sizeof(k_idx1)), k_idx1), ca_oid));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
       rows = customerAccountBuffer.getSize();
       for (int i = 0; i < rows; i++) {
@@ -4124,11 +4047,11 @@ class tpce_ca_and_ap_loader : public bench_loader, public tpce_worker_mixin {
         v.ap_l_name = std::string(record->AP_L_NAME);
         v.ap_f_name = std::string(record->AP_F_NAME);
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_account_permission(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_account_permission(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseCustomerAccountAndAccountPermission();
@@ -4183,11 +4106,11 @@ class tpce_customer_taxrate_loader : public bench_loader,
         k.cx_tx_id = std::string(record->CX_TX_ID);
         v.dummy = true;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_customer_taxrate(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_customer_taxrate(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseCustomerTaxrate();
@@ -4241,11 +4164,11 @@ class tpce_wl_and_wi_loader : public bench_loader, public tpce_worker_mixin {
         k.wl_id = record->WL_ID;
         v.dummy = true;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_watch_list(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_watch_list(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
       rows = watchItemBuffer.getSize();
       for (int i = 0; i < rows; i++) {
@@ -4256,11 +4179,11 @@ class tpce_wl_and_wi_loader : public bench_loader, public tpce_worker_mixin {
         k.wi_wl_id = record->WI_WL_ID;
         k.wi_s_symb = record->WI_S_SYMB;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_watch_item(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_watch_item(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseWatchListAndWatchItem();
@@ -4322,16 +4245,16 @@ class tpce_company_loader : public bench_loader, public tpce_worker_mixin {
         k_idx2.co_in_id = std::string(record->CO_IN_ID);
         k_idx2.co_id = record->CO_ID;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
         ermia::OID c_oid;
-        TryVerifyStrict(tbl_company(1)->Insert(
+        TryVerifyStrict(tbl_company(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v), &c_oid));
-        TryVerifyStrict(tbl_co_name_index(1)->Insert(
+        TryVerifyStrict(tbl_co_name_index(1)->InsertOID(
             txn, Encode(str(sizeof(k_idx1)), k_idx1), c_oid));
-        TryVerifyStrict(tbl_co_in_id_index(1)->Insert(
+        TryVerifyStrict(tbl_co_in_id_index(1)->InsertOID(
             txn, Encode(str(sizeof(k_idx2)), k_idx2), c_oid));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseCompany();
@@ -4383,11 +4306,11 @@ class tpce_company_competitor_loader : public bench_loader,
         k.cp_in_id = std::string(record->CP_IN_ID);
         v.dummy = true;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_company_competitor(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_company_competitor(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseCompanyCompetitor();
@@ -4439,11 +4362,11 @@ class tpce_daily_market_loader : public bench_loader, public tpce_worker_mixin {
         v.dm_low = record->DM_HIGH;
         v.dm_vol = record->DM_VOL;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_daily_market(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_daily_market(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseDailyMarket();
@@ -4503,11 +4426,11 @@ class tpce_financial_loader : public bench_loader, public tpce_worker_mixin {
         v.fi_out_basic = record->FI_OUT_BASIC;
         v.fi_out_dilut = record->FI_OUT_DILUT;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_financial(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_financial(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseFinancial();
@@ -4557,11 +4480,11 @@ class tpce_last_trade_loader : public bench_loader, public tpce_worker_mixin {
         v.lt_open_price = record->LT_OPEN_PRICE;
         v.lt_vol = record->LT_VOL;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_last_trade(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_last_trade(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseLastTrade();
@@ -4614,11 +4537,11 @@ class tpce_ni_and_nx_loader : public bench_loader, public tpce_worker_mixin {
 
         v.dummy = true;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_news_xref(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_news_xref(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
       rows = newsItemBuffer.getSize();
       for (int i = 0; i < rows; i++) {
@@ -4635,11 +4558,11 @@ class tpce_ni_and_nx_loader : public bench_loader, public tpce_worker_mixin {
         v.ni_source = std::string(record->NI_SOURCE);
         v.ni_author = std::string(record->NI_AUTHOR);
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_news_item(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_news_item(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseNewsItemAndNewsXRef();
@@ -4706,14 +4629,14 @@ class tpce_security_loader : public bench_loader, public tpce_worker_mixin {
         k_idx.s_issue = std::string(record->S_ISSUE);
         k_idx.s_symb = std::string(record->S_SYMB);
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
         ermia::OID s_oid = 0;
-        TryVerifyStrict(tbl_security(1)->Insert(
+        TryVerifyStrict(tbl_security(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v), &s_oid));
-        TryVerifyStrict(tbl_security_index(1)->Insert(
+        TryVerifyStrict(tbl_security_index(1)->InsertOID(
             txn, Encode(str(sizeof(k_idx)), k_idx), s_oid));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
     pGenerateAndLoad->ReleaseSecurity();
@@ -4838,16 +4761,16 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
         k_idx2.t_dts = record->T_DTS.GetDate();
         k_idx2.t_id = record->T_ID;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
         ermia::OID t_oid = 0;
-        TryVerifyStrict(tbl_trade(1)->Insert(
+        TryVerifyStrict(tbl_trade(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v), &t_oid));
-        TryVerifyStrict(tbl_t_ca_id_index(1)->Insert(
+        TryVerifyStrict(tbl_t_ca_id_index(1)->InsertOID(
             txn, Encode(str(sizeof(k_idx1)), k_idx1), t_oid));
-        TryVerifyStrict(tbl_t_s_symb_index(1)->Insert(
+        TryVerifyStrict(tbl_t_s_symb_index(1)->InsertOID(
             txn, Encode(str(sizeof(k_idx2)), k_idx2), t_oid));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
 
       rows = tradeHistoryBuffer.getSize();
@@ -4860,11 +4783,11 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
         k.th_dts = record->TH_DTS.GetDate();
         k.th_st_id = std::string(record->TH_ST_ID);
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_trade_history(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_trade_history(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
 
       rows = settlementBuffer.getSize();
@@ -4879,11 +4802,11 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
         v.se_cash_due_date = record->SE_CASH_DUE_DATE.GetDate();
         v.se_amt = record->SE_AMT;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_settlement(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_settlement(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
 
       rows = cashTransactionBuffer.getSize();
@@ -4898,11 +4821,11 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
         v.ct_amt = record->CT_AMT;
         v.ct_name = std::string(record->CT_NAME);
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_cash_transaction(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_cash_transaction(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
 
       rows = holdingHistoryBuffer.getSize();
@@ -4916,11 +4839,11 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
         v.hh_before_qty = record->HH_BEFORE_QTY;
         v.hh_after_qty = record->HH_AFTER_QTY;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_holding_history(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_holding_history(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
   }
@@ -4951,14 +4874,14 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
         k_idx.b_name = std::string(record->B_NAME);
         k_idx.b_id = record->B_ID;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
         ermia::OID b_oid = 0;
-        TryVerifyStrict(tbl_broker(1)->Insert(
+        TryVerifyStrict(tbl_broker(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v), &b_oid));
-        TryVerifyStrict(tbl_b_name_index(1)->Insert(
+        TryVerifyStrict(tbl_b_name_index(1)->InsertOID(
             txn, Encode(str(sizeof(k_idx)), k_idx), b_oid));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
   }
@@ -4983,11 +4906,11 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
         k.hs_s_symb = std::string(record->HS_S_SYMB);
         v.hs_qty = record->HS_QTY;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_holding_summary(1)->Insert(
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_holding_summary(1)->InsertRecord(
             txn, Encode(str(sizeof(k)), k), Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
   }
@@ -5016,11 +4939,11 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
         v.h_price = record->H_PRICE;
         v.h_qty = record->H_QTY;
 
-        ermia::transaction *txn = db->NewTransaction(0, arena, txn_buf());
-        TryVerifyStrict(tbl_holding(1)->Insert(txn, Encode(str(sizeof(k)), k),
+        ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+        TryVerifyStrict(tbl_holding(1)->InsertRecord(txn, Encode(str(sizeof(k)), k),
                                                  Encode(str(sizeof(v)), v)));
         TryVerifyStrict(db->Commit(txn));
-        arena.reset();
+        arena->reset();
       }
     }
   }
@@ -5029,6 +4952,7 @@ class tpce_growing_loader : public bench_loader, public tpce_worker_mixin {
   ssize_t partition_id;
 };
 
+template <class WorkerType>
 class tpce_bench_runner : public bench_runner {
  private:
   static bool IsTableReadOnly(const char *name) {
@@ -5044,14 +4968,20 @@ class tpce_bench_runner : public bench_runner {
   static std::vector<ermia::OrderedIndex *> OpenTablesForTablespace(const char *name) {
     const std::string s_name(name);
     std::vector<ermia::OrderedIndex *> ret(NumPartitions());
-    ermia::OrderedIndex *idx = ermia::IndexDescriptor::GetIndex(s_name);
+    ermia::OrderedIndex *idx = ermia::TableDescriptor::GetIndex(s_name);
     for (size_t i = 0; i < NumPartitions(); i++) ret[i] = idx;
     return ret;
   }
 
   static void RegisterTable(ermia::Engine *db, const char *name,
                             const char *primary_idx_name = nullptr) {
-    db->CreateMasstreeTable(name, false, primary_idx_name);
+    if (primary_idx_name) {
+      // A secondary index on an existing table
+      db->CreateMasstreeSecondaryIndex(primary_idx_name, std::string(name));
+    } else {
+      db->CreateTable(name);
+      db->CreateMasstreePrimaryIndex(name, std::string(name));
+    }
   }
 
  public:
@@ -5180,13 +5110,13 @@ class tpce_bench_runner : public bench_runner {
     static bool const NO_PIN_WH = false;
     if (NO_PIN_WH) {
       for (size_t i = 0; i < ermia::config::worker_threads; i++) {
-        ret.push_back(new tpce_worker(i, r.next(), db, open_tables, partitions,
-                                      &barrier_a, &barrier_b, 1,
-                                      NumPartitions() + 1));
+        ret.push_back(new WorkerType(i, r.next(), db, open_tables, partitions,
+                                     &barrier_a, &barrier_b, 1,
+                                     NumPartitions() + 1));
       }
     } else if (NumPartitions() <= ermia::config::worker_threads) {
       for (size_t i = 0; i < ermia::config::worker_threads; i++) {
-        ret.push_back(new tpce_worker(
+        ret.push_back(new WorkerType(
             i, r.next(), db, open_tables, partitions, &barrier_a, &barrier_b,
             (i % NumPartitions()) + 1, (i % NumPartitions()) + 2));
       }
@@ -5197,9 +5127,9 @@ class tpce_bench_runner : public bench_runner {
       for (size_t i = 0; i < ermia::config::worker_threads; i++) {
         const unsigned wstart = i * N / T;
         const unsigned wend = (i + 1) * N / T;
-        ret.push_back(new tpce_worker(i, r.next(), db, open_tables, partitions,
-                                      &barrier_a, &barrier_b, wstart + 1,
-                                      wend + 1));
+        ret.push_back(new WorkerType(i, r.next(), db, open_tables, partitions,
+                                     &barrier_a, &barrier_b, wstart + 1,
+                                     wend + 1));
       }
     }
     return ret;
@@ -5279,6 +5209,10 @@ void tpce_do_test(ermia::Engine *db, int argc, char **argv) {
     }
   }
 
+  if (ermia::config::coro_tx) {
+    tpce_cs_worker::CheckWorkloadMix();
+  }
+
   const char *params[] = {"to_skip", "-i",    egen_dir, "-l",   "NULL",
                           "-f",      sfe_str, "-w",     wd_str, "-c",
                           cust_str,  "-t",    cust_str};
@@ -5319,7 +5253,12 @@ void tpce_do_test(ermia::Engine *db, int argc, char **argv) {
     cerr << "  long query scan range: " << long_query_scan_range << "%" << endl;
   }
 
-  tpce_bench_runner r(db);
-  r.run();
+  if (ermia::config::coro_tx) {
+    tpce_bench_runner<tpce_cs_worker> r(db);
+    r.run();
+  } else {
+    tpce_bench_runner<tpce_worker> r(db);
+    r.run();
+  }
 }
 #endif // ADV_COROUTINE
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include "../macros.h"
+
+// A fixed-capacity Chase-Lev work-stealing deque. The owner pushes and pops
+// at the bottom; other threads steal from the top. Entries are small,
+// trivially copyable structs: a thief copies its entry out before claiming
+// it, and the owner can only overwrite that slot once the top has moved past
+// it, so a torn copy is always thrown away with a failed claim.
+//
+// Used by the work-stealing coroutine scheduler (see
+// bench_worker::WorkStealingScheduler) to share pending transaction requests
+// among workers. kCapacity must be a power of two.
+template <typename T, uint32_t kCapacity>
+class work_deque {
+  static_assert(kCapacity && !(kCapacity & (kCapacity - 1)),
+                "Capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value, "Entries are copied racily");
+  static const uint64_t kMask = kCapacity - 1;
+
+ public:
+  work_deque() : top_(0), bottom_(0) {}
+
+  // Owner only. Returns false if the deque is full.
+  inline bool push(const T &v) {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_acquire);
+    if (b - t >= (int64_t)kCapacity) {
+      return false;
+    }
+    slots_[b & kMask] = v;
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Owner only. Returns false if the deque is empty or the last entry was
+  // lost to a concurrent thief.
+  inline bool pop(T &v) {
+    int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    v = slots_[b & kMask];
+    if (t == b) {
+      // Racing with thieves for the last entry
+      bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed);
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  // Any thread. Returns false if the deque is empty or the steal lost a race.
+  inline bool steal(T &v) {
+    int64_t t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) {
+      return false;
+    }
+    v = slots_[t & kMask];
+    return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed);
+  }
+
+  // Approximate; only meaningful as a hint for victim selection. The owner
+  // can rely on it as an upper bound, since thieves only ever shrink it.
+  inline int64_t size() const {
+    int64_t b = bottom_.load(std::memory_order_relaxed);
+    int64_t t = top_.load(std::memory_order_relaxed);
+    return b > t ? b - t : 0;
+  }
+
+ private:
+  std::atomic<int64_t> top_ CACHE_ALIGNED;
+  std::atomic<int64_t> bottom_ CACHE_ALIGNED;
+  T slots_[kCapacity] CACHE_ALIGNED;
+};
@@ -17,7 +17,13 @@ int g_scan_max_length = 1000;
 int g_scan_length_zipfain_rng = 0;
 double g_scan_length_zipfain_theta = 0.99;
 
+int g_bulk_load = 0;
+int g_hash_index = 0;
+std::vector<ermia::OrderedIndex::BulkLoadEntry> g_bulk_load_entries;
+std::vector<char *> g_bulk_load_keys;
+
 ReadTransactionType g_read_txn_type = ReadTransactionType::Sequential;
+WriteTransactionType g_write_txn_type = WriteTransactionType::Sequential;
 
 // { insert, read, update, scan, rmw }
 YcsbWorkload YcsbWorkloadA('A', 0, 50U, 100U, 0, 0);  // Workload A - 50% read, 50% update
@@ -42,7 +48,11 @@ void ycsb_create_db(ermia::Engine *db) {
 
   auto create_table = [=](char *) {
     db->CreateTable("USERTABLE");
-    db->CreateMasstreePrimaryIndex("USERTABLE", std::string("USERTABLE"));
+    if (g_hash_index) {
+      db->CreateHashPrimaryIndex("USERTABLE", std::string("USERTABLE"), g_initial_table_size);
+    } else {
+      db->CreateMasstreePrimaryIndex("USERTABLE", std::string("USERTABLE"));
+    }
   };
 
   thread->StartTask(create_table);
@@ -57,6 +67,31 @@ void ycsb_usertable_loader::load() {
   uint64_t start_key = loader_id * to_insert;
   uint64_t kBatchSize = 50;
 
+  if (g_bulk_load) {
+    // Keys must outlive this loader's arena: the index is built only after
+    // all loaders are done. Leave some slack at the end as Masstree reads
+    // keys a word at a time.
+    const size_t key_size = ermia::align_up(sizeof(ermia::varstr) + sizeof(ycsb_kv::key));
+    char *keys = (char *)malloc(key_size * to_insert + sizeof(uint64_t));
+    ALWAYS_ASSERT(keys);
+    g_bulk_load_keys[loader_id] = keys;
+
+    ermia::varstr &v = str(sizeof(ycsb_kv::value));
+    *(char*)v.p = 'a';
+    for (uint64_t i = 0; i < to_insert; ++i) {
+      ermia::varstr *k = (ermia::varstr *)(keys + key_size * i);
+      new (k) ermia::varstr((char *)k + sizeof(ermia::varstr), sizeof(ycsb_kv::key));
+      BuildKey(start_key + i, *k);
+      g_bulk_load_entries[start_key + i] = {k, tbl->BulkInsertTuple(v)};
+    }
+
+    if (ermia::config::verbose) {
+      std::cerr << "[INFO] loader " << loader_id <<  " created "
+                << to_insert << " records in USERTABLE" << std::endl;
+    }
+    return;
+  }
+
   ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
   for (uint64_t i = 0; i < to_insert; ++i) {
     ermia::varstr &k = str(sizeof(ycsb_kv::key));
@@ -109,6 +144,31 @@ void ycsb_usertable_loader::load() {
   }
 }
 
+void ycsb_finish_bulk_load(ermia::OrderedIndex *tbl) {
+  ermia::thread::Thread *thread = ermia::thread::GetThread(true);
+  ALWAYS_ASSERT(thread);
+
+  uint32_t nloaders = g_bulk_load_keys.size();
+  auto bulk_load = [=](char *) {
+    tbl->BulkLoad(g_bulk_load_entries, 1.0, nloaders);
+  };
+
+  thread->StartTask(bulk_load);
+  thread->Join();
+  ermia::thread::PutThread(thread);
+
+  if (ermia::config::verbose) {
+    std::cerr << "[INFO] bulk-loaded " << g_bulk_load_entries.size()
+              << " keys into USERTABLE" << std::endl;
+  }
+
+  for (auto &keys : g_bulk_load_keys) {
+    free(keys);
+  }
+  g_bulk_load_keys.clear();
+  std::vector<ermia::OrderedIndex::BulkLoadEntry>().swap(g_bulk_load_entries);
+}
+
 void ycsb_parse_options(int argc, char **argv) {
   // parse options
   optind = 1;
@@ -122,10 +182,13 @@ void ycsb_parse_options(int argc, char **argv) {
         {"zipfian-theta", required_argument, 0, 'z'},
         {"read-tx-type", required_argument, 0, 't'},
         {"scan-range", required_argument, 0, 'g'},
+        {"write-tx-type", required_argument, 0, 'u'},
+        {"bulk-load", no_argument, &g_bulk_load, 1},
+        {"hash-index", no_argument, &g_hash_index, 1},
         {0, 0, 0, 0}};
 
     int option_index = 0;
-    int c = getopt_long(argc, argv, "r:a:w:s:z:t:g:", long_options, &option_index);
+    int c = getopt_long(argc, argv, "r:a:w:s:z:t:g:u:", long_options, &option_index);
     if (c == -1) break;
     switch (c) {
       case 0:
@@ -151,6 +214,18 @@ void ycsb_parse_options(int argc, char **argv) {
         }
         break;
 
+      case 'u':
+        if (std::string(optarg) == "sequential") {
+          g_write_txn_type = WriteTransactionType::Sequential;
+        } else if (std::string(optarg) == "multi-amac") {
+          g_write_txn_type = WriteTransactionType::AMACMulti;
+        } else if (std::string(optarg) == "multi-simple-coro") {
+          g_write_txn_type = WriteTransactionType::SimpleCoroMulti;
+        } else {
+          LOG(FATAL) << "Wrong write transaction type " << std::string(optarg);
+        }
+        break;
+
       case 'z':
         g_zipfian_theta = strtod(optarg, NULL);
         break;
@@ -206,6 +281,15 @@ void ycsb_parse_options(int argc, char **argv) {
 
   ALWAYS_ASSERT(g_initial_table_size);
 
+  if (g_hash_index) {
+    // Point accesses only, through the generic OrderedIndex interface
+    LOG_IF(FATAL, ycsb_workload.scan_percent())
+        << "--hash-index doesn't support scans (workloads E, G and H)";
+    LOG_IF(FATAL, g_read_txn_type != ReadTransactionType::Sequential ||
+                  g_write_txn_type != WriteTransactionType::Sequential)
+        << "--hash-index only supports sequential read and write transactions";
+  }
+
   if (ermia::config::verbose) {
     std::cerr << "ycsb settings:" << std::endl
          << "  workload:                   " << g_workload << std::endl
@@ -213,6 +297,8 @@ void ycsb_parse_options(int argc, char **argv) {
          << "  operations per transaction: " << g_reps_per_tx << std::endl
          << "  additional reads after RMW: " << g_rmw_additional_reads << std::endl
          << "  distribution:               " << (g_zipfian_rng ? "zipfian" : "uniform") << std::endl;
+    std::cerr << "  bulk load:                  " << (g_bulk_load ? "yes" : "no") << std::endl;
+    std::cerr << "  primary index:              " << (g_hash_index ? "hash" : "masstree") << std::endl;
 
     if (g_read_txn_type == ReadTransactionType::Sequential) {
       std::cerr << "  read transaction type:      sequential" << std::endl;
@@ -230,6 +316,16 @@ void ycsb_parse_options(int argc, char **argv) {
       abort();
     }
 
+    if (g_write_txn_type == WriteTransactionType::Sequential) {
+      std::cerr << "  write transaction type:     sequential" << std::endl;
+    } else if (g_write_txn_type == WriteTransactionType::AMACMulti) {
+      std::cerr << "  write transaction type:     amac multi-insert/update" << std::endl;
+    } else if (g_write_txn_type == WriteTransactionType::SimpleCoroMulti) {
+      std::cerr << "  write transaction type:     simple coroutine multi-insert/update" << std::endl;
+    } else {
+      abort();
+    }
+
     if (g_zipfian_rng) {
       std::cerr << "  zipfian theta:              " << g_zipfian_theta << std::endl;
     }
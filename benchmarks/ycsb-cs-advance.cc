@@ -37,7 +37,7 @@ public:
     }
     ALWAYS_ASSERT(is_worker);
     workload = get_workload();
-    txn_counts.resize(workload.size());
+    prepare_txn_stats(workload.size());
 
     const size_t batch_size = ermia::config::coro_batch_size;
     std::vector<task<rc_t>> task_queue(batch_size);
@@ -143,7 +143,7 @@ private:
     ermia::transaction *txn = nullptr;
 
     if (!ermia::config::index_probe_only) {
-        txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | ermia::transaction::TXN_FLAG_READ_ONLY,
+        txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | read_only_txn_flags(),
                                  *arena, &transactions[idx], idx);
         ermia::TXN::xid_context * xc = txn->GetXIDContext();
         xc->begin_epoch = begin_epoch;
@@ -185,7 +185,7 @@ private:
   }
 
   task<rc_t> txn_scan(uint32_t idx, ermia::epoch_num begin_epoch) {
-    ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | ermia::transaction::TXN_FLAG_READ_ONLY,
+    ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | read_only_txn_flags(),
                                                  *arena, &transactions[idx], idx);
     ermia::TXN::xid_context *xc = txn->GetXIDContext();
     xc->begin_epoch = begin_epoch;
@@ -210,7 +210,7 @@ private:
   }
 
   task<rc_t> txn_scan_with_iterator(uint32_t idx, ermia::epoch_num begin_epoch) {
-    ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | ermia::transaction::TXN_FLAG_READ_ONLY,
+    ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | read_only_txn_flags(),
                                                  *arena, &transactions[idx], idx);
     ermia::TXN::xid_context *xc = txn->GetXIDContext();
     xc->begin_epoch = begin_epoch;
@@ -275,7 +275,7 @@ private:
       arena->reset();
     } else {
       values.clear();
-      txn = db->NewTransaction(ermia::transaction::TXN_FLAG_READ_ONLY, *arena, txn_buf());
+      txn = db->NewTransaction(read_only_txn_flags(), *arena, txn_buf());
       for (uint i = 0; i < g_reps_per_tx; ++i) {
         values.push_back(&str(sizeof(ycsb_kv::value)));
       }
@@ -307,6 +307,7 @@ private:
 
 void ycsb_cs_advance_do_test(ermia::Engine *db, int argc, char **argv) {
   ycsb_parse_options(argc, argv);
+  LOG_IF(FATAL, g_hash_index) << "--hash-index is only supported by the sequential YCSB";
   ycsb_bench_runner<ycsb_cs_adv_worker> r(db);
   r.run();
 }
@@ -25,14 +25,19 @@ public:
     // No replication support
     ALWAYS_ASSERT(is_worker);
     workload = get_workload();
-    txn_counts.resize(workload.size());
+    prepare_txn_stats(workload.size());
 
-    if (ermia::config::coro_batch_schedule) {
-      //PipelineScheduler();
+    if (ermia::config::coro_pipeline_schedule) {
+      PipelineScheduler();
+    } else if (ermia::config::coro_batch_schedule) {
       BatchScheduler();
+    } else if (ermia::config::coro_work_stealing) {
+      WorkStealingScheduler();
     } else {
       Scheduler();
     }
+
+    coro_frame_stats = ermia::coro::coroutine_allocator.get_stats();
   }
 
   virtual workload_desc_vec get_workload() const override {
@@ -88,7 +93,7 @@ public:
       arenas[idx].reset();
     } else {
       txn = db->NewTransaction(
-          ermia::transaction::TXN_FLAG_CSWITCH | ermia::transaction::TXN_FLAG_READ_ONLY,
+          ermia::transaction::TXN_FLAG_CSWITCH | read_only_txn_flags(),
           arenas[idx],
           &transactions[idx],
           idx);
@@ -126,7 +131,7 @@ public:
 
 #ifndef CORO_BATCH_COMMIT
     if (!ermia::config::index_probe_only) {
-        TryCatchCoro(db->Commit(txn));
+        TryCatchCoro(co_await db->coro_Commit(txn));
     }
 #endif
     co_return {RC_TRUE};
@@ -186,13 +191,13 @@ public:
       memcpy((char*)(&v) + sizeof(ermia::varstr), (char *)v.data(), v.size());
     }
 #ifndef CORO_BATCH_COMMIT
-    TryCatchCoro(db->Commit(txn));
+    TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
     co_return {RC_TRUE};
   }
 
   ermia::coro::generator<rc_t> txn_scan(uint32_t idx, ermia::epoch_num begin_epoch) {
-    auto *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | ermia::transaction::TXN_FLAG_READ_ONLY,
+    auto *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | read_only_txn_flags(),
                                    arenas[idx], &transactions[idx], idx);
     ermia::TXN::xid_context *xc = txn->GetXIDContext();
     xc->begin_epoch = begin_epoch;
@@ -211,13 +216,13 @@ public:
 #endif
     }
 #ifndef CORO_BATCH_COMMIT
-    TryCatchCoro(db->Commit(txn));
+    TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
     co_return {RC_TRUE};
   }
 
   ermia::coro::generator<rc_t> txn_scan_with_iterator(uint32_t idx, ermia::epoch_num begin_epoch) {
-    auto *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | ermia::transaction::TXN_FLAG_READ_ONLY,
+    auto *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_CSWITCH | read_only_txn_flags(),
                                    arenas[idx], &transactions[idx], idx);
     ermia::TXN::xid_context *xc = txn->GetXIDContext();
     xc->begin_epoch = begin_epoch;
@@ -253,7 +258,7 @@ public:
       ALWAYS_ASSERT(ermia::config::index_probe_only || callback.size() <= g_scan_max_length);
     }
 #ifndef CORO_BATCH_COMMIT
-    TryCatchCoro(db->Commit(txn));
+    TryCatchCoro(co_await db->coro_Commit(txn));
 #endif
     co_return {RC_TRUE};
   }
@@ -261,6 +266,7 @@ public:
 
 void ycsb_cs_do_test(ermia::Engine *db, int argc, char **argv) {
   ycsb_parse_options(argc, argv);
+  LOG_IF(FATAL, g_hash_index) << "--hash-index is only supported by the sequential YCSB";
   ycsb_bench_runner<ycsb_cs_worker> r(db);
   r.run();
 }
@@ -10,6 +10,7 @@ extern uint g_reps_per_tx;
 extern uint g_rmw_additional_reads;
 extern YcsbWorkload ycsb_workload;
 extern ReadTransactionType g_read_txn_type;
+extern WriteTransactionType g_write_txn_type;
 
 class ycsb_sequential_worker : public ycsb_base_worker {
  public:
@@ -22,7 +23,27 @@ class ycsb_sequential_worker : public ycsb_base_worker {
   virtual workload_desc_vec get_workload() const {
     workload_desc_vec w;
     if (ycsb_workload.insert_percent() || ycsb_workload.update_percent()) {
-      LOG(FATAL) << "Not implemented";
+      LOG_IF(FATAL, ermia::config::index_probe_only) << "Not supported";
+    }
+
+    if (ycsb_workload.insert_percent()) {
+      if (g_write_txn_type == WriteTransactionType::AMACMulti) {
+        w.push_back(workload_desc("Insert", double(ycsb_workload.insert_percent()) / 100.0, TxnInsertAMACMulti));
+      } else if (g_write_txn_type == WriteTransactionType::SimpleCoroMulti) {
+        w.push_back(workload_desc("Insert", double(ycsb_workload.insert_percent()) / 100.0, TxnInsertSimpleCoroMulti));
+      } else {
+        w.push_back(workload_desc("Insert", double(ycsb_workload.insert_percent()) / 100.0, TxnInsert));
+      }
+    }
+
+    if (ycsb_workload.update_percent()) {
+      if (g_write_txn_type == WriteTransactionType::AMACMulti) {
+        w.push_back(workload_desc("Update", double(ycsb_workload.update_percent()) / 100.0, TxnUpdateAMACMulti));
+      } else if (g_write_txn_type == WriteTransactionType::SimpleCoroMulti) {
+        w.push_back(workload_desc("Update", double(ycsb_workload.update_percent()) / 100.0, TxnUpdateSimpleCoroMulti));
+      } else {
+        w.push_back(workload_desc("Update", double(ycsb_workload.update_percent()) / 100.0, TxnUpdate));
+      }
     }
 
     if (ycsb_workload.read_percent()) {
@@ -60,6 +81,12 @@ class ycsb_sequential_worker : public ycsb_base_worker {
   static rc_t TxnReadAMACMultiGet(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_read_amac_multiget(); }
   static rc_t TxnReadSimpleCoroMultiGet(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_read_simple_coro_multiget(); }
   static rc_t TxnRMW(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_rmw(); }
+  static rc_t TxnInsert(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_write(true); }
+  static rc_t TxnInsertAMACMulti(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_write_amac_multi(true); }
+  static rc_t TxnInsertSimpleCoroMulti(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_write_simple_coro_multi(true); }
+  static rc_t TxnUpdate(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_write(false); }
+  static rc_t TxnUpdateAMACMulti(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_write_amac_multi(false); }
+  static rc_t TxnUpdateSimpleCoroMulti(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_write_simple_coro_multi(false); }
   static rc_t TxnScan(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_scan(); }
   static rc_t TxnScanWithIterator(bench_worker *w) { return static_cast<ycsb_sequential_worker *>(w)->txn_scan_with_iterator(); }
 
@@ -70,7 +97,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
       // Reset the arena as txn will be nullptr and GenerateKey will get space from it
       arena->reset();
     } else {
-      txn = db->NewTransaction(ermia::transaction::TXN_FLAG_READ_ONLY, *arena, txn_buf());
+      txn = db->NewTransaction(read_only_txn_flags(), *arena, txn_buf());
     }
 
     for (uint i = 0; i < g_reps_per_tx; ++i) {
@@ -78,7 +105,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
       ermia::varstr &v = str((ermia::config::index_probe_only) ? 0 : sizeof(ycsb_kv::value));
       // TODO(tzwang): add read/write_all_fields knobs
       rc_t rc = rc_t{RC_INVALID};
-      table_index->GetRecord(txn, rc, k, v);  // Read
+      usertable->GetRecord(txn, rc, k, v);  // Read
 
 #if defined(SSI) || defined(SSN) || defined(MVOCC)
       TryCatch(rc);  // Might abort if we use SSI/SSN/MVOCC
@@ -104,7 +131,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
       arena->reset();
     } else {
       values.clear();
-      txn = db->NewTransaction(ermia::transaction::TXN_FLAG_READ_ONLY, *arena, txn_buf());
+      txn = db->NewTransaction(read_only_txn_flags(), *arena, txn_buf());
       for (uint i = 0; i < g_reps_per_tx; ++i) {
         values.push_back(&str(sizeof(ycsb_kv::value)));
       }
@@ -140,7 +167,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
       arena->reset();
     } else {
       values.clear();
-      txn = db->NewTransaction(ermia::transaction::TXN_FLAG_READ_ONLY, *arena, txn_buf());
+      txn = db->NewTransaction(read_only_txn_flags(), *arena, txn_buf());
       for (uint i = 0; i < g_reps_per_tx; ++i) {
         values.push_back(&str(sizeof(ycsb_kv::value)));
       }
@@ -167,6 +194,80 @@ class ycsb_sequential_worker : public ycsb_base_worker {
     return {RC_TRUE};
   }
 
+  ermia::varstr &GenerateValue() {
+    ermia::varstr &v = str(sizeof(ycsb_kv::value));
+    new (v.data()) ycsb_kv::value("a");
+    return v;
+  }
+
+  // Insert (new keys) or blind update (existing keys) transaction using
+  // traditional sequential execution
+  rc_t txn_write(bool insert) {
+    ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+    for (uint i = 0; i < g_reps_per_tx; ++i) {
+      ermia::varstr &k = insert ? GenerateNewKey(txn) : GenerateKey(txn);
+      ermia::varstr &v = GenerateValue();
+      if (insert) {
+        TryCatch(usertable->InsertRecord(txn, k, v));
+      } else {
+        TryCatch(usertable->UpdateRecord(txn, k, v));
+      }
+    }
+    TryCatch(db->Commit(txn));
+    return {RC_TRUE};
+  }
+
+  // Multi-insert/update using AMAC
+  rc_t txn_write_amac_multi(bool insert) {
+    ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+    values.clear();
+    for (uint i = 0; i < g_reps_per_tx; ++i) {
+      auto &k = insert ? GenerateNewKey(txn) : GenerateKey(txn);
+      if (as.size() < g_reps_per_tx)
+        as.emplace_back(&k);
+      else
+        as[i].reset(&k);
+      values.push_back(&GenerateValue());
+    }
+
+    rcs.resize(g_reps_per_tx);
+    if (insert) {
+      table_index->amac_MultiInsert(txn, as, values, rcs);
+    } else {
+      table_index->amac_MultiUpdate(txn, as, values, rcs);
+    }
+    for (auto &rc : rcs) {
+      TryCatch(rc);
+    }
+    TryCatch(db->Commit(txn));
+    return {RC_TRUE};
+  }
+
+  // Multi-insert/update using simple coroutine
+  rc_t txn_write_simple_coro_multi(bool insert) {
+    ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
+    keys.clear();
+    values.clear();
+    for (uint i = 0; i < g_reps_per_tx; ++i) {
+      keys.push_back(insert ? &GenerateNewKey(txn) : &GenerateKey(txn));
+      values.push_back(&GenerateValue());
+    }
+
+    rcs.resize(g_reps_per_tx);
+    thread_local std::vector<std::experimental::coroutine_handle<
+        ermia::coro::generator<rc_t>::promise_type>> handles(g_reps_per_tx);
+    if (insert) {
+      table_index->simple_coro_MultiInsert(txn, keys, values, rcs, handles);
+    } else {
+      table_index->simple_coro_MultiUpdate(txn, keys, values, rcs, handles);
+    }
+    for (auto &rc : rcs) {
+      TryCatch(rc);
+    }
+    TryCatch(db->Commit(txn));
+    return {RC_TRUE};
+  }
+
   // Read-modify-write transaction. Sequential execution only
   rc_t txn_rmw() {
     ermia::transaction *txn = db->NewTransaction(0, *arena, txn_buf());
@@ -175,7 +276,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
       ermia::varstr &v = str(sizeof(ycsb_kv::value));
       // TODO(tzwang): add read/write_all_fields knobs
       rc_t rc = rc_t{RC_INVALID};
-      table_index->GetRecord(txn, rc, k, v);  // Read
+      usertable->GetRecord(txn, rc, k, v);  // Read
 
 #if defined(SSI) || defined(SSN) || defined(MVOCC)
       TryCatch(rc);  // Might abort if we use SSI/SSN/MVOCC
@@ -194,7 +295,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
       // copy (in the read op we just did).
       new (&v) ermia::varstr((char *)&v + sizeof(ermia::varstr), sizeof(ycsb_kv::value));
       new (v.data()) ycsb_kv::value("a");
-      TryCatch(table_index->UpdateRecord(txn, k, v));  // Modify-write
+      TryCatch(usertable->UpdateRecord(txn, k, v));  // Modify-write
     }
 
     for (uint i = 0; i < g_rmw_additional_reads; ++i) {
@@ -203,7 +304,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
 
       // TODO(tzwang): add read/write_all_fields knobs
       rc_t rc = rc_t{RC_INVALID};
-      table_index->GetRecord(txn, rc, k, v);  // Read
+      usertable->GetRecord(txn, rc, k, v);  // Read
 
 #if defined(SSI) || defined(SSN) || defined(MVOCC)
       TryCatch(rc);  // Might abort if we use SSI/SSN/MVOCC
@@ -221,7 +322,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
   }
 
   rc_t txn_scan() {
-    ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_READ_ONLY, *arena, txn_buf());
+    ermia::transaction *txn = db->NewTransaction(read_only_txn_flags(), *arena, txn_buf());
     for (uint i = 0; i < g_reps_per_tx; ++i) {
       rc_t rc = rc_t{RC_INVALID};
       ScanRange range = GenerateScanRange(txn);
@@ -240,7 +341,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
   }
 
   rc_t txn_scan_with_iterator() {
-    ermia::transaction *txn = db->NewTransaction(ermia::transaction::TXN_FLAG_READ_ONLY, *arena, txn_buf());
+    ermia::transaction *txn = db->NewTransaction(read_only_txn_flags(), *arena, txn_buf());
     for (uint i = 0; i < g_reps_per_tx; ++i) {
       rc_t rc = rc_t{RC_INVALID};
       ScanRange range = GenerateScanRange(txn);
@@ -286,6 +387,7 @@ class ycsb_sequential_worker : public ycsb_base_worker {
   std::vector<ermia::ConcurrentMasstree::AMACState> as;
   std::vector<ermia::varstr *> keys;
   std::vector<ermia::varstr *> values;
+  std::vector<rc_t> rcs;
 };
 
 void ycsb_do_test(ermia::Engine *db, int argc, char **argv) {
@@ -17,6 +17,18 @@ extern const int g_scan_min_length;
 extern int g_scan_max_length;
 extern int g_scan_length_zipfain_rng;
 extern double g_scan_length_zipfain_theta;
+extern int g_bulk_load;
+
+// --hash-index: USERTABLE's primary index is a ConcurrentHashIndex (point
+// reads, updates and inserts only) instead of Masstree
+extern int g_hash_index;
+
+// --bulk-load: loaders create the records without transactions and leave the
+// key-OID pairs here, each loader in its own (key-ordered) slice, for
+// ycsb_finish_bulk_load() to build the index from. Keys live in one buffer
+// per loader.
+extern std::vector<ermia::OrderedIndex::BulkLoadEntry> g_bulk_load_entries;
+extern std::vector<char *> g_bulk_load_keys;
 
 enum class ReadTransactionType {
   Sequential,
@@ -27,6 +39,12 @@ enum class ReadTransactionType {
   AdvCoro
 };
 
+enum class WriteTransactionType {
+  Sequential,
+  AMACMulti,
+  SimpleCoroMulti
+};
+
 // TODO(tzwang); support other value length specified by user
 #define YCSB_KEY_FIELDS(x, y) x(inline_str_fixed<8>, y_key)
 #define YCSB_VALUE_FIELDS(x, y) x(inline_str_fixed<8>, y_value)
@@ -101,6 +119,7 @@ class ycsb_usertable_loader : public bench_loader {
 };
 
 void ycsb_create_db(ermia::Engine *db);
+void ycsb_finish_bulk_load(ermia::OrderedIndex *tbl);
 void ycsb_parse_options(int argc, char **argv);
 
 template<class WorkerType>
@@ -127,6 +146,11 @@ class ycsb_bench_runner : public bench_runner {
            << g_initial_table_size << std::endl;
     }
 
+    if (g_bulk_load) {
+      g_bulk_load_entries.resize(g_initial_table_size);
+      g_bulk_load_keys.resize(nloaders);
+    }
+
     std::vector<bench_loader *> ret;
     for (uint32_t i = 0; i < nloaders; ++i) {
       ret.push_back(new ycsb_usertable_loader(0, db, open_tables, i));
@@ -134,6 +158,12 @@ class ycsb_bench_runner : public bench_runner {
     return ret;
   }
 
+  virtual void finish_load() {
+    if (g_bulk_load) {
+      ycsb_finish_bulk_load(open_tables.at("USERTABLE"));
+    }
+  }
+
   virtual std::vector<bench_worker *> make_cmdlog_redoers() {
     // Not implemented
     LOG(FATAL) << "Not applicable";
@@ -159,7 +189,9 @@ class ycsb_base_worker : public bench_worker {
                    const std::map<std::string, ermia::OrderedIndex *> &open_tables,
                    spin_barrier *barrier_a, spin_barrier *barrier_b)
       : bench_worker(worker_id, true, seed, db, open_tables, barrier_a, barrier_b),
-        table_index((ermia::ConcurrentMasstreeIndex*)open_tables.at("USERTABLE")) {
+        usertable(open_tables.at("USERTABLE")),
+        table_index(g_hash_index ? nullptr : (ermia::ConcurrentMasstreeIndex*)usertable),
+        inserted_keys(0) {
       const unsigned int key_rng_seed = 1237 + worker_id;
       uniform_rng = foedus::assorted::UniformRandom(key_rng_seed);
       if (g_zipfian_rng) {
@@ -180,6 +212,29 @@ class ycsb_base_worker : public bench_worker {
     LOG(FATAL) << "Not applicable";
   }
 
+  // Keys and scan lengths come from the foedus generators
+  virtual void seed_txn_inputs(uint64_t seed, uint32_t home) override {
+    bench_worker::seed_txn_inputs(seed, home);
+    uniform_rng.set_current_seed(r.next());
+    zipfian_rng.set_current_seed(r.next());
+    scan_length_uniform_rng.set_current_seed(r.next());
+    scan_length_zipfian_rng.set_current_seed(r.next());
+  }
+  virtual void save_txn_inputs(txn_inputs &in) override {
+    bench_worker::save_txn_inputs(in);
+    in.seeds[1] = uniform_rng.get_current_seed();
+    in.seeds[2] = zipfian_rng.get_current_seed();
+    in.seeds[3] = scan_length_uniform_rng.get_current_seed();
+    in.seeds[4] = scan_length_zipfian_rng.get_current_seed();
+  }
+  virtual void load_txn_inputs(const txn_inputs &in) override {
+    bench_worker::load_txn_inputs(in);
+    uniform_rng.set_current_seed(in.seeds[1]);
+    zipfian_rng.set_current_seed(in.seeds[2]);
+    scan_length_uniform_rng.set_current_seed(in.seeds[3]);
+    scan_length_zipfian_rng.set_current_seed(in.seeds[4]);
+  }
+
  protected:
   struct KeyCompare : public std::unary_function<ermia::varstr, bool> {
     explicit KeyCompare(ermia::varstr &baseline) : baseline(baseline) {}
@@ -213,6 +268,15 @@ class ycsb_base_worker : public bench_worker {
     return r;
   }
 
+  // A key that is not in the table yet: beyond the initially loaded ones,
+  // interleaved among workers
+  ermia::varstr &GenerateNewKey(ermia::transaction *t) {
+    ermia::varstr &k = t ? *t->string_allocator().next(sizeof(ycsb_kv::key)) : str(sizeof(ycsb_kv::key));
+    new (&k) ermia::varstr((char *)&k + sizeof(ermia::varstr), sizeof(ycsb_kv::key));
+    ::BuildKey(g_initial_table_size + worker_id + ermia::config::worker_threads * inserted_keys++, k);
+    return k;
+  }
+
   ermia::varstr &GenerateKey(ermia::transaction *t) {
     ermia::varstr &k = t ? *t->string_allocator().next(sizeof(ycsb_kv::key)) : str(sizeof(ycsb_kv::key));
     new (&k) ermia::varstr((char *)&k + sizeof(ermia::varstr), sizeof(ycsb_kv::key));
@@ -239,7 +303,11 @@ class ycsb_base_worker : public bench_worker {
   }
   
 
+  // Either index type; table_index is only set (and only used by the
+  // Masstree-specific multi-get/scan/coroutine paths) without --hash-index
+  ermia::OrderedIndex *usertable;
   ermia::ConcurrentMasstreeIndex *table_index;
+  uint64_t inserted_keys;
   foedus::assorted::UniformRandom uniform_rng;
   foedus::assorted::ZipfianRandom zipfian_rng;
   foedus::assorted::UniformRandom scan_length_uniform_rng;
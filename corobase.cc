@@ -1,6 +1,8 @@
 #include "dbcore/rcu.h"
 #include "dbcore/sm-chkpt.h"
 #include "dbcore/sm-cmd-log.h"
+#include "dbcore/sm-evict.h"
+#include "dbcore/sm-gc.h"
 #include "dbcore/sm-rep.h"
 
 #include "ermia.h"
@@ -267,6 +269,23 @@ forward:
     oid_array *oa = table_descriptor->GetTupleArray();
     TXN::xid_context *visitor_xc = t->xc;
     fat_ptr *entry = oa->get(oid);
+
+    // A hit in the version cache saves walking the chain
+    VersionCache *cache = table_descriptor->GetVersionCache();
+    if (cache) {
+      VersionCache::Slot *slot = cache->PeekSlot(oid);
+      if (slot) {
+        ::prefetch((const char *)slot);
+        co_await std::experimental::suspend_always{};
+        if (cache->Lookup(oid, visitor_xc->begin, t->string_allocator(), &value)) {
+          if (out_oid) {
+            *out_oid = oid;
+          }
+          co_return {RC_TRUE};
+        }
+      }
+    }
+    uint32_t hops = 0;
 start_over:
     ::prefetch((const char*)entry);
     co_await std::experimental::suspend_always{};
@@ -362,12 +381,29 @@ start_over:
       if (out_oid) {
         *out_oid = oid;
       }
+      if (cache) {
+        cache->Fill(oid, entry, cur_obj);
+      }
+      record_version_hops(hops);
+      if (cur_obj->IsEvicted()) {
+        // Read-ahead hint, then let the others run; DoTupleRead reads the log
+        evict::Prefetch(cur_obj);
+        co_await std::experimental::suspend_always{};
+      }
       co_return t->DoTupleRead(cur_obj->GetPinnedTuple(), &value);
 
     handle_invisible:
       ptr = tentative_next;
       prev_obj = cur_obj;
+      if (ptr.offset()) {
+        // Older versions are likely cold; let the rest of the batch run
+        // while this one is fetched
+        Object::PrefetchHeader((Object *)ptr.offset());
+        co_await std::experimental::suspend_always{};
+        ++hops;
+      }
     }
+    record_version_hops(hops);
   }
   co_return {RC_FALSE};
 }
@@ -472,6 +508,23 @@ forward:
     oid_array *oa = table_descriptor->GetTupleArray();
     TXN::xid_context *visitor_xc = t->xc;
     fat_ptr *entry = oa->get(oid);
+
+    // A hit in the version cache saves walking the chain
+    VersionCache *cache = table_descriptor->GetVersionCache();
+    if (cache) {
+      VersionCache::Slot *slot = cache->PeekSlot(oid);
+      if (slot) {
+        ::prefetch((const char *)slot);
+        co_await std::experimental::suspend_always{};
+        if (cache->Lookup(oid, visitor_xc->begin, t->string_allocator(), &value)) {
+          if (out_oid) {
+            *out_oid = oid;
+          }
+          co_return {RC_TRUE};
+        }
+      }
+    }
+    uint32_t hops = 0;
 start_over:
     ::prefetch((const char*)entry);
     co_await std::experimental::suspend_always{};
@@ -566,12 +619,29 @@ start_over:
       if (out_oid) {
         *out_oid = oid;
       }
+      if (cache) {
+        cache->Fill(oid, entry, cur_obj);
+      }
+      record_version_hops(hops);
+      if (cur_obj->IsEvicted()) {
+        // Read-ahead hint, then let the others run; DoTupleRead reads the log
+        evict::Prefetch(cur_obj);
+        co_await std::experimental::suspend_always{};
+      }
       co_return t->DoTupleRead(cur_obj->GetPinnedTuple(), &value);
 
     handle_invisible:
       ptr = tentative_next;
       prev_obj = cur_obj;
+      if (ptr.offset()) {
+        // Older versions are likely cold; let the rest of the batch run
+        // while this one is fetched
+        Object::PrefetchHeader((Object *)ptr.offset());
+        co_await std::experimental::suspend_always{};
+        ++hops;
+      }
     }
+    record_version_hops(hops);
   }
   co_return {RC_FALSE};
 }
@@ -773,7 +843,9 @@ forward:
     // Note for this to be correct we shouldn't allow multiple txs
     // working on the same tuple at the same time.
 
-    new_obj_ptr = Object::Create(&value, false, t->xc->begin_epoch);
+    new_obj_ptr = Object::CreateVersion(
+        &value, overwrite ? (Object *)old_desc->GetNextVolatile().offset() : old_desc,
+        t->xc->begin_epoch);
     ASSERT(new_obj_ptr.asi_type() == 0);
     new_object = (Object *)new_obj_ptr.offset();
     new_object->SetClsn(t->xc->owner.to_ptr());
@@ -796,9 +868,7 @@ forward:
                                        new_obj_ptr._ptr)) {
         // Succeeded installing a new version, now only I can modify the
         // chain, try recycle some objects
-        if (config::enable_gc) {
-          MM::gc_version_chain(ptr);
-        }
+        MM::version_chain_updated(ptr);
         prev_obj_ptr = head;
         goto check_prev;
       } else {
@@ -810,6 +880,9 @@ forward:
   check_prev:
     Object *prev_obj = (Object *)prev_obj_ptr.offset();
     if (prev_obj) {  // succeeded
+      if (table_descriptor->GetVersionCache()) {
+        table_descriptor->GetVersionCache()->Invalidate(oid);
+      }
       Object::PrefetchHeader(prev_obj);
       co_await std::experimental::suspend_always{};
       dbtuple *tuple = ((Object *)new_obj_ptr.offset())->GetPinnedTuple();
@@ -1421,6 +1494,7 @@ ermia::coro::generator<rc_t> ConcurrentMasstreeIndex::coro_Scan(transaction *t,
       // oid_get_version:
       {
         fat_ptr *oid_entry = table_descriptor->GetTupleArray()->get(entry.value());
+        uint32_t hops = 0;
       get_version_start_over:
         ::prefetch((const char*)oid_entry);
         co_await std::experimental::suspend_always{};
@@ -1449,6 +1523,7 @@ ermia::coro::generator<rc_t> ConcurrentMasstreeIndex::coro_Scan(transaction *t,
             goto get_version_start_over;
           }
           if (visible) {
+            record_version_hops(hops);
             if (!scanner.visit_value(ka, cur_obj->GetPinnedTuple())) {
               goto done;
             }
@@ -1456,6 +1531,13 @@ ermia::coro::generator<rc_t> ConcurrentMasstreeIndex::coro_Scan(transaction *t,
           }
           ptr = tentative_next;
           prev_obj = cur_obj;
+          if (ptr.offset()) {
+            Object::PrefetchHeader((Object *)ptr.offset());
+            co_await std::experimental::suspend_always{};
+            ++hops;
+          } else {
+            record_version_hops(hops);
+          }
         }
       }  // oid_get_version
 
@@ -1622,11 +1704,237 @@ void ConcurrentMasstreeIndex::simple_coro_MultiOps(std::vector<rc_t> &rcs,
           handles[i].destroy();
           handles[i] = nullptr;
         } else {
-          handles[i].resume();
+          handles[i].promise().resume_leaf();
+        }
+      }
+    }
+  }
+}
+
+void ConcurrentMasstreeIndex::amac_MultiInsert(
+    transaction *t, std::vector<ConcurrentMasstree::AMACState> &requests,
+    std::vector<varstr *> &values, std::vector<rc_t> &rcs) {
+  // For primary index only
+  ALWAYS_ASSERT(IsPrimary());
+  t->ensure_active();
+
+  // Probe first: this brings the target leaves into cache for the inserts
+  // below, and keys that already exist fail without creating a tuple
+  masstree_.search_amac(requests, t->xc->begin_epoch);
+  for (uint32_t i = 0; i < requests.size(); ++i) {
+    if (requests[i].out_oid != INVALID_OID) {
+      rcs[i] = rc_t{RC_ABORT_INTERNAL};
+    } else {
+      rcs[i] = InsertRecord(t, *requests[i].key, *values[i]);
+    }
+  }
+}
+
+void ConcurrentMasstreeIndex::amac_MultiUpdate(
+    transaction *t, std::vector<ConcurrentMasstree::AMACState> &requests,
+    std::vector<varstr *> &values, std::vector<rc_t> &rcs) {
+  // For primary index only
+  ALWAYS_ASSERT(IsPrimary());
+  t->ensure_active();
+
+  masstree_.search_amac(requests, t->xc->begin_epoch);
+
+  // Also get the OID entries (version chain heads) going before updating
+  oid_array *tuple_array = table_descriptor->GetTupleArray();
+  for (auto &r : requests) {
+    if (r.out_oid != INVALID_OID) {
+      ::prefetch((const char *)tuple_array->get(r.out_oid));
+    }
+  }
+
+  for (uint32_t i = 0; i < requests.size(); ++i) {
+    auto &r = requests[i];
+    if (r.out_oid != INVALID_OID) {
+      rcs[i] = t->Update(table_descriptor, r.out_oid, r.key, values[i]);
+    } else {
+      rcs[i] = rc_t{RC_ABORT_INTERNAL};
+    }
+  }
+}
+
+void ConcurrentMasstreeIndex::simple_coro_MultiInsert(
+    transaction *t, std::vector<varstr *> &keys, std::vector<varstr *> &values,
+    std::vector<rc_t> &rcs,
+    std::vector<std::experimental::coroutine_handle<ermia::coro::generator<rc_t>::promise_type>> &handles) {
+  for (uint32_t i = 0; i < keys.size(); ++i) {
+    handles[i] = coro_InsertRecord(t, *keys[i], *values[i]).get_handle();
+  }
+  simple_coro_MultiOps(rcs, handles);
+}
+
+void ConcurrentMasstreeIndex::simple_coro_MultiUpdate(
+    transaction *t, std::vector<varstr *> &keys, std::vector<varstr *> &values,
+    std::vector<rc_t> &rcs,
+    std::vector<std::experimental::coroutine_handle<ermia::coro::generator<rc_t>::promise_type>> &handles) {
+  for (uint32_t i = 0; i < keys.size(); ++i) {
+    handles[i] = coro_UpdateRecord(t, *keys[i], *values[i]).get_handle();
+  }
+  simple_coro_MultiOps(rcs, handles);
+}
+
+void ConcurrentHashIndex::amac_MultiGet(
+    transaction *t, std::vector<ConcurrentHashTable::AMACState> &requests,
+    std::vector<varstr *> &values) {
+  table_.search_amac(requests);
+  if (!t) {
+    return;
+  }
+
+  t->ensure_active();
+  if (config::is_backup_srv()) {
+    for (uint32_t i = 0; i < requests.size(); ++i) {
+      auto &r = requests[i];
+      if (r.out_oid != INVALID_OID) {
+        auto *tuple = oidmgr->BackupGetVersion(
+            table_descriptor->GetTupleArray(),
+            table_descriptor->GetPersistentAddressArray(), r.out_oid, t->xc);
+        if (tuple) {
+          t->DoTupleRead(tuple, values[i]);
         }
       }
     }
+  } else if (!config::index_probe_only) {
+    if (config::amac_version_chain) {
+      // AMAC style version chain traversal; only probe the keys we found
+      thread_local std::vector<OIDAMACState> version_requests;
+      thread_local std::vector<uint32_t> version_request_idx;
+      version_requests.clear();
+      version_request_idx.clear();
+      for (uint32_t i = 0; i < requests.size(); ++i) {
+        if (requests[i].out_oid != INVALID_OID) {
+          version_requests.emplace_back(requests[i].out_oid);
+          version_request_idx.push_back(i);
+        }
+      }
+      oidmgr->oid_get_version_amac(table_descriptor->GetTupleArray(),
+                                   version_requests, t->xc);
+      for (uint32_t i = 0; i < version_requests.size(); ++i) {
+        if (version_requests[i].tuple) {
+          t->DoTupleRead(version_requests[i].tuple, values[version_request_idx[i]]);
+        }
+      }
+    } else {
+      for (uint32_t i = 0; i < requests.size(); ++i) {
+        auto &r = requests[i];
+        if (r.out_oid != INVALID_OID) {
+          auto *tuple = oidmgr->oid_get_version(table_descriptor->GetTupleArray(),
+                                                r.out_oid, t->xc);
+          if (tuple) {
+            t->DoTupleRead(tuple, values[i]);
+          }
+        }
+      }
+    }
+  }
+}
+
+void ConcurrentHashIndex::simple_coro_MultiGet(
+    transaction *t, std::vector<varstr *> &keys, std::vector<varstr *> &values,
+    std::vector<std::experimental::coroutine_handle<>> &handles) {
+  if (!t) {
+    // Nothing to interleave without version chains: batch the probes
+    thread_local std::vector<ConcurrentHashTable::AMACState> requests;
+    requests.clear();
+    for (auto *k : keys) {
+      requests.emplace_back(k);
+    }
+    table_.search_amac(requests);
+    return;
+  }
+
+  for (int i = 0; i < keys.size(); ++i) {
+    handles[i] = coro_GetRecord(t, *keys[i], *values[i]).get_handle();
+  }
+
+  int finished = 0;
+  while (finished < handles.size()) {
+    for (auto &h : handles) {
+      if (h) {
+        if (h.done()) {
+          ++finished;
+          h.destroy();
+          h = nullptr;
+        } else {
+          h.resume();
+        }
+      }
+    }
+  }
+}
+
+ermia::coro::generator<rc_t> ConcurrentHashIndex::coro_GetRecord(transaction *t, const varstr &key,
+                                                                varstr &value, OID *out_oid) {
+  OID oid = INVALID_OID;
+  t->ensure_active();
+
+// start: hash probe
+  uint64_t hash = ConcurrentHashTable::Hash((const char *)key.data(), key.size());
+  const ConcurrentHashTable::Bucket *b = table_.GetBucket(hash);
+  bool found = false;
+  while (b && !found) {
+    ::prefetch((const char *)b);
+    co_await std::experimental::suspend_always{};
+    for (uint32_t i = 0; i < ConcurrentHashTable::kSlotsPerBucket; ++i) {
+      uint64_t s = b->slots[i].load(std::memory_order_acquire);
+      if (!s) {
+        // Empty slots only trail a chain
+        co_return {RC_FALSE};
+      }
+      if (ConcurrentHashTable::TagMatches(s, hash)) {
+        ConcurrentHashTable::Entry *e = ConcurrentHashTable::SlotEntry(s);
+        ::prefetch((const char *)e);
+        co_await std::experimental::suspend_always{};
+        if (ConcurrentHashTable::KeyMatches(e, hash, key)) {
+          oid = e->oid;
+          found = true;
+          break;
+        }
+      }
+    }
+    if (!found) {
+      b = b->next.load(std::memory_order_acquire);
+    }
+  }
+  if (!found) {
+    co_return {RC_FALSE};
+  }
+// end: hash probe
+
+  if (out_oid) {
+    *out_oid = oid;
+  }
+
+  VersionCache *cache = table_descriptor->GetVersionCache();
+  VersionCache::Slot *slot = cache ? cache->PeekSlot(oid) : nullptr;
+  if (slot) {
+    ::prefetch((const char *)slot);
+    co_await std::experimental::suspend_always{};
+    if (cache->Lookup(oid, t->xc->begin, t->string_allocator(), &value)) {
+      co_return {RC_TRUE};
+    }
+  }
+
+  oid_array *oa = table_descriptor->GetTupleArray();
+  ::prefetch((const char *)oa->get(oid));
+  co_await std::experimental::suspend_always{};
+
+  dbtuple *tuple = oidmgr->oid_get_version(oa, oid, t->xc);
+  if (!tuple) {
+    co_return {RC_FALSE};
+  }
+  if (cache) {
+    cache->Fill(oid, oa->get(oid), tuple->GetObject());
+  }
+  if (tuple->GetObject()->IsEvicted()) {
+    evict::Prefetch(tuple->GetObject());
+    co_await std::experimental::suspend_always{};
   }
+  co_return t->DoTupleRead(tuple, &value);
 }
 #endif
 } // namespace ermia
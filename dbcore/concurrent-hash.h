@@ -0,0 +1,347 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <numa.h>
+
+#include "../macros.h"
+#include "../masstree/compiler.hh"
+#include "../varstr.h"
+#include "sm-common.h"
+
+namespace ermia {
+
+/*
+ * A lock-free, insert-only hash table mapping keys to OIDs, for primary
+ * indexes that only ever see point accesses.
+ *
+ * The table is an array of cache line-sized buckets. Each bucket holds
+ * kSlotsPerBucket slots and a pointer to an overflow bucket. A slot is one
+ * word: the high 16 bits are a tag taken from the key's hash and the low 48
+ * bits point to an Entry that holds the OID and a copy of the key. A probe
+ * thus touches one cache line per bucket and only dereferences entries whose
+ * tag matches - the two memory accesses the AMAC and coroutine probes
+ * prefetch and interleave.
+ *
+ * An insert claims the first empty slot along the bucket chain with a CAS,
+ * appending an overflow bucket when the chain is full. Key-OID mappings are
+ * never removed (removing a record installs a tombstone version instead), so a
+ * slot never goes back to empty and the empty slots of a chain always form a
+ * suffix. This gives uniqueness without locks: two racing inserts of the same
+ * key walk the same chain in the same order, and the one losing a CAS checks
+ * the winner's entry before moving on. Lookups can stop at the first empty
+ * slot.
+ *
+ * The number of buckets is fixed at construction; overflow chains absorb
+ * growth beyond it at the cost of longer probes.
+ */
+class ConcurrentHashTable {
+public:
+  static const uint32_t kSlotsPerBucket = 7;
+  static const uint64_t kMinBuckets = 1024;
+  static const uint32_t kTagShift = 48;
+  static const uint64_t kPointerMask = (uint64_t{1} << kTagShift) - 1;
+
+  struct Entry {
+    uint64_t hash;
+    OID oid;
+    uint32_t size;
+    char data[0];
+  };
+
+  struct Bucket {
+    std::atomic<uint64_t> slots[kSlotsPerBucket];
+    std::atomic<Bucket *> next;
+  } CACHE_ALIGNED;
+  static_assert(sizeof(Bucket) == CACHELINE_SIZE, "Bucket must be one cache line");
+
+  // Per-request state of a batched (AMAC) probe
+  struct AMACState {
+    OID out_oid;
+    const varstr *key;
+
+    uint64_t stage;
+    uint64_t hash;
+    const Bucket *bucket;
+    uint32_t slot;  // Next slot in [bucket] to look at
+
+    static const uint64_t kInvalidStage = ~uint64_t{0};
+
+    AMACState(const varstr *key)
+    : out_oid(INVALID_OID)
+    , key(key)
+    , stage(0)
+    , hash(0)
+    , bucket(nullptr)
+    , slot(0)
+    {}
+
+    void reset(const varstr *new_key) {
+      out_oid = INVALID_OID;
+      key = new_key;
+      stage = 0;
+      hash = 0;
+      bucket = nullptr;
+      slot = 0;
+    }
+  };
+
+  // [expected_keys] sizes the bucket array for ~4 keys per bucket
+  ConcurrentHashTable(uint64_t expected_keys = 0) {
+    nbuckets_ = kMinBuckets;
+    while (nbuckets_ * 4 < expected_keys) {
+      nbuckets_ <<= 1;
+    }
+    // Probes come from all threads: spread the buckets over all nodes.
+    // numa_alloc_* returns zeroed, page-aligned memory.
+    buckets_ = (Bucket *)numa_alloc_interleaved(nbuckets_ * sizeof(Bucket));
+    ALWAYS_ASSERT(buckets_);
+  }
+
+  ~ConcurrentHashTable() {
+    clear();
+    numa_free(buckets_, nbuckets_ * sizeof(Bucket));
+  }
+
+  // FNV-1a over 8-byte words, finished with the murmur3 mixer so both the
+  // low (bucket) and high (tag) bits are usable
+  static inline uint64_t Hash(const char *data, uint32_t size) {
+    static const uint64_t kPrime = 0x100000001b3ull;
+    uint64_t h = 0xcbf29ce484222325ull ^ size;
+    while (size >= 8) {
+      uint64_t w;
+      memcpy(&w, data, 8);
+      h = (h ^ w) * kPrime;
+      data += 8;
+      size -= 8;
+    }
+    if (size) {
+      uint64_t w = 0;
+      memcpy(&w, data, size);
+      h = (h ^ w) * kPrime;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+  }
+
+  inline const Bucket *GetBucket(uint64_t hash) const {
+    return &buckets_[hash & (nbuckets_ - 1)];
+  }
+
+  static inline Entry *SlotEntry(uint64_t slot) {
+    return (Entry *)(slot & kPointerMask);
+  }
+
+  // Cheap filter on the slot word alone, doesn't touch the entry
+  static inline bool TagMatches(uint64_t slot, uint64_t hash) {
+    return (slot >> kTagShift) == (hash >> kTagShift);
+  }
+
+  static inline bool KeyMatches(const Entry *e, uint64_t hash, const varstr &key) {
+    return e->hash == hash && e->size == key.size() &&
+           memcmp(e->data, key.data(), key.size()) == 0;
+  }
+
+  inline bool search(const varstr &key, OID &out_oid) const {
+    uint64_t hash = Hash((const char *)key.data(), key.size());
+    const Bucket *b = GetBucket(hash);
+    while (b) {
+      for (uint32_t i = 0; i < kSlotsPerBucket; ++i) {
+        uint64_t s = b->slots[i].load(std::memory_order_acquire);
+        if (!s) {
+          return false;
+        }
+        if (TagMatches(s, hash) && KeyMatches(SlotEntry(s), hash, key)) {
+          out_oid = SlotEntry(s)->oid;
+          return true;
+        }
+      }
+      b = b->next.load(std::memory_order_acquire);
+    }
+    return false;
+  }
+
+  // Returns false if [key] is already mapped
+  bool insert_if_absent(const varstr &key, OID oid) {
+    uint64_t hash = Hash((const char *)key.data(), key.size());
+    Bucket *b = &buckets_[hash & (nbuckets_ - 1)];
+    Entry *entry = nullptr;
+    while (true) {
+      for (uint32_t i = 0; i < kSlotsPerBucket; ++i) {
+        uint64_t s = b->slots[i].load(std::memory_order_acquire);
+        if (!s) {
+          if (!entry) {
+            entry = NewEntry(hash, key, oid);
+          }
+          uint64_t desired = (hash >> kTagShift << kTagShift) | (uint64_t)entry;
+          if (b->slots[i].compare_exchange_strong(s, desired, std::memory_order_acq_rel)) {
+            return true;
+          }
+          // Lost the slot, [s] now has the winner; it might be our key
+        }
+        if (TagMatches(s, hash) && KeyMatches(SlotEntry(s), hash, key)) {
+          free(entry);
+          return false;
+        }
+      }
+      Bucket *next = b->next.load(std::memory_order_acquire);
+      if (!next) {
+        Bucket *nb = NewBucket();
+        if (b->next.compare_exchange_strong(next, nb, std::memory_order_acq_rel)) {
+          next = nb;
+        } else {
+          free(nb);
+        }
+      }
+      b = next;
+    }
+  }
+
+  // Probe a batch of keys, interleaving the bucket and entry accesses of
+  // different requests: each stage issues a prefetch and moves on to the
+  // next request instead of waiting for the cache miss.
+  //
+  // Stages: 0 - hash and prefetch the bucket; 1 - scan bucket slots, prefetch
+  // the entry of a tag match or the overflow bucket; 2 - compare the key.
+  void search_amac(std::vector<AMACState> &states) const {
+    uint32_t todo = states.size();
+    while (todo) {
+      for (auto &s : states) {
+        switch (s.stage) {
+        case AMACState::kInvalidStage:
+          break;
+        case 0:
+          s.hash = Hash((const char *)s.key->data(), s.key->size());
+          s.bucket = GetBucket(s.hash);
+          s.slot = 0;
+          ::prefetch((const char *)s.bucket);
+          s.stage = 1;
+          break;
+        case 2: {
+          uint64_t slot = s.bucket->slots[s.slot - 1].load(std::memory_order_acquire);
+          Entry *e = SlotEntry(slot);
+          if (KeyMatches(e, s.hash, *s.key)) {
+            s.out_oid = e->oid;
+            s.stage = AMACState::kInvalidStage;
+            --todo;
+            break;
+          }
+          s.stage = 1;
+        }
+        // fall through: keep scanning the (cached) bucket
+        case 1:
+          while (true) {
+            if (s.slot == kSlotsPerBucket) {
+              s.bucket = s.bucket->next.load(std::memory_order_acquire);
+              s.slot = 0;
+              if (s.bucket) {
+                ::prefetch((const char *)s.bucket);
+              } else {
+                s.stage = AMACState::kInvalidStage;
+                --todo;
+              }
+              break;
+            }
+            uint64_t slot = s.bucket->slots[s.slot++].load(std::memory_order_acquire);
+            if (!slot) {
+              s.stage = AMACState::kInvalidStage;
+              --todo;
+              break;
+            }
+            if (TagMatches(slot, s.hash)) {
+              ::prefetch((const char *)SlotEntry(slot));
+              s.stage = 2;
+              break;
+            }
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  // Number of keys; walks the whole table
+  size_t size() const {
+    size_t n = 0;
+    for (uint64_t i = 0; i < nbuckets_; ++i) {
+      for (const Bucket *b = &buckets_[i]; b; b = b->next.load(std::memory_order_acquire)) {
+        for (uint32_t j = 0; j < kSlotsPerBucket; ++j) {
+          n += (b->slots[j].load(std::memory_order_acquire) != 0);
+        }
+      }
+    }
+    return n;
+  }
+
+  // Bytes taken by buckets and entries; walks the whole table
+  size_t memory_size() const {
+    size_t bytes = nbuckets_ * sizeof(Bucket);
+    for (uint64_t i = 0; i < nbuckets_; ++i) {
+      for (const Bucket *b = &buckets_[i]; b; b = b->next.load(std::memory_order_acquire)) {
+        if (b != &buckets_[i]) {
+          bytes += sizeof(Bucket);
+        }
+        for (uint32_t j = 0; j < kSlotsPerBucket; ++j) {
+          if (Entry *e = SlotEntry(b->slots[j].load(std::memory_order_acquire))) {
+            bytes += sizeof(Entry) + e->size;
+          }
+        }
+      }
+    }
+    return bytes;
+  }
+
+  // Drop all keys. Not thread-safe: no one else may use the table meanwhile.
+  void clear() {
+    for (uint64_t i = 0; i < nbuckets_; ++i) {
+      Bucket *b = &buckets_[i];
+      Bucket *overflow = b->next.load(std::memory_order_relaxed);
+      FreeEntries(b);
+      b->next.store(nullptr, std::memory_order_relaxed);
+      while (overflow) {
+        Bucket *next = overflow->next.load(std::memory_order_relaxed);
+        FreeEntries(overflow);
+        free(overflow);
+        overflow = next;
+      }
+    }
+  }
+
+private:
+  Bucket *buckets_;
+  uint64_t nbuckets_;
+
+  static Entry *NewEntry(uint64_t hash, const varstr &key, OID oid) {
+    Entry *e = (Entry *)malloc(sizeof(Entry) + key.size());
+    ALWAYS_ASSERT(e);
+    ASSERT(((uint64_t)e & ~kPointerMask) == 0);
+    e->hash = hash;
+    e->oid = oid;
+    e->size = key.size();
+    memcpy(e->data, key.data(), key.size());
+    return e;
+  }
+
+  static Bucket *NewBucket() {
+    void *p = nullptr;
+    ALWAYS_ASSERT(posix_memalign(&p, CACHELINE_SIZE, sizeof(Bucket)) == 0);
+    memset(p, 0, sizeof(Bucket));
+    return (Bucket *)p;
+  }
+
+  static void FreeEntries(Bucket *b) {
+    for (uint32_t j = 0; j < kSlotsPerBucket; ++j) {
+      free(SlotEntry(b->slots[j].load(std::memory_order_relaxed)));
+      b->slots[j].store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+}  // namespace ermia
@@ -8,6 +8,7 @@
 #include "sm-alloc.h"
 #include "sm-chkpt.h"
 #include "sm-common.h"
+#include "sm-coroutine.h"
 #include "sm-object.h"
 #include "../txn.h"
 
@@ -51,6 +52,10 @@ epoch_mgr mm_epochs{{nullptr, &global_init, &get_tls, &thread_registered,
 uint64_t safesnap_lsn = 0;
 
 thread_local TlsFreeObjectPool *tls_free_object_pool CACHE_ALIGNED;
+NodeFreeObjectDepot *node_free_object_depots = nullptr;
+// Every thread's pool, for get_free_pool_stats(); pools are never freed
+static std::vector<TlsFreeObjectPool *> all_free_object_pools;
+static mcs_lock all_free_object_pools_lock;
 char **node_memory = nullptr;
 uint64_t *allocated_node_memory = nullptr;
 static uint64_t thread_local tls_allocated_node_memory CACHE_ALIGNED;
@@ -65,6 +70,7 @@ void prepare_node_memory() {
   allocated_node_memory =
       (uint64_t *)malloc(sizeof(uint64_t) * config::numa_nodes);
   node_memory = (char **)malloc(sizeof(char *) * config::numa_nodes);
+  node_free_object_depots = new NodeFreeObjectDepot[config::numa_nodes];
   std::vector<std::future<void> > futures;
   LOG(INFO) << "Will run and allocate on " << config::numa_nodes << " nodes, "
             << config::node_memory_gb << "GB each";
@@ -87,14 +93,53 @@ void prepare_node_memory() {
   for (auto &f : futures) {
     f.get();
   }
+
+  // Coroutine frames come from the same huge pages from now on
+  coro::tcalloc::set_chunk_source(&allocate_onnode);
+}
+
+void TlsFreeObjectPool::HandOff(FreeObjectList &list, uint16_t size_code) {
+  if (!depot_) {
+    return;
+  }
+  auto &slot = depot_->slots[size_code];
+  CRITICAL_SECTION(cs, slot.lock);
+  slot.list.splice(list);
+}
+
+bool TlsFreeObjectPool::Refill(FreeObjectList &list, uint16_t size_code) {
+  if (!depot_) {
+    return false;
+  }
+  auto &slot = depot_->slots[size_code];
+  // Peek first so threads with nothing to take don't bounce the lock around
+  if (!volatile_read(slot.list.head)) {
+    return false;
+  }
+  CRITICAL_SECTION(cs, slot.lock);
+  list.splice(slot.list);
+  return !list.empty();
+}
+
+static inline TlsFreeObjectPool *get_tls_free_object_pool() {
+  if (unlikely(!tls_free_object_pool)) {
+    NodeFreeObjectDepot *depot = nullptr;
+    if (node_free_object_depots) {
+      depot = &node_free_object_depots[numa_node_of_cpu(sched_getcpu())];
+    }
+    tls_free_object_pool = new TlsFreeObjectPool(depot);
+    CRITICAL_SECTION(cs, all_free_object_pools_lock);
+    all_free_object_pools.push_back(tls_free_object_pool);
+  }
+  return tls_free_object_pool;
 }
 
-void gc_version_chain(fat_ptr *oid_entry) {
-  fat_ptr ptr = *oid_entry;
+uint32_t gc_version_chain(fat_ptr *oid_entry) {
+  fat_ptr ptr = volatile_read(*oid_entry);
   Object *cur_obj = (Object *)ptr.offset();
   if (!cur_obj) {
     // Tuple is deleted, skip
-    return;
+    return 0;
   }
 
   // Start from the first **committed** version, and delete after its next,
@@ -103,13 +148,22 @@ void gc_version_chain(fat_ptr *oid_entry) {
   // well - not even in memory.
   auto clsn = cur_obj->GetClsn();
   fat_ptr *prev_next = nullptr;
+  uint32_t length = 1;
   if (clsn.asi_type() == fat_ptr::ASI_CHK) {
-    return;
+    return 0;
   }
   if (clsn.asi_type() != fat_ptr::ASI_LOG) {
-    DCHECK(clsn.asi_type() == fat_ptr::ASI_XID);
+    // A background GC thread might find the head already gone (its
+    // transaction aborted)
+    if (clsn.asi_type() != fat_ptr::ASI_XID) {
+      return 0;
+    }
     ptr = cur_obj->GetNextVolatile();
     cur_obj = (Object *)ptr.offset();
+    if (!cur_obj) {
+      return 0;
+    }
+    ++length;
   }
 
   // Now cur_obj should be the fisrt committed version, continue to the version
@@ -117,6 +171,7 @@ void gc_version_chain(fat_ptr *oid_entry) {
   ptr = cur_obj->GetNextVolatile();
   prev_next = cur_obj->GetNextVolatilePtr();
 
+  uint32_t recycled = 0;
   while (ptr.offset()) {
     cur_obj = (Object *)ptr.offset();
     clsn = cur_obj->GetClsn();
@@ -124,6 +179,7 @@ void gc_version_chain(fat_ptr *oid_entry) {
       // Might already got recycled, give up
       break;
     }
+    ++length;
     ptr = cur_obj->GetNextVolatile();
     prev_next = cur_obj->GetNextVolatilePtr();
     // If the chkpt needs to be a consistent one, must make sure not to GC a
@@ -136,7 +192,10 @@ void gc_version_chain(fat_ptr *oid_entry) {
     // grabs the latest committed version directly. Log replay after the
     // chkpt-start lsn is necessary for correctness.
     uint64_t glsn = volatile_read(gc_lsn);
-    if (LSN::from_ptr(clsn).offset() <= glsn && ptr._ptr) {
+    // Delta versions need everything down to their full version, so only
+    // cut right after a full one
+    if (LSN::from_ptr(clsn).offset() <= glsn && ptr._ptr &&
+        !((dbtuple *)cur_obj->GetPayload())->delta_depth) {
       // Fast forward to the **second** version < gc_lsn. Consider that we set
       // safesnap lsn to 1.8, and gc_lsn to 1.6. Assume we have two versions
       // with LSNs 2 and 1.5.  We need to keep the one with LSN=1.5 although
@@ -157,15 +216,15 @@ void gc_version_chain(fat_ptr *oid_entry) {
         fat_ptr next_ptr = cur_obj->GetNextVolatile();
         cur_obj->SetClsn(NULL_PTR);
         cur_obj->SetNextVolatile(NULL_PTR);
-        if (!tls_free_object_pool) {
-          tls_free_object_pool = new TlsFreeObjectPool;
-        }
-        tls_free_object_pool->Put(ptr);
+        get_tls_free_object_pool()->Put(ptr);
         ptr = next_ptr;
+        ++recycled;
       }
       break;
     }
   }
+  record_gc_chain_length(length + recycled);
+  return recycled;
 }
 
 void *allocate(size_t size) {
@@ -176,10 +235,10 @@ void *allocate(size_t size) {
 
   void *p = NULL;
 
-  // Try the tls free object store first
-  if (tls_free_object_pool) {
+  // Try the tls free object store (and the node's depot) first
+  {
     auto size_code = encode_size_aligned(size);
-    fat_ptr ptr = tls_free_object_pool->Get(size_code);
+    fat_ptr ptr = get_tls_free_object_pool()->Get(size_code);
     if (ptr.offset()) {
       p = (void *)ptr.offset();
       goto out;
@@ -229,10 +288,37 @@ void deallocate(fat_ptr p) {
   Object *obj = (Object *)p.offset();
   obj->SetNextVolatile(NULL_PTR);
   obj->SetClsn(NULL_PTR);
-  if (!tls_free_object_pool) {
-    tls_free_object_pool = new TlsFreeObjectPool;
+  get_tls_free_object_pool()->Put(p);
+}
+
+void hand_off_free_objects() {
+  if (tls_free_object_pool) {
+    tls_free_object_pool->HandOffAll();
+  }
+}
+
+free_pool_stats get_free_pool_stats(int node) {
+  free_pool_stats s;
+  {
+    CRITICAL_SECTION(cs, all_free_object_pools_lock);
+    for (auto *pool : all_free_object_pools) {
+      if (node < 0 || pool->depot() == &node_free_object_depots[node]) {
+        pool->AddStats(s);
+      }
+    }
+  }
+  if (node_free_object_depots) {
+    for (int n = 0; n < config::numa_nodes; ++n) {
+      if (node >= 0 && n != node) {
+        continue;
+      }
+      for (uint32_t i = 0; i < INVALID_SIZE_CODE; ++i) {
+        s.depot_bytes += volatile_read(node_free_object_depots[n].slots[i].list.count) *
+                         decode_size_aligned(i);
+      }
+    }
   }
-  tls_free_object_pool->Put(p);
+  return s;
 }
 
 // epoch mgr callbacks
@@ -308,6 +394,11 @@ void epoch_reclaimed(void *cookie, void *epoch_cookie) {
   }
 }
 
+bool epoch_end_due() {
+  return epoch_tls.nbytes >= EPOCH_SIZE_NBYTES ||
+         epoch_tls.counts >= EPOCH_SIZE_COUNT;
+}
+
 void epoch_exit(uint64_t s, epoch_num e) {
   // Transactions under a safesnap will pass s = 0 (INVALID_LSN)
   if (s != 0 && (epoch_tls.nbytes >= EPOCH_SIZE_NBYTES ||
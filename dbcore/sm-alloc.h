@@ -1,6 +1,5 @@
 #pragma once
-#include <unordered_map>
-#include <unordered_set>
+#include <algorithm>
 #include "sm-config.h"
 #include "sm-defs.h"
 #include "sm-object.h"
@@ -24,15 +23,21 @@ namespace ermia {
  * recycle stale versions because an update means we're potentially making
  * older versions stale and becoming candidates of GC.
  *
- * The TLS free object pool is a hash table indexed by aligned object sizes.
- * Objects of the same size will be put into the same set (std::unordered_set).
+ * The TLS free object pool keeps one set of free lists per size code. The
+ * lists are intrusive (linked through the freed objects themselves), so
+ * putting and getting an object is O(1) and never allocates. An object may
+ * only be reused once its allocation epoch is older than gc_epoch; freed
+ * objects wait in a few lists bucketed by that epoch and move to the ready
+ * list as a whole once gc_epoch passes the bucket. A thread that piles up too
+ * many ready objects of a size hands them off to its NUMA node's depot, from
+ * which other threads on the node refill.
  *
- * Upon allocation, if the TLS object pool is non-empty, the thread will try to
- * find an object of the requested size in this pool, instead of the TLS bump
- * allocator.  If the free object pool is empty, we continue with the bump
- * allocator; if the bump allocator also doesn't have free memory, we ask the
- * central per-socket reserved memory pool; if we still don't get any free
- * memory, the allocation fails.
+ * Upon allocation, the thread will first try to find an object of the
+ * requested size in its pool, then in its node's depot, instead of the TLS
+ * bump allocator. If both are empty, we continue with the bump allocator; if
+ * the bump allocator also doesn't have free memory, we ask the central
+ * per-socket reserved memory pool; if we still don't get any free memory, the
+ * allocation fails.
  *
  * In this way, GC time is amortized in updates, saving extra costs for
  * maintaining the set of updated OIDs and extra thread resources for the GC
@@ -50,52 +55,170 @@ namespace ermia {
 typedef epoch_mgr::epoch_num epoch_num;
 
 namespace MM {
-void gc_version_chain(fat_ptr *oid_entry);
+// Recycle versions no one needs anymore from the chain at [oid_entry];
+// returns the number of versions recycled
+uint32_t gc_version_chain(fat_ptr *oid_entry);
 
 extern epoch_num gc_epoch;
+extern uint64_t gc_lsn;
 
-// A hashtab storing recycled (freed) objects by size. No CC.
+// Bytes sitting in free object pools, see get_free_pool_stats()
+struct free_pool_stats {
+  uint64_t ready_bytes;    // in thread pools, reusable
+  uint64_t pending_bytes;  // in thread pools, waiting for gc_epoch to pass
+  uint64_t depot_bytes;    // handed off to the node depots
+  free_pool_stats() : ready_bytes(0), pending_bytes(0), depot_bytes(0) {}
+};
+
+// A singly linked list of free objects of the same size. Each object's first
+// word (Object::alloc_epoch_, which readers don't look at) stores the next
+// object's fat_ptr. No CC.
+struct FreeObjectList {
+  uint64_t head;
+  uint64_t tail;
+  uint64_t count;
+  // For lists waiting for GC: the newest allocation epoch among the objects
+  epoch_num epoch;
+
+  FreeObjectList() : head(0), tail(0), count(0), epoch(0) {}
+
+  inline bool empty() { return head == 0; }
+
+  inline void push(fat_ptr ptr) {
+    *(uint64_t *)ptr.offset() = head;
+    if (!head) {
+      tail = ptr._ptr;
+    }
+    head = ptr._ptr;
+    ++count;
+  }
+
+  inline fat_ptr pop() {
+    fat_ptr ret_ptr{head};
+    if (head) {
+      head = *(uint64_t *)ret_ptr.offset();
+      if (!head) {
+        tail = 0;
+      }
+      --count;
+    }
+    return ret_ptr;
+  }
+
+  // Move all of [other]'s objects to the front of this list
+  inline void splice(FreeObjectList &other) {
+    if (other.empty()) {
+      return;
+    }
+    *(uint64_t *)fat_ptr{other.tail}.offset() = head;
+    if (!head) {
+      tail = other.tail;
+    }
+    head = other.head;
+    count += other.count;
+    other.head = other.tail = other.count = 0;
+  }
+};
+
+// Free objects that are safe to reuse, shared by the threads of one NUMA node
+struct NodeFreeObjectDepot {
+  struct Slot {
+    mcs_lock lock;
+    FreeObjectList list;
+  } CACHE_ALIGNED;
+  Slot slots[INVALID_SIZE_CODE];
+};
+
+// Recycled (freed) objects of this thread by size code. No CC.
 class TlsFreeObjectPool {
+ public:
+  // Objects freed in the same epoch (mod kEpochBuckets) share a pending list.
+  // gc_epoch trails the current epoch by a few epochs only, so a bucket is
+  // usually drained before its slot comes around again; if not, the newer
+  // objects just wait along with the old ones.
+  static const uint32_t kEpochBuckets = 8;
+
+  // Hand ready objects of a size to the node's depot beyond this many
+  static const uint64_t kMaxReadyObjects = 1024;
+
  private:
-  // The unordered_set stores a fat_ptr (just in the form of an int)
-  std::unordered_map<size_t, std::unordered_set<uint64_t> *> pool_;
+  struct SizeClass {
+    FreeObjectList ready;
+    FreeObjectList pending[kEpochBuckets];
+  };
+  SizeClass classes_[INVALID_SIZE_CODE];
+  NodeFreeObjectDepot *depot_;
+
+  void HandOff(FreeObjectList &list, uint16_t size_code);
+  bool Refill(FreeObjectList &list, uint16_t size_code);
 
  public:
-  TlsFreeObjectPool() {}
+  TlsFreeObjectPool(NodeFreeObjectDepot *depot) : depot_(depot) {}
+
+  inline NodeFreeObjectDepot *depot() { return depot_; }
+
   inline void Put(fat_ptr ptr) {
-    if (pool_.find(ptr.size_code()) == pool_.end()) {
-      pool_[ptr.size_code()] = new std::unordered_set<uint64_t>;
+    ASSERT(ptr.size_code() < INVALID_SIZE_CODE);
+    SizeClass &sc = classes_[ptr.size_code()];
+    epoch_num e = ((Object *)ptr.offset())->GetAllocateEpoch();
+    epoch_num safe_epoch = volatile_read(gc_epoch);
+    if (e < safe_epoch) {
+      sc.ready.push(ptr);
+    } else {
+      FreeObjectList &pending = sc.pending[e % kEpochBuckets];
+      if (!pending.empty() && pending.epoch < safe_epoch) {
+        sc.ready.splice(pending);
+      }
+      pending.epoch = pending.empty() ? e : std::max(pending.epoch, e);
+      pending.push(ptr);
+    }
+    if (sc.ready.count > kMaxReadyObjects) {
+      HandOff(sc.ready, ptr.size_code());
     }
-    pool_[ptr.size_code()]->insert(ptr._ptr);
   }
+
+  // Add up this pool's objects; racy, meant for monitoring only
+  void AddStats(free_pool_stats &s) {
+    for (uint32_t i = 0; i < INVALID_SIZE_CODE; ++i) {
+      uint64_t size = decode_size_aligned(i);
+      s.ready_bytes += volatile_read(classes_[i].ready.count) * size;
+      for (auto &pending : classes_[i].pending) {
+        s.pending_bytes += volatile_read(pending.count) * size;
+      }
+    }
+  }
+
+  // Give all ready objects to the node's depot
+  void HandOffAll() {
+    for (uint32_t i = 0; i < INVALID_SIZE_CODE; ++i) {
+      if (!classes_[i].ready.empty()) {
+        HandOff(classes_[i].ready, i);
+      }
+    }
+  }
+
   inline fat_ptr Get(uint16_t size_code) {
-    if (pool_.find(size_code) != pool_.end()) {
-      auto *set = pool_[size_code];
-      uint32_t tries = 10;
-      for (auto &p : *set) {
-        if (p) {
-          fat_ptr ret_ptr{p};
-          Object *obj = (Object *)ret_ptr.offset();
-          if (obj->GetAllocateEpoch() < gc_epoch) {
-            set->erase(p);
-            return ret_ptr;
-          }
-          // XXX(tzwang): try a few times, too slow to look at all candidates.
-          // Tune it if memory space is a concern.
-          // TODO(tzwang): make this a list, consume from one end, add at
-          // another.
-          if (--tries == 0) {
-            return NULL_PTR;
-          }
+    ASSERT(size_code < INVALID_SIZE_CODE);
+    SizeClass &sc = classes_[size_code];
+    if (sc.ready.empty()) {
+      epoch_num safe_epoch = volatile_read(gc_epoch);
+      for (auto &pending : sc.pending) {
+        if (!pending.empty() && pending.epoch < safe_epoch) {
+          sc.ready.splice(pending);
         }
       }
+      if (sc.ready.empty() && !Refill(sc.ready, size_code)) {
+        return NULL_PTR;
+      }
     }
-    return NULL_PTR;
+    return sc.ready.pop();
   }
 };
 
 extern uint64_t safesnap_lsn;
 extern epoch_mgr mm_epochs;
+// Bytes handed out so far from each node's reserved memory
+extern uint64_t *allocated_node_memory;
 
 struct thread_data {
   bool initialized;
@@ -106,6 +229,12 @@ struct thread_data {
 void prepare_node_memory();
 void *allocate(size_t size);
 void deallocate(fat_ptr p);
+// Make this thread's recycled objects available to the other threads on its
+// node, e.g., for threads that free a lot but seldom allocate
+void hand_off_free_objects();
+// Sum up the free object pools of the threads on [node] and its depot; all
+// nodes if [node] is negative
+free_pool_stats get_free_pool_stats(int node = -1);
 void *allocate_onnode(size_t size);
 epoch_mgr::tls_storage *get_tls(void *);
 void global_init(void *);
@@ -118,5 +247,11 @@ inline void register_thread() { mm_epochs.thread_init(); }
 inline void deregister_thread() { mm_epochs.thread_fini(); }
 inline epoch_num epoch_enter(void) { return mm_epochs.thread_enter(); }
 void epoch_exit(uint64_t s, epoch_num e);
+
+// Whether this thread has allocated enough in its current epoch that its next
+// epoch_exit() would try to open a new one. Lets a worker that stays in an
+// epoch across many transactions (e.g., the pipeline coroutine scheduler)
+// know when to rotate.
+bool epoch_end_due();
 }  // namespace MM
 }  // namespace ermia
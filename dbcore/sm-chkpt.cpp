@@ -191,7 +191,8 @@ void sm_chkpt_mgr::do_recovery(char* chkpt_name, OID oid_partition,
     oid_array* ka = oidmgr->get_array(key_fid);
 
     // Populate the OID/key array and index
-    // FIXME(tzwang): support other index types
+    // FIXME(tzwang): support other index types; Engine::CreateIndex refuses
+    // hash indexes with checkpointing
     ConcurrentMasstreeIndex* index = (ConcurrentMasstreeIndex *)IndexDescriptor::GetIndex(key_fid);
     bool is_primary = index->GetDescriptor()->IsPrimary();
     ALWAYS_ASSERT(index);
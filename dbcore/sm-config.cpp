@@ -2,6 +2,7 @@
 #include <numa.h>
 #include "../macros.h"
 #include "sm-config.h"
+#include "sm-delta.h"
 #include "sm-log-recover-impl.h"
 #include "sm-thread.h"
 #include <iostream>
@@ -16,6 +17,12 @@ bool verbose = true;
 bool coro_tx = false;
 uint32_t coro_batch_size = 1;
 bool coro_batch_schedule = false;
+bool coro_pipeline_schedule = false;
+bool coro_work_stealing = false;
+uint32_t coro_request_interval_us = 0;
+bool coro_adaptive_batch = false;
+bool coro_batch_pmu = false;
+bool coro_durable_commit = false;
 bool scan_with_it = false;
 std::string benchmark("");
 uint32_t worker_threads = 0;
@@ -28,6 +35,16 @@ bool wait_for_primary = true;
 int backoff_aborted_transactions = 0;
 int numa_nodes = 0;
 int enable_gc = 0;
+uint32_t gc_threads_per_node = 0;
+uint32_t gc_cpu_budget = 100;
+std::string version_cache_tables("");
+uint32_t version_cache_value_size = 64;
+bool delta_versions = false;
+uint32_t delta_max_depth = 4;
+uint32_t evict_threshold_pct = 0;
+uint32_t evict_cold_ms = 1000;
+bool read_set_dedup = true;
+bool fast_read_only = false;
 std::string tmpfs_dir("/dev/shm");
 int enable_safesnap = 0;
 int enable_ssi_read_only_opt = 0;
@@ -37,6 +54,10 @@ int num_backups = 0;
 std::atomic<uint32_t> num_active_backups(0);
 uint64_t log_buffer_mb = 512;
 uint64_t log_segment_mb = 8192;
+bool log_io_uring = false;
+uint32_t log_io_depth = 4;
+bool log_direct_io = false;
+bool log_lsn_consolidation = false;
 uint32_t log_redo_partitions = 0;
 std::string log_dir("");
 bool null_log_device = false;
@@ -48,6 +69,7 @@ bool physical_workers_only = true;
 bool print_cpu_util = false;
 bool enable_perf = false;
 std::string perf_record_event("");
+std::string latency_json("");
 uint64_t node_memory_gb = 12;
 bool log_ship_offset_replay = false;
 int recovery_warm_up_policy = WARM_UP_NONE;
@@ -75,6 +97,8 @@ bool persist_nvram_on_replay = true;
 int persist_policy = kPersistSync;
 uint32_t read_view_stat_interval_ms;
 std::string read_view_stat_file;
+uint32_t mem_stat_interval_ms = 0;
+std::string mem_stat_file;
 bool command_log = false;
 uint32_t command_log_buffer_mb = 16;
 bool index_probe_only = false;
@@ -112,6 +136,43 @@ void sanity_check() {
       ALWAYS_ASSERT(!command_log);
     }
   }
+  if (delta_versions) {
+    // Recovery, log shipping and checkpoints only deal with full versions
+    LOG_IF(FATAL, is_backup_srv() || num_backups || enable_chkpt)
+        << "Delta versions can't be used with backups or checkpointing";
+    LOG_IF(FATAL, !delta_max_depth || delta_max_depth > kDeltaMaxDepth)
+        << "delta_max_depth must be between 1 and " << kDeltaMaxDepth;
+  }
+  if (evict_threshold_pct) {
+    LOG_IF(FATAL, evict_threshold_pct > 100) << "evict_threshold_pct must be at most 100";
+    LOG_IF(FATAL, !tls_alloc) << "Eviction needs the TLS allocator";
+    // Evicted records live only in the log
+    LOG_IF(FATAL, null_log_device || is_backup_srv() || num_backups || enable_chkpt)
+        << "Eviction can't be used with a null log device, backups or checkpointing";
+#if defined(SSN) || defined(SSI) || defined(MVOCC)
+    LOG(WARNING) << "Eviction is not supported by serializable CC schemes";
+    evict_threshold_pct = 0;
+#endif
+  }
+  if (log_io_uring) {
+    LOG_IF(FATAL, !log_io_depth) << "log_io_depth must be at least 1";
+    // Log shipping acks and dequeues committed work per flush window
+    if (num_backups && log_io_depth > 1) {
+      LOG(WARNING) << "Only one log write in flight with backups";
+      log_io_depth = 1;
+    }
+  }
+  // Closed-loop workers always have work of their own, so nobody would steal
+  LOG_IF(FATAL, coro_work_stealing && !coro_request_interval_us)
+      << "coro_work_stealing needs an arrival rate (coro_request_interval_us)";
+  if (coro_durable_commit) {
+    LOG_IF(FATAL, !coro_tx || !group_commit || command_log)
+        << "coro_durable_commit needs coroutine transactions and group commit, "
+           "and doesn't support command logging";
+  }
+  // Log shipping sizes segments by their file size, which preallocation breaks
+  LOG_IF(FATAL, log_direct_io && (is_backup_srv() || num_backups))
+      << "Direct log I/O can't be used with backups";
 }
 
 }  // namespace config
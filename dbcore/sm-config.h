@@ -37,14 +37,21 @@ extern uint64_t chkpt_interval;
 extern uint64_t log_buffer_mb;
 extern uint64_t log_segment_mb;
 extern std::string log_dir;
+extern bool log_io_uring;
+extern uint32_t log_io_depth;
+extern bool log_direct_io;
+extern bool log_lsn_consolidation;
 extern uint32_t read_view_stat_interval_ms;
 extern std::string read_view_stat_file;
+extern uint32_t mem_stat_interval_ms;
+extern std::string mem_stat_file;
 extern bool command_log;
 extern uint32_t command_log_buffer_mb;
 extern bool print_cpu_util;
 extern uint32_t arena_size_mb;
 extern bool enable_perf;
 extern std::string perf_record_event;
+extern std::string latency_json;
 
 // NVRAM settings - for backup servers only, the primary doesn't care.
 extern bool nvram_log_buffer;
@@ -58,6 +65,16 @@ extern bool parallel_loading;
 extern bool retry_aborted_transactions;
 extern int backoff_aborted_transactions;
 extern int enable_gc;
+extern uint32_t gc_threads_per_node;
+extern uint32_t gc_cpu_budget;
+extern std::string version_cache_tables;  // comma-separated
+extern uint32_t version_cache_value_size;
+extern bool delta_versions;
+extern uint32_t delta_max_depth;
+extern uint32_t evict_threshold_pct;
+extern uint32_t evict_cold_ms;
+extern bool read_set_dedup;
+extern bool fast_read_only;
 extern uint32_t log_redo_partitions;
 extern bool null_log_device;
 extern bool truncate_at_bench_start;
@@ -81,6 +98,12 @@ extern bool index_probe_only;
 extern bool coro_tx;
 extern uint32_t coro_batch_size;
 extern bool coro_batch_schedule;
+extern bool coro_pipeline_schedule;
+extern bool coro_work_stealing;
+extern uint32_t coro_request_interval_us;
+extern bool coro_adaptive_batch;
+extern bool coro_batch_pmu;
+extern bool coro_durable_commit;
 
 extern bool scan_with_it;
 
@@ -190,6 +213,13 @@ extern double cycles_per_byte;
 
 inline bool is_backup_srv() { return primary_srv.size(); }
 
+// Whether durable latency under group commit is accounted by the log flusher
+// on dequeuing the commit queues (rather than by transactions waiting for
+// their commits to become durable)
+inline bool commit_queue_latency() {
+  return !is_backup_srv() && group_commit && !coro_durable_commit;
+}
+
 inline bool eager_warm_up() {
   return recovery_warm_up_policy == WARM_UP_EAGER ||
          log_ship_warm_up_policy == WARM_UP_EAGER;
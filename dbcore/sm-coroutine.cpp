@@ -3,6 +3,7 @@
 namespace ermia {
 namespace coro {
 
+tcalloc::chunk_source_t tcalloc::chunk_source = nullptr;
 thread_local tcalloc coroutine_allocator;
 
 } // namespace coro
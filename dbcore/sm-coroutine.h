@@ -2,8 +2,11 @@
 
 #include <experimental/coroutine>
 #include <array>
+#include <climits>
+#include <cstring>
 #include <map>
 #include <numa.h>
+#include <sched.h>
 
 #include "../macros.h"
 #include "sm-defs.h"
@@ -11,7 +14,15 @@
 namespace ermia {
 namespace coro {
 
-// Simple thread caching allocator.
+// Thread caching allocator for coroutine frames.
+//
+// Frames are carved out of kChunkSize chunks that are obtained on demand,
+// from the engine's per-node huge page pool once MM::prepare_node_memory()
+// has installed it as the chunk source, or node-local numa memory otherwise.
+// Freed frames go to per-thread, power-of-two size class free lists (256B -
+// 1MB), so both alloc and free are a list pop/push on the hot path. Frames
+// larger than the biggest class get their own numa allocation. Chunks are
+// kept until the thread exits.
 class tcalloc {
     struct alignas(CACHELINE_SIZE) FrameNode {
         FrameNode *next;
@@ -21,16 +32,42 @@ class tcalloc {
 
     static_assert(sizeof(FrameNode) == CACHELINE_SIZE, "");
 
+    // Header of chunks we got from numa_alloc_onnode and have to give back
+    struct alignas(CACHELINE_SIZE) NumaChunk {
+        NumaChunk *next;
+    };
+
    public:
-    tcalloc() { 
+    typedef void *(*chunk_source_t)(size_t size);
+
+    struct stats {
+        uint64_t allocs;
+        uint64_t frees;
+        uint64_t bytes_in_use;
+        uint64_t high_water;   // max. bytes_in_use
+        uint64_t chunk_bytes;  // reserved for frames, including oversized ones
+    };
+
+    static constexpr size_t kChunkSize = 2 * 1024 * 1024;
+
+    tcalloc() : arena_top(nullptr), arena_end(nullptr), numa_chunks(nullptr) {
         memset(entries, 0, sizeof(entries));
+        memset(&counters, 0, sizeof(counters));
+        node = numa_node_of_cpu(sched_getcpu());
+    }
+    ~tcalloc() {
+        while (numa_chunks) {
+            NumaChunk *next = numa_chunks->next;
+            numa_free(numa_chunks, kChunkSize);
+            numa_chunks = next;
+        }
+    }
 
-        constexpr size_t kArenaSize = 8 * 1024 * 1024;
-        arena = static_cast<uint8_t *>(
-            numa_alloc_onnode(kArenaSize, numa_node_of_cpu(sched_getcpu())));
-        arena_top = arena;
+    // Where new chunks come from; nullptr means numa_alloc_onnode. The source
+    // may return nullptr when it runs out, in which case we fall back to numa.
+    static void set_chunk_source(chunk_source_t source) {
+        volatile_write(chunk_source, source);
     }
-    ~tcalloc() {}
 
     static inline uint32_t lg_down(uint64_t x) {
         static_assert(sizeof(unsigned long long) * CHAR_BIT == 64, "");
@@ -47,18 +84,24 @@ class tcalloc {
         return lg_down(x - 1) + 1;
     }
 
-    void *alloc_from_arena(size_t byte_size, uint8_t alignment) {
-        ASSERT(arena_top);
-        const int8_t mask = alignment - 1;
+    void *alloc_from_arena(size_t byte_size) {
+        ASSERT(byte_size + CACHELINE_SIZE <= kChunkSize);
         uint8_t *p = reinterpret_cast<uint8_t *>(
-            reinterpret_cast<intptr_t>(arena_top + mask) & ~mask);
+            reinterpret_cast<intptr_t>(arena_top + CACHELINE_SIZE - 1) &
+            ~intptr_t(CACHELINE_SIZE - 1));
+        if (unlikely(!arena_top || p + byte_size > arena_end)) {
+            new_chunk();
+            p = arena_top;
+        }
         arena_top = p + byte_size;
         return reinterpret_cast<void *>(p);
     }
 
     void *alloc(size_t byte_size) {
-        const int ceil_log_2 = lg_up(byte_size);
-        ASSERT(ceil_log_2 < kEndSizeExp);
+        const uint32_t ceil_log_2 = lg_up(byte_size);
+        if (unlikely(ceil_log_2 >= kEndSizeExp)) {
+            return alloc_oversized(byte_size);
+        }
 
         const int entry_index =
             ceil_log_2 > kBeginSizeExp ? ceil_log_2 - kBeginSizeExp : 0;
@@ -66,47 +109,187 @@ class tcalloc {
         FrameNode *frame_to_alloc = entries[entry_index];
         if (frame_to_alloc == nullptr) {
             const size_t frame_size = 1 << (entry_index + kBeginSizeExp);
-            frame_to_alloc = reinterpret_cast<FrameNode *>(alloc_from_arena(
-                sizeof(FrameNode) + frame_size, CACHELINE_SIZE));
+            frame_to_alloc = reinterpret_cast<FrameNode *>(
+                alloc_from_arena(sizeof(FrameNode) + frame_size));
             frame_to_alloc->entry_index = entry_index;
         } else {
             entries[entry_index] = frame_to_alloc->next;
         }
 
+        account_alloc(byte_size);
         return static_cast<void *>(frame_to_alloc + 1);
     }
 
     void free(void *p, size_t byte_size) {
         FrameNode *frame_to_free = reinterpret_cast<FrameNode *>(p) - 1;
         const int entry_index = frame_to_free->entry_index;
+        ++counters.frees;
+        counters.bytes_in_use -= byte_size;
+        if (unlikely(entry_index == kOversizedIndex)) {
+            numa_free(frame_to_free, sizeof(FrameNode) + byte_size);
+            counters.chunk_bytes -= sizeof(FrameNode) + byte_size;
+            return;
+        }
         frame_to_free->next = entries[entry_index];
         entries[entry_index] = frame_to_free;
     }
 
+    inline const stats &get_stats() const { return counters; }
+
    private:
+    inline void account_alloc(size_t byte_size) {
+        ++counters.allocs;
+        counters.bytes_in_use += byte_size;
+        if (counters.bytes_in_use > counters.high_water) {
+            counters.high_water = counters.bytes_in_use;
+        }
+    }
+
+    void new_chunk() {
+        chunk_source_t source = volatile_read(chunk_source);
+        uint8_t *chunk = source ? static_cast<uint8_t *>(source(kChunkSize)) : nullptr;
+        if (chunk) {
+            arena_top = chunk;
+        } else {
+            chunk = static_cast<uint8_t *>(numa_alloc_onnode(kChunkSize, node));
+            ALWAYS_ASSERT(chunk);
+            NumaChunk *c = reinterpret_cast<NumaChunk *>(chunk);
+            c->next = numa_chunks;
+            numa_chunks = c;
+            arena_top = chunk + sizeof(NumaChunk);
+        }
+        arena_end = chunk + kChunkSize;
+        counters.chunk_bytes += kChunkSize;
+    }
+
+    void *alloc_oversized(size_t byte_size) {
+        FrameNode *frame = static_cast<FrameNode *>(
+            numa_alloc_onnode(sizeof(FrameNode) + byte_size, node));
+        ALWAYS_ASSERT(frame);
+        frame->entry_index = kOversizedIndex;
+        counters.chunk_bytes += sizeof(FrameNode) + byte_size;
+        account_alloc(byte_size);
+        return static_cast<void *>(frame + 1);
+    }
+
     static constexpr short kBeginSizeExp = 8;
-    static constexpr short kEndSizeExp = 16;  // exclusive
+    static constexpr short kEndSizeExp = 21;  // exclusive
+    static constexpr uint8_t kOversizedIndex = 0xFF;
+    static_assert((1UL << (kEndSizeExp - 1)) + sizeof(FrameNode) + sizeof(NumaChunk) <= kChunkSize,
+                  "Largest size class must fit in a chunk");
+
+    static chunk_source_t chunk_source;
+
     FrameNode *entries[kEndSizeExp - kBeginSizeExp];
 
-    uint8_t *arena;
     uint8_t *arena_top;
+    uint8_t *arena_end;
+    NumaChunk *numa_chunks;
+    int node;
+    stats counters;
 };
 
 extern thread_local tcalloc coroutine_allocator;
 
+/*
+ *  generator<T> is the eager (initial_suspend never) coroutine type used by
+ *  the benchmark transactions. Nested generators are co_awaited and resumed
+ *  through symmetric transfer:
+ *
+ *  - Every chain of generators has a root (the one the scheduler holds).
+ *    The root's promise tracks the leaf, i.e., the innermost frame that is
+ *    currently suspended. The scheduler resumes the leaf directly through
+ *    resume_leaf(), so a suspension point at any depth costs one switch
+ *    to get back in, and one to get back out to the scheduler.
+ *
+ *  - When a nested generator finishes, its final_suspend transfers control
+ *    straight to the awaiting parent instead of going back to the
+ *    scheduler first, and the parent becomes the leaf.
+ *
+ *  Because generators start eagerly, a callee may already have suspended
+ *  (with its own nested callees) before the caller co_awaits it. The
+ *  callee's subtree is then attached to the caller's root in await_suspend,
+ *  which walks at most the callee's nesting depth. This only happens on the
+ *  first suspension of each nested call.
+ */
+namespace coro_generator_private {
+
+using generic_coroutine_handle = std::experimental::coroutine_handle<void>;
+
+struct promise_base {
+  promise_base() : parent_(nullptr), root_(this), leaf_(this) {}
+  ~promise_base() {}
+
+  promise_base(const promise_base &) = delete;
+  promise_base(promise_base &&) = delete;
+
+  struct final_awaiter {
+    constexpr bool await_ready() const noexcept { return false; }
+    template <typename promise_t>
+    generic_coroutine_handle await_suspend(
+        std::experimental::coroutine_handle<promise_t> finished) const noexcept {
+      promise_base &p = finished.promise();
+      if (!p.parent_) {
+        // The root or a nested generator that finished before anyone
+        // co_awaited it: return to whoever resumed/created us
+        return std::experimental::noop_coroutine();
+      }
+      p.root_->leaf_ = p.parent_;
+      return p.parent_->handle_;
+    }
+    void await_resume() const noexcept {}
+  };
+
+  auto initial_suspend() { return std::experimental::suspend_never{}; }
+  auto final_suspend() noexcept { return final_awaiter{}; }
+  void unhandled_exception() { std::terminate(); }
+
+  void *operator new(size_t sz) { return coroutine_allocator.alloc(sz); }
+  void operator delete(void *p, size_t sz) { coroutine_allocator.free(p, sz); }
+
+  // Make [this] (which is suspended, possibly inside its own callees) a
+  // callee of [caller]
+  inline void attach_to(promise_base *caller) {
+    ASSERT(!parent_);
+    parent_ = caller;
+    promise_base *root = caller->root_;
+    promise_base *leaf = leaf_;
+    for (promise_base *p = leaf; p != caller; p = p->parent_) {
+      p->root_ = root;
+    }
+    root->leaf_ = leaf;
+  }
+
+  // Resume the innermost suspended frame; only valid on the root
+  inline void resume_leaf() {
+    ASSERT(root_ == this);
+    ASSERT(!leaf_->handle_.done());
+    leaf_->handle_.resume();
+  }
+
+protected:
+  generic_coroutine_handle handle_;
+  promise_base *parent_;
+  promise_base *root_;
+  promise_base *leaf_;
+};
+
+}  // namespace coro_generator_private
+
 template <typename T = void> struct [[nodiscard]] generator {
   struct promise_type;
   using handle = std::experimental::coroutine_handle<promise_type>;
 
-  struct promise_type {
+  struct promise_type : coro_generator_private::promise_base {
     promise_type() {}
     ~promise_type() {
       reinterpret_cast<T*>(&ret_val_buf_)->~T();
     }
-    auto get_return_object() { return generator{handle::from_promise(*this)}; }
-    auto initial_suspend() { return std::experimental::suspend_never{}; }
-    auto final_suspend() noexcept { return std::experimental::suspend_always{}; }
-    void unhandled_exception() { std::terminate(); }
+    auto get_return_object() {
+      handle h = handle::from_promise(*this);
+      handle_ = h;
+      return generator{h};
+    }
     void return_value(const T value) {
         new (&ret_val_buf_) T(std::move(value));
     }
@@ -116,13 +299,10 @@ template <typename T = void> struct [[nodiscard]] generator {
     T get_return_value() {
         return *reinterpret_cast<T*>(&ret_val_buf_);
     }
-    void *operator new(size_t sz) { return coroutine_allocator.alloc(sz); }
-    void operator delete(void *p, size_t sz) { coroutine_allocator.free(p, sz); }
     struct alignas(alignof(T)) T_Buf {
       uint8_t buf[sizeof(T)];
     };
 
-    std::experimental::coroutine_handle<> callee_coro = nullptr;
     T_Buf ret_val_buf_;
   };
 
@@ -152,12 +332,16 @@ template <typename T = void> struct [[nodiscard]] generator {
 
   struct awaiter {
     awaiter(handle h) : awaiter_coro(h) {}
-    constexpr bool await_ready() const noexcept { return false; }
-    template <typename awaiting_handle>
-    constexpr void await_suspend(awaiting_handle awaiting_coro) noexcept {
-      awaiting_coro.promise().callee_coro = awaiter_coro;
+    bool await_ready() const noexcept { return awaiter_coro.done(); }
+    template <typename awaiting_promise_t>
+    void await_suspend(std::experimental::coroutine_handle<awaiting_promise_t>
+                           awaiting_coro) noexcept {
+      // The callee is suspended somewhere inside; hand its leaf to our
+      // root and go back to the scheduler
+      awaiter_coro.promise().attach_to(&awaiting_coro.promise());
     }
-    constexpr auto await_resume() noexcept {
+    auto await_resume() noexcept {
+      ASSERT(awaiter_coro.done());
       return awaiter_coro.promise().transfer_return_value();
     }
   private:
@@ -170,20 +354,18 @@ private:
   handle coro;
 };
 
-template<> struct generator<void>::promise_type {
+template<> struct generator<void>::promise_type : coro_generator_private::promise_base {
   promise_type() {}
   ~promise_type() {}
-  auto get_return_object() { return generator{handle::from_promise(*this)}; }
-  auto initial_suspend() { return std::experimental::suspend_never{}; }
-  auto final_suspend() { return std::experimental::suspend_always{}; }
-  void unhandled_exception() { std::terminate(); }
+  auto get_return_object() {
+    handle h = handle::from_promise(*this);
+    handle_ = h;
+    return generator{h};
+  }
   void return_void() {};
   void transfer_return_value() {};
-  void *operator new(size_t sz) { return coroutine_allocator.alloc(sz); }
-  void operator delete(void *p, size_t sz) { coroutine_allocator.free(p, sz); }
-
-  std::experimental::coroutine_handle<> callee_coro = nullptr;
 };
+
 /*
  *  task<T> is implementation of coroutine promise. It supports chained
  *  co_await, which enables writing coroutine as easy as writing normal
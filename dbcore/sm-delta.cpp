@@ -0,0 +1,96 @@
+#include "sm-delta.h"
+#include "../tuple.h"
+
+namespace ermia {
+
+delta_stats tls_delta_stats[config::MAX_THREADS];
+
+static inline uint64_t load_word(const uint8_t *p) {
+  uint64_t w;
+  memcpy(&w, p, sizeof(w));
+  return w;
+}
+
+uint32_t delta_encode(const uint8_t *base, const uint8_t *value, uint32_t size,
+                      uint8_t *out, uint32_t max_out) {
+  uint32_t n = 0;
+  uint32_t i = 0;
+  while (i < size) {
+    // Skip what's unchanged, a word at a time first
+    while (i + sizeof(uint64_t) <= size &&
+           load_word(base + i) == load_word(value + i)) {
+      i += sizeof(uint64_t);
+    }
+    while (i < size && base[i] == value[i]) {
+      ++i;
+    }
+    if (i == size) {
+      break;
+    }
+
+    // Extend the run until a gap that's worth a new run header
+    uint32_t start = i;
+    uint32_t end = i + 1;
+    for (uint32_t j = end; j < size && j - end < sizeof(delta_run); ++j) {
+      if (base[j] != value[j]) {
+        end = j + 1;
+      }
+    }
+
+    delta_run run = {start, end - start};
+    if (n + sizeof(run) + run.length > max_out) {
+      return 0;
+    }
+    memcpy(out + n, &run, sizeof(run));
+    n += sizeof(run);
+    memcpy(out + n, value + start, run.length);
+    n += run.length;
+    i = end;
+  }
+  return n;
+}
+
+void delta_apply(uint8_t *value, const uint8_t *delta, uint32_t delta_size) {
+  uint32_t n = 0;
+  while (n < delta_size) {
+    delta_run run;
+    memcpy(&run, delta + n, sizeof(run));
+    n += sizeof(run);
+    memcpy(value + run.offset, delta + n, run.length);
+    n += run.length;
+  }
+  ASSERT(n == delta_size);
+}
+
+void delta_materialize(dbtuple *tuple, uint8_t *out) {
+  dbtuple *deltas[kDeltaMaxDepth];
+  uint32_t n = 0;
+  while (tuple->delta_depth) {
+    ALWAYS_ASSERT(n < kDeltaMaxDepth);
+    deltas[n++] = tuple;
+    // GC never cuts the chain between a delta and its full version
+    tuple = tuple->NextVolatile();
+    ALWAYS_ASSERT(tuple);
+  }
+  memcpy(out, tuple->get_value_start(), tuple->size);
+  while (n--) {
+    ASSERT(deltas[n]->size == tuple->size);
+    delta_apply(out, deltas[n]->get_value_start(), deltas[n]->delta_size);
+  }
+  if (delta_stats *s = my_delta_stats()) {
+    ++s->materialized;
+  }
+}
+
+delta_stats get_delta_stats() {
+  delta_stats total;
+  for (uint32_t i = 0; i < config::MAX_THREADS; ++i) {
+    total.versions += volatile_read(tls_delta_stats[i].versions);
+    total.deltas += volatile_read(tls_delta_stats[i].deltas);
+    total.bytes += volatile_read(tls_delta_stats[i].bytes);
+    total.materialized += volatile_read(tls_delta_stats[i].materialized);
+  }
+  return total;
+}
+
+}  // namespace ermia
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+#include "sm-config.h"
+#include "sm-thread.h"
+
+namespace ermia {
+
+struct dbtuple;
+
+/*
+ * Delta-encoded versions.
+ *
+ * With config::delta_versions, an update whose new value has the same size as
+ * its (committed) predecessor stores only the byte ranges that changed
+ * instead of a full copy of the record. Most OLTP updates touch a few fields
+ * of a much wider row (a balance, a counter, a date), so the new version
+ * shrinks to a few dozen bytes.
+ *
+ * The encoding is a sequence of runs, each a delta_run header followed by the
+ * [length] new bytes to put at [offset]. Changed ranges separated by fewer
+ * unchanged bytes than a run header are merged into one run.
+ *
+ * A delta version's dbtuple::size is still the full record size; its payload
+ * holds dbtuple::delta_size bytes of encoding and dbtuple::delta_depth counts
+ * the deltas down to the nearest full version (0 means the version is full).
+ * Reading it walks the chain down to that full version and applies the deltas
+ * back up. Depth is bounded by config::delta_max_depth: the next update after
+ * that materializes a full version again.
+ *
+ * The updater keeps the full new value in dbtuple::pvalue as usual, so reading
+ * its own writes is unaffected by the encoding until commit. The log always
+ * gets the full new value, so replay and anything reading a version back
+ * from its pdest never see deltas.
+ */
+struct delta_run {
+  uint32_t offset;
+  uint32_t length;
+};
+
+// Deltas larger than this fraction of the record aren't worth the reconstruction
+static const uint32_t kDeltaMaxRatio = 2;
+// Hard cap on config::delta_max_depth (size of the reconstruction stack)
+static const uint32_t kDeltaMaxDepth = 32;
+
+// Encode the difference from [base] to [value], both [size] bytes, into [out].
+// Returns the encoded size, or 0 if the encoding would exceed [max_out] bytes.
+uint32_t delta_encode(const uint8_t *base, const uint8_t *value, uint32_t size,
+                      uint8_t *out, uint32_t max_out);
+
+// Apply a delta produced by delta_encode() to [value] in place
+void delta_apply(uint8_t *value, const uint8_t *delta, uint32_t delta_size);
+
+// Reconstruct the full value of delta version [tuple] into [out], which must
+// hold tuple->size bytes
+void delta_materialize(dbtuple *tuple, uint8_t *out);
+
+struct delta_stats {
+  uint64_t versions;       // versions created by updates
+  uint64_t deltas;         // ...of which delta-encoded
+  uint64_t bytes;          // bytes allocated for them
+  uint64_t materialized;   // reads that reconstructed a delta version
+  delta_stats() : versions(0), deltas(0), bytes(0), materialized(0) {}
+} CACHE_ALIGNED;
+
+extern delta_stats tls_delta_stats[config::MAX_THREADS];
+
+inline delta_stats *my_delta_stats() {
+  uint32_t id = thread::MyId();
+  return id < config::MAX_THREADS ? &tls_delta_stats[id] : nullptr;
+}
+
+// Sums up all threads' counters
+delta_stats get_delta_stats();
+
+}  // namespace ermia
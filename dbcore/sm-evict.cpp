@@ -0,0 +1,239 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sm-alloc.h"
+#include "sm-evict.h"
+#include "sm-log.h"
+#include "sm-log-file.h"
+#include "sm-table.h"
+#include "sm-thread.h"
+#include "../tuple.h"
+
+namespace ermia {
+namespace evict {
+
+// Object header + tuple header + the OID entry it's installed at
+static const size_t kStubSize = sizeof(Object) + sizeof(dbtuple) + sizeof(fat_ptr *);
+
+static std::atomic<uint64_t> evicted(0);
+static std::atomic<uint64_t> evicted_bytes(0);
+static std::atomic<uint64_t> faults(0);
+static std::atomic<uint64_t> reloads(0);
+
+static inline fat_ptr *&StubEntry(Object *stub) {
+  return *(fat_ptr **)((dbtuple *)stub->GetPayload())->get_value_start();
+}
+
+// Recycle [ptr], which was replaced at its OID entry but might still be
+// looked at by readers that loaded the entry before
+static void Retire(fat_ptr ptr) {
+  ((Object *)ptr.offset())->SetAllocateEpoch(MM::mm_epochs.get_cur_epoch());
+  MM::deallocate(ptr);
+}
+
+bool UnderPressure(uint64_t allocated, const MM::free_pool_stats &free) {
+  uint64_t limit = config::node_memory_gb * config::GB / 100 * config::evict_threshold_pct;
+  uint64_t free_bytes = free.ready_bytes + free.pending_bytes + free.depot_bytes;
+  return allocated > free_bytes && allocated - free_bytes >= limit;
+}
+
+// Swap the record at [entry] for a stub if it's cold and qualifies (see
+// sm-evict.h); [e] is the caller's MM epoch
+static bool EvictOne(fat_ptr *entry, epoch_num e) {
+  fat_ptr head = volatile_read(*entry);
+  Object *obj = (Object *)head.offset();
+  if (!obj || !obj->IsInMemory()) {
+    return false;
+  }
+  // Second chance
+  if (obj->IsReferenced()) {
+    obj->SetReferenced(false);
+    return false;
+  }
+  fat_ptr clsn = obj->GetClsn();
+  fat_ptr pdest = obj->GetPersistentAddress();
+  dbtuple *tuple = (dbtuple *)obj->GetPayload();
+  size_t size = decode_size_aligned(head.size_code());
+  if (clsn.asi_type() != fat_ptr::ASI_LOG || obj->GetNextVolatile() != NULL_PTR ||
+      pdest.asi_type() != fat_ptr::ASI_LOG || !tuple->size || tuple->delta_depth ||
+      size < 2 * kStubSize) {
+    return false;
+  }
+  if (pdest.offset() + decode_size_aligned(pdest.size_code()) >
+      logmgr->durable_flushed_lsn().offset()) {
+    return false;
+  }
+
+  size_t stub_size = kStubSize;
+  size_t stub_size_code = encode_size_aligned(stub_size);
+  fat_ptr stub_ptr = fat_ptr::make(MM::allocate(kStubSize), stub_size_code, 0);
+  Object *stub = new ((void *)stub_ptr.offset())
+      Object(pdest, obj->GetNextPersistent(), e, false);
+  stub->SetEvicted();
+  stub->SetClsn(clsn);
+  new (stub->GetPayload()) dbtuple(tuple->size);
+  StubEntry(stub) = entry;
+  if (!__sync_bool_compare_and_swap(&entry->_ptr, head._ptr, stub_ptr._ptr)) {
+    MM::deallocate(stub_ptr);
+    return false;
+  }
+  Retire(head);
+  evicted.fetch_add(1, std::memory_order_relaxed);
+  evicted_bytes.fetch_add(size - decode_size_aligned(stub_size_code), std::memory_order_relaxed);
+  return true;
+}
+
+class EvictThread : public thread::Runner {
+ public:
+  // OIDs to look at per MM epoch; the evictor must not hold back epochs
+  static const uint32_t kBatchSize = 1024;
+  static const uint32_t kIdleSleepUs = 1000;
+
+  EvictThread() : Runner(false), stop(false) {
+    for (auto &t : TableDescriptor::name_map) {
+      tables.push_back(t.second);
+    }
+  }
+
+  // Whether any node has used up more than its share of memory
+  bool UnderPressure() {
+    for (int i = 0; i < config::numa_nodes; ++i) {
+      if (evict::UnderPressure(volatile_read(MM::allocated_node_memory[i]),
+                               MM::get_free_pool_stats(i))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  virtual void MyWork(char *) override {
+    uint32_t table = 0;
+    OID oid = 0;
+    util::timer pass;
+    while (!volatile_read(stop)) {
+      if (!UnderPressure()) {
+        usleep(kIdleSleepUs);
+        continue;
+      }
+
+      epoch_num e = MM::epoch_enter();
+      oid_array *oa = tables[table]->GetTupleArray();
+      OID end = std::min<uint64_t>(oa->nentries(), uint64_t(oid) + kBatchSize);
+      for (; oid < end; ++oid) {
+        EvictOne(oa->get(oid), e);
+      }
+      MM::epoch_exit(0, e);
+      // Make what we just released available to the workers right away
+      MM::hand_off_free_objects();
+
+      if (oid < oa->nentries()) {
+        continue;
+      }
+      oid = 0;
+      if (++table < tables.size()) {
+        continue;
+      }
+      // Done a pass: give readers evict_cold_ms to touch what they need
+      table = 0;
+      ++stats.sweeps;
+      uint64_t elapsed_ms = pass.lap() / 1000;
+      if (elapsed_ms < config::evict_cold_ms) {
+        usleep((config::evict_cold_ms - elapsed_ms) * 1000);
+        pass.lap();
+      }
+    }
+  }
+
+  std::vector<TableDescriptor *> tables;
+  bool stop;
+  evict_stats stats;
+};
+
+static EvictThread *evictor = nullptr;
+
+void start_evict_thread() {
+  if (!config::evict_threshold_pct || evictor || !TableDescriptor::NumTables()) {
+    return;
+  }
+  evictor = new EvictThread();
+  if (!evictor->TryImpersonate()) {
+    evictor->physical = true;
+    LOG_IF(FATAL, !evictor->TryImpersonate()) << "No thread left for the evictor";
+  }
+  evictor->Start();
+  LOG(INFO) << "Started evictor, threshold " << config::evict_threshold_pct << "%";
+}
+
+void stop_evict_thread() {
+  if (!evictor) {
+    return;
+  }
+  volatile_write(evictor->stop, true);
+  evictor->Join();
+}
+
+evict_stats get_evict_stats() {
+  evict_stats s;
+  if (evictor) {
+    s = evictor->stats;
+  }
+  s.evicted = evicted.load(std::memory_order_relaxed);
+  s.bytes = evicted_bytes.load(std::memory_order_relaxed);
+  s.faults = faults.load(std::memory_order_relaxed);
+  s.reloads = reloads.load(std::memory_order_relaxed);
+  return s;
+}
+
+bool Evict(fat_ptr *entry) {
+  epoch_num e = config::tls_alloc ? MM::epoch_enter() : 0;
+  bool ret = EvictOne(entry, e);
+  if (config::tls_alloc) {
+    MM::epoch_exit(0, e);
+  }
+  return ret;
+}
+
+void Prefetch(Object *obj) {
+  fat_ptr pdest = obj->GetPersistentAddress();
+  segment_id *sid = logmgr->get_segment(pdest.log_segment());
+  posix_fadvise(sid->fd, pdest.offset() - sid->start_offset,
+                decode_size_aligned(pdest.size_code()), POSIX_FADV_WILLNEED);
+}
+
+void Load(Object *obj, str_arena &arena, varstr *out_v) {
+  ASSERT(obj->IsEvicted());
+  dbtuple *stub_tuple = (dbtuple *)obj->GetPayload();
+  fat_ptr pdest = obj->GetPersistentAddress();
+
+  // The log has the whole varstr, see transaction::Update
+  size_t data_sz = decode_size_aligned(pdest.size_code());
+  varstr *buf = arena.next(data_sz);
+  logmgr->load_object((char *)buf->data(), data_sz, pdest);
+  ASSERT(((varstr *)buf->data())->size() == stub_tuple->size);
+  out_v->p = buf->data() + sizeof(varstr);
+  out_v->l = stub_tuple->size;
+  faults.fetch_add(1, std::memory_order_relaxed);
+
+  // Bring the record back if nobody touched it meanwhile
+  fat_ptr *entry = StubEntry(obj);
+  fat_ptr stub_ptr = volatile_read(*entry);
+  if (stub_ptr.offset() != (uintptr_t)obj) {
+    return;
+  }
+  varstr value(out_v->p, out_v->l);
+  fat_ptr new_ptr = Object::Create(&value, true, MM::mm_epochs.get_cur_epoch());
+  Object *fresh = (Object *)new_ptr.offset();
+  ((dbtuple *)fresh->GetPayload())->pvalue = nullptr;
+  *fresh->GetPersistentAddressPtr() = pdest;
+  fresh->SetNextPersistent(obj->GetNextPersistent());
+  fresh->SetClsn(obj->GetClsn());
+  if (__sync_bool_compare_and_swap(&entry->_ptr, stub_ptr._ptr, new_ptr._ptr)) {
+    Retire(stub_ptr);
+    reloads.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    MM::deallocate(new_ptr);
+  }
+}
+
+}  // namespace evict
+}  // namespace ermia
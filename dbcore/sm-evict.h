@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+
+#include "sm-alloc.h"
+#include "sm-config.h"
+#include "sm-object.h"
+#include "../str_arena.h"
+
+namespace ermia {
+namespace evict {
+
+/*
+ * Anti-caching: evict cold records to the log and fault them back in.
+ *
+ * Every committed version already has a durable copy in the log (pdest_), so
+ * the in-memory payload of a cold record is just a cache. Once a NUMA node's
+ * live memory (handed out minus sitting in free object pools) crosses
+ * config::evict_threshold_pct of node_memory_gb, an evictor
+ * thread sweeps the tables' OID arrays with a clock: readers set an object's
+ * referenced bit, the sweep clears it, and a head version that is still
+ * unreferenced on the next pass (about config::evict_cold_ms later) is cold.
+ *
+ * A cold record is evicted by swapping its head version for a stub: an object
+ * with the same clsn and pdest and a dbtuple header, but no value. The stub's
+ * payload instead records the OID entry it was installed at. Only records
+ * whose chain is a single full version that has reached durable storage are
+ * evicted, so the stub is all that's left and nothing older has to be kept.
+ * The replaced version is recycled once everyone who could have seen it has
+ * left the current epoch.
+ *
+ * Visibility checks only need the object header, so the stub behaves like any
+ * other version until someone reads its value: DoTupleRead then loads the
+ * value from the log into the transaction's arena, and if the stub is still
+ * the head, installs a memory-resident copy again. The read is synchronous;
+ * coroutine readers first hint the OS with Prefetch() (posix_fadvise
+ * WILLNEED) and suspend once, so the rest of the batch runs meanwhile.
+ *
+ * Not supported with checkpointing (which copies objects as they are in
+ * memory), replication, a null log device or the serializable CC schemes
+ * (which keep per-version stamps in the dbtuple header).
+ */
+
+struct evict_stats {
+  uint64_t evicted;      // versions swapped for stubs
+  uint64_t bytes;        // memory released by that
+  uint64_t faults;       // reads that had to go to the log
+  uint64_t reloads;      // ...and installed the record back in memory
+  uint64_t sweeps;       // passes over all tables
+  evict_stats() : evicted(0), bytes(0), faults(0), reloads(0), sweeps(0) {}
+};
+
+// Whether a node that has handed out [allocated] bytes, [free] of which are
+// back in its free object pools, is above config::evict_threshold_pct of
+// node_memory_gb. The node's bump pointer never moves back, so what eviction
+// released only shows up in [free].
+bool UnderPressure(uint64_t allocated, const MM::free_pool_stats &free);
+
+// Start/stop the evictor; no-op unless config::evict_threshold_pct is set.
+// Must start after all tables are created.
+void start_evict_thread();
+void stop_evict_thread();
+evict_stats get_evict_stats();
+
+// Called by readers of [obj]'s value
+inline void Touch(Object *obj) {
+  if (config::evict_threshold_pct && !obj->IsReferenced()) {
+    obj->SetReferenced(true);
+  }
+}
+
+// Evict the record at [entry] now if it qualifies (and, as in a sweep, wasn't
+// read since the last look); returns whether it was evicted
+bool Evict(fat_ptr *entry);
+
+// Hint the OS to read evicted [obj]'s value ahead; Load() still reads it
+// synchronously
+void Prefetch(Object *obj);
+
+// Copy evicted [obj]'s value to [arena] and point [out_v] to it; re-installs
+// the record in memory if [obj] is still its newest version
+void Load(Object *obj, str_arena &arena, varstr *out_v);
+
+}  // namespace evict
+}  // namespace ermia
@@ -0,0 +1,129 @@
+#include <unistd.h>
+
+#include "sm-gc.h"
+
+namespace ermia {
+namespace MM {
+
+bool background_gc = false;
+GCQueue **gc_queues = nullptr;
+uint32_t num_gc_queues = 0;
+
+GCQueue::GCQueue(uint32_t node) : enqueue_pos_(0), dropped_(0), dequeue_pos_(0) {
+  cells_ = (Cell *)numa_alloc_onnode(sizeof(Cell) * kCapacity, node);
+  ALWAYS_ASSERT(cells_);
+  for (uint64_t i = 0; i < kCapacity; ++i) {
+    new (&cells_[i].seq) std::atomic<uint64_t>(i);
+    cells_[i].entry = nullptr;
+  }
+}
+
+GCQueue::~GCQueue() { numa_free(cells_, sizeof(Cell) * kCapacity); }
+
+// Drains one queue, trimming the chains published to it
+class GCThread : public thread::Runner {
+ public:
+  // Chains to trim per MM epoch; the GC thread must not hold back epochs
+  static const uint32_t kBatchSize = 256;
+  static const uint32_t kIdleSleepUs = 100;
+
+  GCThread(GCQueue *queue) : Runner(false), queue(queue), stop(false) {}
+
+  virtual void MyWork(char *) override {
+    while (true) {
+      uint64_t backlog = queue->Backlog();
+      stats.max_backlog = std::max(stats.max_backlog, backlog);
+      if (!backlog) {
+        if (volatile_read(stop)) {
+          break;
+        }
+        usleep(kIdleSleepUs);
+        continue;
+      }
+
+      util::timer t;
+      epoch_num e = epoch_enter();
+      for (uint32_t i = 0; i < kBatchSize; ++i) {
+        fat_ptr *entry = queue->Pop();
+        if (!entry) {
+          break;
+        }
+        stats.versions += gc_version_chain(entry);
+        ++stats.chains;
+      }
+      epoch_exit(0, e);
+      // Make what we just recycled available to the workers right away
+      hand_off_free_objects();
+
+      uint64_t busy_us = t.lap();
+      stats.busy_us += busy_us;
+      // Idle for long enough to stay within the CPU budget
+      if (config::gc_cpu_budget < 100) {
+        usleep(busy_us * (100 - config::gc_cpu_budget) / config::gc_cpu_budget);
+      }
+    }
+  }
+
+  GCQueue *queue;
+  bool stop;
+  gc_stats stats;
+};
+
+static std::vector<GCThread *> gc_threads;
+
+void start_gc_threads() {
+  if (!config::enable_gc || !config::gc_threads_per_node || background_gc) {
+    return;
+  }
+  ALWAYS_ASSERT(config::gc_cpu_budget > 0 && config::gc_cpu_budget <= 100);
+
+  num_gc_queues = config::numa_nodes * config::gc_threads_per_node;
+  gc_queues = new GCQueue *[num_gc_queues];
+  for (uint32_t node = 0; node < config::numa_nodes; ++node) {
+    for (uint32_t i = 0; i < config::gc_threads_per_node; ++i) {
+      GCQueue *queue = new GCQueue(node);
+      gc_queues[gc_threads.size()] = queue;
+      // Prefer hyperthreads so GC doesn't take cores from the workers
+      GCThread *t = new GCThread(queue);
+      if (!t->TryImpersonate(node)) {
+        t->physical = true;
+        LOG_IF(FATAL, !t->TryImpersonate(node)) << "No thread left on node " << node << " for GC";
+      }
+      t->Start();
+      gc_threads.push_back(t);
+    }
+  }
+  LOG(INFO) << "Started " << gc_threads.size() << " GC threads";
+  volatile_write(background_gc, true);
+}
+
+void stop_gc_threads() {
+  if (!background_gc) {
+    return;
+  }
+  // Updaters go back to trimming inline; the GC threads drain what's left
+  volatile_write(background_gc, false);
+  for (auto *t : gc_threads) {
+    volatile_write(t->stop, true);
+  }
+  for (auto *t : gc_threads) {
+    t->Join();
+  }
+}
+
+gc_stats get_gc_stats() {
+  gc_stats s;
+  for (uint32_t i = 0; i < gc_threads.size(); ++i) {
+    auto &ts = gc_threads[i]->stats;
+    s.chains += ts.chains;
+    s.versions += ts.versions;
+    s.busy_us += ts.busy_us;
+    s.max_backlog = std::max(s.max_backlog, ts.max_backlog);
+    s.dropped += gc_queues[i]->Dropped();
+    s.backlog += gc_queues[i]->Backlog();
+  }
+  return s;
+}
+
+}  // namespace MM
+}  // namespace ermia
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+
+#include "sm-alloc.h"
+#include "sm-config.h"
+#include "sm-thread.h"
+
+namespace ermia {
+namespace MM {
+
+/*
+ * Background version chain GC.
+ *
+ * By default gc_version_chain() runs inline right after an updater installed
+ * a new version, so chains of records that stop being updated are never
+ * trimmed, and with skewed updates every updater of a hot record pays for
+ * walking its (long) chain on the critical path.
+ *
+ * With config::gc_threads_per_node > 0, updaters instead publish the OID
+ * entry they just updated to one of the GC threads' queues and move on. The
+ * queue is picked by the entry's address: each chain is thus only ever
+ * trimmed by one GC thread, which keeps the single-trimmer assumption
+ * gc_version_chain() relies on to unlink versions with a blind write. The GC
+ * threads are spread over all NUMA nodes and return the versions they
+ * recycle to their node's free object depot, where workers on that node pick
+ * them up.
+ *
+ * A queue that is full drops the entry; the chain gets published again the
+ * next time the record is updated.
+ */
+
+// Bounded multi-producer, single-consumer queue of OID entries
+class GCQueue {
+ public:
+  static const uint64_t kCapacity = 1 << 16;
+
+  GCQueue(uint32_t node);
+  ~GCQueue();
+
+  inline bool Push(fat_ptr *entry) {
+    uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &c = cells_[pos & (kCapacity - 1)];
+      uint64_t seq = c.seq.load(std::memory_order_acquire);
+      int64_t diff = (int64_t)seq - (int64_t)pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          c.entry = entry;
+          c.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Single consumer only
+  inline fat_ptr *Pop() {
+    Cell &c = cells_[dequeue_pos_ & (kCapacity - 1)];
+    if (c.seq.load(std::memory_order_acquire) != dequeue_pos_ + 1) {
+      return nullptr;
+    }
+    fat_ptr *entry = c.entry;
+    c.seq.store(dequeue_pos_ + kCapacity, std::memory_order_release);
+    ++dequeue_pos_;
+    return entry;
+  }
+
+  // Entries waiting to be processed
+  inline uint64_t Backlog() {
+    return enqueue_pos_.load(std::memory_order_relaxed) - volatile_read(dequeue_pos_);
+  }
+  inline uint64_t Dropped() { return dropped_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Cell {
+    std::atomic<uint64_t> seq;
+    fat_ptr *entry;
+  };
+  Cell *cells_;
+  std::atomic<uint64_t> enqueue_pos_ CACHE_ALIGNED;
+  std::atomic<uint64_t> dropped_;
+  uint64_t dequeue_pos_ CACHE_ALIGNED;
+};
+
+struct gc_stats {
+  uint64_t chains;       // chains looked at
+  uint64_t versions;     // versions recycled
+  uint64_t dropped;      // entries not published because a queue was full
+  uint64_t backlog;      // entries still queued
+  uint64_t max_backlog;  // largest backlog a GC thread has seen
+  uint64_t busy_us;      // time spent trimming
+  gc_stats() : chains(0), versions(0), dropped(0), backlog(0), max_backlog(0), busy_us(0) {}
+};
+
+// Start/stop the background GC threads; no-op unless config::enable_gc and
+// config::gc_threads_per_node are set
+void start_gc_threads();
+void stop_gc_threads();
+gc_stats get_gc_stats();
+
+extern bool background_gc;
+extern GCQueue **gc_queues;
+extern uint32_t num_gc_queues;
+
+// Called by an updater that just installed a new version at [oid_entry]
+inline void version_chain_updated(fat_ptr *oid_entry) {
+  if (!config::enable_gc) {
+    return;
+  }
+  if (volatile_read(background_gc)) {
+    uint64_t h = ((uint64_t)oid_entry >> 3) * 0x9e3779b97f4a7c15ull;
+    gc_queues[(h >> 32) % num_gc_queues]->Push(oid_entry);
+  } else {
+    gc_version_chain(oid_entry);
+  }
+}
+
+}  // namespace MM
+}  // namespace ermia
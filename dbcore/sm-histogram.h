@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+namespace ermia {
+
+/*
+ * A log-linear (HDR-style) histogram of non-negative integer samples, used to
+ * track transaction latencies in microseconds.
+ *
+ * Values below 2 * kSubBuckets get a bucket each. Above that, every power of
+ * two range [2^k, 2^(k+1)) is split into kSubBuckets equal-width buckets, so
+ * a recorded value is off by at most 1/kSubBuckets (~3%) of itself while the
+ * whole 64-bit range fits in a fixed array of kBuckets counters.
+ *
+ * The counters live inline: recording is a couple of shifts and increments,
+ * never allocates and never takes a lock. A histogram has a single writer
+ * (e.g., one per worker and transaction type); readers merge the per-writer
+ * histograms once the writers are done.
+ */
+class LatencyHistogram {
+public:
+  static const uint32_t kSubBucketBits = 5;
+  static const uint32_t kSubBuckets = 1 << kSubBucketBits;
+  static const uint32_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram() { Reset(); }
+
+  void Reset() {
+    memset(counts_, 0, sizeof(counts_));
+    count_ = 0;
+    sum_ = 0;
+    min_ = ~uint64_t{0};
+    max_ = 0;
+  }
+
+  static inline uint32_t BucketIndex(uint64_t value) {
+    if (value < 2 * kSubBuckets) {
+      return value;
+    }
+    uint32_t shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+    return (shift << kSubBucketBits) + (value >> shift);
+  }
+
+  // Smallest value that maps to bucket [idx]
+  static inline uint64_t BucketLow(uint32_t idx) {
+    if (idx < 2 * kSubBuckets) {
+      return idx;
+    }
+    uint32_t shift = (idx >> kSubBucketBits) - 1;
+    return uint64_t(idx - (shift << kSubBucketBits)) << shift;
+  }
+
+  // Largest value that maps to bucket [idx]
+  static inline uint64_t BucketHigh(uint32_t idx) {
+    if (idx < 2 * kSubBuckets) {
+      return idx;
+    }
+    uint32_t shift = (idx >> kSubBucketBits) - 1;
+    return BucketLow(idx) + (uint64_t{1} << shift) - 1;
+  }
+
+  inline void Record(uint64_t value) {
+    ++counts_[BucketIndex(value)];
+    ++count_;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void Merge(const LatencyHistogram &other) {
+    if (!other.count_) {
+      return;
+    }
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  inline uint64_t Count() const { return count_; }
+  inline uint64_t Min() const { return count_ ? min_ : 0; }
+  inline uint64_t Max() const { return max_; }
+  inline double Mean() const { return count_ ? double(sum_) / count_ : 0; }
+
+  // Value at or below which [percentile]% of the samples fall. Reports the
+  // upper end of the bucket the sample landed in, capped at the exact max.
+  uint64_t ValueAtPercentile(double percentile) const {
+    if (!count_) {
+      return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(percentile / 100.0 * count_ + 0.5));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        return std::min(BucketHigh(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  // One line: count, mean and the usual SLO percentiles
+  void PrintSummary(std::ostream &os) const {
+    os << count_ << " samples\tavg " << Mean() << "\tp50 " << ValueAtPercentile(50)
+       << "\tp99 " << ValueAtPercentile(99) << "\tp99.9 " << ValueAtPercentile(99.9)
+       << "\tmax " << Max();
+  }
+
+  // Summary plus the non-empty buckets as [low, high, count] triples
+  void PrintJson(std::ostream &os) const {
+    os << "{\"count\": " << count_ << ", \"min\": " << Min() << ", \"max\": " << Max()
+       << ", \"mean\": " << Mean() << ", \"p50\": " << ValueAtPercentile(50)
+       << ", \"p90\": " << ValueAtPercentile(90) << ", \"p99\": " << ValueAtPercentile(99)
+       << ", \"p99.9\": " << ValueAtPercentile(99.9) << ", \"buckets\": [";
+    bool first = true;
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+      if (counts_[i]) {
+        os << (first ? "" : ", ") << "[" << BucketLow(i) << ", " << BucketHigh(i)
+           << ", " << counts_[i] << "]";
+        first = false;
+      }
+    }
+    os << "]}";
+  }
+
+private:
+  uint64_t counts_[kBuckets];
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t min_;
+  uint64_t max_;
+};
+
+}  // namespace ermia
@@ -1,3 +1,6 @@
+#include <numa.h>
+#include <sched.h>
+
 #include "rcu.h"
 #include "sm-cmd-log.h"
 #include "sm-log-alloc.h"
@@ -25,6 +28,7 @@ enum { DAEMON_HAS_WORK = 0x1, DAEMON_SLEEPING = 0x2 };
 namespace ermia {
 
 uint64_t sm_log_alloc_mgr::commit_queue::total_latency_us = 0;
+LatencyHistogram sm_log_alloc_mgr::commit_queue::durable_latency[kMaxTypes];
 
 void sm_log_alloc_mgr::set_tls_lsn_offset(uint64_t offset) {
   volatile_write(_tls_lsn_offset[thread::MyId()], offset);
@@ -47,7 +51,14 @@ sm_log_alloc_mgr::sm_log_alloc_mgr(sm_log_recover_impl *rf, void *rfn_arg)
       _waiting_for_dmark(false),
       _write_daemon_should_wake(false),
       _write_daemon_should_stop(false),
-      _lsn_offset(_lm.get_durable_mark().offset()) {
+      _lsn_offset(_lm.get_durable_mark().offset()),
+      _lsn_requests(nullptr),
+      _lsn_groups(nullptr),
+      _num_lsn_groups(0),
+      _log_writer(nullptr),
+      _submitted_sid(nullptr),
+      _submitted_lsn_offset(0),
+      _active_fd(-1) {
   _logbuf_partition_size =
       config::log_buffer_mb * config::MB / config::log_redo_partitions;
   ALWAYS_ASSERT(
@@ -59,12 +70,23 @@ sm_log_alloc_mgr::sm_log_alloc_mgr(sm_log_recover_impl *rf, void *rfn_arg)
         (uint64_t *)malloc(sizeof(uint64_t) * config::MAX_THREADS);
     memset(_tls_lsn_offset, 0, sizeof(uint64_t) * config::MAX_THREADS);
 
+    if (config::log_lsn_consolidation) {
+      _lsn_requests = new lsn_request[config::MAX_THREADS];
+      _num_lsn_groups = numa_max_node() + 1;
+      _lsn_groups = new lsn_group[_num_lsn_groups];
+    }
+
     uint32_t n = config::is_backup_srv() ? config::replay_threads : config::worker_threads;
     _commit_queue = new commit_queue[n];
     for (uint32_t i = 0; i < n; ++i) {
       _commit_queue[i].lm = this;
     }
 
+    _log_writer = new log_writer(config::log_io_uring ? config::log_io_depth : 1,
+                                 config::log_io_uring, config::log_direct_io);
+    // Both mappings, so every window the daemon writes is covered
+    _log_writer->RegisterBuffer(_logbuf->_data, 2 * _logbuf->window_size());
+
     // fire up the log writing daemon
     _write_daemon_mutex.lock();
     DEFER(_write_daemon_mutex.unlock());
@@ -72,6 +94,10 @@ sm_log_alloc_mgr::sm_log_alloc_mgr(sm_log_recover_impl *rf, void *rfn_arg)
     int err =
         pthread_create(&_write_daemon_tid, NULL, &log_write_daemon_thunk, this);
     THROW_IF(err, os_error, err, "Unable to start log writer daemon thread");
+
+    if (config::log_direct_io && !config::null_log_device) {
+      _segment_preparer = std::thread(&sm_log_alloc_mgr::_segment_prepare_daemon, this);
+    }
   }
 }
 
@@ -79,18 +105,43 @@ sm_log_alloc_mgr::~sm_log_alloc_mgr() {
   _write_daemon_should_stop = true;
   int err = pthread_join(_write_daemon_tid, NULL);
   LOG_IF(FATAL, err) << "Unable to join log writer daemon thread";
+  if (_segment_preparer.joinable()) {
+    _segment_preparer.join();
+  }
+  ASSERT(_flush_windows.empty());
+  if (_log_writer) {
+    log_writer::stats s = _log_writer->GetStats();
+    LOG(INFO) << "Log writes: " << s.writes << " (" << s.bytes << " bytes), max in flight "
+              << s.max_inflight << ", waited for a free slot " << s.full_waits << " times";
+  }
+  delete _log_writer;
+  for (uint32_t i = 0; i < _num_lsn_groups; ++i) {
+    lsn_group &g = _lsn_groups[i];
+    if (g.batches) {
+      LOG(INFO) << "LSN consolidation on node " << i << ": " << g.requests << " requests in "
+                << g.batches << " batches (" << (double)g.requests / g.batches << " per batch)";
+    }
+  }
+  delete[] _lsn_groups;
+  delete[] _lsn_requests;
+  if (_active_fd >= 0) {
+    os_close(_active_fd);
+  }
 }
 
 void sm_log_alloc_mgr::enqueue_committed_xct(uint32_t worker_id,
-                                             uint64_t start_time) {
+                                             uint64_t start_time,
+                                             uint32_t type) {
+  ASSERT(type < commit_queue::kMaxTypes);
   uint64_t lsn = config::command_log ?
                  CommandLog::cmd_log->GetTlsOffset() :
                  get_tls_lsn_offset() & ~kDirtyTlsLsnOffset;
-  _commit_queue[worker_id].push_back(lsn, start_time);
+  _commit_queue[worker_id].push_back(lsn, start_time, type);
 }
 
 void sm_log_alloc_mgr::commit_queue::push_back(uint64_t lsn,
-                                               uint64_t start_time) {
+                                               uint64_t start_time,
+                                               uint32_t type) {
   bool flush = false;
   bool insert = true;
 retry :
@@ -111,6 +162,7 @@ retry :
       uint32_t idx = (start + items) % config::group_commit_queue_length;
       volatile_write(queue[idx].lsn, lsn);
       volatile_write(queue[idx].start_time, start_time);
+      volatile_write(queue[idx].type, type);
       volatile_write(items, items + 1);
       ASSERT(items == size());
       insert = false;
@@ -136,6 +188,7 @@ void sm_log_alloc_mgr::dequeue_committed_xcts(uint64_t upto,
         break;
       }
       _commit_queue[i].total_latency_us += end_time - entry.start_time;
+      commit_queue::durable_latency[entry.type].Record(end_time - entry.start_time);
       dequeue++;
     }
     _commit_queue[i].items -= dequeue;
@@ -384,9 +437,14 @@ int sm_log_alloc_mgr::open_segment_for_read(segment_id *sid) {
 
 /* Figure out the corresponding segments in the logbuf and flush them.
  * The caller should enter/exit_rcu().
+ *
+ * With config::log_io_uring, the writes issued here might still be in flight
+ * when we return: each becomes a flush window that is retired (making it
+ * durable and releasing its log buffer space) by later calls once the write
+ * completed. Returns the segment that contains the durable LSN offset.
  */
 segment_id *sm_log_alloc_mgr::PrimaryFlushLog(uint64_t new_dlsn_offset,
-                                              bool update_dmark) {
+                                              bool update_dmark, bool drain) {
   ASSERT(!config::is_backup_srv() || config::command_log);
   /* The primary ships log records at log buffer flush boundaries, and log
    * flushing respects segment boundaries. Threads trying to carve out a range
@@ -406,9 +464,16 @@ segment_id *sm_log_alloc_mgr::PrimaryFlushLog(uint64_t new_dlsn_offset,
   ASSERT(_durable_flushed_lsn_offset <= new_dlsn_offset);
   auto *durable_sid = _lm.get_segment(dlsn.segment());
   ALWAYS_ASSERT(durable_sid);
-  uint64_t durable_byte = durable_sid->buf_offset(_durable_flushed_lsn_offset);
-  int active_fd = _lm.open_for_write(durable_sid);
-  DEFER(os_close(active_fd));
+  if (_flush_windows.empty()) {
+    // Nothing in flight, continue from the durable offset
+    _submitted_sid = durable_sid;
+    _submitted_lsn_offset = _durable_flushed_lsn_offset;
+  }
+  uint64_t submitted_byte = _submitted_sid->buf_offset(_submitted_lsn_offset);
+
+  // Shipping and backup acks assume the previous window is already durable
+  bool sync = !_log_writer->IsAsync() || config::num_backups ||
+              config::num_active_backups;
 
   /* The block list contains a fluctuating---and usually fairly
      short---set of log_allocation objects. Releasing or
@@ -426,12 +491,13 @@ segment_id *sm_log_alloc_mgr::PrimaryFlushLog(uint64_t new_dlsn_offset,
      segment to obtain an LSN.
    */
   bool new_seg = false;
-  while (_durable_flushed_lsn_offset < new_dlsn_offset) {
+  bool submitted = false;
+  while (_submitted_lsn_offset < new_dlsn_offset) {
     segment_id *new_sid;
     uint64_t new_offset;
     uint64_t new_byte;
 
-    if (durable_sid->end_offset < new_dlsn_offset + MIN_LOG_BLOCK_SIZE) {
+    if (_submitted_sid->end_offset < new_dlsn_offset + MIN_LOG_BLOCK_SIZE) {
       /* Watch out for segment boundaries!
 
          The true end of a segment is somewhere in the last
@@ -441,20 +507,20 @@ segment_id *sm_log_alloc_mgr::PrimaryFlushLog(uint64_t new_dlsn_offset,
          this "red zone" also ensures that the next segment
          has been created, so we can safely access it.
        */
-      new_sid = _lm.get_segment((durable_sid->segnum + 1) % NUM_LOG_SEGMENTS);
+      new_sid = _lm.get_segment((_submitted_sid->segnum + 1) % NUM_LOG_SEGMENTS);
       ASSERT(new_sid);
       new_offset = new_sid->start_offset;
       new_byte = new_sid->byte_offset;
       DLOG(INFO) << "Crossing segment boundary, new_offset=" << std::hex
                  << new_offset << " new_byte=" << new_byte << std::dec;
     } else {
-      new_sid = durable_sid;
+      new_sid = _submitted_sid;
       new_offset = new_dlsn_offset;
       new_byte = new_sid->buf_offset(new_dlsn_offset);
     }
 
-    ASSERT(durable_byte == _logbuf->read_begin());
-    ASSERT(durable_byte < new_byte);
+    ASSERT(_logbuf->read_begin() <= submitted_byte);
+    ASSERT(submitted_byte < new_byte);
     ASSERT(new_byte <= _logbuf->write_end());
 
     /* Log insertions don't advance the buffer window because
@@ -462,60 +528,114 @@ segment_id *sm_log_alloc_mgr::PrimaryFlushLog(uint64_t new_dlsn_offset,
        that we know the correct value to use. The only exception
        is when we read and replay the log buffer directly.
      */
-    uint64_t nbytes = new_byte - durable_byte;
-    if (_logbuf->available_to_read() < nbytes) {
+    uint64_t nbytes = new_byte - submitted_byte;
+    if (_logbuf->read_end() < new_byte) {
       _logbuf->advance_writer(new_byte);
     }
-    THROW_IF(_logbuf->available_to_read() < nbytes, log_file_error,
+    THROW_IF(_logbuf->read_end() < new_byte, log_file_error,
              "Not enough log bufer to read");
 
     // perform the write
-    auto *buf = _logbuf->read_buf(durable_byte, nbytes);
-    auto file_offset = durable_sid->offset(_durable_flushed_lsn_offset);
+    auto *buf = _logbuf->read_buf(submitted_byte, nbytes);
+    auto file_offset = _submitted_sid->offset(_submitted_lsn_offset);
 
     // Ship the log to backups, unless we're doing async log shipping
     if (!config::command_log &&
         config::persist_policy != config::kPersistAsync &&
         config::num_active_backups &&
         !config::IsLoading()) {
-      PrimaryShipLog(durable_sid, nbytes, new_seg, new_offset, buf);
+      PrimaryShipLog(_submitted_sid, nbytes, new_seg, new_offset, buf);
       if (new_seg) {
         new_seg = false;
       }
     }
 
-    uint64_t n = 0;
+    flush_window w;
+    w.sid = new_sid;
+    w.end_offset = new_offset;
+    w.end_byte = new_byte;
+    w.close_fd = -1;
     // Note: Here we actually allow skip log writing on the primary node even in
     // a primary/backup setting, but for benchmarking purpose only. A fully
     // 'correct' setting is to ensure persistence at *all* nodes, including the
     // primary.  Note(tzwang): 20170428: the only reason I added this is due to
     // lack of DRAM space for storing log files in tmpfs.
-    if (config::null_log_device && (config::num_active_backups == 0 || !config::IsLoading())) {
-      n = nbytes;
-    } else {
-      n = os_pwrite(active_fd, buf, nbytes, file_offset);
+    w.io = !(config::null_log_device &&
+             (config::num_active_backups == 0 || !config::IsLoading()));
+    if (w.io) {
+      if (_log_writer->Full()) {
+        _log_writer->CountFullWait();
+        durable_sid = RetireFlushWindows(true, update_dmark, durable_sid);
+      }
+      if (_active_fd < 0) {
+        _active_fd = _lm.open_for_write(_submitted_sid, config::log_direct_io);
+      }
+      _log_writer->Submit(_active_fd, buf, nbytes, file_offset);
       if (!config::command_log && config::persist_policy == config::kPersistAsync) {
         rep::async_ship_cond.notify_all();
       }
     }
-    LOG_IF(FATAL, n < nbytes) << "Incomplete log write";
-
-    // After this the buffer space will become available for consumption
-    _logbuf->advance_reader(new_byte);
 
-    // segment change?
-    if (new_sid != durable_sid) {
-      os_close(active_fd);
-      active_fd = _lm.open_for_write(new_sid);
+    // segment change? The old file stays open until its last write is done
+    if (new_sid != _submitted_sid) {
+      w.close_fd = _active_fd;
+      _active_fd = -1;
       ASSERT(!new_seg);
       new_seg = true;
     }
+    _flush_windows.push_back(w);
+    submitted = true;
 
     // update values for next round
-    durable_sid = new_sid;
-    _durable_flushed_lsn_offset = new_offset;
-    durable_byte = new_byte;
+    _submitted_sid = new_sid;
+    _submitted_lsn_offset = new_offset;
+    submitted_byte = new_byte;
+
+    if (sync) {
+      durable_sid = RetireFlushWindows(true, update_dmark, durable_sid);
+      ASSERT(_flush_windows.empty());
+    }
+  }
+
+  // Pick up whatever completed meanwhile; if there was nothing new to write,
+  // the caller is waiting on the writes in flight
+  durable_sid = RetireFlushWindows(!submitted, update_dmark, durable_sid);
+  while (drain && !_flush_windows.empty()) {
+    durable_sid = RetireFlushWindows(true, update_dmark, durable_sid);
+  }
+  return durable_sid;
+}
 
+/* Retire flush windows whose writes (and all writes before them) completed:
+ * advance the durable offset and hand their space in the log buffer back to
+ * log allocation. With [wait] set, block until at least the oldest one
+ * completed. Returns the segment that contains the durable LSN offset.
+ */
+segment_id *sm_log_alloc_mgr::RetireFlushWindows(bool wait, bool update_dmark,
+                                                 segment_id *durable_sid) {
+  uint32_t completed = _log_writer->Reap(false);
+  while (!_flush_windows.empty()) {
+    flush_window &w = _flush_windows.front();
+    if (w.io) {
+      if (!completed) {
+        if (!wait) {
+          break;
+        }
+        completed = _log_writer->Reap(true);
+        ALWAYS_ASSERT(completed);
+      }
+      --completed;
+    }
+    wait = false;
+
+    // After this the buffer space will become available for consumption
+    _logbuf->advance_reader(w.end_byte);
+    if (w.close_fd >= 0) {
+      os_close(w.close_fd);
+    }
+
+    durable_sid = w.sid;
+    _durable_flushed_lsn_offset = w.end_offset;
     if (update_dmark) {
       // Have to use LSN::make (instead of durable_sid->make_lsn which checks
       // lsn offset ownership): If we're on a backup server, then this new
@@ -525,7 +645,9 @@ segment_id *sm_log_alloc_mgr::PrimaryFlushLog(uint64_t new_dlsn_offset,
       _lm.update_durable_mark(
           LSN::make(_durable_flushed_lsn_offset, durable_sid->segnum));
     }
+    _flush_windows.pop_front();
   }
+  ASSERT(!completed);
   return durable_sid;
 }
 
@@ -624,7 +746,7 @@ log_allocation *sm_log_alloc_mgr::allocate(uint32_t nrec,
 
 start_over:
   size_t nbytes = log_block::size(nrec, payload_bytes);
-  auto lsn_offset = __sync_fetch_and_add(&_lsn_offset, nbytes);
+  auto lsn_offset = acquire_lsn_offset(nbytes);
   auto next_lsn_offset = lsn_offset + nbytes;
 
   /* We are now the proud owners of an LSN offset range, most likely
@@ -689,9 +811,34 @@ start_over:
     tmp_payload_bytes = 0;
   }
 
-grab_buffer:
-  char *buf = _logbuf->write_buf(sid->buf_offset(lsn), tmp_nbytes);
-  if (not buf) {
+  char *buf = _wait_for_write_buf(sid, lsn, tmp_nbytes);
+  log_block *b = (log_block *)buf;
+  b->lsn = lsn;
+  b->nrec = tmp_nrec;
+  fill_skip_record(&b->records[tmp_nrec], rval.next_lsn, tmp_payload_bytes,
+                   false);
+
+  if (not rval.full_size) {
+    goto start_over;
+  }
+
+  log_allocation *x = nullptr;
+  int err = posix_memalign((void **)&x, DEFAULT_ALIGNMENT, sizeof(log_allocation));
+  LOG_IF(FATAL, err != 0);
+  x->lsn_offset = lsn_offset;
+  x->block = b;
+  x->more_in_batch = false;
+
+  // success!
+  return x;
+}
+
+char *sm_log_alloc_mgr::_wait_for_write_buf(segment_id *sid, LSN lsn, size_t nbytes) {
+  while (true) {
+    char *buf = _logbuf->write_buf(sid->buf_offset(lsn), nbytes);
+    if (buf) {
+      return buf;
+    }
     /* Unavailable write buffer space is due to unconsumed reads,
        which in turn are really just due to non-durable
        log. Figure out which durable LSN corresponds to the buffer
@@ -705,33 +852,158 @@ grab_buffer:
 
     _kick_log_write_daemon();
     _write_complete_cond.wait(_write_daemon_mutex);
-    goto grab_buffer;
   }
+}
 
-  log_block *b = (log_block *)buf;
-  b->lsn = lsn;
-  b->nrec = tmp_nrec;
-  fill_skip_record(&b->records[tmp_nrec], rval.next_lsn, tmp_payload_bytes,
-                   false);
+/* Same protocol as allocate(), except that the LSN offset range covers all
+   [n] blocks. Segment boundaries are left to allocate(): if the range falls
+   into a dead zone it's simply dropped, and if it overflows the segment we
+   close the segment with a skip block before giving up.
+ */
+bool sm_log_alloc_mgr::allocate_batch(uint32_t n, const uint32_t *nrec,
+                                      const size_t *payload_bytes,
+                                      log_allocation **out) {
+  // Shipping needs to know block boundaries at log buffer partitions
+  if (!config::IsLoading() && config::num_active_backups && !config::command_log) {
+    return false;
+  }
+
+  size_t nbytes = 0;
+  for (uint32_t i = 0; i < n; ++i) {
+    ASSERT(is_aligned(payload_bytes[i]));
+    nbytes += log_block::size(nrec[i], payload_bytes[i]);
+  }
+  if (nbytes > sm_log_recover_mgr::MAX_BLOCK_SIZE) {
+    return false;
+  }
+
+  // Stays dirty (at an offset before all of the blocks) until the last one
+  // is released
+  uint64_t *my_off = &_tls_lsn_offset[thread::MyId()];
+  volatile_write(*my_off, *my_off | kDirtyTlsLsnOffset);
+
+  auto lsn_offset = acquire_lsn_offset(nbytes);
+  auto next_lsn_offset = lsn_offset + nbytes;
+  auto rval = _lm.assign_segment(lsn_offset, next_lsn_offset);
+  auto *sid = rval.sid;
+  if (not sid) {
+    return false;
+  }
 
   if (not rval.full_size) {
-    goto start_over;
+    // Close the segment, see allocate()
+    uint64_t newsz = sid->end_offset - lsn_offset;
+    ASSERT(newsz < nbytes);
+    log_block *b = (log_block *)_wait_for_write_buf(sid, sid->make_lsn(lsn_offset), newsz);
+    b->lsn = sid->make_lsn(lsn_offset);
+    b->nrec = 0;
+    fill_skip_record(&b->records[0], rval.next_lsn, 0, false);
+    b->checksum = b->full_checksum();
+    return false;
   }
 
-  log_allocation *x = nullptr;
-  int err = posix_memalign((void **)&x, DEFAULT_ALIGNMENT, sizeof(log_allocation));
-  LOG_IF(FATAL, err != 0);
-  x->lsn_offset = lsn_offset;
-  x->block = b;
+  char *buf = _wait_for_write_buf(sid, sid->make_lsn(lsn_offset), nbytes);
+  for (uint32_t i = 0; i < n; ++i) {
+    size_t block_bytes = log_block::size(nrec[i], payload_bytes[i]);
+    log_block *b = (log_block *)buf;
+    b->lsn = sid->make_lsn(lsn_offset);
+    b->nrec = nrec[i];
+    lsn_offset += block_bytes;
+    LSN next_lsn = (i == n - 1) ? rval.next_lsn : sid->make_lsn(lsn_offset);
+    fill_skip_record(&b->records[nrec[i]], next_lsn, payload_bytes[i], false);
+
+    log_allocation *x = nullptr;
+    int err = posix_memalign((void **)&x, DEFAULT_ALIGNMENT, sizeof(log_allocation));
+    LOG_IF(FATAL, err != 0);
+    x->lsn_offset = b->lsn.offset();
+    x->block = b;
+    x->more_in_batch = (i < n - 1);
+    out[i] = x;
+    buf += block_bytes;
+  }
+  ASSERT(lsn_offset == next_lsn_offset);
+  return true;
+}
 
-  // success!
-  return x;
+uint64_t sm_log_alloc_mgr::acquire_lsn_offset(uint64_t nbytes) {
+  if (_lsn_requests) {
+    return consolidate_lsn_offset(nbytes);
+  }
+  return __sync_fetch_and_add(&_lsn_offset, nbytes);
+}
+
+/* Get an LSN offset range of [nbytes] by combining requests with the other
+   threads of the same NUMA node (see _lsn_requests). Post the request, then
+   either find it served by another thread or take the node's lock and serve
+   every pending request, including this one, with one fetch-and-add.
+ */
+uint64_t sm_log_alloc_mgr::consolidate_lsn_offset(uint64_t nbytes) {
+  lsn_request &me = _lsn_requests[thread::MyId()];
+  if (me.group < 0) {
+    // Worker threads are pinned, so the node we run on now is ours for good;
+    // if not, we'd only combine with a few remote threads.
+    int node = numa_node_of_cpu(sched_getcpu());
+    me.group = node < 0 ? 0 : node % _num_lsn_groups;
+    lsn_group &g = _lsn_groups[me.group];
+    // Under the node's lock, so that a combiner never sees a member whose
+    // slot isn't filled in yet
+    while (volatile_read(g.lock) or not __sync_bool_compare_and_swap(&g.lock, 0, 1)) {
+      NOP_PAUSE;
+    }
+    ALWAYS_ASSERT(g.nmembers < config::MAX_THREADS);
+    g.members[g.nmembers] = thread::MyId();
+    volatile_write(g.nmembers, g.nmembers + 1);
+    __sync_lock_release(&g.lock);
+  }
+  lsn_group &g = _lsn_groups[me.group];
+
+  ASSERT(nbytes and not(nbytes & kLsnGranted));
+  volatile_write(me.word, nbytes);
+  while (true) {
+    uint64_t w = volatile_read(me.word);
+    if (w & kLsnGranted) {
+      volatile_write(me.word, 0);
+      return w & ~kLsnGranted;
+    }
+    if (volatile_read(g.lock) or not __sync_bool_compare_and_swap(&g.lock, 0, 1)) {
+      NOP_PAUSE;
+      continue;
+    }
+
+    // Combine. Members only register while holding the lock.
+    uint32_t ids[config::MAX_THREADS];
+    uint64_t sizes[config::MAX_THREADS];
+    uint32_t npending = 0;
+    uint64_t total = 0;
+    uint32_t nmembers = volatile_read(g.nmembers);
+    for (uint32_t i = 0; i < nmembers; ++i) {
+      uint32_t id = volatile_read(g.members[i]);
+      uint64_t r = volatile_read(_lsn_requests[id].word);
+      if (r and not(r & kLsnGranted)) {
+        ids[npending] = id;
+        sizes[npending++] = r;
+        total += r;
+      }
+    }
+    // Our own request may have been served by the previous lock holder
+    if (npending) {
+      uint64_t offset = __sync_fetch_and_add(&_lsn_offset, total);
+      for (uint32_t i = 0; i < npending; ++i) {
+        volatile_write(_lsn_requests[ids[i]].word, offset | kLsnGranted);
+        offset += sizes[i];
+      }
+      g.requests += npending;
+      ++g.batches;
+    }
+    __sync_lock_release(&g.lock);
+  }
 }
 
 void sm_log_alloc_mgr::release(log_allocation *x) {
   // Include the size of our allocation, indicated by next_lsn.
   // Otherwise we might lose committed work.
-  if (!config::is_backup_srv() || (config::command_log && config::replay_threads)) {
+  if ((!config::is_backup_srv() || (config::command_log && config::replay_threads)) &&
+      !x->more_in_batch) {
     // Only need to do this for the primary server - worker threads on
     // backups don't do updates
     set_tls_lsn_offset(x->block->next_lsn().offset());
@@ -824,11 +1096,14 @@ void sm_log_alloc_mgr::_log_write_daemon() {
     }
     segment_id *durable_sid = nullptr;
     if (new_dlsn_offset > _durable_flushed_lsn_offset) {
-      durable_sid = PrimaryFlushLog(new_dlsn_offset);
+      // Someone waiting in flush() wants everything so far on disk
+      durable_sid = PrimaryFlushLog(new_dlsn_offset, false,
+                                    volatile_read(_waiting_for_dmark));
     }
     if (!config::command_log) {
-      // Dequeue transactions pending persistence (if pipelined group commit is on)
-      PrimaryCommitPersistedWork(new_dlsn_offset);
+      // Dequeue transactions pending persistence (if pipelined group commit is
+      // on); with writes in flight, only what's retired is persistent
+      PrimaryCommitPersistedWork(std::min(new_dlsn_offset, _durable_flushed_lsn_offset));
     }
 
     /* Having completed a round of writes, notify waiting threads
@@ -872,7 +1147,8 @@ void sm_log_alloc_mgr::_log_write_daemon() {
     }
 
     // time to sleep?
-    while (!_write_daemon_should_stop && !(volatile_read(_write_daemon_state) & DAEMON_HAS_WORK)) {
+    while (!_write_daemon_should_stop && _flush_windows.empty() &&
+           !(volatile_read(_write_daemon_state) & DAEMON_HAS_WORK)) {
       // looks like we can sleep
       auto old_state =
           __sync_fetch_and_or(&_write_daemon_state, DAEMON_SLEEPING);
@@ -897,6 +1173,18 @@ void sm_log_alloc_mgr::_log_write_daemon() {
   }
 }
 
+/* Keep the next log segment's file created and its space allocated well
+   before the active segment fills up, so neither the thread that installs
+   the next segment nor the log writer has to wait for the file system.
+ */
+void sm_log_alloc_mgr::_segment_prepare_daemon() {
+  static const uint32_t kSegmentPrepareIntervalUs = 10000;
+  while (!volatile_read(_write_daemon_should_stop)) {
+    _lm.prepare_nxt_seg_file();
+    usleep(kSegmentPrepareIntervalUs);
+  }
+}
+
 /* Wake up the log write daemon if it happens to be alseep.
 
    WARNING: caller must hold the log write mutex!
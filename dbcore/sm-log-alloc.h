@@ -1,7 +1,10 @@
 #pragma once
 
 #include <deque>
+#include <thread>
+#include "sm-log-io.h"
 #include "sm-log-recover.h"
+#include "sm-histogram.h"
 
 namespace ermia {
 
@@ -54,6 +57,19 @@ struct sm_log_alloc_mgr {
    */
   log_allocation *allocate(uint32_t nrec, size_t payload_bytes);
 
+  /* Allocate [n] log blocks back to back with one LSN acquisition,
+     the i-th one for [nrec[i]] records and [payload_bytes[i]] bytes
+     of payload. Each block is a regular log block with its own
+     header, skip record and LSN, but the caller must release (or
+     discard) them in order.
+
+     Return false without allocating anything if the blocks can't go
+     together (too big, crossing a segment, or log shipping needs
+     block boundaries), so the caller should allocate them one by one.
+   */
+  bool allocate_batch(uint32_t n, const uint32_t *nrec, const size_t *payload_bytes,
+                      log_allocation **out);
+
   /* Release a fully populated allocation. Its contents will be
      written to disk in the background.
 
@@ -73,14 +89,18 @@ struct sm_log_alloc_mgr {
 
   void _log_write_daemon();
   void _kick_log_write_daemon();
+  char *_wait_for_write_buf(segment_id *sid, LSN lsn, size_t nbytes);
+  void _segment_prepare_daemon();
   segment_id *PrimaryFlushLog(uint64_t new_dlsn_dlsn,
-                              bool update_dmark = false);
+                              bool update_dmark = false, bool drain = false);
+  segment_id *RetireFlushWindows(bool wait, bool update_dmark,
+                                 segment_id *durable_sid);
   void PrimaryShipLog(segment_id *durable_sid, uint64_t nbytes,
                       bool new_seg, uint64_t new_offset, const char *buf);
   void PrimaryCommitPersistedWork(uint64_t new_offset);
   void BackupFlushLog(uint64_t new_dlsn_dlsn);
   uint64_t smallest_tls_lsn_offset();
-  void enqueue_committed_xct(uint32_t worker_id, uint64_t start_time);
+  void enqueue_committed_xct(uint32_t worker_id, uint64_t start_time, uint32_t type);
   void dequeue_committed_xcts(uint64_t up_to, uint64_t end_time);
   int open_segment_for_read(segment_id * sid);
 
@@ -144,6 +164,40 @@ struct sm_log_alloc_mgr {
   static const uint64_t kDirtyTlsLsnOffset = uint64_t{1} << 63;
   uint64_t *_tls_lsn_offset CACHE_ALIGNED;
   uint64_t _lsn_offset CACHE_ALIGNED;
+
+  // With config::log_lsn_consolidation, threads don't fetch-and-add
+  // _lsn_offset themselves. On a multi-socket machine every committer doing
+  // so keeps the cache line bouncing across sockets, so instead threads on
+  // the same NUMA node post their block size to their own request slot, and
+  // whoever grabs the node's combining lock sums up all pending requests of
+  // the node, takes one range with a single fetch-and-add and hands out
+  // consecutive pieces of it. The result is the same as if the requests had
+  // each added to _lsn_offset back to back: there is still one log and one
+  // LSN order, which matters because LSN offsets double as begin and commit
+  // timestamps.
+  //
+  // A request slot holds the requested size while pending and the granted
+  // offset (with kLsnGranted set) once served.
+  static const uint64_t kLsnGranted = uint64_t{1} << 63;
+  struct lsn_request {
+    uint64_t word;
+    int32_t group;  // NUMA node the thread registered with, -1 if not yet
+    lsn_request() : word(0), group(-1) {}
+  } CACHE_ALIGNED;
+  struct lsn_group {
+    uint32_t lock;
+    uint32_t nmembers;
+    uint32_t members[config::MAX_THREADS];  // thread IDs
+    // Stats, only updated by the lock holder
+    uint64_t requests;
+    uint64_t batches;
+    lsn_group() : lock(0), nmembers(0), requests(0), batches(0) {}
+  } CACHE_ALIGNED;
+  lsn_request *_lsn_requests;
+  lsn_group *_lsn_groups;
+  uint32_t _num_lsn_groups;
+  uint64_t acquire_lsn_offset(uint64_t nbytes);
+  uint64_t consolidate_lsn_offset(uint64_t nbytes);
   uint64_t _logbuf_partition_size CACHE_ALIGNED;
 
   // One queue per worker thread to account latency under group commit
@@ -153,7 +207,8 @@ struct sm_log_alloc_mgr {
     struct Entry {
       uint64_t lsn;
       uint64_t start_time;
-      Entry() : lsn(0), start_time(0) {}
+      uint32_t type;
+      Entry() : lsn(0), start_time(0), type(0) {}
     };
     Entry *queue;
     mcs_lock lock;
@@ -161,13 +216,39 @@ struct sm_log_alloc_mgr {
     uint32_t items;
     sm_log_alloc_mgr *lm;
     static uint64_t total_latency_us;
+    // Commit-to-durable latency (usec) of all queues by transaction type; like
+    // total_latency_us, only the log flusher (in dequeue_committed_xcts)
+    // writes them
+    static const uint32_t kMaxTypes = 16;
+    static LatencyHistogram durable_latency[kMaxTypes];
     commit_queue() : start(0), items(0), lm(nullptr) {
       queue = new Entry[config::group_commit_queue_length];
     }
     ~commit_queue() { delete[] queue; }
-    void push_back(uint64_t lsn, uint64_t start_time);
+    void push_back(uint64_t lsn, uint64_t start_time, uint32_t type);
     inline uint32_t size() { return items; }
   };
   commit_queue *_commit_queue CACHE_ALIGNED;
+
+  // Log writes issued by the daemon but not yet retired, oldest first (see
+  // log_writer). Retiring a window makes [end_offset] the durable offset and
+  // returns the log buffer up to [end_byte].
+  struct flush_window {
+    segment_id *sid;      // segment containing end_offset
+    uint64_t end_offset;
+    uint64_t end_byte;
+    int close_fd;         // segment file done with after this write, or -1
+    bool io;              // false if the write was skipped (null log device)
+  };
+  std::deque<flush_window> _flush_windows;
+  log_writer *_log_writer;
+
+  // Where the next flush window starts, and the segment file it goes to
+  segment_id *_submitted_sid;
+  uint64_t _submitted_lsn_offset;
+  int _active_fd;
+
+  // With config::log_direct_io, creates and preallocates segment files
+  std::thread _segment_preparer;
 };
 }  // namespace ermia
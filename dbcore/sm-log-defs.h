@@ -338,6 +338,11 @@ struct log_allocation {
      having, or keeping, any particular value.
    */
   log_block *block;
+
+  /* Set on all but the last block of sm_log_alloc_mgr::allocate_batch:
+     the owner still has later blocks of the batch to populate.
+   */
+  bool more_in_batch;
 };
 
 struct LOG_ALIGN log_request {
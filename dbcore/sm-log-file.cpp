@@ -6,6 +6,7 @@
 #include <new>
 #include <sys/fcntl.h>
 #include <algorithm>
+#include <cerrno>
 
 namespace ermia {
 
@@ -225,6 +226,9 @@ void sm_log_file_mgr::_make_new_log() {
   // write out the block
   int fd = open_for_write(sid);
   DEFER(os_close(fd));
+  if (config::log_direct_io) {
+    _preallocate(fd, sid->segnum);
+  }
   os_pwrite(fd, buf, sizeof(buf), 0);
   _durable_lsn = b.next_lsn();
 
@@ -236,6 +240,7 @@ void sm_log_file_mgr::_make_new_log() {
 
 sm_log_file_mgr::sm_log_file_mgr() {
   set_segment_size(config::log_segment_mb * config::MB);
+  preallocated_segnum = 0;
 
   /* The code below does not close open segment file descriptors if
      anything goes wrong. There is no meaningful way to recover from
@@ -467,11 +472,39 @@ void sm_log_file_mgr::_create_nxt_seg_file(bool force) {
   if (doit) {
     ALWAYS_ASSERT(!config::is_backup_srv() || config::command_log);
     nxt_seg_file_name sname(segnum);
-    uint64_t fd = os_openat(dfd, sname, O_CREAT | O_EXCL | O_RDONLY);
+    // Writable so prepare_nxt_seg_file() can allocate its space
+    int mode = config::log_direct_io ? O_RDWR : O_RDONLY;
+    uint64_t fd = os_openat(dfd, sname, O_CREAT | O_EXCL | mode);
     nxt_segment_fd = (fd << 32) | segnum;
   }
 }
 
+void sm_log_file_mgr::_preallocate(int fd, uint32_t segnum) {
+  int err = fallocate(fd, 0, 0, volatile_read(segment_size));
+  LOG_IF(WARNING, err) << "Unable to preallocate log segment " << segnum
+                       << " (" << errno << ")";
+  volatile_write(preallocated_segnum, segnum);
+}
+
+void sm_log_file_mgr::prepare_nxt_seg_file() {
+  uint64_t fd_info = 0;
+  {
+    file_mutex.lock();
+    DEFER(file_mutex.unlock());
+    _create_nxt_seg_file(false);
+    fd_info = nxt_segment_fd;
+  }
+
+  /* Allocating the space outside file_mutex is fine: nobody closes the
+     next segment's fd, and if it becomes active meanwhile, writes and
+     fallocate can overlap.
+   */
+  uint32_t segnum = uint32_t(fd_info);
+  if (config::log_direct_io && segnum != volatile_read(preallocated_segnum)) {
+    _preallocate(fd_info >> 32, segnum);
+  }
+}
+
 void sm_log_file_mgr::update_durable_mark(LSN dlsn) {
   file_mutex.lock();
   DEFER(file_mutex.unlock());
@@ -508,13 +541,13 @@ void sm_log_file_mgr::update_chkpt_mark(LSN cstart, LSN cend) {
   _chkpt_end_lsn = cend;
 }
 
-int sm_log_file_mgr::open_for_write(segment_id *sid) {
+int sm_log_file_mgr::open_for_write(segment_id *sid, bool direct) {
   file_mutex.lock();
   DEFER(file_mutex.unlock());
   _create_nxt_seg_file(false);
 
   segment_file_name sname(sid);
-  return os_openat(dfd, sname, O_WRONLY | O_SYNC);
+  return os_openat(dfd, sname, O_WRONLY | O_SYNC | (direct ? O_DIRECT : 0));
 }
 
 int sm_log_file_mgr::open_for_read(segment_id *sid) {
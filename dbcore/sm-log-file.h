@@ -181,11 +181,19 @@ struct sm_log_file_mgr {
   LSN get_chkpt_end() { return _chkpt_end_lsn; }
 
   /* Open a writable file descriptor for the passed-in log
-     segment. The segment must already exist.
+     segment. The segment must already exist. With [direct], writes
+     bypass the page cache and must be aligned (see log_writer).
    */
-  int open_for_write(segment_id *sid);
+  int open_for_write(segment_id *sid, bool direct = false);
   int open_for_read(segment_id *sid);
 
+  /* Make sure the file for the next segment exists, and with
+     config::log_direct_io, that its space is allocated, so changing
+     segments doesn't wait on the file system. Meant to be called
+     periodically in the background.
+   */
+  void prepare_nxt_seg_file();
+
   /* Create a new log segment file, with segment number one higher
      than the current highest segnum.
 
@@ -236,6 +244,7 @@ struct sm_log_file_mgr {
   void _pop_newest();
 
   void _create_nxt_seg_file(bool force);
+  void _preallocate(int fd, uint32_t segnum);
   segment_id *_prepare_new_segment(uint32_t segnum, uint64_t start,
                                    uint64_t byte_offset);
   void _make_new_log();
@@ -251,6 +260,9 @@ struct sm_log_file_mgr {
 
   uint64_t nxt_segment_fd;
 
+  // Newest segment whose space has been allocated upfront
+  uint32_t preallocated_segnum;
+
   LSN _durable_lsn;
 
   LSN _chkpt_start_lsn;
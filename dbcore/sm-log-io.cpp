@@ -0,0 +1,395 @@
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "../macros.h"
+#include "sm-common.h"
+#include "sm-log-io.h"
+
+namespace ermia {
+
+static inline int io_uring_setup(uint32_t entries, struct io_uring_params *p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+                                 uint32_t flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      nullptr, 0);
+}
+
+static inline int io_uring_register(int fd, uint32_t opcode, void *arg,
+                                    uint32_t nr_args) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+log_writer::log_writer(uint32_t depth, bool try_uring, bool direct)
+    : depth(depth ? depth : 1),
+      ring_fd(-1),
+      direct(direct),
+      partial(nullptr),
+      partial_fd(-1),
+      partial_end(0),
+      sq_ring(nullptr),
+      sq_ring_size(0),
+      cq_ring(nullptr),
+      cq_ring_size(0),
+      sqes_size(0),
+      fixed_buf(nullptr),
+      fixed_size(0),
+      first_seq(0) {
+  pending.reserve(this->depth);
+  if (try_uring && !SetupRing(this->depth)) {
+    LOG(WARNING) << "io_uring unavailable, writing the log with pwrite";
+  }
+  if (direct) {
+    int err = posix_memalign((void **)&partial, kDirectIOAlign, kDirectIOAlign);
+    LOG_IF(FATAL, err) << "Unable to allocate log bounce block";
+  }
+}
+
+log_writer::~log_writer() {
+  while (Inflight()) {
+    Reap(true);
+  }
+  free(partial);
+  if (ring_fd < 0) {
+    return;
+  }
+  munmap(sqes, sqes_size);
+  if (cq_ring != sq_ring) {
+    munmap(cq_ring, cq_ring_size);
+  }
+  munmap(sq_ring, sq_ring_size);
+  close(ring_fd);
+}
+
+bool log_writer::SetupRing(uint32_t entries) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  int fd = io_uring_setup(entries, &p);
+  if (fd < 0) {
+    return false;
+  }
+
+  sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+  }
+  sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  if (single_mmap) {
+    cq_ring = sq_ring;
+  } else {
+    cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      munmap(sq_ring, sq_ring_size);
+      close(fd);
+      return false;
+    }
+  }
+  sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+  sqes = (struct io_uring_sqe *)mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    if (cq_ring != sq_ring) {
+      munmap(cq_ring, cq_ring_size);
+    }
+    munmap(sq_ring, sq_ring_size);
+    close(fd);
+    return false;
+  }
+
+  char *sq = (char *)sq_ring;
+  sq_head = (unsigned *)(sq + p.sq_off.head);
+  sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  sq_array = (unsigned *)(sq + p.sq_off.array);
+  char *cq = (char *)cq_ring;
+  cq_head = (unsigned *)(cq + p.cq_off.head);
+  cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+  ring_fd = fd;
+  LOG(INFO) << "Writing the log with io_uring, depth " << depth;
+  return true;
+}
+
+void log_writer::RegisterBuffer(char *buf, size_t size) {
+  if (ring_fd < 0) {
+    return;
+  }
+  struct iovec iov = {buf, size};
+  if (io_uring_register(ring_fd, IORING_REGISTER_BUFFERS, &iov, 1)) {
+    // Usually RLIMIT_MEMLOCK; plain writes work just as well, only slower
+    LOG(WARNING) << "Cannot register the log buffer with io_uring (" << errno << ")";
+    return;
+  }
+  fixed_buf = buf;
+  fixed_size = size;
+}
+
+void log_writer::Submit(int fd, const char *buf, size_t nbytes, off_t offset) {
+  ALWAYS_ASSERT(!Full());
+  ++st.writes;
+  st.bytes += nbytes;
+
+  request r = {fd, buf, nbytes, offset, false, nullptr, nullptr, 0};
+  if (direct) {
+    PrepareDirect(r);
+  }
+
+  if (ring_fd < 0) {
+    if (direct) {
+      WriteDirectSync(r);
+      free(r.bounce);
+      r.bounce = nullptr;
+    } else {
+      size_t n = os_pwrite(fd, buf, nbytes, offset);
+      LOG_IF(FATAL, n < nbytes) << "Incomplete log write";
+    }
+    r.done = true;
+    pending.push_back(r);
+    if (st.max_inflight < 1) {
+      st.max_inflight = 1;
+    }
+    return;
+  }
+
+  unsigned tail = *sq_tail;
+  unsigned idx = tail & *sq_mask;
+  struct io_uring_sqe *sqe = &sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->fd = fd;
+  if (direct) {
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->addr = (uint64_t)r.iov;
+    sqe->len = r.iovcnt;
+    sqe->off = offset & ~off_t(kDirectIOAlign - 1);
+  } else {
+    if (fixed_buf && buf >= fixed_buf && buf + nbytes <= fixed_buf + fixed_size) {
+      sqe->opcode = IORING_OP_WRITE_FIXED;
+      sqe->buf_index = 0;
+    } else {
+      sqe->opcode = IORING_OP_WRITE;
+    }
+    sqe->addr = (uint64_t)buf;
+    sqe->len = nbytes;
+    sqe->off = offset;
+  }
+  sqe->user_data = first_seq + pending.size();
+  sq_array[idx] = idx;
+  __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+  int ret = 0;
+  do {
+    ret = io_uring_enter(ring_fd, 1, 0, 0);
+  } while (ret < 0 && errno == EINTR);
+  THROW_IF(ret != 1, os_error, errno, "Unable to submit log write");
+
+  pending.push_back(r);
+  if (pending.size() > st.max_inflight) {
+    st.max_inflight = pending.size();
+  }
+}
+
+void log_writer::Complete(uint64_t seq, int32_t res) {
+  ALWAYS_ASSERT(seq >= first_seq && seq < first_seq + pending.size());
+  request &r = pending[seq - first_seq];
+  LOG_IF(FATAL, res < 0) << "Error writing " << r.nbytes << " bytes to the log at offset "
+                         << r.offset << " (" << -res << ")";
+  if (r.bounce) {
+    size_t total = 0;
+    for (int i = 0; i < r.iovcnt; ++i) {
+      total += r.iov[i].iov_len;
+    }
+    if ((size_t)res < total) {
+      // Has to stay aligned, redo the whole thing
+      WriteDirectSync(r);
+    }
+    free(r.bounce);
+    r.bounce = nullptr;
+  } else if ((size_t)res < r.nbytes) {
+    // Rare for regular files; finish it here
+    size_t rest = r.nbytes - res;
+    size_t n = os_pwrite(r.fd, r.buf + res, rest, r.offset + res);
+    LOG_IF(FATAL, n < rest) << "Incomplete log write";
+  }
+  r.done = true;
+}
+
+void log_writer::WaitAll() {
+  while (true) {
+    bool all_done = true;
+    for (auto &r : pending) {
+      all_done &= r.done;
+    }
+    if (all_done) {
+      return;
+    }
+    unsigned head = *cq_head;
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      int ret = io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+      THROW_IF(ret < 0 && errno != EINTR, os_error, errno,
+               "Unable to wait for log writes");
+      continue;
+    }
+    for (; head != tail; ++head) {
+      struct io_uring_cqe *cqe = &cqes[head & *cq_mask];
+      Complete(cqe->user_data, cqe->res);
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+  }
+}
+
+/* Turn [r] into whole-block iovecs:
+
+   |<- head ->|<------ middle ------>|<- tail ->|
+   |   ...[offset ...                  ... end)  |
+
+   The middle points into the caller's buffer when it's aligned (the log
+   buffer is page-aligned and segments start at block boundaries in it, so
+   normally it is); otherwise it's copied as well.
+ */
+void log_writer::PrepareDirect(request &r) {
+  static const off_t kAlign = kDirectIOAlign;
+  off_t start = r.offset;
+  off_t end = r.offset + r.nbytes;
+  off_t head_start = start & ~(kAlign - 1);
+  bool has_head = head_start != start;
+  off_t mid_start = has_head ? head_start + kAlign : start;
+  off_t mid_end = end & ~(kAlign - 1);
+  bool has_tail = mid_end != end && mid_end >= mid_start;
+  size_t mid = mid_end > mid_start ? mid_end - mid_start : 0;
+  const char *mid_ptr = r.buf + (mid_start - start);
+  bool copy_mid = mid && ((uintptr_t)mid_ptr & (kAlign - 1));
+
+  size_t bounce_size = (has_head + has_tail) * kAlign + (copy_mid ? mid : 0);
+  int err = posix_memalign((void **)&r.bounce, kAlign,
+                           bounce_size + 3 * sizeof(struct iovec));
+  LOG_IF(FATAL, err) << "Unable to allocate log bounce blocks";
+  r.iov = (struct iovec *)(r.bounce + bounce_size);
+  r.iovcnt = 0;
+
+  char *p = r.bounce;
+  char *last_block = nullptr;
+  if (has_head) {
+    // Whatever precedes [start] in this block was written before
+    if (partial_fd == r.fd && partial_end == start) {
+      memcpy(p, partial, start - head_start);
+    } else {
+      LoadBlock(r.fd, head_start, p);
+    }
+    off_t head_end = std::min(head_start + kAlign, end);
+    memcpy(p + (start - head_start), r.buf, head_end - start);
+    memset(p + (head_end - head_start), 0, kAlign - (head_end - head_start));
+    r.iov[r.iovcnt++] = {p, kDirectIOAlign};
+    last_block = p;
+    p += kAlign;
+
+    // Might overlap the last block of a write in flight
+    if (ring_fd >= 0 && Inflight()) {
+      WaitAll();
+    }
+  }
+  if (mid) {
+    if (copy_mid) {
+      memcpy(p, mid_ptr, mid);
+      r.iov[r.iovcnt++] = {p, mid};
+      p += mid;
+    } else {
+      r.iov[r.iovcnt++] = {(void *)mid_ptr, mid};
+    }
+  }
+  if (has_tail) {
+    memcpy(p, r.buf + (mid_end - start), end - mid_end);
+    memset(p + (end - mid_end), 0, kAlign - (end - mid_end));
+    r.iov[r.iovcnt++] = {p, kDirectIOAlign};
+    last_block = p;
+  }
+
+  if (end & (kAlign - 1)) {
+    ASSERT(last_block);
+    memcpy(partial, last_block, kAlign);
+    partial_fd = r.fd;
+    partial_end = end;
+  } else {
+    partial_fd = -1;
+  }
+}
+
+// Read the block at [offset] of the file behind the write-only, O_DIRECT [fd]
+void log_writer::LoadBlock(int fd, off_t offset, char *out) {
+  if (ring_fd >= 0 && Inflight()) {
+    WaitAll();
+  }
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", fd);
+  int rfd = os_open(path, O_RDONLY);
+  DEFER(os_close(rfd));
+  size_t n = os_pread(rfd, out, kDirectIOAlign, offset);
+  memset(out + n, 0, kDirectIOAlign - n);
+}
+
+void log_writer::WriteDirectSync(request &r) {
+  off_t offset = r.offset & ~off_t(kDirectIOAlign - 1);
+  size_t total = 0;
+  for (int i = 0; i < r.iovcnt; ++i) {
+    total += r.iov[i].iov_len;
+  }
+  ssize_t n = 0;
+  do {
+    n = pwritev(r.fd, r.iov, r.iovcnt, offset);
+  } while (n < 0 && errno == EINTR);
+  LOG_IF(FATAL, n < 0 || (size_t)n < total)
+      << "Error writing " << total << " bytes to the log at offset " << offset
+      << " (" << errno << ")";
+}
+
+uint32_t log_writer::Reap(bool wait) {
+  if (ring_fd >= 0 && pending.size()) {
+    while (true) {
+      unsigned head = *cq_head;
+      unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head) {
+        struct io_uring_cqe *cqe = &cqes[head & *cq_mask];
+        Complete(cqe->user_data, cqe->res);
+      }
+      __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+      if (!wait || pending.front().done) {
+        break;
+      }
+      int ret = io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+      THROW_IF(ret < 0 && errno != EINTR, os_error, errno,
+               "Unable to wait for log writes");
+    }
+  }
+
+  uint32_t n = 0;
+  while (n < pending.size() && pending[n].done) {
+    ++n;
+  }
+  pending.erase(pending.begin(), pending.begin() + n);
+  first_seq += n;
+  return n;
+}
+
+}  // namespace ermia
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include "sm-config.h"
+
+namespace ermia {
+
+/*
+ * Log device writes.
+ *
+ * The log write daemon used to write each flush window with a synchronous
+ * pwrite, so submitting a window, waiting for it and advancing the durable
+ * mark were serialized on the daemon. With config::log_io_uring, log_writer
+ * submits writes to an io_uring instead and keeps up to config::log_io_depth
+ * of them in flight; the daemon keeps carving out new windows from the log
+ * buffer while earlier ones are still being written, and only retires a
+ * window (advancing the durable LSN and releasing its buffer space) once it
+ * and everything before it completed.
+ *
+ * The log buffer can be registered with the ring so writes use
+ * IORING_OP_WRITE_FIXED and skip pinning pages on every request. Segment
+ * files are opened with O_SYNC (sm_log_file_mgr::open_for_write), so a
+ * completed write is durable in either mode without a separate fdatasync.
+ *
+ * If the kernel doesn't support io_uring (or it's forbidden, e.g., by
+ * seccomp), log_writer falls back to pwrite: Submit() completes the write
+ * before returning, so callers don't need a separate code path.
+ *
+ * With config::log_direct_io, segment files are opened with O_DIRECT and
+ * every write must cover whole kDirectIOAlign-byte blocks from an aligned
+ * buffer. Log flushes end wherever the last committed block ends, so
+ * log_writer widens each write to block boundaries: the aligned middle is
+ * written straight from the log buffer, while the first and last partial
+ * blocks go through small bounce blocks. The bytes that precede the write
+ * in its first block come from a copy of the previous write's last block
+ * (or are read back from the file, e.g., right after recovery). Since two
+ * consecutive writes can share a block, a write that starts mid-block waits
+ * for the ones in flight so they can't land out of order.
+ *
+ * The ring is driven through the raw system calls to avoid a dependency on
+ * liburing; only the log write daemon uses a log_writer, so no locking.
+ */
+class log_writer {
+ public:
+  static const size_t kDirectIOAlign = 4096;
+
+  log_writer(uint32_t depth, bool try_uring, bool direct);
+  ~log_writer();
+
+  // Whether writes really are asynchronous (io_uring is in use)
+  inline bool IsAsync() { return ring_fd >= 0; }
+  inline uint32_t Inflight() { return pending.size(); }
+  inline bool Full() { return Inflight() >= depth; }
+
+  // Register [buf, buf + size) for fixed-buffer writes; no-op in pwrite mode.
+  // Writes from elsewhere still work, they just take the normal path.
+  void RegisterBuffer(char *buf, size_t size);
+
+  // Write [nbytes] at [buf] to [fd] at [offset]. The caller must keep both the
+  // buffer and [fd] intact until the write is reaped and must not exceed the
+  // configured depth.
+  void Submit(int fd, const char *buf, size_t nbytes, off_t offset);
+
+  // Collect completions and return the number of writes, oldest first, that
+  // are done (everything submitted before them is done as well). With [wait]
+  // set, blocks until at least the oldest write has completed.
+  uint32_t Reap(bool wait);
+
+  struct stats {
+    uint64_t writes;        // write requests submitted
+    uint64_t bytes;         // ...and their size
+    uint64_t full_waits;    // Submit() calls that found the queue full
+    uint64_t max_inflight;  // deepest queue seen
+    stats() : writes(0), bytes(0), full_waits(0), max_inflight(0) {}
+  };
+  inline stats GetStats() { return st; }
+  inline void CountFullWait() { ++st.full_waits; }
+
+ private:
+  struct request {
+    int fd;
+    const char *buf;
+    size_t nbytes;
+    off_t offset;
+    bool done;
+    // O_DIRECT writes: bounce blocks followed by the iovecs, freed once done
+    char *bounce;
+    struct iovec *iov;
+    int iovcnt;
+  };
+
+  bool SetupRing(uint32_t entries);
+  void Complete(uint64_t seq, int32_t res);
+  void WaitAll();
+  void PrepareDirect(request &r);
+  void LoadBlock(int fd, off_t offset, char *out);
+  void WriteDirectSync(request &r);
+
+  uint32_t depth;
+  int ring_fd;
+  bool direct;
+
+  // Copy of the block the last O_DIRECT write ended in, up to [partial_end]
+  char *partial;
+  int partial_fd;
+  off_t partial_end;
+
+  // Submission queue
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+
+  // Completion queue
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+
+  // Registered (fixed) buffer, if any
+  char *fixed_buf;
+  size_t fixed_size;
+
+  // In-flight writes in submission order; the first one has sequence number
+  // [first_seq]
+  std::vector<request> pending;
+  uint64_t first_seq;
+
+  stats st;
+};
+
+}  // namespace ermia
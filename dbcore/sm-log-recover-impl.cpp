@@ -138,7 +138,8 @@ void sm_log_recover_impl::recover_index_insert(
   }
 
   varstr payload_key((char*)payload_buf + sizeof(varstr), len);
-  // FIXME(tzwang): support other index types
+  // FIXME(tzwang): support other index types; Engine::CreateIndex refuses
+  // hash indexes when there's a log to replay
   if (((ConcurrentMasstreeIndex*)index)->masstree_.insert_if_absent(payload_key, logrec->oid(),
                                                      NULL)) {
     // Don't add the key on backup - on backup chkpt will traverse OID arrays
@@ -69,8 +69,8 @@ void sm_log::BackupFlushLog(uint64_t new_dlsn_offset) {
   return get_impl(this)->_lm.BackupFlushLog(new_dlsn_offset);
 }
 
-void sm_log::enqueue_committed_xct(uint32_t worker_id, uint64_t start_time) {
-  get_impl(this)->_lm.enqueue_committed_xct(worker_id, start_time);
+void sm_log::enqueue_committed_xct(uint32_t worker_id, uint64_t start_time, uint32_t type) {
+  get_impl(this)->_lm.enqueue_committed_xct(worker_id, start_time, type);
 }
 
 LSN sm_log::flush() { return get_impl(this)->_lm.flush(); }
@@ -189,4 +189,8 @@ void sm_log::wait_for_durable_flushed_lsn_offset(uint64_t offset) {
   auto *self = get_impl(this);
   self->_lm.wait_for_durable(offset);
 }
+
+uint64_t sm_log::committed_lsn_offset() {
+  return get_impl(this)->_lm.get_tls_lsn_offset() & ~sm_log_alloc_mgr::kDirtyTlsLsnOffset;
+}
 }  // namespace ermia
@@ -105,6 +105,20 @@ struct sm_tx_log {
   */
   LSN pre_commit();
 
+  /* Acquire commit blocks for the [n] logs in one go, e.g., for a
+     batch of transactions committing back to back on one thread.
+     The blocks are laid out in order in a single allocation (see
+     sm_log_alloc_mgr::allocate_batch), so each log still gets its own
+     commit block and CLSN. The logs must then be committed (or
+     discarded) in the same order. If the blocks can't be allocated
+     together, nothing happens and each log gets its block on
+     pre_commit() as usual.
+
+     WARNING: log records cannot be added to the transactions after
+     this call returns.
+   */
+  static void pre_commit_batch(sm_tx_log **logs, uint32_t n);
+
   /* Pre-commit succeeded. Log record(s) for this transaction can
      safely be made durable. Return the commit LSN. If [pdest] is
      non-NULL, fill it with the on-disk location of the commit
@@ -378,6 +392,11 @@ struct sm_log {
    */
   void wait_for_durable_flushed_lsn_offset(uint64_t offset);
 
+  /* Return the LSN offset the log has to be durable up to for the
+     calling thread's latest commit to be durable.
+   */
+  uint64_t committed_lsn_offset();
+
   /* Load the object referenced by [ptr] from the log. The pointer
      must reference the log (ASI_LOG) and the given buffer must be large
      enough to hold the object.
@@ -403,7 +422,8 @@ struct sm_log {
   LSN backup_redo_log_by_oid(LSN start_lsn, LSN end_lsn);
   void start_logbuf_redoers();
   void recover();
-  void enqueue_committed_xct(uint32_t worker_id, uint64_t start_time);
+  // [type] is the transaction type (the benchmark's workload index)
+  void enqueue_committed_xct(uint32_t worker_id, uint64_t start_time, uint32_t type);
   void create_segment_file(segment_id *sid);
   uint64_t durable_flushed_lsn_offset();
   sm_log_recover_impl *get_backup_replay_functor();
@@ -1,5 +1,6 @@
 #include "sm-alloc.h"
 #include "sm-chkpt.h"
+#include "sm-delta.h"
 #include "sm-log.h"
 #include "sm-log-recover.h"
 #include "sm-object.h"
@@ -18,8 +19,10 @@ void Object::Pin(bool load_from_logbuf) {
       while (volatile_read(status_) != kStatusMemory) {
       }
     }
+    // Evicted versions are loaded by the reader, see sm-evict.h
     ALWAYS_ASSERT(volatile_read(status_) == kStatusMemory ||
-                  volatile_read(status_) == kStatusDeleted);
+                  volatile_read(status_) == kStatusDeleted ||
+                  volatile_read(status_) == kStatusEvicted);
     return;
   }
 
@@ -134,6 +137,63 @@ fat_ptr Object::Create(const varstr *tuple_value, bool do_write,
   return fat_ptr::make(obj, size_code, 0 /* 0: in-memory */);
 }
 
+fat_ptr Object::CreateVersion(const varstr *tuple_value, Object *base,
+                              epoch_num epoch) {
+  fat_ptr ptr = NULL_PTR;
+  delta_stats *stats = my_delta_stats();
+  dbtuple *base_tuple = base ? (dbtuple *)base->GetPayload() : nullptr;
+  // Only delta against a version that's committed and written (post-commit
+  // fills in the payload before switching clsn to LSN) and of the same size
+  if (!config::delta_versions || !tuple_value || !base_tuple ||
+      base->GetClsn().asi_type() != fat_ptr::ASI_LOG || !base->IsInMemory() ||
+      base_tuple->size != tuple_value->size() ||
+      base_tuple->delta_depth >= config::delta_max_depth) {
+    ptr = Create(tuple_value, false, epoch);
+  } else {
+    const uint32_t size = tuple_value->size();
+    const uint32_t max_delta =
+        std::min<uint32_t>(size / kDeltaMaxRatio, UINT16_MAX);
+    static thread_local std::vector<uint8_t> scratch;
+    if (scratch.size() < size + max_delta) {
+      scratch.resize(size + max_delta);
+    }
+    const uint8_t *base_value = base_tuple->get_value_start();
+    if (base_tuple->delta_depth) {
+      delta_materialize(base_tuple, &scratch[max_delta]);
+      base_value = &scratch[max_delta];
+    }
+    uint32_t delta_size =
+        delta_encode(base_value, tuple_value->data(), size, &scratch[0], max_delta);
+    if (!delta_size) {
+      ptr = Create(tuple_value, false, epoch);
+    } else {
+      size_t alloc_sz = sizeof(dbtuple) + sizeof(Object) + delta_size;
+      Object *obj = new (MM::allocate(alloc_sz)) Object();
+      ASSERT(obj->GetAllocateEpoch() <= epoch - 4);
+      obj->SetAllocateEpoch(epoch);
+
+      dbtuple *tuple = (dbtuple *)obj->GetPayload();
+      new (tuple) dbtuple(size);
+      tuple->pvalue = (varstr *)tuple_value;
+      tuple->delta_depth = base_tuple->delta_depth + 1;
+      tuple->delta_size = delta_size;
+      memcpy(tuple->get_value_start(), &scratch[0], delta_size);
+
+      size_t size_code = encode_size_aligned(alloc_sz);
+      ASSERT(size_code != INVALID_SIZE_CODE);
+      ptr = fat_ptr::make(obj, size_code, 0 /* 0: in-memory */);
+      if (stats) {
+        ++stats->deltas;
+      }
+    }
+  }
+  if (stats) {
+    ++stats->versions;
+    stats->bytes += decode_size_aligned(ptr.size_code());
+  }
+  return ptr;
+}
+
 // Make sure the object has a valid clsn/pdest
 fat_ptr Object::GenerateClsnPtr(uint64_t clsn) {
   fat_ptr clsn_ptr = NULL_PTR;
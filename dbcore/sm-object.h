@@ -19,6 +19,8 @@ class Object {
   static const uint32_t kStatusStorage = 2;
   static const uint32_t kStatusLoading = 3;
   static const uint32_t kStatusDeleted = 4;
+  // Payload dropped to storage by the evictor, see sm-evict.h
+  static const uint32_t kStatusEvicted = 5;
 
   // alloc_epoch_ and status_ must be the first two fields
 
@@ -28,6 +30,9 @@ class Object {
   // Where exactly is the payload?
   uint32_t status_;
 
+  // Clock bit for the evictor, set by readers
+  uint32_t referenced_;
+
   // The object's permanent home in the log/chkpt
   fat_ptr pdest_;
 
@@ -47,9 +52,16 @@ class Object {
   static fat_ptr Create(const varstr* tuple_value, bool do_write,
                         epoch_num epoch);
 
+  // Create a new version that will overwrite [base] (the newest committed
+  // version, may be null). Stores only a delta against [base] if
+  // config::delta_versions is on and the delta is small enough.
+  static fat_ptr CreateVersion(const varstr* tuple_value, Object* base,
+                               epoch_num epoch);
+
   Object()
       : alloc_epoch_(0),
         status_(kStatusMemory),
+        referenced_(1),
         pdest_(NULL_PTR),
         next_pdest_(NULL_PTR),
         next_volatile_(NULL_PTR),
@@ -58,6 +70,7 @@ class Object {
   Object(fat_ptr pdest, fat_ptr next, epoch_num e, bool in_memory)
       : alloc_epoch_(e),
         status_(in_memory ? kStatusMemory : kStatusStorage),
+        referenced_(0),
         pdest_(pdest),
         next_pdest_(next),
         next_volatile_(NULL_PTR),
@@ -65,6 +78,10 @@ class Object {
 
   inline bool IsDeleted() { return status_ == kStatusDeleted; }
   inline bool IsInMemory() { return status_ == kStatusMemory; }
+  inline bool IsEvicted() { return status_ == kStatusEvicted; }
+  inline void SetEvicted() { status_ = kStatusEvicted; }
+  inline bool IsReferenced() { return volatile_read(referenced_); }
+  inline void SetReferenced(bool r) { volatile_write(referenced_, r); }
   inline fat_ptr* GetPersistentAddressPtr() { return &pdest_; }
   inline fat_ptr GetPersistentAddress() { return pdest_; }
   inline fat_ptr GetClsn() { return volatile_read(clsn_); }
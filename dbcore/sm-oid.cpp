@@ -12,6 +12,7 @@
 #include "sm-alloc.h"
 #include "sm-chkpt.h"
 #include "sm-config.h"
+#include "sm-gc.h"
 #include "sm-table.h"
 #include "sm-log-recover-impl.h"
 #include "sm-object.h"
@@ -763,7 +764,9 @@ install:
   // Note for this to be correct we shouldn't allow multiple txs
   // working on the same tuple at the same time.
 
-  *new_obj_ptr = Object::Create(value, false, updater_xc->begin_epoch);
+  *new_obj_ptr = Object::CreateVersion(
+      value, overwrite ? (Object *)old_desc->GetNextVolatile().offset() : old_desc,
+      updater_xc->begin_epoch);
   ASSERT(new_obj_ptr->asi_type() == 0);
   Object *new_object = (Object *)new_obj_ptr->offset();
   new_object->SetClsn(updater_xc->owner.to_ptr());
@@ -785,9 +788,7 @@ install:
                                      new_obj_ptr->_ptr)) {
       // Succeeded installing a new version, now only I can modify the
       // chain, try recycle some objects
-      if (config::enable_gc) {
-        MM::gc_version_chain(ptr);
-      }
+      MM::version_chain_updated(ptr);
       return head;
     } else {
       MM::deallocate(*new_obj_ptr);
@@ -990,16 +991,19 @@ void sm_oid_mgr::oid_get_version_amac(oid_array *oa,
             s.tuple = s.cur_obj->GetPinnedTuple();
             s.done = true;
             ++finished;
+            record_version_hops(s.hops);
           } else  {
             s.ptr = s.tentative_next;
             s.prev_obj = s.cur_obj;
             if (s.ptr.offset()) {
               s.cur_obj = (Object *)s.ptr.offset();
               Object::PrefetchHeader(s.cur_obj);
+              ++s.hops;
             } else {
               s.done = true;
               s.tuple = nullptr;
               ++finished;
+              record_version_hops(s.hops);
             }
           }
         }
@@ -1032,6 +1036,7 @@ void sm_oid_mgr::oid_get_version_amac(oid_array *oa,
 PROMISE(dbtuple *) sm_oid_mgr::oid_get_version(oid_array *oa, OID o,
                                      TXN::xid_context *visitor_xc) {
   fat_ptr *entry = oa->get(o);
+  uint32_t hops = 0;
 start_over:
   fat_ptr ptr = volatile_read(*entry);
   ASSERT(ptr.asi_type() == 0);
@@ -1065,6 +1070,7 @@ start_over:
       SUSPEND;
       tentative_next = cur_obj->GetNextVolatile();
       ASSERT(tentative_next.asi_type() == 0);
+      PrefetchNextVersion(cur_obj, tentative_next, visitor_xc);
     }
 
     bool retry = false;
@@ -1073,14 +1079,31 @@ start_over:
       goto start_over;
     }
     if (visible) {
+      record_version_hops(hops);
       RETURN cur_obj->GetPinnedTuple();
     }
     ptr = tentative_next;
     prev_obj = cur_obj;
+    ++hops;
   }
+  record_version_hops(hops);
   RETURN nullptr;  // No Visible records
 }
 
+version_chain_stats tls_version_chain_stats[config::MAX_THREADS];
+
+version_chain_stats get_version_chain_stats() {
+  version_chain_stats total;
+  for (uint32_t i = 0; i < config::MAX_THREADS; ++i) {
+    total.reads += volatile_read(tls_version_chain_stats[i].reads);
+    total.hops += volatile_read(tls_version_chain_stats[i].hops);
+    total.max_hops = std::max(total.max_hops, volatile_read(tls_version_chain_stats[i].max_hops));
+    total.read_hops.Merge(tls_version_chain_stats[i].read_hops);
+    total.gc_lengths.Merge(tls_version_chain_stats[i].gc_lengths);
+  }
+  return total;
+}
+
 bool sm_oid_mgr::TestVisibility(Object *object, TXN::xid_context *xc, bool &retry) {
   fat_ptr clsn = object->GetClsn();
   uint16_t asi_type = clsn.asi_type();
@@ -5,6 +5,7 @@
 #include "sm-oid-alloc-impl.h"
 #include "sm-log.h"
 #include "sm-coroutine.h"
+#include "sm-thread.h"
 
 #include "dynarray.h"
 
@@ -88,6 +89,7 @@ struct OIDAMACState {
   Object *cur_obj;
   Object *prev_obj;
   fat_ptr tentative_next;
+  uint32_t hops;
 
   OIDAMACState(OID oid)
   : oid(oid)
@@ -98,9 +100,64 @@ struct OIDAMACState {
   , cur_obj(nullptr)
   , prev_obj(nullptr)
   , tentative_next(NULL_PTR)
+  , hops(0)
   {}
 };
 
+// Version chain lengths in power-of-two buckets: bucket 0 counts length 0,
+// bucket i > 0 counts lengths in [2^(i-1), 2^i), the last bucket the rest
+struct chain_histogram {
+  static const uint32_t kBuckets = 8;
+  uint64_t counts[kBuckets];
+  chain_histogram() { memset(counts, 0, sizeof(counts)); }
+
+  static inline uint32_t Bucket(uint64_t length) {
+    return length ? std::min<uint32_t>(kBuckets - 1, 64 - __builtin_clzll(length)) : 0;
+  }
+  // Smallest length that goes to bucket [i]
+  static inline uint64_t BucketLow(uint32_t i) { return i ? uint64_t{1} << (i - 1) : 0; }
+
+  inline void Record(uint64_t length) { ++counts[Bucket(length)]; }
+  void Merge(const chain_histogram &other) {
+    for (uint32_t i = 0; i < kBuckets; ++i) {
+      counts[i] += volatile_read(other.counts[i]);
+    }
+  }
+};
+
+// How far readers had to walk version chains, kept per thread
+struct version_chain_stats {
+  uint64_t reads;     // chain walks
+  uint64_t hops;      // versions skipped before finding the visible one
+  uint64_t max_hops;  // longest single walk
+  chain_histogram read_hops;   // hops per read
+  chain_histogram gc_lengths;  // chain lengths gc_version_chain() found
+  version_chain_stats() : reads(0), hops(0), max_hops(0) {}
+} CACHE_ALIGNED;
+
+extern version_chain_stats tls_version_chain_stats[config::MAX_THREADS];
+
+inline void record_version_hops(uint32_t hops) {
+  uint32_t id = thread::MyId();
+  if (id < config::MAX_THREADS) {
+    version_chain_stats &s = tls_version_chain_stats[id];
+    ++s.reads;
+    s.hops += hops;
+    s.max_hops = std::max<uint64_t>(s.max_hops, hops);
+    s.read_hops.Record(hops);
+  }
+}
+
+inline void record_gc_chain_length(uint32_t length) {
+  uint32_t id = thread::MyId();
+  if (id < config::MAX_THREADS) {
+    tls_version_chain_stats[id].gc_lengths.Record(length);
+  }
+}
+
+// Sums up all threads' counters
+version_chain_stats get_version_chain_stats();
+
 struct sm_oid_mgr {
   using log_tx_scan = sm_log_scan_mgr::record_scan;
 
@@ -229,6 +286,23 @@ struct sm_oid_mgr {
    */
   bool TestVisibility(Object *object, TXN::xid_context *xc, bool &retry);
 
+  /* Start loading the version after [object] unless [object] is obviously
+   * visible to [xc]: an in-flight version makes TestVisibility() go to the
+   * holder's context, and a too-new committed one is going to be skipped, so
+   * the next version is likely needed and its miss can overlap with that.
+   */
+  static inline void PrefetchNextVersion(Object *object, fat_ptr next,
+                                         TXN::xid_context *xc) {
+    if (!next.offset()) {
+      return;
+    }
+    fat_ptr clsn = object->GetClsn();
+    if (clsn.asi_type() != fat_ptr::ASI_LOG ||
+        LSN::from_ptr(clsn).offset() > xc->begin) {
+      Object::PrefetchHeader((Object *)next.offset());
+    }
+  }
+
   inline void oid_check_phantom(TXN::xid_context *visitor_xc, uint64_t vcstamp) {
 #if !defined(SSI) && !defined(SSN)
     MARK_REFERENCED(visitor_xc);
@@ -13,7 +13,8 @@ TableDescriptor::TableDescriptor(std::string& name)
       tuple_fid(0),
       tuple_array(nullptr),
       aux_fid_(0),
-      aux_array_(nullptr) {
+      aux_array_(nullptr),
+      version_cache_(nullptr) {
 }
 
 void TableDescriptor::Initialize() {
@@ -26,6 +27,64 @@ void TableDescriptor::Initialize() {
   aux_array_ = oidmgr->get_array(aux_fid_);
 }
 
+void TableDescriptor::EnableVersionCache(uint32_t max_value_size) {
+#if defined(SSN) || defined(SSI) || defined(MVOCC)
+  // Every read must go through the tuple to be tracked
+  MARK_REFERENCED(max_value_size);
+  LOG(WARNING) << "Version cache not supported with serializable CC, ignored for " << name;
+#else
+  if (config::is_backup_srv() || version_cache_ || !max_value_size) {
+    return;
+  }
+  version_cache_ = new VersionCache(max_value_size);
+#endif
+}
+
+void TableDescriptor::CollectMemStats(table_mem_stats &s) {
+  // OIDs to look at per MM epoch, so we don't hold back GC
+  static const OID kBatchSize = 4096;
+  if (!tuple_array) {
+    return;
+  }
+  s.oid_array_bytes += tuple_array->nentries() * sizeof(fat_ptr);
+  if (aux_array_) {
+    s.oid_array_bytes += aux_array_->nentries() * sizeof(fat_ptr);
+  }
+
+  OID himark = tuple_array->nentries();
+  for (OID begin = 0; begin < himark; begin += kBatchSize) {
+    OID end = std::min<uint64_t>(himark, uint64_t(begin) + kBatchSize);
+    epoch_num e = MM::epoch_enter();
+    for (OID oid = begin; oid < end; ++oid) {
+      uint64_t length = 0;
+      fat_ptr ptr = volatile_read(*tuple_array->get(oid));
+      while (ptr.offset()) {
+        Object *obj = (Object *)ptr.offset();
+        // Recycled under our feet (aborted or GC'ed), the rest is gone too
+        if (obj->GetClsn() == NULL_PTR) {
+          break;
+        }
+        ++length;
+        s.version_bytes += decode_size_aligned(ptr.size_code());
+        ptr = obj->GetNextVolatile();
+      }
+      if (length) {
+        ++s.records;
+        s.versions += length;
+        s.max_chain = std::max(s.max_chain, length);
+      }
+      if (aux_array_ && !config::is_backup_srv() && oid < aux_array_->nentries()) {
+        fat_ptr key = volatile_read(*aux_array_->get(oid));
+        // Keys are installed without a size code, see InsertRecord
+        if (key.offset()) {
+          s.key_bytes += align_up(sizeof(varstr) + ((varstr *)key.offset())->size());
+        }
+      }
+    }
+    MM::epoch_exit(0, e);
+  }
+}
+
 void TableDescriptor::SetPrimaryIndex(OrderedIndex *index, const std::string &name) {
   ALWAYS_ASSERT(index);
   ALWAYS_ASSERT(!primary_index);
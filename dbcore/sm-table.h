@@ -3,11 +3,25 @@
 #include <string>
 #include "sm-common.h"
 #include "sm-oid.h"
+#include "sm-version-cache.h"
 
 namespace ermia {
 
 class OrderedIndex;
 
+// What a table takes up in memory, see TableDescriptor::CollectMemStats()
+struct table_mem_stats {
+  uint64_t records;          // OIDs with at least one version
+  uint64_t versions;         // versions in memory
+  uint64_t version_bytes;    // ...and their size
+  uint64_t key_bytes;        // keys in the key array
+  uint64_t oid_array_bytes;  // tuple and auxiliary OID arrays
+  uint64_t max_chain;        // longest version chain
+  table_mem_stats()
+      : records(0), versions(0), version_bytes(0), key_bytes(0), oid_array_bytes(0),
+        max_chain(0) {}
+};
+
 class TableDescriptor {
  public:
   // Map table name to descriptors, global, no CC
@@ -57,6 +71,9 @@ class TableDescriptor {
   FID aux_fid_;
   oid_array* aux_array_;
 
+  // Newest committed versions of small records, null unless enabled
+  VersionCache* version_cache_;
+
  public:
   TableDescriptor(std::string& name);
 
@@ -64,6 +81,12 @@ class TableDescriptor {
   void SetPrimaryIndex(OrderedIndex *index, const std::string &name);
   void AddSecondaryIndex(OrderedIndex *index, const std::string &name);
   void Recover(FID tuple_fid, FID key_fid, OID himark = 0);
+  // Keep the newest committed version of records of up to [max_value_size]
+  // bytes in a version cache; ignored where the cache can't be used
+  void EnableVersionCache(uint32_t max_value_size);
+  // Walk the table's OID arrays and version chains; can run along with
+  // transactions, but the calling thread must be registered with MM
+  void CollectMemStats(table_mem_stats &s);
   inline std::string& GetName() { return name; }
   inline OrderedIndex* GetPrimaryIndex() { return primary_index; }
   inline FID GetTupleFid() { return tuple_fid; }
@@ -84,5 +107,6 @@ class TableDescriptor {
     return aux_array_;
   }
   inline oid_array* GetTupleArray() { return tuple_array; }
+  inline VersionCache* GetVersionCache() { return version_cache_; }
 };
 }  // namespace ermia
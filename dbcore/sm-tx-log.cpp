@@ -1,4 +1,5 @@
 #include <string>
+#include <vector>
 #include "sm-log-impl.h"
 
 namespace {
@@ -121,6 +122,31 @@ LSN sm_tx_log::pre_commit() {
   return impl->_commit_block->block->next_lsn();
 }
 
+void sm_tx_log::pre_commit_batch(sm_tx_log **logs, uint32_t n) {
+  if (n < 2) {
+    return;
+  }
+  thread_local std::vector<uint32_t> nrec;
+  thread_local std::vector<size_t> payload_bytes;
+  thread_local std::vector<log_allocation *> blocks;
+  nrec.resize(n);
+  payload_bytes.resize(n);
+  blocks.resize(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    auto *impl = get_log_impl(logs[i]);
+    ASSERT(not impl->_commit_block);
+    nrec[i] = impl->_nreq;
+    payload_bytes[i] = impl->_payload_bytes;
+  }
+
+  auto *log = get_log_impl(logs[0])->_log;
+  if (log->_lm.allocate_batch(n, &nrec[0], &payload_bytes[0], &blocks[0])) {
+    for (uint32_t i = 0; i < n; ++i) {
+      volatile_write(get_log_impl(logs[i])->_commit_block, blocks[i]);
+    }
+  }
+}
+
 LSN sm_tx_log::commit(LSN *pdest) {
   // make sure we acquired a commit block
   LSN clsn = pre_commit();
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+
+#include "dynarray.h"
+#include "mcs_lock.h"
+#include "sm-delta.h"
+#include "sm-object.h"
+#include "sm-oid.h"
+#include "../str_arena.h"
+#include "../tuple.h"
+
+namespace ermia {
+
+/*
+ * Per-table cache of each record's newest committed version.
+ *
+ * A lookup through the OID array costs two dependent misses (the OID entry,
+ * then the object header) before the visibility test can even run. For
+ * tables with small, hot records, the cache keeps the newest committed
+ * version's clsn and value inline in a cache-line-aligned slot indexed by
+ * OID, so a reader whose snapshot covers that version needs to touch a single
+ * slot and nothing else.
+ *
+ * The OID array itself keeps its one-fat_ptr-per-entry layout (recovery,
+ * checkpointing and the OID allocator all depend on it); the slots live in a
+ * separate array parallel to it, allocated only for tables that opt in.
+ *
+ * Each slot is guarded by a sequence number, odd meaning the contents are
+ * valid:
+ *
+ * - Updaters invalidate the slot (bump seq to the next even number) right
+ *   after installing a new version, before the version can commit.
+ * - Readers that found the committed head version through the chain fill the
+ *   slot: they read seq, check the head is still the version they are
+ *   copying, claim the slot by moving seq to the next even number, copy and
+ *   publish it by making seq odd. Any invalidation in between changes seq and
+ *   makes the claim or publish fail. Two fillers can only both get past the
+ *   claim for the same head version, so they write the same bytes.
+ * - Lookups copy the slot out and re-check seq, seqlock style.
+ *
+ * Only versions of at most max_value_size bytes are cached; deletes are
+ * never cached. Serializable CC schemes track every version read and don't
+ * use the cache.
+ */
+class VersionCache {
+ public:
+  struct Slot {
+    std::atomic<uint64_t> seq;
+    uint64_t clsn;  // LSN offset of the cached version
+    uint32_t size;
+    char data[0];
+  };
+
+  VersionCache(uint32_t max_value_size)
+      : max_value_size_(max_value_size),
+        stride_(align_up(sizeof(Slot) + max_value_size, CACHELINE_SIZE)),
+        slots_(oid_array::MAX_ENTRIES * stride_, 0),
+        capacity_(0) {}
+
+  inline uint32_t MaxValueSize() { return max_value_size_; }
+
+  inline Slot *GetSlot(OID oid) { return (Slot *)(slots_.data() + oid * stride_); }
+
+  // Returns the slot of [oid] if it has been mapped in, for prefetching
+  inline Slot *PeekSlot(OID oid) {
+    return oid < volatile_read(capacity_) ? GetSlot(oid) : nullptr;
+  }
+
+  // Copy the cached value of [oid] to [arena] if it's visible to a
+  // transaction that started at [begin]
+  inline bool Lookup(OID oid, uint64_t begin, str_arena &arena, varstr *out_v) {
+    Slot *slot = PeekSlot(oid);
+    if (!slot) {
+      return false;
+    }
+    uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    if (!(seq & 1)) {
+      return false;
+    }
+    uint64_t clsn = volatile_read(slot->clsn);
+    uint32_t size = volatile_read(slot->size);
+#if !defined(RC) && !defined(RC_SPIN)
+    if (clsn > begin) {
+      return false;
+    }
+#else
+    MARK_REFERENCED(begin);
+    MARK_REFERENCED(clsn);
+#endif
+    if (size > max_value_size_) {  // torn read
+      return false;
+    }
+    varstr *v = arena.next(size);
+    memcpy((void *)v->p, slot->data, size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->seq.load(std::memory_order_relaxed) != seq) {
+      arena.return_space(size);
+      return false;
+    }
+    out_v->p = v->p;
+    out_v->l = size;
+    return true;
+  }
+
+  // Cache [object] for [oid] if it is still the committed head at [entry]
+  inline void Fill(OID oid, fat_ptr *entry, Object *object) {
+    dbtuple *tuple = (dbtuple *)object->GetPayload();
+    if (!object->IsInMemory() || !tuple->size || tuple->size > max_value_size_) {
+      return;
+    }
+    if (oid >= volatile_read(capacity_)) {
+      Grow(oid);
+    }
+    Slot *slot = GetSlot(oid);
+    uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      return;
+    }
+    fat_ptr clsn = object->GetClsn();
+    if (clsn.asi_type() != fat_ptr::ASI_LOG ||
+        volatile_read(*entry).offset() != (uintptr_t)object) {
+      return;
+    }
+    if (!slot->seq.compare_exchange_strong(seq, seq + 2, std::memory_order_acq_rel)) {
+      return;
+    }
+    slot->clsn = LSN::from_ptr(clsn).offset();
+    slot->size = tuple->size;
+    if (tuple->delta_depth) {
+      delta_materialize(tuple, (uint8_t *)slot->data);
+    } else {
+      memcpy(slot->data, tuple->get_value_start(), tuple->size);
+    }
+    seq += 2;
+    slot->seq.compare_exchange_strong(seq, seq + 1, std::memory_order_release);
+  }
+
+  // Called by updaters after installing a new version of [oid]
+  inline void Invalidate(OID oid) {
+    Slot *slot = PeekSlot(oid);
+    if (!slot) {
+      return;
+    }
+    uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+    while (!slot->seq.compare_exchange_weak(seq, (seq | 1) + 1, std::memory_order_acq_rel)) {
+    }
+  }
+
+ private:
+  void Grow(OID oid) {
+    CRITICAL_SECTION(cs, lock_);
+    if (oid < capacity_) {
+      return;
+    }
+    slots_.ensure_size((size_t(oid) + 1) * stride_);
+    volatile_write(capacity_, slots_.size() / stride_);
+    // Updaters that installed a version after this must see the slot
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  const uint32_t max_value_size_;
+  const uint32_t stride_;
+  dynarray slots_;
+  uint64_t capacity_;  // slots mapped in so far
+  mcs_lock lock_;
+};
+
+}  // namespace ermia
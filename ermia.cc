@@ -1,7 +1,9 @@
 #include "dbcore/rcu.h"
 #include "dbcore/sm-chkpt.h"
 #include "dbcore/sm-cmd-log.h"
+#include "dbcore/sm-gc.h"
 #include "dbcore/sm-rep.h"
+#include "dbcore/sm-thread.h"
 
 #include "ermia.h"
 #include "txn.h"
@@ -37,12 +39,19 @@ Engine::Engine() {
     if (sm_log::need_recovery) {
       logmgr->recover();
     }
+
+    MM::start_gc_threads();
   }
 }
 
 TableDescriptor *Engine::CreateTable(const char *name) {
   auto *td = TableDescriptor::New(name);
 
+  std::string tables = "," + config::version_cache_tables + ",";
+  if (tables.find("," + std::string(name) + ",") != std::string::npos) {
+    td->EnableVersionCache(config::version_cache_value_size);
+  }
+
   if (!sm_log::need_recovery && !config::is_backup_srv()) {
     // Note: this will insert to the log and therefore affect min_flush_lsn,
     // so must be done in an sm-thread which must be created by the user
@@ -78,10 +87,25 @@ void Engine::LogIndexCreation(bool primary, FID table_fid, FID index_fid, const
   }
 }
 
-void Engine::CreateIndex(const char *table_name, const std::string &index_name, bool is_primary) {
+void Engine::CreateIndex(const char *table_name, const std::string &index_name, bool is_primary,
+                         uint16_t index_type, uint64_t expected_keys) {
   auto *td = TableDescriptor::Get(table_name);
   ALWAYS_ASSERT(td);
-  auto *index = new ConcurrentMasstreeIndex(table_name, is_primary);
+  OrderedIndex *index = nullptr;
+  if (index_type == kIndexConcurrentMasstree) {
+    index = new ConcurrentMasstreeIndex(table_name, is_primary);
+  } else if (index_type == kIndexConcurrentHash) {
+    ALWAYS_ASSERT(is_primary);
+    // Absent keys leave nothing behind in a hash table to validate against
+    LOG_IF(FATAL, config::phantom_prot)
+      << "Hash index " << index_name << " does not support phantom protection";
+    // Checkpoint loading and log replay rebuild indexes through Masstree
+    LOG_IF(FATAL, config::enable_chkpt || sm_log::need_recovery || config::is_backup_srv())
+      << "Hash index " << index_name << " does not support checkpointing, recovery or backups";
+    index = new ConcurrentHashIndex(table_name, expected_keys);
+  } else {
+    LOG(FATAL) << "Unknown index type " << index_type;
+  }
   if (is_primary) {
     td->SetPrimaryIndex(index, index_name);
   } else {
@@ -91,6 +115,54 @@ void Engine::CreateIndex(const char *table_name, const std::string &index_name,
   LogIndexCreation(is_primary, td->GetTupleFid(), index_fid, index_name);
 }
 
+ermia::coro::generator<rc_t> Engine::coro_Commit(transaction *t) {
+  rc_t rc = Commit(t);
+  if (rc.IsAbort() || !config::coro_durable_commit) {
+    co_return rc;
+  }
+
+  // The log flusher advances the durable LSN once per flush window, so one
+  // flush releases every transaction (of any worker) it covers. Until then
+  // the scheduler gets to resume the others in the batch.
+  uint64_t lsn_offset = logmgr->committed_lsn_offset();
+  while (logmgr->durable_flushed_lsn_offset() < lsn_offset) {
+    co_await std::experimental::suspend_always{};
+  }
+  co_return rc;
+}
+
+void Engine::CommitBatch(transaction *txns, rc_t *rcs, uint32_t n) {
+#if !defined(SSN) && !defined(SSI) && !defined(MVOCC)
+  // Only under SI: a transaction holds its CLSN from here until its turn
+  // below, which SI readers can't tell from a plain active transaction. The
+  // serializable schemes would have to wait on it instead, possibly for a
+  // transaction later in this very batch.
+  thread_local std::vector<sm_tx_log *> logs;
+  logs.clear();
+  for (uint32_t i = 0; i < n; ++i) {
+    if (!rcs[i].IsAbort()) {
+      if (sm_tx_log *log = txns[i].commit_log()) {
+        logs.push_back(log);
+      }
+    }
+  }
+  if (logs.size() > 1) {
+    sm_tx_log::pre_commit_batch(&logs[0], logs.size());
+  }
+#endif
+
+  // Commit blocks are released in allocation order, so a failed commit must
+  // give back its block before the next transaction goes on
+  for (uint32_t i = 0; i < n; ++i) {
+    if (!rcs[i].IsAbort()) {
+      rcs[i] = Commit(&txns[i]);
+      if (rcs[i].IsAbort()) {
+        Abort(&txns[i]);
+      }
+    }
+  }
+}
+
 PROMISE(rc_t) ConcurrentMasstreeIndex::Scan(transaction *t, const varstr &start_key,
                                    const varstr *end_key, ScanCallback &callback) {
   SearchRangeCallback c(callback);
@@ -142,6 +214,73 @@ std::map<std::string, uint64_t> ConcurrentMasstreeIndex::Clear() {
   return std::map<std::string, uint64_t>();
 }
 
+// Keep a copy of each bulk-loaded key for checkpointing, as InsertRecord does
+static void BulkInstallChkptKeys(TableDescriptor *td,
+                                 std::vector<OrderedIndex::BulkLoadEntry> &entries) {
+  auto *key_array = td->GetKeyArray();
+  for (auto &entry : entries) {
+    varstr *new_key = (varstr *)MM::allocate(sizeof(varstr) + entry.key->size());
+    new (new_key) varstr((char *)new_key + sizeof(varstr), 0);
+    new_key->copy_from(entry.key);
+    key_array->ensure_size(entry.oid);
+    oidmgr->oid_put(key_array, entry.oid,
+                    fat_ptr::make((void *)new_key, INVALID_SIZE_CODE));
+  }
+}
+
+void ConcurrentMasstreeIndex::BulkLoad(std::vector<BulkLoadEntry> &entries,
+                                       double fill_factor, uint32_t nthreads) {
+  ALWAYS_ASSERT(fill_factor > 0 && fill_factor <= 1);
+  ALWAYS_ASSERT(masstree_.size() == 0);
+  epoch_num e = MM::epoch_enter();
+
+  size_t layer = ConcurrentMasstree::bulk_common_layers(entries.data(), entries.size());
+  std::vector<size_t> bounds = ConcurrentMasstree::bulk_partition(
+      entries.data(), entries.size(), layer, std::max<uint32_t>(nthreads, 1));
+  uint32_t nparts = bounds.size() - 1;
+
+  // Each loader builds the leaves of one key range; stitching them together
+  // and building the upper levels is cheap and done here
+  std::vector<std::vector<ConcurrentMasstree::bulk_node>> parts(nparts);
+  std::vector<thread::Thread *> loaders;
+  for (uint32_t i = 1; i < nparts; ++i) {
+    auto *t = thread::GetThread(true /* physical */);
+    if (!t) {
+      break;
+    }
+    thread::Thread::Task task = [&, i](char *) {
+      ConcurrentMasstree::bulk_build_leaves(entries.data() + bounds[i],
+                                            bounds[i + 1] - bounds[i], layer,
+                                            fill_factor, e, parts[i]);
+    };
+    t->StartTask(task);
+    loaders.push_back(t);
+  }
+  // Whatever we couldn't get a thread for, build ourselves
+  for (uint32_t i = loaders.size() + 1; i < nparts; ++i) {
+    ConcurrentMasstree::bulk_build_leaves(entries.data() + bounds[i],
+                                          bounds[i + 1] - bounds[i], layer,
+                                          fill_factor, e, parts[i]);
+  }
+  ConcurrentMasstree::bulk_build_leaves(entries.data(), bounds[1], layer,
+                                        fill_factor, e, parts[0]);
+  for (auto &t : loaders) {
+    t->Join();
+    thread::PutThread(t);
+  }
+
+  std::vector<ConcurrentMasstree::bulk_node> leaves;
+  for (auto &p : parts) {
+    leaves.insert(leaves.end(), p.begin(), p.end());
+  }
+  masstree_.bulk_install(leaves, entries.data(), layer, fill_factor, e);
+  MM::epoch_exit(0, e);
+
+  if (config::enable_chkpt && IsPrimary()) {
+    BulkInstallChkptKeys(table_descriptor, entries);
+  }
+}
+
 PROMISE(void) ConcurrentMasstreeIndex::GetRecord(transaction *t, rc_t &rc, const varstr &key,
                                         varstr &value, OID *out_oid) {
   OID oid = INVALID_OID;
@@ -157,22 +296,31 @@ PROMISE(void) ConcurrentMasstreeIndex::GetRecord(transaction *t, rc_t &rc, const
     bool found = AWAIT masstree_.search(key, oid, t->xc->begin_epoch, &sinfo);
 
     dbtuple *tuple = nullptr;
+    bool cached = false;
     if (found) {
       // Key-OID mapping exists, now try to get the actual tuple to be sure
+      VersionCache *cache = table_descriptor->GetVersionCache();
       if (config::is_backup_srv()) {
         tuple = oidmgr->BackupGetVersion(
             table_descriptor->GetTupleArray(),
             table_descriptor->GetPersistentAddressArray(), oid, t->xc);
+      } else if (cache && cache->Lookup(oid, t->xc->begin, t->string_allocator(), &value)) {
+        cached = true;
       } else {
         tuple =
             AWAIT oidmgr->oid_get_version(table_descriptor->GetTupleArray(), oid, t->xc);
+        if (tuple && cache) {
+          cache->Fill(oid, table_descriptor->GetTupleArray()->get(oid), tuple->GetObject());
+        }
       }
-      if (!tuple) {
+      if (!tuple && !cached) {
         found = false;
       }
     }
 
-    if (found) {
+    if (cached) {
+      volatile_write(rc._val, RC_TRUE);
+    } else if (found) {
       volatile_write(rc._val, t->DoTupleRead(tuple, &value)._val);
     } else if (config::phantom_prot) {
       volatile_write(rc._val, DoNodeRead(t, sinfo.first, sinfo.second)._val);
@@ -344,6 +492,10 @@ void ConcurrentMasstreeIndex::XctSearchRangeCallback::on_resp_node(
       return;
     }
 #endif
+    // Nothing to check at commit
+    if (t->is_fast_read_only()) {
+      return;
+    }
     rc_t rc = DoNodeRead(t, n, version);
     if (rc.IsAbort()) {
       caller_callback->return_code = rc;
@@ -377,6 +529,164 @@ bool ConcurrentMasstreeIndex::XctSearchRangeCallback::invoke(
   return true;
 }
 
+////////////////// Hash index interfaces /////////////////
+
+PROMISE(void) ConcurrentHashIndex::GetRecord(transaction *t, rc_t &rc, const varstr &key,
+                                    varstr &value, OID *out_oid) {
+  OID oid = INVALID_OID;
+  rc = {RC_INVALID};
+
+  if (!t) {
+    rc._val = table_.search(key, oid) ? RC_TRUE : RC_FALSE;
+  } else {
+    t->ensure_active();
+    bool found = table_.search(key, oid);
+
+    dbtuple *tuple = nullptr;
+    bool cached = false;
+    if (found) {
+      VersionCache *cache = table_descriptor->GetVersionCache();
+      if (config::is_backup_srv()) {
+        tuple = oidmgr->BackupGetVersion(
+            table_descriptor->GetTupleArray(),
+            table_descriptor->GetPersistentAddressArray(), oid, t->xc);
+      } else if (cache && cache->Lookup(oid, t->xc->begin, t->string_allocator(), &value)) {
+        cached = true;
+      } else {
+        tuple =
+            AWAIT oidmgr->oid_get_version(table_descriptor->GetTupleArray(), oid, t->xc);
+        if (tuple && cache) {
+          cache->Fill(oid, table_descriptor->GetTupleArray()->get(oid), tuple->GetObject());
+        }
+      }
+      if (!tuple && !cached) {
+        found = false;
+      }
+    }
+
+    if (cached) {
+      volatile_write(rc._val, RC_TRUE);
+    } else if (found) {
+      volatile_write(rc._val, t->DoTupleRead(tuple, &value)._val);
+    } else {
+      volatile_write(rc._val, RC_FALSE);
+    }
+#ifndef SSN
+    ASSERT(rc._val == RC_FALSE || rc._val == RC_TRUE);
+#endif
+  }
+
+  if (out_oid) {
+    *out_oid = oid;
+  }
+}
+
+PROMISE(bool) ConcurrentHashIndex::InsertIfAbsent(transaction *t, const varstr &key,
+                                         OID oid) {
+  MARK_REFERENCED(t);
+  RETURN table_.insert_if_absent(key, oid);
+}
+
+PROMISE(bool) ConcurrentHashIndex::InsertOID(transaction *t, const varstr &key, OID oid) {
+  bool inserted = AWAIT InsertIfAbsent(t, key, oid);
+  if (inserted) {
+    t->LogIndexInsert(this, oid, &key);
+    if (config::enable_chkpt) {
+      auto *key_array = GetTableDescriptor()->GetKeyArray();
+      volatile_write(key_array->get(oid)->_ptr, 0);
+    }
+  }
+  RETURN inserted;
+}
+
+PROMISE(rc_t) ConcurrentHashIndex::InsertRecord(transaction *t, const varstr &key, varstr &value, OID *out_oid) {
+  ASSERT((char *)key.data() == (char *)&key + sizeof(varstr));
+  t->ensure_active();
+
+  // Insert to the table first
+  dbtuple *tuple = nullptr;
+  OID oid = t->Insert(table_descriptor, &value, &tuple);
+
+  if (!AWAIT InsertOID(t, key, oid)) {
+    if (config::enable_chkpt) {
+      volatile_write(table_descriptor->GetKeyArray()->get(oid)->_ptr, 0);
+    }
+    RETURN rc_t{RC_ABORT_INTERNAL};
+  }
+
+  if (config::enable_chkpt) {
+    varstr *new_key =
+        (varstr *)MM::allocate(sizeof(varstr) + key.size());
+    new (new_key) varstr((char *)new_key + sizeof(varstr), 0);
+    new_key->copy_from(&key);
+    auto *key_array = table_descriptor->GetKeyArray();
+    key_array->ensure_size(oid);
+    oidmgr->oid_put(key_array, oid,
+                    fat_ptr::make((void *)new_key, INVALID_SIZE_CODE));
+  }
+
+  if (out_oid) {
+    *out_oid = oid;
+  }
+
+  RETURN rc_t{RC_TRUE};
+}
+
+PROMISE(rc_t) ConcurrentHashIndex::UpdateRecord(transaction *t, const varstr &key, varstr &value) {
+  OID oid = 0;
+  if (table_.search(key, oid)) {
+    RETURN t->Update(table_descriptor, oid, &key, &value);
+  }
+  RETURN rc_t{RC_ABORT_INTERNAL};
+}
+
+PROMISE(rc_t) ConcurrentHashIndex::RemoveRecord(transaction *t, const varstr &key) {
+  OID oid = 0;
+  if (table_.search(key, oid)) {
+    RETURN t->Update(table_descriptor, oid, &key, nullptr);
+  }
+  RETURN rc_t{RC_ABORT_INTERNAL};
+}
+
+PROMISE(rc_t) ConcurrentHashIndex::Scan(transaction *t, const varstr &start_key,
+                               const varstr *end_key, ScanCallback &callback) {
+  MARK_REFERENCED(t);
+  MARK_REFERENCED(start_key);
+  MARK_REFERENCED(end_key);
+  MARK_REFERENCED(callback);
+  LOG_FIRST_N(ERROR, 1) << "Scan is not supported by the hash index on "
+                        << table_descriptor->GetName();
+  RETURN rc_t{RC_ABORT_INTERNAL};
+}
+
+PROMISE(rc_t) ConcurrentHashIndex::ReverseScan(transaction *t, const varstr &start_key,
+                                      const varstr *end_key, ScanCallback &callback) {
+  MARK_REFERENCED(t);
+  MARK_REFERENCED(start_key);
+  MARK_REFERENCED(end_key);
+  MARK_REFERENCED(callback);
+  LOG_FIRST_N(ERROR, 1) << "ReverseScan is not supported by the hash index on "
+                        << table_descriptor->GetName();
+  RETURN rc_t{RC_ABORT_INTERNAL};
+}
+
+std::map<std::string, uint64_t> ConcurrentHashIndex::Clear() {
+  table_.clear();
+  return std::map<std::string, uint64_t>();
+}
+
+void ConcurrentHashIndex::BulkLoad(std::vector<BulkLoadEntry> &entries,
+                                   double fill_factor, uint32_t nthreads) {
+  MARK_REFERENCED(fill_factor);
+  MARK_REFERENCED(nthreads);
+  for (auto &entry : entries) {
+    ALWAYS_ASSERT(table_.insert_if_absent(*entry.key, entry.oid));
+  }
+  if (config::enable_chkpt) {
+    BulkInstallChkptKeys(table_descriptor, entries);
+  }
+}
+
 ////////////////// End of index interfaces //////////
 
 ////////////////// Table interfaces /////////////////
@@ -417,4 +727,19 @@ OrderedIndex::OrderedIndex(std::string table_name, bool is_primary) : is_primary
   self_fid = oidmgr->create_file(true);
 }
 
+OID OrderedIndex::BulkInsertTuple(const varstr &value) {
+  epoch_num e = MM::epoch_enter();
+  fat_ptr head = Object::Create(&value, true, e);
+  ASSERT(head.size_code() != INVALID_SIZE_CODE);
+  Object *obj = (Object *)head.offset();
+  // Stamp it as committed at the current LSN: visible to every transaction
+  // that begins from now on
+  obj->SetClsn(LSN::make(logmgr->cur_lsn().offset(), 0).to_log_ptr());
+  OID oid = oidmgr->alloc_oid(table_descriptor->GetTupleFid());
+  ALWAYS_ASSERT(oid != INVALID_OID);
+  oidmgr->oid_put_new(table_descriptor->GetTupleArray(), oid, head);
+  MM::epoch_exit(0, e);
+  return oid;
+}
+
 } // namespace ermia
@@ -3,6 +3,7 @@
 #include "txn.h"
 #include "varstr.h"
 #include "ermia_internal.h"
+#include "dbcore/concurrent-hash.h"
 #include "../dbcore/sm-log-recover-impl.h"
 #include "../benchmarks/record/encoder.h"
 #include <experimental/coroutine>
@@ -14,7 +15,8 @@ class Table;
 class Engine {
 private:
   void LogIndexCreation(bool primary, FID table_fid, FID index_fid, const std::string &index_name);
-  void CreateIndex(const char *table_name, const std::string &index_name, bool is_primary);
+  void CreateIndex(const char *table_name, const std::string &index_name, bool is_primary,
+                   uint16_t index_type, uint64_t expected_keys = 0);
 
 public:
   Engine();
@@ -22,18 +24,26 @@ public:
 
   // All supported index types
   static const uint16_t kIndexConcurrentMasstree = 0x1;
+  static const uint16_t kIndexConcurrentHash = 0x2;
 
   // Create a table without any index (at least yet)
   TableDescriptor *CreateTable(const char *name);
 
   // Create the primary index for a table
   inline void CreateMasstreePrimaryIndex(const char *table_name, const std::string &index_name) {
-    CreateIndex(table_name, index_name, true);
+    CreateIndex(table_name, index_name, true, kIndexConcurrentMasstree);
   }
 
   // Create a secondary masstree index
   inline void CreateMasstreeSecondaryIndex(const char *table_name, const std::string &index_name) {
-    CreateIndex(table_name, index_name, false);
+    CreateIndex(table_name, index_name, false, kIndexConcurrentMasstree);
+  }
+
+  // Create a hash primary index for a table that is only accessed by key
+  // (no scans). [expected_keys] sizes the bucket array.
+  inline void CreateHashPrimaryIndex(const char *table_name, const std::string &index_name,
+                                     uint64_t expected_keys = 0) {
+    CreateIndex(table_name, index_name, true, kIndexConcurrentHash, expected_keys);
   }
 
   inline transaction *NewTransaction(uint64_t txn_flags, str_arena &arena, transaction *buf, uint32_t coro_batch_idx = 0) {
@@ -51,6 +61,19 @@ public:
     return rc;
   }
 
+  // Commit for coroutine transactions. With config::coro_durable_commit, the
+  // caller suspends until its commit record is durable instead of blocking,
+  // so the worker keeps running the rest of its batch; every flush of the log
+  // completes all waiters whose commit LSN it covers.
+  ermia::coro::generator<rc_t> coro_Commit(transaction *t);
+
+  // Commit [n] transactions that finished together on this thread, e.g., a
+  // coroutine batch, in index order; those with [rcs] already set to an abort
+  // are skipped. Their commit blocks are allocated together first (see
+  // sm_tx_log::pre_commit_batch) and a transaction that fails to commit is
+  // aborted here.
+  void CommitBatch(transaction *txns, rc_t *rcs, uint32_t n);
+
   inline void Abort(transaction *t) {
     t->Abort();
     t->~transaction();
@@ -149,6 +172,28 @@ public:
                             std::vector<varstr *> &values,
                             std::vector<std::experimental::coroutine_handle<>> &handles);
 
+  // Multi-insert/update interfaces using AMAC: probe the index for all keys
+  // with interleaved prefetching, then apply the writes. [rcs] holds the
+  // result for each request, as InsertRecord/UpdateRecord would return it.
+  void amac_MultiInsert(transaction *t,
+                        std::vector<ConcurrentMasstree::AMACState> &requests,
+                        std::vector<varstr *> &values, std::vector<rc_t> &rcs);
+  void amac_MultiUpdate(transaction *t,
+                        std::vector<ConcurrentMasstree::AMACState> &requests,
+                        std::vector<varstr *> &values, std::vector<rc_t> &rcs);
+
+  // Multi-insert/update interfaces using coroutines: one coro_InsertRecord or
+  // coro_UpdateRecord per key, interleaved. [rcs] and [handles] must be as
+  // large as [keys].
+  void simple_coro_MultiInsert(transaction *t, std::vector<varstr *> &keys,
+                               std::vector<varstr *> &values, std::vector<rc_t> &rcs,
+                               std::vector<std::experimental::coroutine_handle<
+                                   ermia::coro::generator<rc_t>::promise_type>> &handles);
+  void simple_coro_MultiUpdate(transaction *t, std::vector<varstr *> &keys,
+                               std::vector<varstr *> &values, std::vector<rc_t> &rcs,
+                               std::vector<std::experimental::coroutine_handle<
+                                   ermia::coro::generator<rc_t>::promise_type>> &handles);
+
   // A multi-ops interface using coroutines
   static void simple_coro_MultiOps(std::vector<rc_t> &rcs,
 		                   std::vector<std::experimental::coroutine_handle<ermia::coro::generator<rc_t>::promise_type>> &handles);
@@ -173,8 +218,11 @@ public:
                             const varstr *end_key, ScanCallback &callback) override;
 
   inline size_t Size() override { return masstree_.size(); }
+  inline size_t MemoryBytes() override { return masstree_.memory_size(); }
   std::map<std::string, uint64_t> Clear() override;
   inline void SetArrays(bool primary) override { masstree_.set_arrays(table_descriptor, primary); }
+  void BulkLoad(std::vector<BulkLoadEntry> &entries, double fill_factor = 1.0,
+                uint32_t nthreads = 1) override;
 
   inline PROMISE(void)
   GetOID(const varstr &key, rc_t &rc, TXN::xid_context *xc, OID &out_oid,
@@ -183,6 +231,67 @@ public:
     volatile_write(rc._val, found ? RC_TRUE : RC_FALSE);
   }
 
+private:
+  PROMISE(bool) InsertIfAbsent(transaction *t, const varstr &key, OID oid) override;
+};
+
+// User-facing concurrent hash index, primary only; point accesses only
+class ConcurrentHashIndex : public OrderedIndex {
+private:
+  ConcurrentHashTable table_;
+
+public:
+  ConcurrentHashIndex(const char *table_name, uint64_t expected_keys)
+    : OrderedIndex(table_name, true), table_(expected_keys) {}
+
+  ConcurrentHashTable &GetHashTable() { return table_; }
+
+  inline void *GetTable() override { return &table_; }
+
+  // A multi-get interface using AMAC
+  void amac_MultiGet(transaction *t,
+                     std::vector<ConcurrentHashTable::AMACState> &requests,
+                     std::vector<varstr *> &values);
+
+  // A multi-get interface using coroutines
+  void simple_coro_MultiGet(transaction *t, std::vector<varstr *> &keys,
+                            std::vector<varstr *> &values,
+                            std::vector<std::experimental::coroutine_handle<>> &handles);
+
+  ermia::coro::generator<rc_t> coro_GetRecord(transaction *t, const varstr &key, varstr &value, OID *out_oid = nullptr);
+
+  PROMISE(void) GetRecord(transaction *t, rc_t &rc, const varstr &key, varstr &value, OID *out_oid = nullptr) override;
+  PROMISE(rc_t) UpdateRecord(transaction *t, const varstr &key, varstr &value) override;
+  PROMISE(rc_t) InsertRecord(transaction *t, const varstr &key, varstr &value, OID *out_oid = nullptr) override;
+  PROMISE(rc_t) RemoveRecord(transaction *t, const varstr &key) override;
+  PROMISE(bool) InsertOID(transaction *t, const varstr &key, OID oid) override;
+
+  // Not supported: log an error and return RC_ABORT_INTERNAL
+  PROMISE(rc_t) Scan(transaction *t, const varstr &start_key, const varstr *end_key,
+                     ScanCallback &callback) override;
+  PROMISE(rc_t) ReverseScan(transaction *t, const varstr &start_key,
+                            const varstr *end_key, ScanCallback &callback) override;
+
+  inline size_t Size() override { return table_.size(); }
+  inline size_t MemoryBytes() override { return table_.memory_size(); }
+  std::map<std::string, uint64_t> Clear() override;
+  inline void SetArrays(bool) override {}
+  // No tree to build: [fill_factor] and [nthreads] are ignored
+  void BulkLoad(std::vector<BulkLoadEntry> &entries, double fill_factor = 1.0,
+                uint32_t nthreads = 1) override;
+
+  inline PROMISE(void)
+  GetOID(const varstr &key, rc_t &rc, TXN::xid_context *xc, OID &out_oid,
+         ConcurrentMasstree::versioned_node_t *out_sinfo = nullptr) override {
+    MARK_REFERENCED(xc);
+    if (out_sinfo) {
+      *out_sinfo = ConcurrentMasstree::versioned_node_t(nullptr, 0);
+    }
+    bool found = table_.search(key, out_oid);
+    volatile_write(rc._val, found ? RC_TRUE : RC_FALSE);
+    RETURN;
+  }
+
 private:
   PROMISE(bool) InsertIfAbsent(transaction *t, const varstr &key, OID oid) override;
 };
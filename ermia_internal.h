@@ -65,9 +65,26 @@ public:
   virtual PROMISE(rc_t) RemoveRecord(transaction *t, const varstr &key) = 0;
 
   virtual size_t Size() = 0;
+  // Memory held by the index structure itself, not counting records; walks
+  // the whole index and is only approximate under concurrent updates
+  virtual size_t MemoryBytes() = 0;
   virtual std::map<std::string, uint64_t> Clear() = 0;
   virtual void SetArrays(bool) = 0;
 
+  // A key and the OID it maps to, for BulkLoad
+  typedef ConcurrentMasstree::bulk_entry BulkLoadEntry;
+
+  // Install [entries], sorted by key and unique, into this index without
+  // transactions or logging. The index must be empty and not in use until
+  // this returns. [nthreads] loader threads build disjoint key ranges.
+  virtual void BulkLoad(std::vector<BulkLoadEntry> &entries, double fill_factor = 1.0,
+                        uint32_t nthreads = 1) = 0;
+
+  // Create a committed, visible version of [value] in this index's table
+  // without a transaction and return its OID; the counterpart of BulkLoad
+  // for the table. Not logged.
+  OID BulkInsertTuple(const varstr &value);
+
   /**
    * Insert key-oid pair to the underlying actual index structure.
    *
@@ -232,6 +232,47 @@ public:
   search_coro(const key_type &k, OID &o, threadinfo &ti,
               versioned_node_t *search_info = nullptr) const;
 
+  /**
+   * Bulk loading: build the tree bottom-up from keys that are already
+   * sorted, instead of doing a root-to-leaf descent (and maybe a split) per
+   * key. Leaves are packed left to right, [fill_factor] of the node width
+   * each, then internal nodes are built over them level by level. Keys that
+   * share an 8-byte slice with longer keys get their lower layers built the
+   * same way, recursively.
+   *
+   * Keys must be sorted by their bytes and unique. The tree must be empty
+   * and nobody else may use it until the load is done. Only the key-OID
+   * mappings are installed: no transaction, no log record.
+   *
+   * bulk_load() does everything in the calling thread. To build in parallel,
+   * find the layer at which the keys start to differ with
+   * bulk_common_layers(), cut the keys into pieces with bulk_partition(),
+   * build each piece's leaves with bulk_build_leaves() in any thread, then
+   * concatenate the results in key order and call bulk_install() once.
+   */
+  struct bulk_entry {
+    const key_type *key;
+    OID oid;
+  };
+  // A built node and the lowest ikey it covers (its separator in the parent)
+  typedef std::pair<node_base_type *, key_slice> bulk_node;
+
+  static size_t bulk_common_layers(const bulk_entry *entries, size_t n);
+  static std::vector<size_t> bulk_partition(const bulk_entry *entries, size_t n,
+                                            size_t layer, uint32_t nparts);
+  static void bulk_build_leaves(const bulk_entry *entries, size_t n, size_t layer,
+                                double fill_factor, epoch_num e,
+                                std::vector<bulk_node> &out);
+  void bulk_install(std::vector<bulk_node> &leaves, const bulk_entry *entries,
+                    size_t layer, double fill_factor, epoch_num e);
+  inline void bulk_load(const bulk_entry *entries, size_t n,
+                        double fill_factor = 1.0, epoch_num e = 0) {
+    size_t layer = bulk_common_layers(entries, n);
+    std::vector<bulk_node> leaves;
+    bulk_build_leaves(entries, n, layer, fill_factor, e, leaves);
+    bulk_install(leaves, entries, layer, fill_factor, e);
+  }
+
   /**
    * The low level callback interface is as follows:
    *
@@ -409,6 +450,12 @@ public:
    */
   inline size_t size() const;
 
+  /**
+   * Bytes taken by the tree's nodes (leaves and internodes of all layers).
+   * Same caveats as size().
+   */
+  size_t memory_size() const;
+
   static inline uint64_t ExtractVersionNumber(const node_opaque_t *n) {
     // XXX(stephentu): I think we must use stable_version() for
     // correctness, but I am not 100% sure. It's definitely correct to use it,
@@ -440,6 +487,16 @@ private:
 
   static leaf_type *leftmost_descend_layer(node_base_type *n);
   class size_walk_callback;
+
+  static inline Masstree::key<key_slice> bulk_layer_key(const bulk_entry &entry,
+                                                        size_t layer) {
+    return Masstree::key<key_slice>((const char *)entry.key->data() + layer * sizeof(key_slice),
+                                    entry.key->size() - layer * sizeof(key_slice));
+  }
+  static size_t bulk_group(const bulk_entry *entries, size_t n, size_t begin,
+                           size_t layer, int &nslots, size_t &nlong, size_t &ksuf_len);
+  static node_base_type *bulk_build_upper(std::vector<bulk_node> &level,
+                                          double fill_factor, threadinfo &ti);
 public:
   template <bool Reverse> class search_range_scanner_base;
   template <bool Reverse> class no_callback_search_range_scanner;
@@ -783,6 +840,37 @@ template <typename P> inline size_t mbtree<P>::size() const {
   return c.size_;
 }
 
+template <typename P> size_t mbtree<P>::memory_size() const {
+  size_t bytes = 0;
+  std::vector<node_base_type *> q, children;
+  q.push_back(table_.root());
+  while (!q.empty()) {
+    node_base_type *cur = q.back();
+    q.pop_back();
+    prefetch(cur);
+    nodeversion_type version;
+    do {
+      children.clear();
+      version = cur->stable();
+      if (cur->isleaf()) {
+        leaf_type *leaf = static_cast<leaf_type *>(cur);
+        auto perm = leaf->permutation();
+        for (int i = 0; i != perm.size(); ++i)
+          if (leaf->is_layer(perm[i]))
+            children.push_back(leaf->lv_[perm[i]].layer());
+      } else {
+        internode_type *in = static_cast<internode_type *>(cur);
+        for (int i = 0; i <= in->size(); ++i)
+          children.push_back(in->child_[i]);
+      }
+    } while (unlikely(cur->has_changed(version)));
+    // Nodes come from MM::allocate() with an Object header, see simple_threadinfo
+    bytes += align_up(sizeof(Object) + (cur->isleaf() ? sizeof(leaf_type) : sizeof(internode_type)));
+    q.insert(q.end(), children.begin(), children.end());
+  }
+  return bytes;
+}
+
 template <typename P>
 inline PROMISE(bool) mbtree<P>::search(const key_type &k, OID &o, epoch_num e,
                               versioned_node_t *search_info) const {
@@ -1297,6 +1385,212 @@ mbtree<P>::ExtractValues(const node_opaque_t *n) {
   return ret;
 }
 
+template <typename P>
+size_t mbtree<P>::bulk_common_layers(const bulk_entry *entries, size_t n) {
+  if (!n) {
+    return 0;
+  }
+  // Sorted: the first and last keys' common prefix is everyone's
+  const varstr *first = entries[0].key;
+  const varstr *last = entries[n - 1].key;
+  size_t len = std::min(first->size(), last->size());
+  size_t lcp = 0;
+  while (lcp < len && first->data()[lcp] == last->data()[lcp]) {
+    ++lcp;
+  }
+  size_t layers = lcp / sizeof(key_slice);
+  if (layers && first->size() == layers * sizeof(key_slice)) {
+    // The common prefix is itself a key; it lives one layer up
+    --layers;
+  }
+  return layers;
+}
+
+// Find the end of the run of keys starting at [begin] that share their ikey
+// in [layer]. Such a run must stay in one leaf: each key short enough to end
+// in this layer takes a slot, all the longer ones share one more slot, as a
+// key suffix if there is only one or a lower layer otherwise.
+template <typename P>
+size_t mbtree<P>::bulk_group(const bulk_entry *entries, size_t n, size_t begin,
+                             size_t layer, int &nslots, size_t &nlong,
+                             size_t &ksuf_len) {
+  key_slice ikey = bulk_layer_key(entries[begin], layer).ikey();
+  size_t end = begin;
+  nslots = 0;
+  nlong = 0;
+  ksuf_len = 0;
+  for (; end < n; ++end) {
+    auto k = bulk_layer_key(entries[end], layer);
+    if (k.ikey() != ikey) {
+      break;
+    }
+    if (k.has_suffix()) {
+      ++nlong;
+      ksuf_len = k.suffix_length();
+    } else {
+      ++nslots;
+    }
+  }
+  if (nlong) {
+    ++nslots;
+  }
+  if (nlong != 1) {
+    ksuf_len = 0;
+  }
+  return end;
+}
+
+template <typename P>
+std::vector<size_t> mbtree<P>::bulk_partition(const bulk_entry *entries, size_t n,
+                                              size_t layer, uint32_t nparts) {
+  std::vector<size_t> bounds(1, 0);
+  for (uint32_t i = 1; i < nparts; ++i) {
+    size_t b = std::max(bounds.back(), n * i / nparts);
+    // Don't cut through keys that must share a leaf
+    while (b > 0 && b < n &&
+           bulk_layer_key(entries[b], layer).ikey() ==
+               bulk_layer_key(entries[b - 1], layer).ikey()) {
+      ++b;
+    }
+    if (b > bounds.back() && b < n) {
+      bounds.push_back(b);
+    }
+  }
+  bounds.push_back(n);
+  return bounds;
+}
+
+template <typename P>
+void mbtree<P>::bulk_build_leaves(const bulk_entry *entries, size_t n, size_t layer,
+                                  double fill_factor, epoch_num e,
+                                  std::vector<bulk_node> &out) {
+  threadinfo ti(e);
+  const int per_leaf = std::max(1, std::min(int(leaf_type::width),
+                                            int(leaf_type::width * fill_factor)));
+  size_t i = 0;
+  while (i < n) {
+    // Take as many whole groups as fit
+    int nslots = 0;
+    size_t ksuf_len = 0;
+    size_t end = i;
+    while (end < n) {
+      int g_slots = 0;
+      size_t g_long = 0, g_ksuf_len = 0;
+      size_t g_end = bulk_group(entries, n, end, layer, g_slots, g_long, g_ksuf_len);
+      if (nslots && nslots + g_slots > per_leaf) {
+        break;
+      }
+      nslots += g_slots;
+      ksuf_len += g_ksuf_len;
+      end = g_end;
+    }
+
+    size_t ksuf_size = 0;
+    if (ksuf_len) {
+      ksuf_size = leaf_type::internal_ksuf_type::safe_size(leaf_type::width, ksuf_len);
+    }
+    leaf_type *leaf = leaf_type::make(ksuf_size, 0, ti);
+    int p = 0;
+    while (i < end) {
+      int g_slots = 0;
+      size_t g_long = 0, g_ksuf_len = 0;
+      size_t g_end = bulk_group(entries, n, i, layer, g_slots, g_long, g_ksuf_len);
+      // Short keys sort before the long ones with the same ikey
+      size_t long_begin = g_end - g_long;
+      for (; i < long_begin || (g_long == 1 && i < g_end); ++i, ++p) {
+        // assign() keeps key suffixes of positions in the permutation
+        leaf->permutation_ = permuter_type::make_sorted(p);
+        leaf->assign(p, bulk_layer_key(entries[i], layer), ti);
+        leaf->lv_[p].value() = entries[i].oid;
+      }
+      if (g_long > 1) {
+        std::vector<bulk_node> lower;
+        bulk_build_leaves(entries + long_begin, g_long, layer + 1, fill_factor, e, lower);
+        leaf->ikey0_[p] = bulk_layer_key(entries[long_begin], layer).ikey();
+        leaf->keylenx_[p] = leaf_type::layer_keylenx;
+        leaf->lv_[p] = leafvalue_type(bulk_build_upper(lower, fill_factor, ti));
+        ++p;
+        i = g_end;
+      }
+    }
+    ASSERT(p == nslots);
+    leaf->permutation_ = permuter_type::make_sorted(p);
+    out.emplace_back(leaf, leaf->ikey_bound());
+  }
+}
+
+// Link the leaves in [level] and build the internal nodes above them.
+// Returns the root, which is marked as such; [level] is consumed.
+template <typename P>
+typename mbtree<P>::node_base_type *
+mbtree<P>::bulk_build_upper(std::vector<bulk_node> &level, double fill_factor,
+                            threadinfo &ti) {
+  ALWAYS_ASSERT(level.size());
+  for (size_t i = 0; i < level.size(); ++i) {
+    leaf_type *leaf = static_cast<leaf_type *>(level[i].first);
+    leaf->prev_ = i ? static_cast<leaf_type *>(level[i - 1].first) : nullptr;
+    leaf->next_.ptr =
+        i + 1 < level.size() ? static_cast<leaf_type *>(level[i + 1].first) : nullptr;
+  }
+
+  const int max_children = internode_type::width + 1;
+  const int per_node = std::max(2, std::min(max_children, int(max_children * fill_factor)));
+  while (level.size() > 1) {
+    std::vector<bulk_node> upper;
+    size_t i = 0;
+    while (i < level.size()) {
+      size_t take = std::min<size_t>(per_node, level.size() - i);
+      // Every internal node needs at least two children
+      if (level.size() - i - take == 1) {
+        if (take < max_children) {
+          ++take;
+        } else {
+          --take;
+        }
+      }
+      internode_type *in = internode_type::make(ti);
+      in->child_[0] = level[i].first;
+      level[i].first->set_parent(in);
+      for (size_t j = 1; j < take; ++j) {
+        in->ikey0_[j - 1] = level[i + j].second;
+        in->child_[j] = level[i + j].first;
+        level[i + j].first->set_parent(in);
+      }
+      in->nkeys_ = take - 1;
+      upper.emplace_back(in, level[i].second);
+      i += take;
+    }
+    level.swap(upper);
+  }
+  level[0].first->mark_root();
+  return level[0].first;
+}
+
+template <typename P>
+void mbtree<P>::bulk_install(std::vector<bulk_node> &leaves, const bulk_entry *entries,
+                             size_t layer, double fill_factor, epoch_num e) {
+  node_base_type *old_root = table_.root_;
+  ALWAYS_ASSERT(old_root->isleaf() && static_cast<leaf_type *>(old_root)->size() == 0);
+  if (leaves.empty()) {
+    return;
+  }
+
+  threadinfo ti(e);
+  node_base_type *root = bulk_build_upper(leaves, fill_factor, ti);
+  // Above [layer] all keys are the same: one single-entry leaf per layer
+  while (layer--) {
+    leaf_type *twig = leaf_type::make_root(0, nullptr, ti);
+    twig->ikey0_[0] = bulk_layer_key(entries[0], layer).ikey();
+    twig->keylenx_[0] = leaf_type::layer_keylenx;
+    twig->lv_[0] = leafvalue_type(root);
+    twig->permutation_ = permuter_type::make_sorted(1);
+    root = twig;
+  }
+  fence();
+  table_.root_ = root;
+  static_cast<leaf_type *>(old_root)->deallocate(ti);
+}
+
 template <typename P> void mbtree<P>::print() { table_.print(); }
 
 typedef mbtree<masstree_params> ConcurrentMasstree;
@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+
+#include <sm-coroutine.h>
+
+// Compares the cost of suspending and resuming at the bottom of a chain of
+// nested generators, for nesting depths 1-6:
+//
+// - round_trip_generator is how generator<T> used to work: a callee records
+//   itself in its caller's promise, and every frame goes back to the
+//   scheduler when it suspends or finishes, so the scheduler has to walk the
+//   chain to find the frame to resume and pays an extra switch per finished
+//   frame.
+//
+// - ermia::coro::generator uses symmetric transfer: the scheduler resumes
+//   the leaf directly, and finished callees transfer straight to their
+//   callers.
+
+using ermia::coro::generator;
+
+static const int kLeafSuspends = 16;
+
+template <typename T> struct [[nodiscard]] round_trip_generator {
+  struct promise_type;
+  using handle = std::experimental::coroutine_handle<promise_type>;
+
+  struct promise_type {
+    auto get_return_object() { return round_trip_generator{handle::from_promise(*this)}; }
+    auto initial_suspend() { return std::experimental::suspend_never{}; }
+    auto final_suspend() noexcept { return std::experimental::suspend_always{}; }
+    void unhandled_exception() { std::terminate(); }
+    void return_value(T v) { value = v; }
+    void *operator new(size_t sz) { return ermia::coro::coroutine_allocator.alloc(sz); }
+    void operator delete(void *p, size_t sz) { ermia::coro::coroutine_allocator.free(p, sz); }
+
+    T value;
+    handle callee = nullptr;
+  };
+
+  round_trip_generator(handle h) : coro(h) {}
+  round_trip_generator(round_trip_generator &&rhs) : coro(rhs.coro) { rhs.coro = nullptr; }
+  ~round_trip_generator() {
+    if (coro) {
+      coro.destroy();
+    }
+  }
+
+  struct awaiter {
+    handle callee;
+    constexpr bool await_ready() const noexcept { return false; }
+    void await_suspend(handle caller) noexcept { caller.promise().callee = callee; }
+    T await_resume() noexcept { return callee.promise().value; }
+  };
+  awaiter operator co_await() { return awaiter{coro}; }
+
+  // Resume the innermost frame that can make progress
+  static void resume(handle root) {
+    handle h = root;
+    while (h.promise().callee && !h.promise().callee.done()) {
+      h = h.promise().callee;
+    }
+    h.promise().callee = nullptr;
+    h.resume();
+  }
+
+  handle get_handle() {
+    handle h = coro;
+    coro = nullptr;
+    return h;
+  }
+
+  handle coro;
+};
+
+round_trip_generator<int> RoundTripNested(int depth) {
+  if (depth == 1) {
+    for (int i = 0; i < kLeafSuspends; ++i) {
+      co_await std::experimental::suspend_always{};
+    }
+    co_return 1;
+  }
+  int ret = co_await RoundTripNested(depth - 1);
+  co_return ret + 1;
+}
+
+generator<int> SymmetricNested(int depth) {
+  if (depth == 1) {
+    for (int i = 0; i < kLeafSuspends; ++i) {
+      co_await std::experimental::suspend_always{};
+    }
+    co_return 1;
+  }
+  int ret = co_await SymmetricNested(depth - 1);
+  co_return ret + 1;
+}
+
+static void BM_RoundTripGenerator(benchmark::State &state) {
+  const int depth = state.range(0);
+  for (auto _ : state) {
+    auto h = RoundTripNested(depth).get_handle();
+    while (!h.done()) {
+      round_trip_generator<int>::resume(h);
+    }
+    benchmark::DoNotOptimize(h.promise().value);
+    h.destroy();
+  }
+  state.SetItemsProcessed(state.iterations() * kLeafSuspends);
+}
+
+static void BM_SymmetricGenerator(benchmark::State &state) {
+  const int depth = state.range(0);
+  for (auto _ : state) {
+    auto h = SymmetricNested(depth).get_handle();
+    while (!h.done()) {
+      h.promise().resume_leaf();
+    }
+    benchmark::DoNotOptimize(h.promise().get_return_value());
+    h.destroy();
+  }
+  state.SetItemsProcessed(state.iterations() * kLeafSuspends);
+}
+
+BENCHMARK(BM_RoundTripGenerator)->DenseRange(1, 6);
+BENCHMARK(BM_SymmetricGenerator)->DenseRange(1, 6);
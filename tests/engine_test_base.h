@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <dbcore/sm-config.h>
+#include <dbcore/sm-log-recover-impl.h>
+#include <dbcore/sm-thread.h>
+#include <ermia.h>
+
+// Tests that run real transactions. The log and OID managers are process-wide,
+// so all tests in a binary share one engine: a single worker, a null log
+// device (unless realLogDevice() is set) and malloc-backed records (no huge
+// pages needed).
+class EngineTestBase : public ::testing::Test {
+   protected:
+    virtual void SetUp() override {
+        db_ = engine();
+        arena_ = new ermia::str_arena(ermia::config::arena_size_mb);
+        txn_buf_ = (ermia::transaction *)malloc(sizeof(ermia::transaction));
+    }
+
+    virtual void TearDown() override {
+        free(txn_buf_);
+        delete arena_;
+    }
+
+    // Tests that read records back from the log set this before the first
+    // engine() call in the binary
+    static bool &realLogDevice() {
+        static bool real = false;
+        return real;
+    }
+
+    static ermia::Engine *engine() {
+        static ermia::Engine *db = createEngine();
+        return db;
+    }
+
+    // Transactions must run on an ermia thread (registered with the epoch
+    // managers), as benchmark workers do
+    static void runOnThread(std::function<void()> fn) {
+        ermia::thread::Thread *th = ermia::thread::GetThread(true);
+        ASSERT_TRUE(th);
+        ermia::thread::Thread::Task task = [&](char *) { fn(); };
+        th->StartTask(task);
+        th->Join();
+        ermia::thread::PutThread(th);
+    }
+
+    // Create a table (and its primary index through [create_index]) from an
+    // ermia thread; returns the primary index
+    static ermia::OrderedIndex *createTable(const char *name,
+                                            std::function<void()> create_index) {
+        runOnThread([&]() {
+            engine()->CreateTable(name);
+            create_index();
+        });
+        return ermia::TableDescriptor::GetPrimaryIndex(name);
+    }
+
+    // Resets the arena: allocate keys and values after this
+    ermia::transaction *begin(uint64_t flags = 0) {
+        return db_->NewTransaction(flags, *arena_, txn_buf_);
+    }
+
+    ermia::varstr &str(ermia::transaction *t, const std::string &s) {
+        ermia::varstr *v = t->string_allocator().next(s.size());
+        memcpy(v->data(), s.data(), s.size());
+        return *v;
+    }
+
+    static std::string toString(const ermia::varstr &v) {
+        return std::string((const char *)v.data(), v.size());
+    }
+
+    ermia::Engine *db_;
+    ermia::str_arena *arena_;
+    ermia::transaction *txn_buf_;
+
+   private:
+    static ermia::Engine *createEngine() {
+        char log_dir[] = "/dev/shm/ermia-test-log-XXXXXX";
+        EXPECT_TRUE(mkdtemp(log_dir));
+        ermia::config::log_dir = log_dir;
+        ermia::config::null_log_device = !realLogDevice();
+        ermia::config::log_segment_mb = 64;
+        ermia::config::log_buffer_mb = 16;
+        ermia::config::tls_alloc = false;
+        ermia::config::verbose = false;
+        ermia::config::threads = 1;
+        ermia::config::worker_threads = 1;
+        ermia::config::recover_functor = new ermia::parallel_oid_replay(1);
+
+        ermia::thread::Initialize();
+        ermia::config::init();
+        ermia::MM::prepare_node_memory();
+        ermia::config::sanity_check();
+        return new ermia::Engine();
+    }
+};
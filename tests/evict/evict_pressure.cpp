@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include <dbcore/sm-evict.h>
+
+// The evictor's memory pressure signal: a node's bump allocator only grows,
+// so what eviction gives back has to come off through the free object pools
+class EvictPressure : public ::testing::Test {
+   protected:
+    virtual void SetUp() override {
+        ermia::config::node_memory_gb = 1;
+        ermia::config::evict_threshold_pct = 50;
+    }
+
+    static const uint64_t kLimit = ermia::config::GB / 2;
+};
+
+TEST_F(EvictPressure, BelowThreshold) {
+    ermia::MM::free_pool_stats free;
+    EXPECT_FALSE(ermia::evict::UnderPressure(0, free));
+    EXPECT_FALSE(ermia::evict::UnderPressure(kLimit - 1, free));
+}
+
+TEST_F(EvictPressure, AboveThreshold) {
+    ermia::MM::free_pool_stats free;
+    EXPECT_TRUE(ermia::evict::UnderPressure(kLimit, free));
+    EXPECT_TRUE(ermia::evict::UnderPressure(ermia::config::GB, free));
+}
+
+TEST_F(EvictPressure, ClearsAfterEviction) {
+    uint64_t allocated = kLimit + 100 * ermia::config::MB;
+    ermia::MM::free_pool_stats free;
+    ASSERT_TRUE(ermia::evict::UnderPressure(allocated, free));
+
+    // Evicted versions wait for their epoch first...
+    free.pending_bytes = 60 * ermia::config::MB;
+    EXPECT_TRUE(ermia::evict::UnderPressure(allocated, free));
+
+    // ...then are handed off to the node's depot, ready for reuse
+    free.pending_bytes = 0;
+    free.depot_bytes = 101 * ermia::config::MB;
+    EXPECT_FALSE(ermia::evict::UnderPressure(allocated, free));
+
+    // Workers reused most of it
+    free.depot_bytes = 0;
+    free.ready_bytes = 50 * ermia::config::MB;
+    EXPECT_TRUE(ermia::evict::UnderPressure(allocated, free));
+}
@@ -0,0 +1,103 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <dbcore/sm-evict.h>
+#include <dbcore/sm-table.h>
+
+#include "../engine_test_base.h"
+
+// Evict a record to the log and read it back through transactions. Needs the
+// log on disk; the evictor thread itself isn't started (no huge pages here),
+// records are evicted one by one with evict::Evict().
+class EvictReload : public EngineTestBase {
+   protected:
+    virtual void SetUp() override {
+        realLogDevice() = true;
+        EngineTestBase::SetUp();
+        index_ = table();
+    }
+
+    static ermia::OrderedIndex *table() {
+        static ermia::OrderedIndex *index = createTable("EVICT_TABLE", []() {
+            engine()->CreateMasstreePrimaryIndex("EVICT_TABLE", std::string("EVICT_TABLE"));
+        });
+        return index;
+    }
+
+    // Big enough to be worth a stub
+    static std::string value(char c) { return std::string(1024, c); }
+
+    rc_t get(const std::string &key, std::string &v) {
+        ermia::transaction *t = begin(ermia::transaction::TXN_FLAG_READ_ONLY);
+        ermia::varstr out;
+        rc_t rc = rc_t{RC_INVALID};
+        index_->GetRecord(t, rc, str(t, key), out);
+        if (rc._val == RC_TRUE) {
+            v = toString(out);
+        }
+        EXPECT_FALSE(db_->Commit(t).IsAbort());
+        return rc;
+    }
+
+    // Insert [key] and make it durable; returns its OID entry
+    ermia::fat_ptr *insertDurable(const std::string &key, const std::string &v) {
+        ermia::transaction *t = begin();
+        ermia::OID oid = 0;
+        EXPECT_EQ(index_->InsertRecord(t, str(t, key), str(t, v), &oid)._val, RC_TRUE);
+        EXPECT_FALSE(db_->Commit(t).IsAbort());
+        ermia::logmgr->flush();
+        return ermia::TableDescriptor::Get("EVICT_TABLE")->GetTupleArray()->get(oid);
+    }
+
+    static ermia::Object *head(ermia::fat_ptr *entry) {
+        return (ermia::Object *)ermia::volatile_read(*entry).offset();
+    }
+
+    ermia::OrderedIndex *index_;
+};
+
+TEST_F(EvictReload, ReadBack) {
+    runOnThread([&]() {
+        ermia::fat_ptr *entry = insertDurable("evict", value('a'));
+        ermia::evict::evict_stats before = ermia::evict::get_evict_stats();
+
+        ASSERT_TRUE(ermia::evict::Evict(entry));
+        EXPECT_TRUE(head(entry)->IsEvicted());
+        // Already a stub
+        EXPECT_FALSE(ermia::evict::Evict(entry));
+
+        // The first read goes to the log and puts the record back
+        std::string v;
+        ASSERT_EQ(get("evict", v)._val, RC_TRUE);
+        EXPECT_EQ(v, value('a'));
+        EXPECT_FALSE(head(entry)->IsEvicted());
+
+        ermia::evict::evict_stats after = ermia::evict::get_evict_stats();
+        EXPECT_EQ(after.evicted - before.evicted, 1u);
+        EXPECT_EQ(after.faults - before.faults, 1u);
+        EXPECT_EQ(after.reloads - before.reloads, 1u);
+
+        // The next one doesn't
+        ASSERT_EQ(get("evict", v)._val, RC_TRUE);
+        EXPECT_EQ(v, value('a'));
+        EXPECT_EQ(ermia::evict::get_evict_stats().faults, after.faults);
+    });
+}
+
+TEST_F(EvictReload, UpdateAfterReload) {
+    runOnThread([&]() {
+        ermia::fat_ptr *entry = insertDurable("evict-update", value('a'));
+        ASSERT_TRUE(ermia::evict::Evict(entry));
+
+        std::string v;
+        ASSERT_EQ(get("evict-update", v)._val, RC_TRUE);
+        ermia::transaction *t = begin();
+        ASSERT_EQ(index_->UpdateRecord(t, str(t, "evict-update"), str(t, value('b')))._val,
+                  RC_TRUE);
+        ASSERT_FALSE(db_->Commit(t).IsAbort());
+
+        ASSERT_EQ(get("evict-update", v)._val, RC_TRUE);
+        EXPECT_EQ(v, value('b'));
+    });
+}
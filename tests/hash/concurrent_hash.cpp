@@ -0,0 +1,137 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <dbcore/concurrent-hash.h>
+#include <varstr.h>
+
+class ConcurrentHashTable : public ::testing::Test {
+   protected:
+    virtual void SetUp() override {
+        // Small on purpose so that overflow buckets get exercised
+        table_ = new ermia::ConcurrentHashTable(0);
+    }
+
+    virtual void TearDown() override {
+        delete table_;
+    }
+
+    static std::string keyOf(uint32_t i) {
+        return "key-" + std::to_string(i);
+    }
+
+    bool insert(const std::string &key, ermia::OID oid) {
+        return table_->insert_if_absent(ermia::varstr(key.data(), key.size()), oid);
+    }
+
+    bool search(const std::string &key, ermia::OID &oid) {
+        return table_->search(ermia::varstr(key.data(), key.size()), oid);
+    }
+
+    ermia::ConcurrentHashTable *table_;
+};
+
+TEST_F(ConcurrentHashTable, InsertSearch) {
+    const uint32_t kKeys = 50000;
+    for (uint32_t i = 0; i < kKeys; ++i) {
+        ASSERT_TRUE(insert(keyOf(i), i));
+    }
+    for (uint32_t i = 0; i < kKeys; ++i) {
+        ermia::OID oid = ermia::INVALID_OID;
+        ASSERT_TRUE(search(keyOf(i), oid));
+        EXPECT_EQ(oid, i);
+    }
+    ermia::OID oid = ermia::INVALID_OID;
+    EXPECT_FALSE(search(keyOf(kKeys), oid));
+    EXPECT_EQ(table_->size(), kKeys);
+}
+
+TEST_F(ConcurrentHashTable, DuplicateInsert) {
+    ASSERT_TRUE(insert("k", 1));
+    EXPECT_FALSE(insert("k", 2));
+
+    ermia::OID oid = ermia::INVALID_OID;
+    ASSERT_TRUE(search("k", oid));
+    EXPECT_EQ(oid, 1);
+
+    // Prefixes are different keys
+    EXPECT_TRUE(insert("", 3));
+    EXPECT_TRUE(insert("kk", 4));
+    EXPECT_EQ(table_->size(), 3);
+}
+
+TEST_F(ConcurrentHashTable, MemorySize) {
+    typedef ermia::ConcurrentHashTable T;
+    const size_t empty = table_->memory_size();
+    EXPECT_EQ(empty, T::kMinBuckets * sizeof(T::Bucket));
+
+    const uint32_t kKeys = 20000;
+    size_t entries = 0;
+    for (uint32_t i = 0; i < kKeys; ++i) {
+        ASSERT_TRUE(insert(keyOf(i), i));
+        entries += sizeof(T::Entry) + keyOf(i).size();
+    }
+    // Past 7 keys per bucket on average, so some overflow buckets too
+    EXPECT_GT(table_->memory_size(), empty + entries);
+    EXPECT_EQ((table_->memory_size() - empty - entries) % sizeof(T::Bucket), 0);
+}
+
+TEST_F(ConcurrentHashTable, ConcurrentInsertSameKeys) {
+    const uint32_t kKeys = 20000;
+    const uint32_t kThreads = 8;
+    std::vector<uint32_t> inserted(kThreads, 0);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t] {
+            // Every thread inserts every key: exactly one must win each
+            for (uint32_t i = 0; i < kKeys; ++i) {
+                inserted[t] += insert(keyOf(i), t);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    uint32_t total = 0;
+    for (auto n : inserted) {
+        total += n;
+    }
+    EXPECT_EQ(total, kKeys);
+    EXPECT_EQ(table_->size(), kKeys);
+}
+
+TEST_F(ConcurrentHashTable, AMACSearch) {
+    const uint32_t kKeys = 10000;
+    for (uint32_t i = 0; i < kKeys; i += 2) {
+        ASSERT_TRUE(insert(keyOf(i), i));
+    }
+
+    std::vector<std::string> keys;
+    for (uint32_t i = 0; i < kKeys; ++i) {
+        keys.push_back(keyOf(i));
+    }
+    std::vector<ermia::varstr> vkeys;
+    for (auto &k : keys) {
+        vkeys.emplace_back(k.data(), k.size());
+    }
+
+    const uint32_t kBatch = 16;
+    std::vector<ermia::ConcurrentHashTable::AMACState> requests;
+    for (uint32_t i = 0; i < kKeys; i += kBatch) {
+        requests.clear();
+        for (uint32_t j = i; j < i + kBatch && j < kKeys; ++j) {
+            requests.emplace_back(&vkeys[j]);
+        }
+        table_->search_amac(requests);
+        for (uint32_t j = 0; j < requests.size(); ++j) {
+            if ((i + j) % 2 == 0) {
+                EXPECT_EQ(requests[j].out_oid, i + j);
+            } else {
+                EXPECT_EQ(requests[j].out_oid, ermia::INVALID_OID);
+            }
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../engine_test_base.h"
+
+// ConcurrentHashIndex through transactions: the OrderedIndex interface the
+// benchmarks use (YCSB --hash-index)
+class ConcurrentHashIndex : public EngineTestBase {
+   protected:
+    virtual void SetUp() override {
+        EngineTestBase::SetUp();
+        index_ = table();
+    }
+
+    static ermia::OrderedIndex *table() {
+        static ermia::OrderedIndex *index = createTable("HASH_TABLE", []() {
+            engine()->CreateHashPrimaryIndex("HASH_TABLE", std::string("HASH_TABLE"));
+        });
+        return index;
+    }
+
+    rc_t insert(const std::string &key, const std::string &value) {
+        ermia::transaction *t = begin();
+        rc_t rc = index_->InsertRecord(t, str(t, key), str(t, value));
+        if (rc.IsAbort()) {
+            db_->Abort(t);
+            return rc;
+        }
+        return db_->Commit(t);
+    }
+
+    // Returns RC_TRUE and the value if [key] is visible to a new transaction
+    rc_t get(const std::string &key, std::string &value) {
+        ermia::transaction *t = begin(ermia::transaction::TXN_FLAG_READ_ONLY);
+        ermia::varstr v;
+        rc_t rc = rc_t{RC_INVALID};
+        index_->GetRecord(t, rc, str(t, key), v);
+        if (rc._val == RC_TRUE) {
+            value = toString(v);
+        }
+        EXPECT_FALSE(db_->Commit(t).IsAbort());
+        return rc;
+    }
+
+    ermia::OrderedIndex *index_;
+};
+
+class CountingCallback : public ermia::OrderedIndex::ScanCallback {
+   public:
+    virtual bool Invoke(const char *, size_t, const ermia::varstr &) override {
+        ++count;
+        return true;
+    }
+    size_t count = 0;
+};
+
+TEST_F(ConcurrentHashIndex, InsertGet) {
+    runOnThread([&]() {
+        ASSERT_EQ(insert("insert-get", "v1")._val, RC_TRUE);
+        std::string value;
+        ASSERT_EQ(get("insert-get", value)._val, RC_TRUE);
+        EXPECT_EQ(value, "v1");
+        EXPECT_EQ(get("insert-get-missing", value)._val, RC_FALSE);
+    });
+}
+
+TEST_F(ConcurrentHashIndex, DuplicateInsert) {
+    runOnThread([&]() {
+        ASSERT_EQ(insert("duplicate", "v1")._val, RC_TRUE);
+        EXPECT_EQ(insert("duplicate", "v2")._val, RC_ABORT_INTERNAL);
+        std::string value;
+        ASSERT_EQ(get("duplicate", value)._val, RC_TRUE);
+        EXPECT_EQ(value, "v1");
+    });
+}
+
+TEST_F(ConcurrentHashIndex, AbortedInsert) {
+    runOnThread([&]() {
+        ermia::transaction *t = begin();
+        ASSERT_EQ(index_->InsertRecord(t, str(t, "aborted"), str(t, "v1"))._val, RC_TRUE);
+        db_->Abort(t);
+        std::string value;
+        EXPECT_EQ(get("aborted", value)._val, RC_FALSE);
+    });
+}
+
+TEST_F(ConcurrentHashIndex, Update) {
+    runOnThread([&]() {
+        ASSERT_EQ(insert("update", "v1")._val, RC_TRUE);
+
+        ermia::transaction *t = begin();
+        ASSERT_EQ(index_->UpdateRecord(t, str(t, "update"), str(t, "v2"))._val, RC_TRUE);
+        ASSERT_FALSE(db_->Commit(t).IsAbort());
+
+        std::string value;
+        ASSERT_EQ(get("update", value)._val, RC_TRUE);
+        EXPECT_EQ(value, "v2");
+
+        // Updating a key that isn't there aborts
+        t = begin();
+        EXPECT_EQ(index_->UpdateRecord(t, str(t, "update-missing"), str(t, "v"))._val,
+                  RC_ABORT_INTERNAL);
+        db_->Abort(t);
+    });
+}
+
+TEST_F(ConcurrentHashIndex, Remove) {
+    runOnThread([&]() {
+        ASSERT_EQ(insert("remove", "v1")._val, RC_TRUE);
+
+        ermia::transaction *t = begin();
+        ASSERT_EQ(index_->RemoveRecord(t, str(t, "remove"))._val, RC_TRUE);
+        ASSERT_FALSE(db_->Commit(t).IsAbort());
+
+        std::string value;
+        EXPECT_EQ(get("remove", value)._val, RC_FALSE);
+
+        t = begin();
+        EXPECT_EQ(index_->RemoveRecord(t, str(t, "remove-missing"))._val,
+                  RC_ABORT_INTERNAL);
+        db_->Abort(t);
+    });
+}
+
+TEST_F(ConcurrentHashIndex, ScanNotSupported) {
+    runOnThread([&]() {
+        ASSERT_EQ(insert("scan", "v1")._val, RC_TRUE);
+
+        ermia::transaction *t = begin(ermia::transaction::TXN_FLAG_READ_ONLY);
+        CountingCallback callback;
+        ermia::varstr &start = str(t, "scan");
+        ermia::varstr &end = str(t, "scan~");
+        EXPECT_EQ(index_->Scan(t, start, &end, callback)._val, RC_ABORT_INTERNAL);
+        EXPECT_EQ(index_->ReverseScan(t, end, &start, callback)._val, RC_ABORT_INTERNAL);
+        EXPECT_EQ(callback.count, 0u);
+        db_->Abort(t);
+    });
+}
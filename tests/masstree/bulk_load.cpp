@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <dbcore/sm-coroutine.h>
+#include <dbcore/sm-thread.h>
+#include <masstree/masstree_btree.h>
+#include <varstr.h>
+
+#include "record.h"
+
+typedef ermia::ConcurrentMasstree::bulk_entry bulk_entry;
+typedef ermia::ConcurrentMasstree::bulk_node bulk_node;
+
+class BulkLoadMasstree : public ::testing::Test {
+   protected:
+    virtual void SetUp() override {
+        tree_ = new ermia::ConcurrentMasstree();
+        xid_context_.begin_epoch = 0;
+        xid_context_.owner = ermia::XID::make(0, 0);
+        xid_context_.xct = nullptr;
+    }
+
+    virtual void TearDown() override {
+        delete tree_;
+    }
+
+    // Sort and dedup [records] and point [entries] at their keys
+    void prepare(std::vector<Record> &records) {
+        std::sort(records.begin(), records.end(),
+                  [](const Record &a, const Record &b) { return a.key < b.key; });
+        records.erase(std::unique(records.begin(), records.end(),
+                                  [](const Record &a, const Record &b) {
+                                      return a.key == b.key;
+                                  }),
+                      records.end());
+        keys_.clear();
+        entries_.clear();
+        keys_.reserve(records.size());
+        for (Record &record : records) {
+            // Masstree reads keys a word at a time
+            record.key.reserve(record.key.size() + sizeof(uint64_t));
+            keys_.emplace_back(record.key.data(), record.key.size());
+        }
+        for (size_t i = 0; i < records.size(); ++i) {
+            entries_.push_back(bulk_entry{&keys_[i], records[i].value});
+        }
+    }
+
+    void parallelBulkLoad(double fill_factor, uint32_t nthreads) {
+        size_t layer = ermia::ConcurrentMasstree::bulk_common_layers(
+            entries_.data(), entries_.size());
+        std::vector<size_t> bounds = ermia::ConcurrentMasstree::bulk_partition(
+            entries_.data(), entries_.size(), layer, nthreads);
+        std::vector<std::vector<bulk_node>> parts(bounds.size() - 1);
+
+        std::vector<ermia::thread::Thread *> threads;
+        for (uint32_t i = 0; i < parts.size(); ++i) {
+            ermia::thread::Thread *th = ermia::thread::GetThread(true);
+            EXPECT_TRUE(th);
+            ermia::thread::Thread::Task build_task = [&, i](char *) {
+                ermia::ConcurrentMasstree::bulk_build_leaves(
+                    entries_.data() + bounds[i], bounds[i + 1] - bounds[i],
+                    layer, fill_factor, 0, parts[i]);
+            };
+            th->StartTask(build_task);
+            threads.push_back(th);
+        }
+        for (ermia::thread::Thread *th : threads) {
+            th->Join();
+            ermia::thread::PutThread(th);
+        }
+
+        std::vector<bulk_node> leaves;
+        for (auto &part : parts) {
+            leaves.insert(leaves.end(), part.begin(), part.end());
+        }
+        tree_->bulk_install(leaves, entries_.data(), layer, fill_factor, 0);
+    }
+
+    PROMISE(bool) insertRecord(const Record &record) {
+        RETURN AWAIT tree_->insert(
+            ermia::varstr(record.key.data(), record.key.size()), record.value,
+            &xid_context_, nullptr, nullptr);
+    }
+
+    PROMISE(bool)
+    searchByKey(const std::string &key, ermia::OID *out_value) {
+        RETURN AWAIT tree_->search(ermia::varstr(key.data(), key.size()),
+                                   *out_value, 0, nullptr);
+    }
+
+    void expectAllFound(const std::vector<Record> &records) {
+        for (const Record &record : records) {
+            ermia::OID value_out = 0;
+            EXPECT_TRUE(sync_wait_coro(searchByKey(record.key, &value_out)));
+            EXPECT_EQ(record.value, value_out);
+        }
+    }
+
+    ermia::ConcurrentMasstree *tree_;
+    ermia::TXN::xid_context xid_context_;
+    std::vector<ermia::varstr> keys_;
+    std::vector<bulk_entry> entries_;
+};
+
+TEST_F(BulkLoadMasstree, Empty) {
+    std::vector<Record> records;
+    prepare(records);
+    tree_->bulk_load(entries_.data(), entries_.size());
+    EXPECT_EQ(tree_->size(), 0);
+
+    Record record = Record{"absd", 1423};
+    EXPECT_TRUE(sync_wait_coro(insertRecord(record)));
+    expectAllFound({record});
+}
+
+TEST_F(BulkLoadMasstree, SequentialKeys) {
+    std::vector<Record> records = genSequentialRecords(200, 8);
+    prepare(records);
+    tree_->bulk_load(entries_.data(), entries_.size());
+    EXPECT_EQ(tree_->size(), records.size());
+    expectAllFound(records);
+}
+
+TEST_F(BulkLoadMasstree, RandomKeys) {
+    std::vector<Record> records = genRandRecords(5000, 32);
+    prepare(records);
+    tree_->bulk_load(entries_.data(), entries_.size(), 0.5);
+    EXPECT_EQ(tree_->size(), records.size());
+    expectAllFound(records);
+
+    const std::vector<Record> records_not_found =
+        genDisjointRecords(records, 100, 32);
+    for (const Record &record : records_not_found) {
+        ermia::OID value_out;
+        EXPECT_FALSE(sync_wait_coro(searchByKey(record.key, &value_out)));
+    }
+}
+
+// Keys that are prefixes of others and long shared prefixes make the loader
+// build lower layers and key suffixes
+TEST_F(BulkLoadMasstree, SharedPrefixes) {
+    std::vector<Record> records;
+    std::string key;
+    for (uint32_t i = 0; i < 2000; ++i) {
+        key.push_back('a' + i % 3);
+        if (key.size() > 40) {
+            key.resize(i % 17);
+        }
+        records.emplace_back(key, i);
+    }
+    prepare(records);
+    tree_->bulk_load(entries_.data(), entries_.size());
+    EXPECT_EQ(tree_->size(), records.size());
+    expectAllFound(records);
+}
+
+TEST_F(BulkLoadMasstree, ParallelBuild) {
+    std::vector<Record> records = genRandRecords(20000, 24);
+    prepare(records);
+    parallelBulkLoad(0.7, 8);
+    EXPECT_EQ(tree_->size(), records.size());
+    expectAllFound(records);
+}
+
+TEST_F(BulkLoadMasstree, InsertAfterLoad) {
+    std::vector<Record> records = genRandRecords(3000, 16);
+    prepare(records);
+    tree_->bulk_load(entries_.data(), entries_.size());
+
+    const std::vector<Record> records_to_insert =
+        genDisjointRecords(records, 3000, 16);
+    for (const Record &record : records_to_insert) {
+        EXPECT_TRUE(sync_wait_coro(insertRecord(record)));
+    }
+    for (const Record &record : records) {
+        EXPECT_FALSE(sync_wait_coro(insertRecord(record)));
+    }
+    EXPECT_EQ(tree_->size(), records.size() + records_to_insert.size());
+    expectAllFound(records);
+    expectAllFound(records_to_insert);
+}
@@ -295,7 +295,7 @@ BENCHMARK_DEFINE_F(PerfSingleThreadSearch, SimpleCoro) (benchmark::State &st) {
                 for (auto & handle : generator_queue) {
                     if (handle) {
                         if(!handle.done()) {
-                            handle.resume();
+                            handle.promise().resume_leaf();
                         } else {
                             finished++;
                             handle.destroy();
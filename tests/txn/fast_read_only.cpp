@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../engine_test_base.h"
+
+// TXN_FLAG_FAST_READ_ONLY: a snapshot without an XID, context or log where
+// the CC scheme allows, a normal read-only transaction otherwise
+class FastReadOnly : public EngineTestBase {
+   protected:
+    virtual void SetUp() override {
+        EngineTestBase::SetUp();
+        index_ = table();
+        writer_arena_ = new ermia::str_arena(ermia::config::arena_size_mb);
+        writer_buf_ = (ermia::transaction *)malloc(sizeof(ermia::transaction));
+    }
+
+    virtual void TearDown() override {
+        free(writer_buf_);
+        delete writer_arena_;
+        EngineTestBase::TearDown();
+    }
+
+    static ermia::OrderedIndex *table() {
+        static ermia::OrderedIndex *index = createTable("FAST_RO_TABLE", []() {
+            engine()->CreateMasstreePrimaryIndex("FAST_RO_TABLE", std::string("FAST_RO_TABLE"));
+        });
+        return index;
+    }
+
+    // Whether this build's CC scheme can take the fast path (SSN/SSI only
+    // with safesnap, which the test engine doesn't enable)
+    static bool fastPath() {
+#if defined(SSN) || defined(SSI) || defined(MVOCC)
+        return false;
+#else
+        return true;
+#endif
+    }
+
+    // Insert or update [key] and commit from another thread, like a
+    // concurrent writer, while the test's own transaction stays open
+    void write(const std::string &key, const std::string &value, bool insert) {
+        runOnThread([&]() {
+            ermia::transaction *t = db_->NewTransaction(0, *writer_arena_, writer_buf_);
+            rc_t rc = insert ? index_->InsertRecord(t, str(t, key), str(t, value))
+                             : index_->UpdateRecord(t, str(t, key), str(t, value));
+            ASSERT_EQ(rc._val, RC_TRUE);
+            ASSERT_FALSE(db_->Commit(t).IsAbort());
+        });
+    }
+
+    rc_t get(ermia::transaction *t, const std::string &key, std::string &value) {
+        ermia::varstr v;
+        rc_t rc = rc_t{RC_INVALID};
+        index_->GetRecord(t, rc, str(t, key), v);
+        if (rc._val == RC_TRUE) {
+            value = toString(v);
+        }
+        return rc;
+    }
+
+    ermia::OrderedIndex *index_;
+    ermia::str_arena *writer_arena_;
+    ermia::transaction *writer_buf_;
+};
+
+TEST_F(FastReadOnly, Flags) {
+    runOnThread([&]() {
+        ermia::transaction *t = begin(ermia::transaction::TXN_FLAG_FAST_READ_ONLY);
+        EXPECT_TRUE(t->is_read_only());
+        EXPECT_EQ(t->is_fast_read_only(), fastPath());
+        if (fastPath()) {
+            // Nothing allocated for it
+            EXPECT_EQ(t->GetXIDContext()->owner._val, ermia::INVALID_XID._val);
+        } else {
+            EXPECT_NE(t->GetXIDContext()->owner._val, ermia::INVALID_XID._val);
+        }
+        EXPECT_FALSE(db_->Commit(t).IsAbort());
+    });
+}
+
+TEST_F(FastReadOnly, SnapshotVisibility) {
+    runOnThread([&]() {
+        write("snapshot", "v1", true);
+
+        ermia::transaction *t = begin(ermia::transaction::TXN_FLAG_FAST_READ_ONLY);
+        std::string value;
+        ASSERT_EQ(get(t, "snapshot", value)._val, RC_TRUE);
+        EXPECT_EQ(value, "v1");
+
+        // Commits after the snapshot was taken stay invisible
+        write("snapshot", "v2", false);
+        write("snapshot-new", "v1", true);
+        ASSERT_EQ(get(t, "snapshot", value)._val, RC_TRUE);
+        EXPECT_EQ(value, "v1");
+        EXPECT_EQ(get(t, "snapshot-new", value)._val, RC_FALSE);
+        EXPECT_FALSE(db_->Commit(t).IsAbort());
+
+        // ...and show up in the next one
+        t = begin(ermia::transaction::TXN_FLAG_FAST_READ_ONLY);
+        ASSERT_EQ(get(t, "snapshot", value)._val, RC_TRUE);
+        EXPECT_EQ(value, "v2");
+        ASSERT_EQ(get(t, "snapshot-new", value)._val, RC_TRUE);
+        EXPECT_EQ(value, "v1");
+        EXPECT_FALSE(db_->Commit(t).IsAbort());
+    });
+}
@@ -0,0 +1,137 @@
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "../engine_test_base.h"
+
+// Read and write sets that spill out of the transaction. Benchmarks take key
+// buffers from the transaction's arena and give them back with
+// return_space() right after the index call that read or wrote the record;
+// whatever the sets grew into during that call must survive the next key.
+
+static const uint32_t kKeySize = 32;
+
+// Take a key buffer from [arena], run [fn] and give the buffer back, then let
+// the next key overwrite it, as the benchmarks do
+template <typename Fn>
+static void withKey(ermia::str_arena &arena, Fn fn) {
+    arena.next(kKeySize);
+    fn();
+    arena.return_space(kKeySize);
+    ermia::varstr *next = arena.next(kKeySize);
+    memset(next->data(), 0xff, kKeySize);
+    arena.return_space(kKeySize);
+}
+
+static ermia::dbtuple *fakeTuple(uint32_t i) {
+    return (ermia::dbtuple *)(uintptr_t)((i + 1) * 64);
+}
+
+TEST(ReadSet, GrowsBetweenStrAndReturnSpace) {
+    ermia::config::read_set_dedup = true;
+    ermia::str_arena arena(ermia::config::arena_size_mb);
+    ermia::read_set_t read_set;
+    const uint32_t kTuples = 3000;
+    for (uint32_t i = 0; i < kTuples; ++i) {
+        withKey(arena, [&]() { read_set.emplace_back(fakeTuple(i)); });
+    }
+    ASSERT_EQ(read_set.size(), kTuples);
+    for (uint32_t i = 0; i < kTuples; ++i) {
+        ASSERT_EQ(read_set[i], fakeTuple(i));
+    }
+
+    // The dedup filter must still know all of them
+    for (uint32_t i = 0; i < kTuples; ++i) {
+        withKey(arena, [&]() { read_set.emplace_back(fakeTuple(i)); });
+    }
+    EXPECT_EQ(read_set.size(), kTuples);
+    read_set.release();
+}
+
+TEST(WriteSet, GrowsBetweenStrAndReturnSpace) {
+    ermia::str_arena arena(ermia::config::arena_size_mb);
+    ermia::write_set_t write_set;
+    const uint32_t kEntries = 3000;
+    for (uint32_t i = 0; i < kEntries; ++i) {
+        withKey(arena, [&]() { write_set.emplace_back((ermia::fat_ptr *)fakeTuple(i)); });
+    }
+    ASSERT_EQ(write_set.size(), kEntries);
+    for (uint32_t i = 0; i < kEntries; ++i) {
+        ASSERT_EQ(write_set[i].entry, (ermia::fat_ptr *)fakeTuple(i));
+    }
+    write_set.release();
+}
+
+// The same through transactions: SSN validates the read set at commit
+class SpilledSets : public EngineTestBase {
+   protected:
+    virtual void SetUp() override {
+        EngineTestBase::SetUp();
+        index_ = table();
+    }
+
+    static ermia::OrderedIndex *table() {
+        static ermia::OrderedIndex *index = createTable("SPILL_TABLE", []() {
+            engine()->CreateMasstreePrimaryIndex("SPILL_TABLE", std::string("SPILL_TABLE"));
+        });
+        return index;
+    }
+
+    static std::string key(uint32_t i) {
+        std::string k = "spill-" + std::to_string(i);
+        k.resize(kKeySize, ' ');
+        return k;
+    }
+
+    // A key buffer from the arena, for the caller to give back
+    ermia::varstr &keyBuffer(uint32_t i) {
+        ermia::varstr *k = arena_->next(kKeySize);
+        memcpy(k->data(), key(i).data(), kKeySize);
+        return *k;
+    }
+
+    ermia::OrderedIndex *index_;
+};
+
+TEST_F(SpilledSets, ReadWriteAcrossReturnSpace) {
+    const uint32_t kRecords = 600;
+    runOnThread([&]() {
+        ermia::transaction *t = begin();
+        for (uint32_t i = 0; i < kRecords; ++i) {
+            ASSERT_EQ(index_->InsertRecord(t, str(t, key(i)), str(t, "v1"))._val, RC_TRUE);
+        }
+        ASSERT_FALSE(db_->Commit(t).IsAbort());
+
+        // Read them all in a read-write transaction, freeing each key right
+        // after the read, then update every other one the same way
+        t = begin();
+        for (uint32_t i = 0; i < kRecords; ++i) {
+            ermia::varstr v;
+            rc_t rc = rc_t{RC_INVALID};
+            index_->GetRecord(t, rc, keyBuffer(i), v);
+            ASSERT_EQ(rc._val, RC_TRUE);
+            arena_->return_space(kKeySize);
+        }
+        for (uint32_t i = 0; i < kRecords; i += 2) {
+            ermia::varstr &k = keyBuffer(i);
+            ermia::varstr *v = arena_->next(2);
+            memcpy(v->data(), "v2", 2);
+            ASSERT_EQ(index_->UpdateRecord(t, k, *v)._val, RC_TRUE);
+            arena_->return_space(2);
+            arena_->return_space(kKeySize);
+        }
+        ASSERT_FALSE(db_->Commit(t).IsAbort());
+
+        t = begin(ermia::transaction::TXN_FLAG_READ_ONLY);
+        for (uint32_t i = 0; i < kRecords; ++i) {
+            ermia::varstr v;
+            rc_t rc = rc_t{RC_INVALID};
+            index_->GetRecord(t, rc, str(t, key(i)), v);
+            ASSERT_EQ(rc._val, RC_TRUE);
+            EXPECT_EQ(toString(v), i % 2 ? "v1" : "v2");
+        }
+        EXPECT_FALSE(db_->Commit(t).IsAbort());
+    });
+}
@@ -47,6 +47,8 @@ struct dbtuple {
                 // and must abort.
 #endif
   uint32_t size;   // actual size of record
+  uint16_t delta_depth;  // deltas down to the nearest full version, 0 if full
+  uint16_t delta_size;   // bytes of delta encoding in value_start (sm-delta.h)
   varstr *pvalue;  // points to the value that will be put into value_start if
                    // committed
                    // so that read-my-own-update can copy from here.
@@ -63,6 +65,8 @@ struct dbtuple {
         s2(0),
 #endif
         size(CheckBounds(size)),
+        delta_depth(0),
+        delta_size(0),
         pvalue(NULL) {
   }
 
@@ -166,6 +170,7 @@ struct dbtuple {
   // safe for the updating transaction itself to read its own write.
   inline rc_t DoRead(varstr *out_v, bool stable) const {
     if (stable) {
+      ASSERT(!delta_depth);  // must be materialized, see DoTupleRead
       out_v->p = get_value_start();
     } else {
       if (!pvalue) {  // so I just deleted this tuple... return empty?
@@ -179,9 +184,10 @@ struct dbtuple {
     return size > 0 ? rc_t{RC_TRUE} : rc_t{RC_FALSE};
   }
 
-  // move data from the user's varstr pvalue to this tuple
+  // move data from the user's varstr pvalue to this tuple; a delta version
+  // already got its encoding when created
   inline void DoWrite() const {
-    if (pvalue) {
+    if (pvalue && !delta_depth) {
       ASSERT(pvalue->size() == size);
       memcpy((void *)get_value_start(), pvalue->data(), pvalue->size());
     }
@@ -1,6 +1,8 @@
 #include "macros.h"
 #include "txn.h"
 #include "dbcore/rcu.h"
+#include "dbcore/sm-delta.h"
+#include "dbcore/sm-evict.h"
 #include "dbcore/sm-rep.h"
 #include "dbcore/serial.h"
 #include "ermia.h"
@@ -9,8 +11,54 @@ extern thread_local ermia::epoch_num coroutine_batch_end_epoch;
 
 namespace ermia {
 
+thread_local void *spill_pool::free_lists[spill_pool::kSizeClasses];
+
+// Turn TXN_FLAG_FAST_READ_ONLY into a normal read-only transaction where the
+// fast path can't be used
+static inline uint64_t adjust_txn_flags(uint64_t flags) {
+  if (!(flags & transaction::TXN_FLAG_FAST_READ_ONLY)) {
+    return flags;
+  }
+  ALWAYS_ASSERT(!(flags & transaction::TXN_FLAG_CMD_REDO));
+  flags |= transaction::TXN_FLAG_READ_ONLY;
+#if defined(MVOCC)
+  flags &= ~uint64_t{transaction::TXN_FLAG_FAST_READ_ONLY};
+#elif defined(SSN) || defined(SSI)
+  // Only a safe snapshot lets readers go untracked
+  if (!config::enable_safesnap && !config::is_backup_srv()) {
+    flags &= ~uint64_t{transaction::TXN_FLAG_FAST_READ_ONLY};
+  }
+#endif
+  return flags;
+}
+
 transaction::transaction(uint64_t flags, str_arena &sa, uint32_t coro_batch_idx)
-    : flags(flags), sa(&sa), coro_batch_idx(coro_batch_idx) {
+    : flags(adjust_txn_flags(flags)), sa(&sa), coro_batch_idx(coro_batch_idx) {
+  if (is_fast_read_only()) {
+    // Just a snapshot: no XID, context, log or write set
+    xid = INVALID_XID;
+    xc = &ro_xc;
+    ro_xc.owner = INVALID_XID;
+    ro_xc.end = 0;
+    ro_xc.xct = this;
+    ro_xc.state = TXN::TXN_ACTIVE;
+    log = nullptr;
+    if (config::is_backup_srv()) {
+      ro_xc.begin_epoch = 0;
+      ro_xc.begin = rep::GetReadView();
+      return;
+    }
+    ro_xc.begin_epoch =
+        (config::tls_alloc && !(this->flags & TXN_FLAG_CSWITCH)) ? MM::epoch_enter() : 0;
+#if defined(SSN) || defined(SSI)
+    ASSERT(MM::safesnap_lsn);
+    ro_xc.begin = volatile_read(MM::safesnap_lsn);
+#else
+    ro_xc.begin = logmgr->cur_lsn().offset() + 1;
+#endif
+    return;
+  }
+
   if (!(flags & TXN_FLAG_CMD_REDO) && config::is_backup_srv()) {
     // Read-only transaction on backup - grab a begin timestamp and go.
     // A read-only 'transaction' on a backup basically is reading a
@@ -96,9 +144,26 @@ transaction::~transaction() {
     return;
   }
 
+  if (is_fast_read_only()) {
+    if (config::tls_alloc) {
+      if (flags & TXN_FLAG_CSWITCH) {
+        if (xc->end > coroutine_batch_end_epoch) {
+          coroutine_batch_end_epoch = xc->end;
+        }
+      } else {
+        MM::epoch_exit(0, xc->begin_epoch);
+      }
+    }
+    return;
+  }
+
   // transaction shouldn't fall out of scope w/o resolution
   // resolution means TXN_CMMTD, and TXN_ABRTD
   ASSERT(state() != TXN::TXN_ACTIVE && state() != TXN::TXN_COMMITTING);
+  write_set.release();
+#if defined(SSN) || defined(SSI) || defined(MVOCC)
+  read_set.release();
+#endif
 #if defined(SSN) || defined(SSI)
   if (!config::enable_safesnap || (!(flags & TXN_FLAG_READ_ONLY))) {
     TXN::serial_deregister_tx(coro_batch_idx, xid);
@@ -128,6 +193,7 @@ void transaction::Abort() {
   // Go over the read set first, to deregister from the tuple
   // asap so the updater won't wait for too long.
   for (uint32_t i = 0; i < read_set.size(); ++i) {
+    read_set.prefetch_ahead(i);
     auto &r = read_set[i];
     ASSERT(r->GetObject()->GetClsn().asi_type() == fat_ptr::ASI_LOG);
     // remove myself from reader list
@@ -165,6 +231,11 @@ void transaction::Abort() {
 
 rc_t transaction::commit() {
   ALWAYS_ASSERT(state() == TXN::TXN_ACTIVE);
+  if (is_fast_read_only()) {
+    xc->end = xc->begin;
+    volatile_write(xc->state, TXN::TXN_CMMTD);
+    return rc_t{RC_TRUE};
+  }
   volatile_write(xc->state, TXN::TXN_COMMITTING);
 #if defined(SSN) || defined(SSI)
   // Safe snapshot optimization for read-only transactions:
@@ -231,6 +302,7 @@ rc_t transaction::parallel_ssn_commit() {
   // Process reads first for a stable sstamp to be used for the
   // read-optimization
   for (uint32_t i = 0; i < read_set.size(); ++i) {
+    read_set.prefetch_ahead(i);
     auto &r = read_set[i];
   try_get_successor:
     ASSERT(r->GetObject()->GetClsn().asi_type() == fat_ptr::ASI_LOG);
@@ -608,6 +680,7 @@ rc_t transaction::parallel_ssn_commit() {
   // Without 1, the updater might see a larger-than-it-should
   // xstamp and use it as its pstamp -> more unnecessary aborts
   for (uint32_t i = 0; i < read_set.size(); ++i) {
+    read_set.prefetch_ahead(i);
     auto &r = read_set[i];
     ASSERT(r->GetObject()->GetClsn().asi_type() == fat_ptr::ASI_LOG);
 
@@ -710,6 +783,7 @@ rc_t transaction::parallel_ssi_commit() {
   uint64_t ct3 = xc->ct3;  // this will be the s2 of versions I clobbered
 
   for (uint32_t i = 0; i < read_set.size(); ++i) {
+    read_set.prefetch_ahead(i);
     auto &r = read_set[i];
   get_overwriter:
     fat_ptr overwriter_clsn = volatile_read(r->sstamp);
@@ -943,6 +1017,7 @@ rc_t transaction::parallel_ssi_commit() {
   // on when to deregister_reader_tx, not when to transitioning to the
   // "committed" state.
   for (uint32_t i = 0; i < read_set.size(); ++i) {
+    read_set.prefetch_ahead(i);
     auto &r = read_set[i];
     // Update xstamps in read versions, this should happen before
     // deregistering from the bitmap, so when the updater found a
@@ -1003,6 +1078,7 @@ rc_t transaction::mvocc_commit() {
 
   // Just need to check read-set
   for (uint32_t i = 0; i < read_set.size(); ++i) {
+    read_set.prefetch_ahead(i);
     auto &r = read_set[i];
   check_backedge:
     fat_ptr successor_clsn = volatile_read(r->sstamp);
@@ -1161,6 +1237,8 @@ bool transaction::MasstreeCheckPhantom() {
 }
 
 rc_t transaction::Update(TableDescriptor *td, OID oid, const varstr *k, varstr *v) {
+  // No XID to stamp the new version with
+  ALWAYS_ASSERT(!is_fast_read_only());
   oid_array *tuple_array = td->GetTupleArray();
   FID tuple_fid = td->GetTupleFid();
 
@@ -1171,6 +1249,10 @@ rc_t transaction::Update(TableDescriptor *td, OID oid, const varstr *k, varstr *
   Object *prev_obj = (Object *)prev_obj_ptr.offset();
 
   if (prev_obj) {  // succeeded
+    // The cached version (if any) is no longer the newest one
+    if (td->GetVersionCache()) {
+      td->GetVersionCache()->Invalidate(oid);
+    }
     dbtuple *tuple = ((Object *)new_obj_ptr.offset())->GetPinnedTuple();
     ASSERT(tuple);
     dbtuple *prev = prev_obj->GetPinnedTuple();
@@ -1313,15 +1395,15 @@ rc_t transaction::Update(TableDescriptor *td, OID oid, const varstr *k, varstr *
       log->log_update(tuple_fid, oid, fat_ptr::make((void *)v, size_code),
                         DEFAULT_ALIGNMENT_BITS,
                         tuple->GetObject()->GetPersistentAddressPtr());
+    }
 
-      if (config::log_key_for_update) {
-        ALWAYS_ASSERT(k);
-        auto key_size = align_up(k->size() + sizeof(varstr));
-        auto key_size_code = encode_size_aligned(key_size);
-        log->log_update_key(tuple_fid, oid,
-                              fat_ptr::make((void *)k, key_size_code),
-                              DEFAULT_ALIGNMENT_BITS);
-      }
+    if (!is_delete && config::log_key_for_update) {
+      ALWAYS_ASSERT(k);
+      auto key_size = align_up(k->size() + sizeof(varstr));
+      auto key_size_code = encode_size_aligned(key_size);
+      log->log_update_key(tuple_fid, oid,
+                            fat_ptr::make((void *)k, key_size_code),
+                            DEFAULT_ALIGNMENT_BITS);
     }
     return rc_t{RC_TRUE};
   } else {  // somebody else acted faster than we did
@@ -1330,6 +1412,7 @@ rc_t transaction::Update(TableDescriptor *td, OID oid, const varstr *k, varstr *
 }
 
 OID transaction::Insert(TableDescriptor *td, varstr *value, dbtuple **out_tuple) {
+  ALWAYS_ASSERT(!is_fast_read_only());
   auto *tuple_array = td->GetTupleArray();
   FID tuple_fid = td->GetTupleFid();
 
@@ -1409,6 +1492,19 @@ rc_t transaction::DoTupleRead(dbtuple *tuple, varstr *out_v) {
 #endif
 
   // do the actual tuple read
+  Object *obj = tuple->GetObject();
+  evict::Touch(obj);
+  if (!read_my_own && obj->IsEvicted()) {
+    evict::Load(obj, string_allocator(), out_v);
+    return rc_t{RC_TRUE};
+  }
+  if (!read_my_own && tuple->delta_depth) {
+    varstr *v = string_allocator().next(tuple->size);
+    delta_materialize(tuple, v->data());
+    out_v->p = v->data();
+    out_v->l = tuple->size;
+    return rc_t{RC_TRUE};
+  }
   return tuple->DoRead(out_v, !read_my_own);
 }
 
@@ -32,33 +32,227 @@ struct write_record_t {
   inline Object *get_object() { return (Object *)entry->offset(); }
 };
 
+// Spill arrays of the read and write sets. These don't come from the
+// transaction's str_arena: callers take key buffers from the same arena and
+// give them back with return_space() right after an index call, which would
+// hand out the end of an array that grew during the call again. Arrays are
+// kept on a per-thread free list for each (power of two) size and reused by
+// the thread's later transactions.
+struct spill_pool {
+  static const uint32_t kSizeClasses = 64;
+  static thread_local void *free_lists[kSizeClasses];
+
+  static inline void *get(size_t bytes) {
+    ASSERT(bytes && !(bytes & (bytes - 1)));
+    void *&head = free_lists[__builtin_ctzll(bytes)];
+    void *p = head;
+    if (p) {
+      head = *(void **)p;
+      return p;
+    }
+    p = malloc(bytes);
+    ALWAYS_ASSERT(p);
+    return p;
+  }
+
+  static inline void put(void *p, size_t bytes) {
+    ASSERT(bytes && !(bytes & (bytes - 1)));
+    void *&head = free_lists[__builtin_ctzll(bytes)];
+    *(void **)p = head;
+    head = p;
+  }
+};
+
+// The first kInlineEntries records live in the transaction itself, which
+// covers most transactions. Beyond that, records spill into an array from the
+// spill_pool; a full spill array is replaced by one twice the size.
 struct write_set_t {
-  static const uint32_t kMaxEntries = 256;
+  static const uint32_t kInlineEntries = 64;
+  static const uint32_t kMinSpillEntries = 256;
   uint32_t num_entries;
-  write_record_t entries[kMaxEntries];
-  write_set_t() : num_entries(0) {}
+  uint32_t spill_capacity;
+  write_record_t *spill;
+  write_record_t entries[kInlineEntries];
+  write_set_t() : num_entries(0), spill_capacity(0), spill(nullptr) {}
   inline void emplace_back(fat_ptr *oe) {
-    ALWAYS_ASSERT(num_entries < kMaxEntries);
-    new (&entries[num_entries]) write_record_t(oe);
+    if (likely(num_entries < kInlineEntries)) {
+      new (&entries[num_entries]) write_record_t(oe);
+    } else {
+      if (unlikely(num_entries - kInlineEntries == spill_capacity)) {
+        grow();
+      }
+      new (&spill[num_entries - kInlineEntries]) write_record_t(oe);
+    }
     ++num_entries;
-    ASSERT(entries[num_entries - 1].entry == oe);
+    ASSERT((*this)[num_entries - 1].entry == oe);
   }
   inline uint32_t size() { return num_entries; }
-  inline void clear() { num_entries = 0; }
-  inline write_record_t &operator[](uint32_t idx) { return entries[idx]; }
+  inline void clear() {
+    num_entries = 0;
+    spill_capacity = 0;
+    spill = nullptr;
+  }
+  // Give the spill array back; the transaction is done with the set
+  inline void release() {
+    if (spill) {
+      spill_pool::put(spill, spill_capacity * sizeof(write_record_t));
+    }
+    clear();
+  }
+  inline write_record_t &operator[](uint32_t idx) {
+    return likely(idx < kInlineEntries) ? entries[idx] : spill[idx - kInlineEntries];
+  }
+
+ private:
+  void grow() {
+    uint32_t capacity = spill_capacity ? spill_capacity * 2 : kMinSpillEntries;
+    write_record_t *s = (write_record_t *)spill_pool::get(capacity * sizeof(write_record_t));
+    if (spill_capacity) {
+      memcpy(s, spill, spill_capacity * sizeof(write_record_t));
+      spill_pool::put(spill, spill_capacity * sizeof(write_record_t));
+    }
+    spill = s;
+    spill_capacity = capacity;
+  }
 };
 
+#if defined(SSN) || defined(SSI) || defined(MVOCC)
+// Versions read, in the order first read. As with the write set, the first
+// kInlineEntries live in the transaction and the rest spill into an array
+// from the spill_pool. With config::read_set_dedup a version read again isn't
+// added again: small sets are searched linearly, larger ones keep an
+// open-addressing table of their versions (also from the spill_pool) that is
+// at most half full.
+struct read_set_t {
+  static const uint32_t kInlineEntries = 16;
+  static const uint32_t kMinSpillEntries = 256;
+  // Commit-time loops prefetch versions this many at a time, a batch ahead
+  static const uint32_t kPrefetchBatch = 8;
+
+  uint32_t num_entries;
+  uint32_t spill_capacity;
+  dbtuple **spill;
+  dbtuple **filter;
+  uint64_t filter_mask;
+  dbtuple *entries[kInlineEntries];
+
+  read_set_t() { clear(); }
+
+  inline void emplace_back(dbtuple *tuple) {
+    if (config::read_set_dedup && !insert_unique(tuple)) {
+      return;
+    }
+    if (likely(num_entries < kInlineEntries)) {
+      entries[num_entries] = tuple;
+    } else {
+      if (unlikely(num_entries - kInlineEntries == spill_capacity)) {
+        grow();
+      }
+      spill[num_entries - kInlineEntries] = tuple;
+    }
+    ++num_entries;
+  }
+  inline uint32_t size() { return num_entries; }
+  inline void clear() {
+    num_entries = spill_capacity = 0;
+    spill = filter = nullptr;
+    filter_mask = 0;
+  }
+  // Give the spill array and filter back; the transaction is done with the set
+  inline void release() {
+    if (spill) {
+      spill_pool::put(spill, spill_capacity * sizeof(dbtuple *));
+    }
+    if (filter) {
+      spill_pool::put(filter, (filter_mask + 1) * sizeof(dbtuple *));
+    }
+    clear();
+  }
+  inline dbtuple *&operator[](uint32_t idx) {
+    return likely(idx < kInlineEntries) ? entries[idx] : spill[idx - kInlineEntries];
+  }
+  // Call for each [idx] in order before looking at (*this)[idx]: at the start
+  // of a batch, prefetches the next batch (and at 0, the first one too)
+  inline void prefetch_ahead(uint32_t idx) {
+    if (idx % kPrefetchBatch) {
+      return;
+    }
+    uint32_t begin = idx ? idx + kPrefetchBatch : 0;
+    uint32_t end = std::min(num_entries, idx + 2 * kPrefetchBatch);
+    for (uint32_t i = begin; i < end; ++i) {
+      ::prefetch((const char *)(*this)[i]);
+    }
+  }
+
+ private:
+  void grow() {
+    uint32_t capacity = spill_capacity ? spill_capacity * 2 : kMinSpillEntries;
+    dbtuple **s = (dbtuple **)spill_pool::get(capacity * sizeof(dbtuple *));
+    if (spill_capacity) {
+      memcpy(s, spill, spill_capacity * sizeof(dbtuple *));
+      spill_pool::put(spill, spill_capacity * sizeof(dbtuple *));
+    }
+    spill = s;
+    spill_capacity = capacity;
+  }
+
+  static inline uint64_t hash(dbtuple *tuple) {
+    return ((uint64_t)tuple * 0x9e3779b97f4a7c15ull) >> 32;
+  }
+
+  // Returns false if [tuple] is in the table already
+  inline bool filter_insert(dbtuple *tuple) {
+    for (uint64_t i = hash(tuple) & filter_mask;; i = (i + 1) & filter_mask) {
+      if (filter[i] == tuple) {
+        return false;
+      }
+      if (!filter[i]) {
+        filter[i] = tuple;
+        return true;
+      }
+    }
+  }
+
+  void build_filter(uint64_t slots) {
+    if (filter) {
+      spill_pool::put(filter, (filter_mask + 1) * sizeof(dbtuple *));
+    }
+    filter = (dbtuple **)spill_pool::get(slots * sizeof(dbtuple *));
+    memset(filter, 0, slots * sizeof(dbtuple *));
+    filter_mask = slots - 1;
+    for (uint32_t i = 0; i < num_entries; ++i) {
+      filter_insert((*this)[i]);
+    }
+  }
+
+  // Returns false if [tuple] is in the set already
+  inline bool insert_unique(dbtuple *tuple) {
+    if (!filter) {
+      for (uint32_t i = 0; i < num_entries; ++i) {
+        if (entries[i] == tuple) {
+          return false;
+        }
+      }
+      if (num_entries < kInlineEntries) {
+        return true;
+      }
+      build_filter(4 * kInlineEntries);
+    } else if ((num_entries + 1) * 2 > filter_mask + 1) {
+      build_filter(2 * (filter_mask + 1));
+    }
+    return filter_insert(tuple);
+  }
+};
+#endif
+
 class transaction {
   friend class ConcurrentMasstreeIndex;
+  friend class ConcurrentHashIndex;
   friend struct sm_oid_mgr;
 
 public:
   typedef TXN::txn_state txn_state;
 
-#if defined(SSN) || defined(SSI) || defined(MVOCC)
-  typedef std::vector<dbtuple *> read_set_t;
-#endif
-
   enum {
     // use the low-level scan protocol for checking scan consistency,
     // instead of keeping track of absent ranges
@@ -76,10 +270,27 @@ public:
 
     // A context-switch transaction doesn't enter/exit thread during construct/destruct.
     TXN_FLAG_CSWITCH = 0x8,
+
+    // A read-only transaction that only takes a snapshot: no XID, context,
+    // log or CC bookkeeping, commit is an epoch exit. Implies
+    // TXN_FLAG_READ_ONLY. Falls back to a normal read-only transaction
+    // where the CC scheme must track readers (MVOCC, and SSN/SSI without
+    // safesnap).
+    TXN_FLAG_FAST_READ_ONLY = 0x10,
   };
 
   inline bool is_read_mostly() { return flags & TXN_FLAG_READ_MOSTLY; }
   inline bool is_read_only() { return flags & TXN_FLAG_READ_ONLY; }
+  inline bool is_fast_read_only() { return flags & TXN_FLAG_FAST_READ_ONLY; }
+
+  // The log commit() will take a commit block from, or nullptr if it won't
+  // write one (read-only, or a backup that doesn't replay commands)
+  inline sm_tx_log *commit_log() {
+    if (config::is_backup_srv() && !(flags & TXN_FLAG_CMD_REDO)) {
+      return nullptr;
+    }
+    return (flags & TXN_FLAG_READ_ONLY) ? nullptr : log;
+  }
 
 protected:
   inline txn_state state() const { return xc->state; }
@@ -152,6 +363,8 @@ protected:
   const uint64_t flags;
   XID xid;
   TXN::xid_context *xc;
+  // Context of a fast read-only transaction, which doesn't get one from TXN
+  TXN::xid_context ro_xc;
   sm_tx_log *log;
   str_arena *sa;
   uint32_t coro_batch_idx; // its index in the batch
@@ -298,6 +298,7 @@ class timer {
  public:
   timer() { lap(); }
   timer(const timer &t) : start(t.start) {};
+  explicit timer(uint64_t start_usec) : start(start_usec) {}
 
   inline uint64_t lap() {
     uint64_t t0 = start;